@@ -0,0 +1,112 @@
+"""Benchmark of hpwhsim against the CSV round trip it replaces: a number of tanks run through a
+test of test/, once by running testTool for each tank and parsing the CSV it writes, and once by
+stepping a fleet over arrays, in one call and from Python threads stepping disjoint groups.
+Reports tank steps per second for each.
+
+Run from test/ with the built module on PYTHONPATH.
+
+Usage: python3 benchHpwhsim.py [testTool path] [tanks (optional)] [test (optional)] [threads (optional)]
+"""
+
+import array
+import csv
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+import hpwhsim
+from testSchedules import read_test
+
+MODEL = "AOSmithHPTU80"
+
+
+def csv_round_trip(test_tool, tanks, test):
+    """testTool for each tank, its heat source energies and thermocouples parsed from its CSV."""
+    output = tempfile.mkdtemp()
+    try:
+        results = []
+        for _ in range(tanks):
+            subprocess.run([test_tool, "Preset", MODEL, test, output], check=True, stdout=subprocess.DEVNULL)
+            with open(os.path.join(output, f"{test}_Preset_{MODEL}.csv")) as f:
+                rows = list(csv.reader(f))[1:]
+            results.append([[float(x) for x in row[6:]] for row in rows])
+        return results
+    finally:
+        shutil.rmtree(output)
+
+
+def fleet_inputs(info):
+    return (array.array("d", info["inletT"]), array.array("d", info["drawL"]), array.array("d", info["ambientT"]),
+            array.array("d", info["evaporatorT"]), array.array("i", [int(dr) for dr in info["DR"]]))
+
+
+def fleet_step(tanks, info, threads):
+    """A fleet of tanks stepped by threads threads, each over its group of tanks, writing heat
+    source energies and thermocouples in place."""
+    fleet = hpwhsim.Fleet()
+    fleet.add_preset(MODEL, tanks)
+    fleet.set_setpoint(0, tanks, info["setpoint"])
+    fleet.reset_to_setpoint(0, tanks)
+    steps = info["minutes"]
+    inputs = fleet_inputs(info)
+    heat_in = array.array("d", bytes(8 * tanks * steps * hpwhsim.HEAT_SOURCES))
+    heat_out = array.array("d", bytes(8 * tanks * steps * hpwhsim.HEAT_SOURCES))
+    tcouples = array.array("d", bytes(8 * tanks * steps * hpwhsim.TCOUPLES))
+
+    def step(first, count):
+        begin, end = first * steps, (first + count) * steps
+        fleet.step(first, count, steps, *inputs,
+                   heat_source_input_kWh=memoryview(heat_in)[begin * hpwhsim.HEAT_SOURCES:end * hpwhsim.HEAT_SOURCES],
+                   heat_source_output_kWh=memoryview(heat_out)[begin * hpwhsim.HEAT_SOURCES:end * hpwhsim.HEAT_SOURCES],
+                   tcouples_C=memoryview(tcouples)[begin * hpwhsim.TCOUPLES:end * hpwhsim.TCOUPLES])
+
+    groups = [(t * tanks // threads, (t + 1) * tanks // threads - t * tanks // threads) for t in range(threads)]
+    workers = [threading.Thread(target=step, args=group) for group in groups]
+    for worker in workers:
+        worker.start()
+    for worker in workers:
+        worker.join()
+    return heat_in, heat_out, tcouples
+
+
+def main():
+    if len(sys.argv) < 2:
+        print(__doc__.splitlines()[-2])
+        sys.exit(1)
+    test_tool = sys.argv[1]
+    tanks = int(sys.argv[2]) if len(sys.argv) > 2 else 20
+    test = sys.argv[3] if len(sys.argv) > 3 else "testDOE_24hr50"
+    threads = int(sys.argv[4]) if len(sys.argv) > 4 else os.cpu_count()
+    info = read_test(test)
+    tank_steps = tanks * info["minutes"]
+
+    print("method,tanks,steps,threads,seconds,tankStepsPerSecond")
+    start = time.perf_counter()
+    rows = csv_round_trip(test_tool, tanks, test)[0]
+    seconds = time.perf_counter() - start
+    print(f"csvRoundTrip,{tanks},{info['minutes']},1,{seconds:.3f},{tank_steps / seconds:.0f}")
+
+    for n in sorted({1, threads}):
+        start = time.perf_counter()
+        heat_in, heat_out, tcouples = fleet_step(tanks, info, n)
+        seconds = time.perf_counter() - start
+        print(f"fleetStep,{tanks},{info['minutes']},{n},{seconds:.3f},{tank_steps / seconds:.0f}")
+
+    # the first tank as testTool writes it, to check both ran the same simulation
+    sources = (len(rows[0]) - hpwhsim.TCOUPLES) // 2
+    for s, row in enumerate(rows):
+        fields = []
+        for j in range(sources):
+            fields += [heat_in[s * hpwhsim.HEAT_SOURCES + j] * 1000., heat_out[s * hpwhsim.HEAT_SOURCES + j] * 1000.]
+        fields += tcouples[s * hpwhsim.TCOUPLES:(s + 1) * hpwhsim.TCOUPLES]
+        if [round(x, 2) for x in fields] != row:
+            print(f"The fleet differs from testTool on minute {s}")
+            sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,430 @@
+/*hpwhsim, Python bindings for HPWHsim over its C interface.  A Fleet holds tanks that step
+ * many at a time over arrays with the buffer protocol, NumPy arrays or array.array, read and
+ * written in place.  The GIL is released while tanks step, so Python threads may step disjoint
+ * groups of tanks of one fleet at the same time.
+ */
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "HPWHcapi.h"
+
+#include <new>
+#include <vector>
+
+static PyObject *hpwhsimError = NULL;
+
+typedef struct {
+	PyObject_HEAD
+	HPWHFleet *fleet;
+	std::vector<char> *busy;	/**< per tank, set while a step on it runs without the GIL */
+	int stepping;				/**< steps running without the GIL */
+} FleetObject;
+
+/** a buffer of doubles or ints held for the length of a call */
+class Buffer {
+public:
+	Buffer() : held(false) {}
+	~Buffer() {
+		if (held) {
+			PyBuffer_Release(&view);
+		}
+	}
+
+	/** gets the buffer of obj, which must be C contiguous with items of type 'd' or 'i', returning
+	    false with a Python exception set if it is not.  None leaves an optional buffer unheld  */
+	bool get(PyObject *obj, const char *name, char type, bool writable, bool optional) {
+		if (obj == NULL || obj == Py_None) {
+			if (optional) {
+				return true;
+			}
+			PyErr_Format(PyExc_TypeError, "%s is required", name);
+			return false;
+		}
+		int flags = PyBUF_C_CONTIGUOUS | PyBUF_FORMAT | (writable ? PyBUF_WRITABLE : 0);
+		if (PyObject_GetBuffer(obj, &view, flags) != 0) {
+			return false;
+		}
+		held = true;
+		if (!hasType(type)) {
+			PyErr_Format(PyExc_TypeError, "%s must hold %s", name, (type == 'd') ? "float64" : "int32");
+			return false;
+		}
+		return true;
+	}
+
+	Py_ssize_t size() const {
+		return held ? view.len / view.itemsize : 0;
+	}
+
+	template <typename T>
+	T *data() const {
+		return held ? static_cast<T *>(view.buf) : NULL;
+	}
+
+	bool held;
+	Py_buffer view;
+
+private:
+	bool hasType(char type) const {
+		const char *format = (view.format == NULL) ? "B" : view.format;
+		if (*format == '@' || *format == '=' || (PY_LITTLE_ENDIAN && *format == '<') || (!PY_LITTLE_ENDIAN && *format == '>')) {
+			format++;
+		}
+		if (format[0] == '\0' || format[1] != '\0') {
+			return false;
+		}
+		if (type == 'd') {
+			return format[0] == 'd' && view.itemsize == sizeof(double);
+		}
+		return (format[0] == 'i' || format[0] == 'l') && view.itemsize == sizeof(int);
+	}
+};
+
+static PyObject *fleetError(const FleetObject *self) {
+	PyErr_SetString(hpwhsimError, hpwh_fleet_error(self->fleet));
+	return NULL;
+}
+
+/** checks that tanks first to first + count - 1 exist  */
+static bool checkRange(const FleetObject *self, int first, int count) {
+	if (first < 0 || count < 0 || first > hpwh_fleet_size(self->fleet) - count) {
+		PyErr_Format(PyExc_IndexError, "There are no tanks %d to %d", first, first + count - 1);
+		return false;
+	}
+	return true;
+}
+
+/** checks that tanks first to first + count - 1 exist and none of them is being stepped  */
+static bool checkTanks(const FleetObject *self, int first, int count) {
+	if (!checkRange(self, first, count)) {
+		return false;
+	}
+	for (int t = first; t < first + count; t++) {
+		if ((*self->busy)[t]) {
+			PyErr_Format(hpwhsimError, "Tank %d is being stepped by another thread", t);
+			return false;
+		}
+	}
+	return true;
+}
+
+static PyObject *Fleet_new(PyTypeObject *type, PyObject *, PyObject *) {
+	FleetObject *self = (FleetObject *)type->tp_alloc(type, 0);
+	if (self == NULL) {
+		return NULL;
+	}
+	self->fleet = hpwh_fleet_create();
+	self->busy = new (std::nothrow) std::vector<char>();
+	self->stepping = 0;
+	if (self->fleet == NULL || self->busy == NULL) {
+		Py_DECREF(self);
+		return PyErr_NoMemory();
+	}
+	return (PyObject *)self;
+}
+
+static void Fleet_dealloc(FleetObject *self) {
+	hpwh_fleet_destroy(self->fleet);
+	delete self->busy;
+	Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static Py_ssize_t Fleet_len(FleetObject *self) {
+	return hpwh_fleet_size(self->fleet);
+}
+
+static PyObject *addTanks(FleetObject *self, PyObject *args, PyObject *kwds, bool fromFile) {
+	static const char *keywords[] = { "name", "count", NULL };
+	const char *name;
+	int count = 1;
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "s|i", (char **)keywords, &name, &count)) {
+		return NULL;
+	}
+	if (self->stepping > 0) {
+		PyErr_SetString(hpwhsimError, "Tanks cannot be added while the fleet is being stepped");
+		return NULL;
+	}
+	int first;
+	if ((fromFile ? hpwh_fleet_add_file(self->fleet, name, count, &first) :
+			hpwh_fleet_add_preset(self->fleet, name, count, &first)) != 0) {
+		return fleetError(self);
+	}
+	self->busy->resize(hpwh_fleet_size(self->fleet), 0);
+	return PyLong_FromLong(first);
+}
+
+static PyObject *Fleet_add_preset(FleetObject *self, PyObject *args, PyObject *kwds) {
+	return addTanks(self, args, kwds, false);
+}
+
+static PyObject *Fleet_add_file(FleetObject *self, PyObject *args, PyObject *kwds) {
+	return addTanks(self, args, kwds, true);
+}
+
+static PyObject *Fleet_num_nodes(FleetObject *self, PyObject *args) {
+	int tank;
+	if (!PyArg_ParseTuple(args, "i", &tank) || !checkRange(self, tank, 1)) {
+		return NULL;
+	}
+	return PyLong_FromLong(hpwh_fleet_num_nodes(self->fleet, tank));
+}
+
+static PyObject *Fleet_num_heat_sources(FleetObject *self, PyObject *args) {
+	int tank;
+	if (!PyArg_ParseTuple(args, "i", &tank) || !checkRange(self, tank, 1)) {
+		return NULL;
+	}
+	return PyLong_FromLong(hpwh_fleet_num_heat_sources(self->fleet, tank));
+}
+
+static PyObject *Fleet_set_setpoint(FleetObject *self, PyObject *args) {
+	int first, count;
+	double setpoint_C;
+	if (!PyArg_ParseTuple(args, "iid", &first, &count, &setpoint_C) || !checkTanks(self, first, count)) {
+		return NULL;
+	}
+	if (hpwh_fleet_set_setpoint(self->fleet, first, count, setpoint_C) != 0) {
+		return fleetError(self);
+	}
+	Py_RETURN_NONE;
+}
+
+static PyObject *Fleet_reset_to_setpoint(FleetObject *self, PyObject *args) {
+	int first, count;
+	if (!PyArg_ParseTuple(args, "ii", &first, &count) || !checkTanks(self, first, count)) {
+		return NULL;
+	}
+	if (hpwh_fleet_reset_to_setpoint(self->fleet, first, count) != 0) {
+		return fleetError(self);
+	}
+	Py_RETURN_NONE;
+}
+
+static PyObject *Fleet_tank_temps(FleetObject *self, PyObject *args) {
+	int first, count;
+	PyObject *outObject;
+	if (!PyArg_ParseTuple(args, "iiO", &first, &count, &outObject) || !checkTanks(self, first, count)) {
+		return NULL;
+	}
+	Buffer out;
+	if (!out.get(outObject, "out", 'd', true, false)) {
+		return NULL;
+	}
+	int numNodes = (count > 0) ? hpwh_fleet_num_nodes(self->fleet, first) : 0;
+	for (int t = first; t < first + count; t++) {
+		if (hpwh_fleet_num_nodes(self->fleet, t) != numNodes) {
+			PyErr_Format(PyExc_ValueError, "Tanks %d to %d do not all have %d nodes", first, first + count - 1, numNodes);
+			return NULL;
+		}
+	}
+	if (out.size() != (Py_ssize_t)count * numNodes) {
+		PyErr_Format(PyExc_ValueError, "out must hold %zd values, %d nodes of %d tanks", (Py_ssize_t)count * numNodes,
+			numNodes, count);
+		return NULL;
+	}
+	for (int t = 0; t < count; t++) {
+		if (hpwh_fleet_tank_temps(self->fleet, first + t, out.data<double>() + (size_t)t * numNodes, numNodes) != 0) {
+			return fleetError(self);
+		}
+	}
+	Py_RETURN_NONE;
+}
+
+/** gets an input of steps values, shared by the tanks, or count * steps values  */
+static bool getInput(Buffer &buffer, PyObject *obj, const char *name, char type, bool optional, Py_ssize_t count,
+	Py_ssize_t steps, unsigned sharedFlag, unsigned &shared) {
+	if (!buffer.get(obj, name, type, false, optional)) {
+		return false;
+	}
+	if (!buffer.held) {
+		return true;
+	}
+	if (buffer.size() == steps && count != 1) {
+		shared |= sharedFlag;
+	}
+	else if (buffer.size() != count * steps) {
+		PyErr_Format(PyExc_ValueError, "%s must hold %zd values, one a step, or %zd, a step of each tank", name,
+			steps, count * steps);
+		return false;
+	}
+	return true;
+}
+
+/** gets an output of perStep values a step of each tank  */
+static bool getOutput(Buffer &buffer, PyObject *obj, const char *name, Py_ssize_t values, Py_ssize_t perStep) {
+	if (!buffer.get(obj, name, 'd', true, true)) {
+		return false;
+	}
+	if (buffer.held && buffer.size() != values * perStep) {
+		PyErr_Format(PyExc_ValueError, "%s must hold %zd values, %zd a step of each tank", name, values * perStep, perStep);
+		return false;
+	}
+	return true;
+}
+
+static PyObject *Fleet_step(FleetObject *self, PyObject *args, PyObject *kwds) {
+	static const char *keywords[] = { "first", "count", "steps", "inlet_C", "draw_L", "ambient_C", "evaporator_C",
+		"dr", "outlet_C", "standby_losses_kWh", "environment_kWh", "heat_content_kJ", "energy_input_kWh",
+		"heat_source_input_kWh", "heat_source_output_kWh", "heat_source_run_time_min", "tcouples_C", NULL };
+	int first, count, steps;
+	PyObject *inletObject, *drawObject, *ambientObject, *evaporatorObject, *drObject = NULL;
+	PyObject *outObjects[9] = { NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL };
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "iiiOOOO|O$OOOOOOOOO", (char **)keywords, &first, &count, &steps,
+			&inletObject, &drawObject, &ambientObject, &evaporatorObject, &drObject, &outObjects[0], &outObjects[1],
+			&outObjects[2], &outObjects[3], &outObjects[4], &outObjects[5], &outObjects[6], &outObjects[7],
+			&outObjects[8])) {
+		return NULL;
+	}
+	if (steps < 0) {
+		PyErr_SetString(PyExc_ValueError, "steps must not be negative");
+		return NULL;
+	}
+	if (!checkTanks(self, first, count)) {
+		return NULL;
+	}
+
+	Buffer inlet, draw, ambient, evaporator, dr;
+	HPWHStepInputs inputs;
+	inputs.shared = 0;
+	if (!getInput(inlet, inletObject, "inlet_C", 'd', false, count, steps, HPWH_C_SHARED_INLET, inputs.shared) ||
+		!getInput(draw, drawObject, "draw_L", 'd', false, count, steps, HPWH_C_SHARED_DRAW, inputs.shared) ||
+		!getInput(ambient, ambientObject, "ambient_C", 'd', false, count, steps, HPWH_C_SHARED_AMBIENT, inputs.shared) ||
+		!getInput(evaporator, evaporatorObject, "evaporator_C", 'd', false, count, steps, HPWH_C_SHARED_EVAPORATOR,
+			inputs.shared) ||
+		!getInput(dr, drObject, "dr", 'i', true, count, steps, HPWH_C_SHARED_DR, inputs.shared)) {
+		return NULL;
+	}
+	inputs.inletT_C = inlet.data<double>();
+	inputs.drawVolume_L = draw.data<double>();
+	inputs.tankAmbientT_C = ambient.data<double>();
+	inputs.heatSourceAmbientT_C = evaporator.data<double>();
+	inputs.DRstatus = dr.data<int>();
+
+	const Py_ssize_t values = (Py_ssize_t)count * steps;
+	const Py_ssize_t perStep[9] = { 1, 1, 1, 1, 1, HPWH_C_HEAT_SOURCES, HPWH_C_HEAT_SOURCES, HPWH_C_HEAT_SOURCES,
+		HPWH_C_TCOUPLES };
+	Buffer out[9];
+	bool anyOutputs = false;
+	for (int k = 0; k < 9; k++) {
+		if (!getOutput(out[k], outObjects[k], keywords[8 + k], values, perStep[k])) {
+			return NULL;
+		}
+		anyOutputs = anyOutputs || out[k].held;
+	}
+	HPWHStepOutputs outputs = { out[0].data<double>(), out[1].data<double>(), out[2].data<double>(),
+		out[3].data<double>(), out[4].data<double>(), out[5].data<double>(), out[6].data<double>(),
+		out[7].data<double>(), out[8].data<double>() };
+
+	// the tanks are this call's until it returns, so that other threads may step others
+	for (int t = first; t < first + count; t++) {
+		(*self->busy)[t] = 1;
+	}
+	self->stepping++;
+	int result;
+	Py_BEGIN_ALLOW_THREADS
+	result = hpwh_fleet_step(self->fleet, first, count, steps, &inputs, anyOutputs ? &outputs : NULL);
+	Py_END_ALLOW_THREADS
+	self->stepping--;
+	for (int t = first; t < first + count; t++) {
+		(*self->busy)[t] = 0;
+	}
+	if (result != 0) {
+		return fleetError(self);
+	}
+	Py_RETURN_NONE;
+}
+
+static PyMethodDef Fleet_methods[] = {
+	{ "add_preset", (PyCFunction)(void (*)(void))Fleet_add_preset, METH_VARARGS | METH_KEYWORDS,
+		"add_preset(name, count=1)\n--\n\nAdds count tanks of a preset model and returns the number of the first." },
+	{ "add_file", (PyCFunction)(void (*)(void))Fleet_add_file, METH_VARARGS | METH_KEYWORDS,
+		"add_file(name, count=1)\n--\n\nAdds count tanks of a model file and returns the number of the first." },
+	{ "num_nodes", (PyCFunction)Fleet_num_nodes, METH_VARARGS,
+		"num_nodes(tank)\n--\n\nThe number of nodes of a tank." },
+	{ "num_heat_sources", (PyCFunction)Fleet_num_heat_sources, METH_VARARGS,
+		"num_heat_sources(tank)\n--\n\nThe number of heat sources of a tank." },
+	{ "set_setpoint", (PyCFunction)Fleet_set_setpoint, METH_VARARGS,
+		"set_setpoint(first, count, setpoint_C)\n--\n\nSets the setpoint of count tanks from first." },
+	{ "reset_to_setpoint", (PyCFunction)Fleet_reset_to_setpoint, METH_VARARGS,
+		"reset_to_setpoint(first, count)\n--\n\nFills count tanks from first with water at their setpoints." },
+	{ "tank_temps", (PyCFunction)Fleet_tank_temps, METH_VARARGS,
+		"tank_temps(first, count, out)\n--\n\n"
+		"Writes the node temperatures in C of count tanks from first, which must have the same number of\n"
+		"nodes, to out, a float64 buffer of count * nodes values, tank by tank from the bottom node." },
+	{ "step", (PyCFunction)(void (*)(void))Fleet_step, METH_VARARGS | METH_KEYWORDS,
+		"step(first, count, steps, inlet_C, draw_L, ambient_C, evaporator_C, dr=None, *, outlet_C=None,\n"
+		"     standby_losses_kWh=None, environment_kWh=None, heat_content_kJ=None, energy_input_kWh=None,\n"
+		"     heat_source_input_kWh=None, heat_source_output_kWh=None, heat_source_run_time_min=None,\n"
+		"     tcouples_C=None)\n--\n\n"
+		"Runs steps one minute steps of count tanks from first without the GIL.\n\n"
+		"The inputs are float64 buffers, dr an int32 one of DR_ flags, each of steps values shared by\n"
+		"the tanks or count * steps values tank by tank.  The outputs are writable float64 buffers of\n"
+		"count * steps values, HEAT_SOURCES a step for the heat source ones and TCOUPLES for\n"
+		"tcouples_C, filled in place; any left as None is not written." },
+	{ NULL, NULL, 0, NULL }
+};
+
+static PySequenceMethods Fleet_sequence = {
+	(lenfunc)Fleet_len,
+};
+
+static PyTypeObject FleetType = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	"hpwhsim.Fleet",
+};
+
+static PyObject *hpwhsim_version(PyObject *, PyObject *) {
+	return PyUnicode_FromString(hpwh_version());
+}
+
+static PyMethodDef hpwhsim_methods[] = {
+	{ "version", hpwhsim_version, METH_NOARGS, "version()\n--\n\nThe version of HPWHsim." },
+	{ NULL, NULL, 0, NULL }
+};
+
+static PyModuleDef hpwhsimModule = {
+	PyModuleDef_HEAD_INIT,
+	"hpwhsim",
+	"Python bindings for HPWHsim: fleets of heat pump water heaters stepped over buffers in place.",
+	-1,
+	hpwhsim_methods,
+};
+
+PyMODINIT_FUNC PyInit_hpwhsim(void) {
+	if (hpwh_c_api_version() != HPWH_C_API_VERSION) {
+		PyErr_SetString(PyExc_ImportError, "hpwhsim was built against another version of the HPWHsim C interface");
+		return NULL;
+	}
+	FleetType.tp_basicsize = sizeof(FleetObject);
+	FleetType.tp_flags = Py_TPFLAGS_DEFAULT;
+	FleetType.tp_doc = "Fleet()\n--\n\nA fleet of tanks, numbered from 0 in the order they were added.";
+	FleetType.tp_new = Fleet_new;
+	FleetType.tp_dealloc = (destructor)Fleet_dealloc;
+	FleetType.tp_methods = Fleet_methods;
+	FleetType.tp_as_sequence = &Fleet_sequence;
+	if (PyType_Ready(&FleetType) < 0) {
+		return NULL;
+	}
+
+	PyObject *module = PyModule_Create(&hpwhsimModule);
+	if (module == NULL) {
+		return NULL;
+	}
+	hpwhsimError = PyErr_NewException("hpwhsim.Error", PyExc_RuntimeError, NULL);
+	Py_INCREF(hpwhsimError);
+	Py_INCREF(&FleetType);
+	if (PyModule_AddObject(module, "Error", hpwhsimError) < 0 ||
+		PyModule_AddObject(module, "Fleet", (PyObject *)&FleetType) < 0 ||
+		PyModule_AddIntConstant(module, "HEAT_SOURCES", HPWH_C_HEAT_SOURCES) < 0 ||
+		PyModule_AddIntConstant(module, "TCOUPLES", HPWH_C_TCOUPLES) < 0 ||
+		// HPWH::DRMODES
+		PyModule_AddIntConstant(module, "DR_ALLOW", 0) < 0 ||
+		PyModule_AddIntConstant(module, "DR_LOC", 1) < 0 ||
+		PyModule_AddIntConstant(module, "DR_LOR", 2) < 0 ||
+		PyModule_AddIntConstant(module, "DR_TOO", 4) < 0 ||
+		PyModule_AddIntConstant(module, "DR_TOT", 8) < 0) {
+		Py_DECREF(module);
+		return NULL;
+	}
+	return module;
+}
@@ -0,0 +1,187 @@
+"""Tests of hpwhsim, the Python bindings: fleets stepped over buffers reproduce testTool's
+reference results, Python threads stepping disjoint tanks of a fleet match stepping them one
+after another, and bad buffers and overlapping steps raise.
+
+Run from test/ with the built module on PYTHONPATH."""
+
+import array
+import sys
+import threading
+
+import hpwhsim
+from testSchedules import read_test
+
+try:
+    import numpy
+except ImportError:
+    numpy = None
+
+REFERENCE_TESTS = ["test30", "test50", "test70", "test95", "testDr_LO", "testDr_TOO", "testDr_TOO2"]
+REFERENCE_MODELS = [("Preset", "AOSmithHPTU80"), ("Preset", "Rheem2020Prem50"), ("File", "AOSmithHPTU80")]
+
+failures = 0
+
+
+def check(condition, message):
+    global failures
+    if not condition:
+        print("FAILED: " + message)
+        failures += 1
+
+
+def doubles(values):
+    return array.array("d", values)
+
+
+def zeros(n):
+    return array.array("d", bytes(8 * n))
+
+
+def raises(exception, call):
+    try:
+        call()
+    except exception:
+        return True
+    return False
+
+
+def test_reference(spec, model, test):
+    """Steps one tank through a test as testTool does and compares with its reference CSV."""
+    info = read_test(test)
+    fleet = hpwhsim.Fleet()
+    tank = fleet.add_file(model + ".txt") if spec == "File" else fleet.add_preset(model)
+    fleet.set_setpoint(tank, 1, info["setpoint"])
+    fleet.reset_to_setpoint(tank, 1)
+
+    steps = info["minutes"]
+    heat_in, heat_out = zeros(steps * hpwhsim.HEAT_SOURCES), zeros(steps * hpwhsim.HEAT_SOURCES)
+    tcouples = zeros(steps * hpwhsim.TCOUPLES)
+    fleet.step(tank, 1, steps, doubles(info["inletT"]), doubles(info["drawL"]), doubles(info["ambientT"]),
+               doubles(info["evaporatorT"]), array.array("i", [int(dr) for dr in info["DR"]]),
+               heat_source_input_kWh=heat_in, heat_source_output_kWh=heat_out, tcouples_C=tcouples)
+
+    sources = fleet.num_heat_sources(tank)
+    with open(f"ref/{test}_{spec}_{model}.csv") as f:
+        rows = f.read().splitlines()[1:]
+    check(len(rows) == steps, f"{test} {spec} {model} has {len(rows)} reference rows, not {steps}")
+    for s, row in enumerate(rows[:steps]):
+        fields = []
+        for j in range(sources):
+            fields += [heat_in[s * hpwhsim.HEAT_SOURCES + j] * 1000., heat_out[s * hpwhsim.HEAT_SOURCES + j] * 1000.]
+        fields += tcouples[s * hpwhsim.TCOUPLES:(s + 1) * hpwhsim.TCOUPLES]
+        expected = row.split(",")[6:]
+        if [f"{x:.2f}" for x in fields] != expected:
+            check(False, f"{test} {spec} {model} differs from its reference on minute {s}")
+            return
+
+
+def step_inputs(tanks, steps):
+    """Different draws for each of tanks tanks, with the other inputs shared."""
+    info = read_test("testDOE_24hr50")
+    minutes = info["minutes"]
+    draws = [info["drawL"][(s + 37 * t) % minutes] for t in range(tanks) for s in range(steps)]
+    shared = [doubles(info[name][s % minutes] for s in range(steps)) for name in ("inletT", "ambientT", "evaporatorT")]
+    return shared[0], doubles(draws), shared[1], shared[2]
+
+
+def test_threads():
+    """Two threads stepping halves of a fleet match the fleet stepped in one call."""
+    tanks, steps = 8, 2 * 1440
+    inlet, draws, ambient, evaporator = step_inputs(tanks, steps)
+    serial, threaded = hpwhsim.Fleet(), hpwhsim.Fleet()
+    serial.add_preset("AOSmithHPTU80", tanks)
+    threaded.add_preset("AOSmithHPTU80", tanks)
+
+    expected_energy, expected_temps = zeros(tanks * steps), zeros(tanks * serial.num_nodes(0))
+    serial.step(0, tanks, steps, inlet, draws, ambient, evaporator, energy_input_kWh=expected_energy)
+    serial.tank_temps(0, tanks, expected_temps)
+
+    energy, temps = zeros(tanks * steps), zeros(tanks * threaded.num_nodes(0))
+    half = tanks // 2
+
+    def step_half(first):
+        threaded.step(first, half, steps, inlet, memoryview(draws)[first * steps:(first + half) * steps], ambient,
+                      evaporator, energy_input_kWh=memoryview(energy)[first * steps:(first + half) * steps])
+
+    threads = [threading.Thread(target=step_half, args=(first,)) for first in (0, half)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    threaded.tank_temps(0, tanks, temps)
+    check(energy == expected_energy, "threaded energy inputs differ from serial ones")
+    check(temps == expected_temps, "threaded node temperatures differ from serial ones")
+
+
+def test_overlap():
+    """A step of tanks another thread is stepping raises, and so does adding tanks, while the
+    other thread runs without the GIL."""
+    tanks, steps = 20, 7 * 1440
+    inlet, draws, ambient, evaporator = step_inputs(tanks, steps)
+    fleet = hpwhsim.Fleet()
+    fleet.add_preset("AOSmithHPTU80", tanks)
+    worker = threading.Thread(target=lambda: fleet.step(0, tanks, steps, inlet, draws, ambient, evaporator))
+    worker.start()
+    empty = doubles([])
+    overlapped = False
+    while worker.is_alive() and not overlapped:
+        # a step of no minutes changes nothing if it does get through
+        overlapped = raises(hpwhsim.Error, lambda: fleet.step(tanks - 1, 1, 0, empty, empty, empty, empty))
+    added = worker.is_alive() and raises(hpwhsim.Error, lambda: fleet.add_preset("AOSmithHPTU80"))
+    alive = worker.is_alive()
+    worker.join()
+    check(overlapped, "an overlapping step did not raise while another thread stepped the tanks")
+    check(added or not alive, "adding tanks did not raise while another thread stepped the fleet")
+    check(len(fleet) == tanks, "tanks were added while the fleet was being stepped")
+
+
+def test_errors():
+    fleet = hpwhsim.Fleet()
+    check(raises(hpwhsim.Error, lambda: fleet.add_preset("NoSuchModel")), "an unknown preset did not raise")
+    check(fleet.add_preset("AOSmithHPTU80", 2) == 0 and len(fleet) == 2, "two tanks were not added")
+    steps = 3
+    ok = doubles([20.] * steps)
+    check(raises(IndexError, lambda: fleet.step(1, 2, steps, ok, ok, ok, ok)), "a step past the last tank did not raise")
+    check(raises(ValueError, lambda: fleet.step(0, 2, steps, doubles([20.] * 4), ok, ok, ok)),
+          "an input of the wrong length did not raise")
+    check(raises(TypeError, lambda: fleet.step(0, 2, steps, array.array("f", [20.] * steps), ok, ok, ok)),
+          "a float32 input did not raise")
+    check(raises(TypeError, lambda: fleet.step(0, 2, steps, ok, ok, ok, ok, ok)), "a float64 DR schedule did not raise")
+    check(raises(BufferError, lambda: fleet.step(0, 2, steps, ok, ok, ok, ok, outlet_C=bytes(8 * 2 * steps))),
+          "a read only output did not raise")
+    check(raises(ValueError, lambda: fleet.step(0, 2, steps, ok, ok, ok, ok, tcouples_C=zeros(2 * steps))),
+          "a thermocouple output of one value a step did not raise")
+    check(raises(ValueError, lambda: fleet.tank_temps(0, 2, zeros(3))), "a short node temperature output did not raise")
+    check(raises(hpwhsim.Error, lambda: fleet.set_setpoint(0, 2, 200.)), "an impossible setpoint did not raise")
+
+
+def test_numpy():
+    """NumPy arrays shaped tank by step are stepped in place."""
+    tanks, steps = 3, 1440
+    inlet, draws, ambient, evaporator = step_inputs(tanks, steps)
+    fleet = hpwhsim.Fleet()
+    fleet.add_preset("Rheem2020Prem50", tanks)
+    heat_in = numpy.zeros((tanks, steps, hpwhsim.HEAT_SOURCES))
+    energy = numpy.zeros((tanks, steps))
+    temps = numpy.zeros((tanks, fleet.num_nodes(0)))
+    fleet.step(0, tanks, steps, numpy.asarray(inlet), numpy.asarray(draws).reshape(tanks, steps), numpy.asarray(ambient),
+               numpy.asarray(evaporator), numpy.zeros(steps, dtype=numpy.int32), heat_source_input_kWh=heat_in,
+               energy_input_kWh=energy)
+    fleet.tank_temps(0, tanks, temps)
+    check(numpy.allclose(heat_in.sum(axis=2), energy, rtol=1.e-12, atol=0.), "heat source inputs do not sum to the energy inputs")
+    check(bool((temps > 0.).all()), "node temperatures were not written")
+    check(raises((BufferError, ValueError), lambda: fleet.step(0, tanks, steps, numpy.asarray(inlet), numpy.asarray(draws)[::-1],
+                                                 numpy.asarray(ambient), numpy.asarray(evaporator))),
+          "a reversed input did not raise")
+
+
+if __name__ == "__main__":
+    for spec, model in REFERENCE_MODELS:
+        for test in REFERENCE_TESTS:
+            test_reference(spec, model, test)
+    test_threads()
+    test_overlap()
+    test_errors()
+    if numpy is not None:
+        test_numpy()
+    sys.exit(1 if failures else 0)
@@ -0,0 +1,54 @@
+"""Reads a test directory of test/ as testTool does: testInfo.txt and the inletT, draw,
+ambientT, evaporatorT, DR and optional setpoint schedules, each a default value and then
+minute,value (or hour,value) exceptions."""
+
+import os
+
+GAL_TO_L = 3.78541
+
+
+def read_schedule(file_name, minutes):
+    """The schedule in file_name as a list of minutes values, None if there is no such file."""
+    if not os.path.exists(file_name):
+        return None
+    with open(file_name) as f:
+        lines = f.read().splitlines()
+    first = lines[0].split()
+    if first[0] != "default":
+        raise ValueError(f"First line of {file_name} must specify default")
+    values = [float(first[1].rstrip(","))] * minutes
+    if len(lines) < 2 or not lines[1].strip():
+        return values
+    hour_input = lines[1].strip()[0].lower() == "h"
+    for line in lines[2:]:
+        fields = line.split(",")
+        try:
+            time, value = int(fields[0]), float(fields[1])
+        except (IndexError, ValueError):
+            break
+        if time >= minutes:
+            raise ValueError(f"In {file_name} the input file has more minutes than the test was defined with")
+        if hour_input:
+            values[time * 60:(time + 1) * 60] = [value] * 60
+        else:
+            values[time] = value
+    return values
+
+
+def read_test(directory):
+    """testInfo.txt of a test directory as a dict, with its schedules under their names, the
+    setpoint schedule under setpointSchedule, and the draws also in litres under drawL."""
+    info = {}
+    with open(os.path.join(directory, "testInfo.txt")) as f:
+        words = f.read().split()
+    for key, value in zip(words[0::2], words[1::2]):
+        info[key] = float(value)
+    minutes = int(info["length_of_test"])
+    info["minutes"] = minutes
+    for name in ("inletT", "draw", "ambientT", "evaporatorT", "DR", "setpoint"):
+        schedule = read_schedule(os.path.join(directory, name + "schedule.csv"), minutes)
+        if schedule is None and name != "setpoint":
+            raise ValueError(f"{directory} has no {name} schedule")
+        info[name + "Schedule" if name == "setpoint" else name] = schedule
+    info["drawL"] = [draw * GAL_TO_L for draw in info["draw"]]
+    return info
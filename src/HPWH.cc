@@ -45,7 +45,19 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <fstream>
 #include <iostream>
 #include <algorithm>
-#include <regex>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <iterator>
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 using std::endl;
 using std::cout;
@@ -80,123 +92,126 @@ void HPWH::setAllDefaults() {
 	delete[] setOfSources;
 
 	simHasFailed = true; isHeating = false; setpointFixed = false; tankSizeFixed = true; canScale = false; hpwhVerbosity = VRB_silent;
-	numHeatSources = 0;
+	numHeatSources = 0; numNodes = 0;
 	setOfSources = NULL; tankTemps_C = NULL; nextTankTemps_C = NULL; doTempDepression = false;
 	locationTemperature_C = UNINITIALIZED_LOCATIONTEMP;
 	doInversionMixing = true; doConduction = true;
+	doParcelDraws = false; parcelTolerance_dC = 0.;
 	inletHeight = 0; inlet2Height = 0; fittingsUA_kJperHrC = 0.;
 	prevDRstatus = DR_ALLOW; timerLimitTOT = 60.; timerTOT = 0.;
+	outletTemp_C = 0.; condenserInlet_C = 0.; energyRemovedFromEnvironment_kWh = 0.; standbyLosses_kWh = 0.;
+	member_inletT_C = 0.;
 }
 
-HPWH::HPWH(const HPWH &hpwh) {
-	simHasFailed = hpwh.simHasFailed;
-
-	hpwhVerbosity = hpwh.hpwhVerbosity;
+HPWH::HPWH(const HPWH &hpwh) : setOfSources(NULL), tankTemps_C(NULL), nextTankTemps_C(NULL)
+{
+	numHeatSources = 0;
+	numNodes = 0;
+	*this = hpwh;
+}
 
-	//these should actually be the same pointers
-	messageCallback = hpwh.messageCallback;
-	messageCallbackContextPtr = hpwh.messageCallbackContextPtr;
-	
-	isHeating = hpwh.isHeating;
+HPWH & HPWH::operator=(const HPWH &hpwh) {
+	if (this == &hpwh) {
+		return *this;
+	}
+	copyValues(hpwh);
 
-	numHeatSources = hpwh.numHeatSources;
-	setOfSources = new HeatSource[numHeatSources];
-	for (int i = 0; i < numHeatSources; i++) {
+	// reuse the arrays when they are already the right size, so cloning into a HPWH of the
+	// same model only copies values
+	if (numHeatSources != hpwh.numHeatSources || (setOfSources == NULL) != (hpwh.setOfSources == NULL)) {
+		delete[] setOfSources;
+		setOfSources = (hpwh.setOfSources == NULL) ? NULL : new HeatSource[hpwh.numHeatSources];
+		numHeatSources = hpwh.numHeatSources;
+	}
+	for (int i = 0; i < numHeatSources && setOfSources != NULL; i++) {
 		setOfSources[i] = hpwh.setOfSources[i];
 		setOfSources[i].hpwh = this;
 	}
 
-
-
-	tankVolume_L = hpwh.tankVolume_L;
-	tankUA_kJperHrC = hpwh.tankUA_kJperHrC;
-	fittingsUA_kJperHrC = hpwh.fittingsUA_kJperHrC;
-
-	setpoint_C = hpwh.setpoint_C;
-	numNodes = hpwh.numNodes;
-	nodeDensity = hpwh.nodeDensity;
-	tankTemps_C = new double[numNodes];
-	nextTankTemps_C = new double[numNodes];
-	for (int i = 0; i < numNodes; i++) {
-		tankTemps_C[i] = hpwh.tankTemps_C[i];
-		nextTankTemps_C[i] = hpwh.nextTankTemps_C[i];
+	if (numNodes != hpwh.numNodes || (tankTemps_C == NULL) != (hpwh.tankTemps_C == NULL) ||
+		(nextTankTemps_C == NULL) != (hpwh.nextTankTemps_C == NULL)) {
+		delete[] tankTemps_C;
+		delete[] nextTankTemps_C;
+		tankTemps_C = (hpwh.tankTemps_C == NULL) ? NULL : new double[hpwh.numNodes];
+		nextTankTemps_C = (hpwh.nextTankTemps_C == NULL) ? NULL : new double[hpwh.numNodes];
+		numNodes = hpwh.numNodes;
 	}
-	inletHeight = hpwh.inletHeight;
-	inlet2Height = hpwh.inlet2Height;
-
-	outletTemp_C = hpwh.outletTemp_C;
-	condenserInlet_C = hpwh.condenserInlet_C;
-	energyRemovedFromEnvironment_kWh = hpwh.energyRemovedFromEnvironment_kWh;
-	standbyLosses_kWh = hpwh.standbyLosses_kWh;
-
-	tankMixesOnDraw = hpwh.tankMixesOnDraw;
-	doTempDepression = hpwh.doTempDepression;
-
-	doInversionMixing = hpwh.doInversionMixing;
-	doConduction = hpwh.doConduction;
-
-	locationTemperature_C = hpwh.locationTemperature_C;
-	
-	prevDRstatus = hpwh.prevDRstatus;
-	timerLimitTOT = hpwh.timerLimitTOT;
-
-	volPerNode_LperNode = hpwh.volPerNode_LperNode;
-	node_height = hpwh.node_height;
-	fracAreaTop = hpwh.fracAreaTop;
-	fracAreaSide = hpwh.fracAreaSide;
+	if (tankTemps_C != NULL) {
+		std::copy(hpwh.tankTemps_C, hpwh.tankTemps_C + numNodes, tankTemps_C);
+	}
+	if (nextTankTemps_C != NULL) {
+		std::copy(hpwh.nextTankTemps_C, hpwh.nextTankTemps_C + numNodes, nextTankTemps_C);
+	}
+	return *this;
+}
 
+HPWH::HPWH(HPWH &&hpwh) noexcept : setOfSources(NULL), tankTemps_C(NULL), nextTankTemps_C(NULL)
+{
+	numHeatSources = 0;
+	numNodes = 0;
+	*this = std::move(hpwh);
 }
 
-HPWH & HPWH::operator=(const HPWH &hpwh) {
+HPWH & HPWH::operator=(HPWH &&hpwh) noexcept {
 	if (this == &hpwh) {
 		return *this;
 	}
+	copyValues(hpwh);
+
+	delete[] setOfSources;
+	delete[] tankTemps_C;
+	delete[] nextTankTemps_C;
+	setOfSources = hpwh.setOfSources;
+	tankTemps_C = hpwh.tankTemps_C;
+	nextTankTemps_C = hpwh.nextTankTemps_C;
+	numHeatSources = hpwh.numHeatSources;
+	numNodes = hpwh.numNodes;
+	for (int i = 0; i < numHeatSources && setOfSources != NULL; i++) {
+		setOfSources[i].hpwh = this;
+	}
 
+	hpwh.setOfSources = NULL;
+	hpwh.tankTemps_C = NULL;
+	hpwh.nextTankTemps_C = NULL;
+	hpwh.numHeatSources = 0;
+	hpwh.numNodes = 0;
+	hpwh.simHasFailed = true;
+	return *this;
+}
 
+void HPWH::copyValues(const HPWH &hpwh) {
 	simHasFailed = hpwh.simHasFailed;
+	isHeating = hpwh.isHeating;
+	setpointFixed = hpwh.setpointFixed;
+	tankSizeFixed = hpwh.tankSizeFixed;
+	canScale = hpwh.canScale;
 
 	hpwhVerbosity = hpwh.hpwhVerbosity;
-
 	//these should actually be the same pointers
 	messageCallback = hpwh.messageCallback;
 	messageCallbackContextPtr = hpwh.messageCallbackContextPtr;
 
-	isHeating = hpwh.isHeating;
-
-	numHeatSources = hpwh.numHeatSources;
-
-	delete[] setOfSources;
-	setOfSources = new HeatSource[numHeatSources];
-	for (int i = 0; i < numHeatSources; i++) {
-		setOfSources[i] = hpwh.setOfSources[i];
-		setOfSources[i].hpwh = this;
-		//HeatSource assignment will fail (causing the simulation to fail) if a
-		//HeatSource has backups/companions.
-		//This could be dealt with in this function (tricky), but the HeatSource
-		//assignment can't know where its backup/companion pointer goes so it either
-		//fails or silently does something that's not at all useful.
-		//I prefer it to fail.  -NDK  1/2016
-	}
-
+	hpwhModel = hpwh.hpwhModel;
+	compressorIndex = hpwh.compressorIndex;
+	lowestElementIndex = hpwh.lowestElementIndex;
+	highestElementIndex = hpwh.highestElementIndex;
+	VIPIndex = hpwh.VIPIndex;
 
+	nodeDensity = hpwh.nodeDensity;
+	inletHeight = hpwh.inletHeight;
+	inlet2Height = hpwh.inlet2Height;
 	tankVolume_L = hpwh.tankVolume_L;
 	tankUA_kJperHrC = hpwh.tankUA_kJperHrC;
 	fittingsUA_kJperHrC = hpwh.fittingsUA_kJperHrC;
+	volPerNode_LperNode = hpwh.volPerNode_LperNode;
+	node_height = hpwh.node_height;
+	fracAreaTop = hpwh.fracAreaTop;
+	fracAreaSide = hpwh.fracAreaSide;
 
 	setpoint_C = hpwh.setpoint_C;
-	numNodes = hpwh.numNodes;
-	nodeDensity = hpwh.nodeDensity;
-
-	delete[] tankTemps_C;
-	delete[] nextTankTemps_C;
-	tankTemps_C = new double[numNodes];
-	nextTankTemps_C = new double[numNodes];
-	for (int i = 0; i < numNodes; i++) {
-		tankTemps_C[i] = hpwh.tankTemps_C[i];
-		nextTankTemps_C[i] = hpwh.nextTankTemps_C[i];
-	}
-	inletHeight = hpwh.inletHeight;
-	inlet2Height = hpwh.inlet2Height;
+	prevDRstatus = hpwh.prevDRstatus;
+	timerLimitTOT = hpwh.timerLimitTOT;
+	timerTOT = hpwh.timerTOT;
 
 	outletTemp_C = hpwh.outletTemp_C;
 	condenserInlet_C = hpwh.condenserInlet_C;
@@ -205,20 +220,15 @@ HPWH & HPWH::operator=(const HPWH &hpwh) {
 
 	tankMixesOnDraw = hpwh.tankMixesOnDraw;
 	doTempDepression = hpwh.doTempDepression;
+	locationTemperature_C = hpwh.locationTemperature_C;
+	maxDepression_C = hpwh.maxDepression_C;
+	member_inletT_C = hpwh.member_inletT_C;
+	minutesPerStep = hpwh.minutesPerStep;
 
 	doInversionMixing = hpwh.doInversionMixing;
 	doConduction = hpwh.doConduction;
-
-	locationTemperature_C = hpwh.locationTemperature_C;
-
-	prevDRstatus = hpwh.prevDRstatus;
-	timerLimitTOT = hpwh.timerLimitTOT;
-
-	volPerNode_LperNode = hpwh.volPerNode_LperNode;
-	node_height = hpwh.node_height;
-	fracAreaTop = hpwh.fracAreaTop;
-	fracAreaSide = hpwh.fracAreaSide;
-	return *this;
+	doParcelDraws = hpwh.doParcelDraws;
+	parcelTolerance_dC = hpwh.parcelTolerance_dC;
 }
 
 HPWH::~HPWH() {
@@ -337,9 +347,9 @@ int HPWH::runOneStep(double drawVolume_L,
 				if (setOfSources[i].isEngaged() && setOfSources[i].shutsOff()) {
 					setOfSources[i].disengageHeatSource();
 					//check if the backup heat source would have to shut off too
-					if (setOfSources[i].backupHeatSource != NULL && setOfSources[i].backupHeatSource->shutsOff() != true) {
+					if (setOfSources[i].backupHeatSource() != NULL && setOfSources[i].backupHeatSource()->shutsOff() != true) {
 						//and if not, go ahead and turn it on
-						setOfSources[i].backupHeatSource->engageHeatSource(DRstatus);
+						setOfSources[i].backupHeatSource()->engageHeatSource(DRstatus);
 					}
 				}
 
@@ -402,7 +412,7 @@ int HPWH::runOneStep(double drawVolume_L,
 				// locks or unlocks the heat source
 				setOfSources[i].toLockOrUnlock(heatSourceAmbientT_C);
 			}
-			if (setOfSources[i].isLockedOut() && setOfSources[i].backupHeatSource == NULL) {
+			if (setOfSources[i].isLockedOut() && setOfSources[i].backupHeatSource() == NULL) {
 				setOfSources[i].disengageHeatSource();
 				if (hpwhVerbosity >= HPWH::VRB_emetic) {
 					msg("\nWARNING: lock-out triggered, but no backupHeatSource defined. Simulation will continue will lock out the heat source.");
@@ -413,24 +423,24 @@ int HPWH::runOneStep(double drawVolume_L,
 			if (setOfSources[i].isEngaged()) {
 
 				HeatSource* heatSourcePtr;
-				if (setOfSources[i].isLockedOut() && setOfSources[i].backupHeatSource != NULL) {
+				if (setOfSources[i].isLockedOut() && setOfSources[i].backupHeatSource() != NULL) {
 
 					// Check that the backup isn't locked out too or already engaged then it will heat on it's own.
-					if (setOfSources[i].backupHeatSource->toLockOrUnlock(heatSourceAmbientT_C) ||
-						shouldDRLockOut(setOfSources[i].backupHeatSource->typeOfHeatSource, DRstatus) || //){
-						setOfSources[i].backupHeatSource->isEngaged() ) {
+					if (setOfSources[i].backupHeatSource()->toLockOrUnlock(heatSourceAmbientT_C) ||
+						shouldDRLockOut(setOfSources[i].backupHeatSource()->typeOfHeatSource, DRstatus) || //){
+						setOfSources[i].backupHeatSource()->isEngaged() ) {
 						continue;
 					}
 					// Don't turn the backup electric resistance heat source on if the VIP resistance element is on .
 					else if (VIPIndex >= 0 && setOfSources[VIPIndex].isOn && 
-						setOfSources[i].backupHeatSource->isAResistance()) {
+						setOfSources[i].backupHeatSource()->isAResistance()) {
 						if (hpwhVerbosity >= VRB_typical) {
 							msg("Locked out back up heat source AND the engaged heat source %i, DRstatus = %i\n", i, DRstatus);
 						}
 						continue;
 					}						
 					else {
-						heatSourcePtr = setOfSources[i].backupHeatSource;
+						heatSourcePtr = setOfSources[i].backupHeatSource();
 					}
 				}
 				else {
@@ -450,21 +460,21 @@ int HPWH::runOneStep(double drawVolume_L,
 					minutesToRun -= heatSourcePtr->runtime_min;
 					setOfSources[i].disengageHeatSource();
 					//and if there's a heat source that follows this heat source (regardless of lockout) that's able to come on,
-					if (setOfSources[i].followedByHeatSource != NULL && setOfSources[i].followedByHeatSource->shutsOff() == false) {
+					if (setOfSources[i].followedByHeatSource() != NULL && setOfSources[i].followedByHeatSource()->shutsOff() == false) {
 						//turn it on
-						setOfSources[i].followedByHeatSource->engageHeatSource(DRstatus);
+						setOfSources[i].followedByHeatSource()->engageHeatSource(DRstatus);
 					}
 					// or if there heat source can't produce hotter water (i.e. it's maxed out) and the tank still isn't at setpoint.
 					// the compressor should get locked out when the maxedOut is true but have to run the resistance first during this 
 					// timestep to make sure tank is above the max temperature for the compressor.
-					else if (setOfSources[i].maxedOut() && setOfSources[i].backupHeatSource != NULL) {
+					else if (setOfSources[i].maxedOut() && setOfSources[i].backupHeatSource() != NULL) {
 
 						// Check that the backup isn't locked out or already engaged then it will heat or already heated on it's own.
-						if (!setOfSources[i].backupHeatSource->toLockOrUnlock(heatSourceAmbientT_C) && //If not locked out
-							!shouldDRLockOut(setOfSources[i].backupHeatSource->typeOfHeatSource, DRstatus) && // and not DR locked out
-							!setOfSources[i].backupHeatSource->isEngaged()) { // and not already engaged
+						if (!setOfSources[i].backupHeatSource()->toLockOrUnlock(heatSourceAmbientT_C) && //If not locked out
+							!shouldDRLockOut(setOfSources[i].backupHeatSource()->typeOfHeatSource, DRstatus) && // and not DR locked out
+							!setOfSources[i].backupHeatSource()->isEngaged()) { // and not already engaged
 
-							HeatSource* backupHeatSourcePtr = setOfSources[i].backupHeatSource;
+							HeatSource* backupHeatSourcePtr = setOfSources[i].backupHeatSource();
 							// turn it on
 							backupHeatSourcePtr->engageHeatSource(DRstatus);
 							// add heat if it hasn't heated up this whole minute already
@@ -561,26 +571,66 @@ int HPWH::runOneStep(double drawVolume_L,
 int HPWH::runNSteps(int N, double *inletT_C, double *drawVolume_L,
 	double *tankAmbientT_C, double *heatSourceAmbientT_C,
 	DRMODES *DRstatus) {
+	StepInputs inputs;
+	inputs.inletT_C = inletT_C;
+	inputs.drawVolume_L = drawVolume_L;
+	inputs.tankAmbientT_C = tankAmbientT_C;
+	inputs.heatSourceAmbientT_C = heatSourceAmbientT_C;
+	inputs.DRstatus = DRstatus;
+	return runNSteps(N, inputs);
+}
+
+int HPWH::runNSteps(int N, const StepInputs &inputs, StepOutputArrays *outputs /*=NULL*/) {
 	//returns 0 on successful completion, HPWH_ABORT on failure
 
+	// check everything up front, so the loop below only has to step
+	bool badInput = N < 0 || inputs.inletT_C == NULL || inputs.drawVolume_L == NULL || inputs.tankAmbientT_C == NULL ||
+		inputs.heatSourceAmbientT_C == NULL || (inputs.inletVol2_L == NULL) != (inputs.inletT2_C == NULL) ||
+		(outputs != NULL && outputs->simTcouples_C != NULL && numNodes < STEP_TCOUPLES);
+	double lastSetpoint_C = setpoint_C;
+	for (int i = 0; inputs.setpoint_C != NULL && i < N && !badInput; i++) {
+		if (inputs.setpoint_C[i] != lastSetpoint_C) {
+			double maxAllowedSetpoint_C;
+			badInput = !isNewSetpointPossible(inputs.setpoint_C[i], maxAllowedSetpoint_C);
+			lastSetpoint_C = inputs.setpoint_C[i];
+		}
+	}
+	if (badInput) {
+		if (hpwhVerbosity >= VRB_reluctant) {
+			msg("runNSteps needs the inlet, draw and ambient inputs, both or neither second inlet inputs, setpoints the model can reach, and %d nodes for thermocouples.  \n",
+				STEP_TCOUPLES);
+		}
+		return HPWH_ABORT;
+	}
+
 	//these are all the accumulating variables we'll need
 	double energyRemovedFromEnvironment_kWh_SUM = 0;
 	double standbyLosses_kWh_SUM = 0;
 	double outletTemp_C_AVG = 0;
 	double totalDrawVolume_L = 0;
-	std::vector<double> heatSources_runTimes_SUM(numHeatSources);
-	std::vector<double> heatSources_energyInputs_SUM(numHeatSources);
-	std::vector<double> heatSources_energyOutputs_SUM(numHeatSources);
+	// reused from call to call, so stepping a fleet a minute at a time does not allocate
+	static thread_local std::vector<double> heatSources_runTimes_SUM, heatSources_energyInputs_SUM,
+		heatSources_energyOutputs_SUM;
+	heatSources_runTimes_SUM.assign(numHeatSources, 0.);
+	heatSources_energyInputs_SUM.assign(numHeatSources, 0.);
+	heatSources_energyOutputs_SUM.assign(numHeatSources, 0.);
 
 	if (hpwhVerbosity >= VRB_typical) {
 		msg("Begin runNSteps.  \n");
 	}
 	//run the sim one step at a time, accumulating the outputs as you go
 	for (int i = 0; i < N; i++) {
-		runOneStep(inletT_C[i], drawVolume_L[i], tankAmbientT_C[i], heatSourceAmbientT_C[i],
-			DRstatus[i]);
+		if (inputs.setpoint_C != NULL && inputs.setpoint_C[i] != setpoint_C) {
+			// checked above, so this is what setSetpoint would do
+			setpoint_C = inputs.setpoint_C[i];
+		}
+		member_inletT_C = inputs.inletT_C[i];
+		int result = runOneStep(inputs.drawVolume_L[i], inputs.tankAmbientT_C[i], inputs.heatSourceAmbientT_C[i],
+			(inputs.DRstatus == NULL) ? DR_ALLOW : inputs.DRstatus[i],
+			(inputs.inletVol2_L == NULL) ? 0. : inputs.inletVol2_L[i], (inputs.inletT2_C == NULL) ? 0. : inputs.inletT2_C[i],
+			(inputs.nodePowerExtra_W == NULL) ? NULL : &inputs.nodePowerExtra_W[i]);
 
-		if (simHasFailed) {
+		if (result != 0 || simHasFailed) {
 			if (hpwhVerbosity >= VRB_reluctant) {
 				msg("RunNSteps has encountered an error on step %d of N and has ceased running.  \n", i + 1);
 			}
@@ -590,18 +640,41 @@ int HPWH::runNSteps(int N, double *inletT_C, double *drawVolume_L,
 		energyRemovedFromEnvironment_kWh_SUM += energyRemovedFromEnvironment_kWh;
 		standbyLosses_kWh_SUM += standbyLosses_kWh;
 
-		outletTemp_C_AVG += outletTemp_C * drawVolume_L[i];
-		totalDrawVolume_L += drawVolume_L[i];
+		outletTemp_C_AVG += outletTemp_C * inputs.drawVolume_L[i];
+		totalDrawVolume_L += inputs.drawVolume_L[i];
 
 		for (int j = 0; j < numHeatSources; j++) {
-			heatSources_runTimes_SUM[j] += getNthHeatSourceRunTime(j);
-			heatSources_energyInputs_SUM[j] += getNthHeatSourceEnergyInput(j);
-			heatSources_energyOutputs_SUM[j] += getNthHeatSourceEnergyOutput(j);
+			heatSources_runTimes_SUM[j] += setOfSources[j].runtime_min;
+			heatSources_energyInputs_SUM[j] += setOfSources[j].energyInput_kWh;
+			heatSources_energyOutputs_SUM[j] += setOfSources[j].energyOutput_kWh;
+		}
+
+		if (outputs != NULL) {
+			if (outputs->outletTemp_C != NULL) outputs->outletTemp_C[i] = outletTemp_C;
+			if (outputs->standbyLosses_kWh != NULL) outputs->standbyLosses_kWh[i] = standbyLosses_kWh;
+			if (outputs->energyRemovedFromEnvironment_kWh != NULL) {
+				outputs->energyRemovedFromEnvironment_kWh[i] = energyRemovedFromEnvironment_kWh;
+			}
+			if (outputs->tankHeatContent_kJ != NULL) outputs->tankHeatContent_kJ[i] = getTankHeatContent_kJ();
+			for (int j = 0; j < numHeatSources; j++) {
+				if (outputs->heatSourceEnergyInput_kWh != NULL) {
+					outputs->heatSourceEnergyInput_kWh[i * numHeatSources + j] = setOfSources[j].energyInput_kWh;
+				}
+				if (outputs->heatSourceEnergyOutput_kWh != NULL) {
+					outputs->heatSourceEnergyOutput_kWh[i * numHeatSources + j] = setOfSources[j].energyOutput_kWh;
+				}
+				if (outputs->heatSourceRunTime_min != NULL) {
+					outputs->heatSourceRunTime_min[i * numHeatSources + j] = setOfSources[j].runtime_min;
+				}
+			}
+			for (int t = 0; t < STEP_TCOUPLES && outputs->simTcouples_C != NULL; t++) {
+				outputs->simTcouples_C[i * STEP_TCOUPLES + t] = simTcouple_C(t + 1, STEP_TCOUPLES);
+			}
 		}
 
 		//print minutely output
 		if (hpwhVerbosity == VRB_minuteOut) {
-			msg("%f,%f,%f,", tankAmbientT_C[i], drawVolume_L[i], inletT_C[i]);
+			msg("%f,%f,%f,", inputs.tankAmbientT_C[i], inputs.drawVolume_L[i], inputs.inletT_C[i]);
 			for (int j = 0; j < numHeatSources; j++) {
 				msg("%f,%f,", getNthHeatSourceEnergyInput(j), getNthHeatSourceEnergyOutput(j));
 			}
@@ -617,8 +690,10 @@ int HPWH::runNSteps(int N, double *inletT_C, double *drawVolume_L,
 		}
 
 	}
-	//finish weighted avg. of outlet temp by dividing by the total drawn volume
-	outletTemp_C_AVG /= totalDrawVolume_L;
+	//finish weighted avg. of outlet temp by dividing by the total drawn volume, 0 as runOneStep with no draw
+	if (totalDrawVolume_L > 0.) {
+		outletTemp_C_AVG /= totalDrawVolume_L;
+	}
 
 	//now, reassign all of the accumulated values to their original spots
 	energyRemovedFromEnvironment_kWh = energyRemovedFromEnvironment_kWh_SUM;
@@ -1130,6 +1205,24 @@ int HPWH::setDoConduction(bool doCondu) {
 	return 0;
 }
 
+int HPWH::setDoParcelDraws(bool doParcels, double mergeTolerance_dC /*=0.*/) {
+	if (mergeTolerance_dC < 0.) {
+		if (hpwhVerbosity >= VRB_reluctant) {
+			msg("The parcel merge tolerance can not be negative.  \n");
+		}
+		return HPWH_ABORT;
+	}
+	doParcelDraws = doParcels;
+	parcelTolerance_dC = mergeTolerance_dC;
+	return 0;
+}
+
+double HPWH::getMaxStableMinutesPerStep() const {
+	// the stability condition tau <= 0.5 from updateTankTemps, solved for the step length
+	const double tauPerMinute = KWATER_WpermC / (CPWATER_kJperkgC * 1000.0 * DENSITYWATER_kgperL * 1000.0 * (node_height * node_height)) * 60.0;
+	return 0.5 / tauPerMinute;
+}
+
 int HPWH::setUA(double UA, UNITS units /*=UNITS_kJperHrC*/) {
 	if (units == UNITS_kJperHrC) {
 		tankUA_kJperHrC = UA;
@@ -1477,6 +1570,32 @@ double HPWH::getTankNodeTemp(int nodeNum, UNITS units  /*=UNITS_C*/) const {
 }
 
 
+double HPWH::simTcouple_C(int iTCouple, int nTCouple) const {
+	double weight = (double)numNodes / (double)nTCouple;
+	double start_ind = (iTCouple - 1.) * weight;
+	int ind = (int)std::ceil(start_ind);
+
+	double averageTemp_C = 0.0;
+
+	// Check any intial fraction of nodes 
+	averageTemp_C += tankTemps_C[(int)std::floor(start_ind)] * ((double)ind - start_ind);
+	weight -= ((double)ind - start_ind);
+
+	// Check the full nodes
+	while (weight >= 1.0 && ind < numNodes) {
+		averageTemp_C += tankTemps_C[ind];
+		weight -= 1.0;
+		ind += 1;
+	}
+
+	// Check any leftover, round off can leave a sliver past the top node
+	if (weight > 0. && ind < numNodes) {
+		averageTemp_C += tankTemps_C[ind] * weight;
+	}
+	// Divide by the original weight to get the true average
+	return averageTemp_C / ((double)numNodes / (double)nTCouple);
+}
+
 double HPWH::getNthSimTcouple(int iTCouple, int nTCouple, UNITS units  /*=UNITS_C*/) const {
 	if (iTCouple > nTCouple || iTCouple < 1) {
 		if (hpwhVerbosity >= VRB_reluctant) {
@@ -1491,29 +1610,7 @@ double HPWH::getNthSimTcouple(int iTCouple, int nTCouple, UNITS units  /*=UNITS_
 		return double(HPWH_ABORT);
 	}
 	else {
-		double weight = (double)numNodes / (double)nTCouple;
-		double start_ind = (iTCouple - 1.) * weight;
-		int ind = (int)std::ceil(start_ind);
-
-		double averageTemp_C = 0.0;
-
-		// Check any intial fraction of nodes 
-		averageTemp_C += getTankNodeTemp((int)std::floor(start_ind), UNITS_C) * ((double)ind - start_ind);
-		weight -= ((double)ind - start_ind);
-
-		// Check the full nodes
-		while (weight >= 1.0) {
-			averageTemp_C += getTankNodeTemp(ind, UNITS_C);
-			weight -= 1.0;
-			ind += 1;
-		}
-
-		// Check any leftover
-		if (weight > 0.) {
-			averageTemp_C += getTankNodeTemp(ind, UNITS_C) * weight;
-		}
-		// Divide by the original weight to get the true average
-		averageTemp_C /= ((double)numNodes / (double)nTCouple);
+		double averageTemp_C = simTcouple_C(iTCouple, nTCouple);
 
 		if (units == UNITS_C) {
 			return averageTemp_C;
@@ -1781,102 +1878,957 @@ double HPWH::getTankHeatContent_kJ() const {
 	return totalHeat;
 }
 
+int HPWH::getStepOutputs(StepOutputs &outputs) const {
+	if (numHeatSources > STEP_HEATSOURCES || numNodes < STEP_TCOUPLES || tankTemps_C == NULL) {
+		if (hpwhVerbosity >= VRB_reluctant) {
+			msg("StepOutputs holds up to %d heat sources and needs at least %d nodes.  \n", STEP_HEATSOURCES, STEP_TCOUPLES);
+		}
+		return HPWH_ABORT;
+	}
+	outputs.numHeatSources = numHeatSources;
+	for (int i = 0; i < STEP_HEATSOURCES; i++) {
+		bool exists = i < numHeatSources;
+		outputs.heatSourceEnergyInput_kWh[i] = exists ? setOfSources[i].energyInput_kWh : 0.;
+		outputs.heatSourceEnergyOutput_kWh[i] = exists ? setOfSources[i].energyOutput_kWh : 0.;
+		outputs.heatSourceRunTime_min[i] = exists ? setOfSources[i].runtime_min : 0.;
+	}
+	outputs.outletTemp_C = outletTemp_C;
+	outputs.standbyLosses_kWh = standbyLosses_kWh;
+	outputs.energyRemovedFromEnvironment_kWh = energyRemovedFromEnvironment_kWh;
+	outputs.tankHeatContent_kJ = getTankHeatContent_kJ();
+	for (int i = 0; i < STEP_TCOUPLES; i++) {
+		outputs.simTcouples_C[i] = simTcouple_C(i + 1, STEP_TCOUPLES);
+	}
+	return 0;
+}
+
 double HPWH::getLocationTemp_C() const {
 	return locationTemperature_C;
 }
 
-int HPWH::getHPWHModel() const {
-	return hpwhModel;
+int HPWH::getSimState(SimState &state) const {
+	state.tankTemps_C.assign(tankTemps_C, tankTemps_C + numNodes);
+	state.heatSourcesOn.resize(numHeatSources);
+	state.heatSourcesLockedOut.resize(numHeatSources);
+	for (int i = 0; i < numHeatSources; i++) {
+		state.heatSourcesOn[i] = setOfSources[i].isOn;
+		state.heatSourcesLockedOut[i] = setOfSources[i].lockedOut;
+	}
+	state.isHeating = isHeating;
+	state.setpoint_C = setpoint_C;
+	state.prevDRstatus = prevDRstatus;
+	state.timerTOT = timerTOT;
+	state.locationTemperature_C = locationTemperature_C;
+	return 0;
 }
 
-bool HPWH::hasACompressor() const {
-	return compressorIndex >= 0;
+int HPWH::setSimState(const SimState &state) {
+	if ((int)state.tankTemps_C.size() != numNodes || (int)state.heatSourcesOn.size() != numHeatSources ||
+		(int)state.heatSourcesLockedOut.size() != numHeatSources) {
+		if (hpwhVerbosity >= VRB_reluctant) {
+			msg("The state does not match the number of nodes or heat sources of this HPWH.  \n");
+		}
+		return HPWH_ABORT;
+	}
+	for (int i = 0; i < numNodes; i++) {
+		tankTemps_C[i] = state.tankTemps_C[i];
+	}
+	for (int i = 0; i < numHeatSources; i++) {
+		setOfSources[i].isOn = state.heatSourcesOn[i];
+		setOfSources[i].lockedOut = state.heatSourcesLockedOut[i];
+	}
+	isHeating = state.isHeating;
+	setpoint_C = state.setpoint_C;
+	prevDRstatus = state.prevDRstatus;
+	timerTOT = state.timerTOT;
+	locationTemperature_C = state.locationTemperature_C;
+	return 0;
 }
 
-double HPWH::getCompressorMinRuntime(UNITS units /*=UNITS_MIN*/) const {
-
-	if (hasACompressor()) {
-		double min_minutes = 10.;
-
-		if (units == UNITS_MIN) {
-			return min_minutes;
-		}
-		else if (units == UNITS_SEC) {
-			return MIN_TO_SEC(min_minutes);
-		}
-		else if (units == UNITS_HR) {
-			return MIN_TO_HR(min_minutes);
-		}
-		else {
-			if (hpwhVerbosity >= VRB_reluctant) {
-				msg("Incorrect unit specification for getCompressorMinRunTime.  \n");
+// the snapshot format of saveState, all little endian:
+//   "HPWS", uint16 version, uint16 reserved, int32 model, uint32 nodes, uint32 heat sources,
+//   float64 setpoint, timerTOT, locationTemperature, int32 prevDRstatus, uint8 isHeating,
+//   isOn and lockedOut of each heat source packed two bits per source,
+//   float64 node temperatures, float64 outletTemp, condenserInlet, energyRemovedFromEnvironment,
+//   standbyLosses, float64 runtime, energyInput and energyOutput of each heat source,
+//   uint32 CRC-32 of everything before it
+static const unsigned char STATE_MAGIC[4] = { 'H', 'P', 'W', 'S' };
+static const size_t STATE_HEADER_BYTES = 4 + 2 + 2 + 4 + 4 + 4 + 3 * 8 + 4 + 1;
+
+struct StateCRCTable {
+	uint32_t entries[256];
+	StateCRCTable() {
+		for (uint32_t i = 0; i < 256; i++) {
+			uint32_t c = i;
+			for (int k = 0; k < 8; k++) {
+				c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
 			}
-			return (double)HPWH_ABORT;
+			entries[i] = c;
 		}
 	}
-	else {
-		if (hpwhVerbosity >= VRB_reluctant) {
-			msg("This HPWH has no compressor.  \n");
-		}
-		return (double)HPWH_ABORT;
+};
+
+static uint32_t stateCRC32(const unsigned char *data, size_t size) {
+	static const StateCRCTable table;
+	uint32_t crc = 0xFFFFFFFFu;
+	for (size_t i = 0; i < size; i++) {
+		crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
 	}
+	return crc ^ 0xFFFFFFFFu;
 }
 
+static unsigned char *putStateUInt(unsigned char *p, uint64_t value, int bytes) {
+	for (int i = 0; i < bytes; i++) {
+		*p++ = (unsigned char)(value >> (8 * i));
+	}
+	return p;
+}
 
-int HPWH::getSizingFractions(double &aquaFract, double &useableFract) const {
-	double aFract = 1.;
-	double useFract = 1.;
+static unsigned char *putStateDouble(unsigned char *p, double value) {
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return putStateUInt(p, bits, 8);
+}
 
-	if (!hasACompressor()) {
-		if (hpwhVerbosity >= VRB_reluctant) {
-			msg("Current model does not have a compressor.  \n");
-		}
-		return HPWH_ABORT;
+static const unsigned char *getStateUInt(const unsigned char *p, uint64_t &value, int bytes) {
+	value = 0;
+	for (int i = 0; i < bytes; i++) {
+		value |= (uint64_t)(*p++) << (8 * i);
 	}
+	return p;
+}
 
-	// Every compressor must have at least one on logic
-	for( auto onLogic : setOfSources[compressorIndex].turnOnLogicSet) {
-		double tempA;
+static const unsigned char *getStateDouble(const unsigned char *p, double &value) {
+	uint64_t bits;
+	p = getStateUInt(p, bits, 8);
+	memcpy(&value, &bits, sizeof(value));
+	return p;
+}
 
-		if (hpwhVerbosity >= VRB_emetic) {
-			msg("\tturnon logic: %s ", onLogic.description.c_str());
-		}
-		tempA = nodeWeightAvgFract(onLogic); // if standby logic will return 1
-		aFract = tempA < aFract ? tempA : aFract;
-	}
-	aquaFract = aFract;
+int HPWH::saveState(std::vector<unsigned char> &buffer) const {
+	size_t flagBytes = (2 * numHeatSources + 7) / 8;
+	size_t size = STATE_HEADER_BYTES + flagBytes + 8 * numNodes + 4 * 8 + 3 * 8 * numHeatSources + 4;
+	buffer.resize(size);
 
-	// Compressors don't need to have an off logic
-	if (setOfSources[compressorIndex].shutOffLogicSet.size() != 0) {
-		for (auto offLogic : setOfSources[compressorIndex].shutOffLogicSet) {
-		
-			double tempUse;
+	unsigned char *p = buffer.data();
+	memcpy(p, STATE_MAGIC, 4);
+	p += 4;
+	p = putStateUInt(p, STATE_VERSION, 2);
+	p = putStateUInt(p, 0, 2);
+	p = putStateUInt(p, (uint32_t)hpwhModel, 4);
+	p = putStateUInt(p, numNodes, 4);
+	p = putStateUInt(p, numHeatSources, 4);
+	p = putStateDouble(p, setpoint_C);
+	p = putStateDouble(p, timerTOT);
+	p = putStateDouble(p, locationTemperature_C);
+	p = putStateUInt(p, (uint32_t)prevDRstatus, 4);
+	*p++ = isHeating ? 1 : 0;
 
-			if (hpwhVerbosity >= VRB_emetic) {
-				msg("\tshutsOff logic: %s ", offLogic.description.c_str());
-			}
-			if (offLogic.description == "large draw" || offLogic.description == "larger draw") {
-				tempUse = 1.; // These logics are just for checking if there's a big draw to switch to RE
-			}
-			else {
-				tempUse = 1. - nodeWeightAvgFract(offLogic);
-			}
-			useFract = tempUse < useFract ? tempUse : useFract; // Will return the smallest case of the useable fraction for multiple off logics
+	memset(p, 0, flagBytes);
+	for (int i = 0; i < numHeatSources; i++) {
+		if (setOfSources[i].isOn) {
+			p[(2 * i) / 8] |= (unsigned char)(1 << ((2 * i) % 8));
 		}
-		useableFract = useFract;
-	}
-	else {
-		if (hpwhVerbosity >= VRB_emetic) {
-			msg("\no shutoff logics present");
+		if (setOfSources[i].lockedOut) {
+			p[(2 * i + 1) / 8] |= (unsigned char)(1 << ((2 * i + 1) % 8));
 		}
-		useableFract = 1.;
 	}
+	p += flagBytes;
 
-	// Check if double's are approximately equally and adjust the relationship so it follows the relationship we expect. 
-	// The tolerance plays with 0.1 mm in position if the tank is 1m tall...
-	double temp = 1. - useableFract;
-	if (aboutEqual(aquaFract, temp)) {
-		useableFract = 1. - aquaFract + TOL_MINVALUE;
+	for (int i = 0; i < numNodes; i++) {
+		p = putStateDouble(p, tankTemps_C[i]);
+	}
+	p = putStateDouble(p, outletTemp_C);
+	p = putStateDouble(p, condenserInlet_C);
+	p = putStateDouble(p, energyRemovedFromEnvironment_kWh);
+	p = putStateDouble(p, standbyLosses_kWh);
+	for (int i = 0; i < numHeatSources; i++) {
+		p = putStateDouble(p, setOfSources[i].runtime_min);
+		p = putStateDouble(p, setOfSources[i].energyInput_kWh);
+		p = putStateDouble(p, setOfSources[i].energyOutput_kWh);
+	}
+	putStateUInt(p, stateCRC32(buffer.data(), size - 4), 4);
+	return 0;
+}
+
+int HPWH::loadState(const unsigned char *data, size_t size) {
+	uint64_t value;
+	if (data == NULL || size < STATE_HEADER_BYTES + 4 || memcmp(data, STATE_MAGIC, 4) != 0) {
+		if (hpwhVerbosity >= VRB_reluctant) {
+			msg("This is not a HPWH state snapshot.  \n");
+		}
+		return HPWH_ABORT;
+	}
+	getStateUInt(data + size - 4, value, 4);
+	if ((uint32_t)value != stateCRC32(data, size - 4)) {
+		if (hpwhVerbosity >= VRB_reluctant) {
+			msg("The state snapshot is damaged, its checksum does not match.  \n");
+		}
+		return HPWH_ABORT;
+	}
+
+	const unsigned char *p = getStateUInt(data + 4, value, 2);
+	if (value != STATE_VERSION) {
+		if (hpwhVerbosity >= VRB_reluctant) {
+			msg("The state snapshot is version %d, only version %d can be loaded.  \n", (int)value, STATE_VERSION);
+		}
+		return HPWH_ABORT;
+	}
+	uint64_t model, nodes, sources;
+	p = getStateUInt(p + 2, model, 4);
+	p = getStateUInt(p, nodes, 4);
+	p = getStateUInt(p, sources, 4);
+	size_t flagBytes = (2 * sources + 7) / 8;
+	if ((int)model != (int)hpwhModel || (int)nodes != numNodes || (int)sources != numHeatSources ||
+		size != STATE_HEADER_BYTES + flagBytes + 8 * nodes + 4 * 8 + 3 * 8 * sources + 4) {
+		if (hpwhVerbosity >= VRB_reluctant) {
+			msg("The state snapshot is of a different model.  \n");
+		}
+		return HPWH_ABORT;
+	}
+
+	// everything is checked, nothing can fail from here on
+	p = getStateDouble(p, setpoint_C);
+	p = getStateDouble(p, timerTOT);
+	p = getStateDouble(p, locationTemperature_C);
+	p = getStateUInt(p, value, 4);
+	prevDRstatus = (DRMODES)(int32_t)(uint32_t)value;
+	isHeating = (*p++ != 0);
+	for (int i = 0; i < numHeatSources; i++) {
+		setOfSources[i].isOn = ((p[(2 * i) / 8] >> ((2 * i) % 8)) & 1) != 0;
+		setOfSources[i].lockedOut = ((p[(2 * i + 1) / 8] >> ((2 * i + 1) % 8)) & 1) != 0;
+	}
+	p += flagBytes;
+
+	for (int i = 0; i < numNodes; i++) {
+		p = getStateDouble(p, tankTemps_C[i]);
+	}
+	p = getStateDouble(p, outletTemp_C);
+	p = getStateDouble(p, condenserInlet_C);
+	p = getStateDouble(p, energyRemovedFromEnvironment_kWh);
+	p = getStateDouble(p, standbyLosses_kWh);
+	for (int i = 0; i < numHeatSources; i++) {
+		p = getStateDouble(p, setOfSources[i].runtime_min);
+		p = getStateDouble(p, setOfSources[i].energyInput_kWh);
+		p = getStateDouble(p, setOfSources[i].energyOutput_kWh);
+	}
+	return 0;
+}
+
+// the model image format of compileModel, all little endian:
+//   "HPWM", uint16 version, uint16 reserved, then every field of the HPWH and its heat sources
+//   in the order written below (int32 for ints and enums, uint8 for bools, float64 for doubles,
+//   a uint32 count before each vector and string), then uint32 CRC-32 of everything before it
+static const unsigned char IMAGE_MAGIC[4] = { 'H', 'P', 'W', 'M' };
+static const int IMAGE_LOGIC_LESS = 0;
+static const int IMAGE_LOGIC_GREATER = 1;
+
+namespace {
+struct ImageWriter {
+	std::vector<unsigned char> &image;
+	explicit ImageWriter(std::vector<unsigned char> &buffer) : image(buffer) {}
+	void putUInt(uint64_t value, int bytes) {
+		size_t n = image.size();
+		image.resize(n + bytes);
+		putStateUInt(image.data() + n, value, bytes);
+	}
+	void putInt(int value) { putUInt((uint32_t)value, 4); }
+	void putBool(bool value) { putUInt(value ? 1 : 0, 1); }
+	void putDouble(double value) {
+		size_t n = image.size();
+		image.resize(n + 8);
+		putStateDouble(image.data() + n, value);
+	}
+	void putDoubles(const std::vector<double> &values) {
+		putUInt(values.size(), 4);
+		for (double value : values) {
+			putDouble(value);
+		}
+	}
+	void putString(const string &value) {
+		putUInt(value.size(), 4);
+		image.insert(image.end(), value.begin(), value.end());
+	}
+};
+
+// reads fields back, failing instead of running past the end of the image
+struct ImageReader {
+	const unsigned char *p, *end;
+	bool ok;
+	ImageReader(const unsigned char *data, size_t size) : p(data), end(data + size), ok(true) {}
+	uint64_t getUInt(int bytes) {
+		uint64_t value = 0;
+		if (!ok || end - p < bytes) {
+			ok = false;
+			return 0;
+		}
+		p = getStateUInt(p, value, bytes);
+		return value;
+	}
+	int getInt() { return (int32_t)(uint32_t)getUInt(4); }
+	bool getBool() { return getUInt(1) != 0; }
+	double getDouble() {
+		double value = 0.;
+		if (!ok || end - p < 8) {
+			ok = false;
+			return 0.;
+		}
+		p = getStateDouble(p, value);
+		return value;
+	}
+	size_t getCount(size_t itemBytes) {
+		// a count can not promise more items than the bytes left
+		uint64_t count = getUInt(4);
+		if (!ok || count * itemBytes > (uint64_t)(end - p)) {
+			ok = false;
+			return 0;
+		}
+		return (size_t)count;
+	}
+	std::vector<double> getDoubles() {
+		std::vector<double> values(getCount(8));
+		for (double &value : values) {
+			value = getDouble();
+		}
+		return values;
+	}
+	string getString() {
+		size_t n = getCount(1);
+		string value(reinterpret_cast<const char *>(p), n);
+		p += n;
+		return value;
+	}
+};
+}
+
+int HPWH::compileModel(std::vector<unsigned char> &image) const {
+	image.clear();
+	ImageWriter out(image);
+	bool badLogic = false;
+	auto putLogic = [&](const HeatingLogic &logic) {
+		out.putString(logic.description);
+		out.putUInt(logic.nodeWeights.size(), 4);
+		for (const NodeWeight &nodeWeight : logic.nodeWeights) {
+			out.putInt(nodeWeight.nodeNum);
+			out.putDouble(nodeWeight.weight);
+		}
+		out.putDouble(logic.decisionPoint);
+		out.putBool(logic.isAbsolute);
+		if (logic.compare.target<std::less<double> >() != NULL) {
+			out.putInt(IMAGE_LOGIC_LESS);
+		}
+		else if (logic.compare.target<std::greater<double> >() != NULL) {
+			out.putInt(IMAGE_LOGIC_GREATER);
+		}
+		else {
+			badLogic = true;
+			out.putInt(-1);
+		}
+	};
+
+	for (unsigned char c : IMAGE_MAGIC) {
+		out.putUInt(c, 1);
+	}
+	out.putUInt(MODEL_IMAGE_VERSION, 2);
+	out.putUInt(0, 2);
+
+	out.putBool(simHasFailed);
+	out.putBool(isHeating);
+	out.putBool(setpointFixed);
+	out.putBool(tankSizeFixed);
+	out.putBool(canScale);
+	out.putInt(hpwhModel);
+	out.putInt(compressorIndex);
+	out.putInt(lowestElementIndex);
+	out.putInt(highestElementIndex);
+	out.putInt(VIPIndex);
+	out.putInt(nodeDensity);
+	out.putInt(inletHeight);
+	out.putInt(inlet2Height);
+	out.putDouble(tankVolume_L);
+	out.putDouble(tankUA_kJperHrC);
+	out.putDouble(fittingsUA_kJperHrC);
+	out.putDouble(volPerNode_LperNode);
+	out.putDouble(node_height);
+	out.putDouble(fracAreaTop);
+	out.putDouble(fracAreaSide);
+	out.putDouble(setpoint_C);
+	out.putInt(prevDRstatus);
+	out.putDouble(timerLimitTOT);
+	out.putDouble(timerTOT);
+	out.putDouble(outletTemp_C);
+	out.putDouble(condenserInlet_C);
+	out.putDouble(energyRemovedFromEnvironment_kWh);
+	out.putDouble(standbyLosses_kWh);
+	out.putBool(tankMixesOnDraw);
+	out.putBool(doTempDepression);
+	out.putDouble(locationTemperature_C);
+	out.putDouble(maxDepression_C);
+	out.putDouble(member_inletT_C);
+	out.putDouble(minutesPerStep);
+	out.putBool(doInversionMixing);
+	out.putBool(doConduction);
+	out.putBool(doParcelDraws);
+	out.putDouble(parcelTolerance_dC);
+
+	out.putInt(numNodes);
+	out.putBool(tankTemps_C != NULL);
+	out.putBool(nextTankTemps_C != NULL);
+	for (int i = 0; i < numNodes && tankTemps_C != NULL; i++) {
+		out.putDouble(tankTemps_C[i]);
+	}
+	for (int i = 0; i < numNodes && nextTankTemps_C != NULL; i++) {
+		out.putDouble(nextTankTemps_C[i]);
+	}
+
+	out.putInt(numHeatSources);
+	for (int i = 0; i < numHeatSources; i++) {
+		const HeatSource &source = setOfSources[i];
+		out.putBool(source.isOn);
+		out.putBool(source.lockedOut);
+		out.putBool(source.doDefrost);
+		out.putDouble(source.runtime_min);
+		out.putDouble(source.energyInput_kWh);
+		out.putDouble(source.energyOutput_kWh);
+		out.putBool(source.isVIP);
+		out.putInt(source.backupIndex);
+		out.putInt(source.companionIndex);
+		out.putInt(source.followedByIndex);
+		for (int j = 0; j < CONDENSITY_SIZE; j++) {
+			out.putDouble(source.condensity[j]);
+		}
+		out.putDouble(source.shrinkage);
+		out.putUInt(source.perfMap.size(), 4);
+		for (const HeatSource::perfPoint &point : source.perfMap) {
+			out.putDouble(point.T_F);
+			out.putDoubles(point.inputPower_coeffs);
+			out.putDoubles(point.COP_coeffs);
+		}
+		out.putUInt(source.turnOnLogicSet.size(), 4);
+		for (const HeatingLogic &logic : source.turnOnLogicSet) {
+			putLogic(logic);
+		}
+		out.putUInt(source.shutOffLogicSet.size(), 4);
+		for (const HeatingLogic &logic : source.shutOffLogicSet) {
+			putLogic(logic);
+		}
+		out.putBool(source.standbyLogic != NULL);
+		if (source.standbyLogic != NULL) {
+			putLogic(*source.standbyLogic);
+		}
+		out.putUInt(source.defrostMap.size(), 4);
+		for (const HeatSource::defrostPoint &point : source.defrostMap) {
+			out.putDouble(point.T_F);
+			out.putDouble(point.derate_fraction);
+		}
+		out.putDouble(source.maxOut_at_LowT.outT_C);
+		out.putDouble(source.maxOut_at_LowT.airT_C);
+		out.putDouble(source.minT);
+		out.putDouble(source.maxT);
+		out.putDouble(source.maxSetpoint_C);
+		out.putDouble(source.hysteresis_dC);
+		out.putBool(source.depressesTemperature);
+		out.putDouble(source.airflowFreedom);
+		out.putInt(source.configuration);
+		out.putInt(source.typeOfHeatSource);
+		out.putInt(source.lowestNode);
+		out.putInt(source.extrapolationMethod);
+	}
+	out.putUInt(stateCRC32(image.data(), image.size()), 4);
+
+	if (badLogic) {
+		image.clear();
+		if (hpwhVerbosity >= VRB_reluctant) {
+			msg("Only heating logic that compares with std::less or std::greater can be compiled.  \n");
+		}
+		return HPWH_ABORT;
+	}
+	return 0;
+}
+
+int HPWH::compileModelFile(string imageFile) const {
+	std::vector<unsigned char> image;
+	if (compileModel(image) != 0) {
+		return HPWH_ABORT;
+	}
+	std::ofstream outputFILE(imageFile.c_str(), std::ios::binary);
+	outputFILE.write(reinterpret_cast<const char *>(image.data()), image.size());
+	if (!outputFILE.good()) {
+		if (hpwhVerbosity >= VRB_reluctant) {
+			msg("Could not write the model image file.  \n");
+		}
+		return HPWH_ABORT;
+	}
+	return 0;
+}
+
+int HPWH::HPWHinit_image(const unsigned char *image, size_t size) {
+	uint64_t value;
+	if (image == NULL || size < 8 + 4 || memcmp(image, IMAGE_MAGIC, 4) != 0) {
+		if (hpwhVerbosity >= VRB_reluctant) {
+			msg("This is not a HPWH model image.  \n");
+		}
+		return HPWH_ABORT;
+	}
+	getStateUInt(image + size - 4, value, 4);
+	if ((uint32_t)value != stateCRC32(image, size - 4)) {
+		if (hpwhVerbosity >= VRB_reluctant) {
+			msg("The model image is damaged, its checksum does not match.  \n");
+		}
+		return HPWH_ABORT;
+	}
+	getStateUInt(image + 4, value, 2);
+	if (value != MODEL_IMAGE_VERSION) {
+		if (hpwhVerbosity >= VRB_reluctant) {
+			msg("The model image is version %d, only version %d can be loaded.  \n", (int)value, MODEL_IMAGE_VERSION);
+		}
+		return HPWH_ABORT;
+	}
+
+	// build the model on the side, so a bad image leaves this HPWH as it was
+	HPWH model;
+	ImageReader in(image + 8, size - 8 - 4);
+	int nodes = 0;
+	// a model never initialized has no tank, and everything at node 0
+	auto isTankNode = [&](int node) {
+		return node >= 0 && node < std::max(nodes, 1);
+	};
+	auto areLogicNodesValid = [](const HeatingLogic &logic) {
+		for (const NodeWeight &nodeWeight : logic.nodeWeights) {
+			if (nodeWeight.nodeNum < 0 || nodeWeight.nodeNum > 13) {
+				return false;
+			}
+		}
+		return true;
+	};
+	// an enum is only cast once it is known to be one of its values
+	auto getEnum = [&](int first, int last) {
+		int number = in.getInt();
+		in.ok = in.ok && number >= first && number <= last;
+		return in.ok ? number : first;
+	};
+	// the presets and the models the other inits make
+	auto isModel = [](int modelNum) {
+		return findPreset((MODELS)modelNum) != NULL || modelNum == MODELS_genericCustomUEF ||
+			modelNum == MODELS_CustomFile || modelNum == MODELS_CustomResTank || modelNum == MODELS_CustomResTankSwing;
+	};
+	// getCapacity reads the constant, linear and quadratic terms at each point of a map, and all
+	// eleven terms of the regression of a single point map.  Only the extra heat source has none
+	auto isPerfMapValid = [](const HeatSource &source) {
+		if (source.perfMap.empty()) {
+			return source.typeOfHeatSource == TYPE_extra;
+		}
+		const size_t terms = (source.perfMap.size() == 1) ? 11 : 3;
+		for (const HeatSource::perfPoint &point : source.perfMap) {
+			if (point.inputPower_coeffs.size() < terms || point.COP_coeffs.size() < terms) {
+				return false;
+			}
+		}
+		return true;
+	};
+	auto getLogic = [&]() {
+		string description = in.getString();
+		std::vector<NodeWeight> nodeWeights;
+		size_t nWeights = in.getCount(12);
+		for (size_t j = 0; j < nWeights; j++) {
+			int nodeNum = in.getInt();
+			nodeWeights.push_back(NodeWeight(nodeNum, in.getDouble()));
+		}
+		double decisionPoint = in.getDouble();
+		bool isAbsolute = in.getBool();
+		int compare = in.getInt();
+		in.ok = in.ok && (compare == IMAGE_LOGIC_LESS || compare == IMAGE_LOGIC_GREATER);
+		return HeatingLogic(description, nodeWeights, decisionPoint, isAbsolute,
+			(compare == IMAGE_LOGIC_GREATER) ? std::function<bool(double, double)>(std::greater<double>())
+				: std::function<bool(double, double)>(std::less<double>()));
+	};
+
+	model.simHasFailed = in.getBool();
+	model.isHeating = in.getBool();
+	model.setpointFixed = in.getBool();
+	model.tankSizeFixed = in.getBool();
+	model.canScale = in.getBool();
+	int modelNum = in.getInt();
+	in.ok = in.ok && isModel(modelNum);
+	model.hpwhModel = in.ok ? (MODELS)modelNum : MODELS_CustomFile;
+	model.compressorIndex = in.getInt();
+	model.lowestElementIndex = in.getInt();
+	model.highestElementIndex = in.getInt();
+	model.VIPIndex = in.getInt();
+	model.nodeDensity = in.getInt();
+	model.inletHeight = in.getInt();
+	model.inlet2Height = in.getInt();
+	model.tankVolume_L = in.getDouble();
+	model.tankUA_kJperHrC = in.getDouble();
+	model.fittingsUA_kJperHrC = in.getDouble();
+	model.volPerNode_LperNode = in.getDouble();
+	model.node_height = in.getDouble();
+	model.fracAreaTop = in.getDouble();
+	model.fracAreaSide = in.getDouble();
+	model.setpoint_C = in.getDouble();
+	model.prevDRstatus = (DRMODES)getEnum(DR_ALLOW, DR_LOC | DR_LOR | DR_TOO | DR_TOT);
+	model.timerLimitTOT = in.getDouble();
+	model.timerTOT = in.getDouble();
+	model.outletTemp_C = in.getDouble();
+	model.condenserInlet_C = in.getDouble();
+	model.energyRemovedFromEnvironment_kWh = in.getDouble();
+	model.standbyLosses_kWh = in.getDouble();
+	model.tankMixesOnDraw = in.getBool();
+	model.doTempDepression = in.getBool();
+	model.locationTemperature_C = in.getDouble();
+	model.maxDepression_C = in.getDouble();
+	model.member_inletT_C = in.getDouble();
+	model.minutesPerStep = in.getDouble();
+	model.doInversionMixing = in.getBool();
+	model.doConduction = in.getBool();
+	model.doParcelDraws = in.getBool();
+	model.parcelTolerance_dC = in.getDouble();
+
+	nodes = in.getInt();
+	bool hasTankTemps = in.getBool();
+	bool hasNextTankTemps = in.getBool();
+	// a tank has both node arrays, a model never initialized neither
+	if (!in.ok || nodes < 0 || hasTankTemps != (nodes > 0) || hasNextTankTemps != (nodes > 0) || (uint64_t)nodes * 8 * ((hasTankTemps ? 1 : 0) + (hasNextTankTemps ? 1 : 0)) > (uint64_t)(in.end - in.p)) {
+		in.ok = false;
+		nodes = 0;
+	}
+	model.numNodes = nodes;
+	if (hasTankTemps && in.ok) {
+		model.tankTemps_C = new double[nodes];
+		for (int i = 0; i < nodes; i++) {
+			model.tankTemps_C[i] = in.getDouble();
+		}
+	}
+	if (hasNextTankTemps && in.ok) {
+		model.nextTankTemps_C = new double[nodes];
+		for (int i = 0; i < nodes; i++) {
+			model.nextTankTemps_C[i] = in.getDouble();
+		}
+	}
+
+	int sources = in.getInt();
+	if (!in.ok || sources < 0 || sources > (in.end - in.p)) {
+		in.ok = false;
+		sources = 0;
+	}
+	model.numHeatSources = sources;
+	model.setOfSources = (sources > 0) ? new HeatSource[sources] : NULL;
+	for (int i = 0; i < sources && in.ok; i++) {
+		HeatSource &source = model.setOfSources[i];
+		source.hpwh = &model;
+		source.isOn = in.getBool();
+		source.lockedOut = in.getBool();
+		source.doDefrost = in.getBool();
+		source.runtime_min = in.getDouble();
+		source.energyInput_kWh = in.getDouble();
+		source.energyOutput_kWh = in.getDouble();
+		source.isVIP = in.getBool();
+		source.backupIndex = in.getInt();
+		source.companionIndex = in.getInt();
+		source.followedByIndex = in.getInt();
+		for (int j = 0; j < CONDENSITY_SIZE; j++) {
+			source.condensity[j] = in.getDouble();
+		}
+		source.shrinkage = in.getDouble();
+		source.perfMap.resize(in.getCount(8 + 4 + 4));
+		for (HeatSource::perfPoint &point : source.perfMap) {
+			point.T_F = in.getDouble();
+			point.inputPower_coeffs = in.getDoubles();
+			point.COP_coeffs = in.getDoubles();
+		}
+		size_t nLogics = in.getCount(4 + 4 + 8 + 1 + 4);
+		for (size_t j = 0; j < nLogics; j++) {
+			source.turnOnLogicSet.push_back(getLogic());
+		}
+		nLogics = in.getCount(4 + 4 + 8 + 1 + 4);
+		for (size_t j = 0; j < nLogics; j++) {
+			source.shutOffLogicSet.push_back(getLogic());
+		}
+		if (in.getBool()) {
+			source.standbyLogic = std::make_shared<HeatingLogic>(getLogic());
+		}
+		source.defrostMap.resize(in.getCount(16));
+		for (HeatSource::defrostPoint &point : source.defrostMap) {
+			point.T_F = in.getDouble();
+			point.derate_fraction = in.getDouble();
+		}
+		source.maxOut_at_LowT.outT_C = in.getDouble();
+		source.maxOut_at_LowT.airT_C = in.getDouble();
+		source.minT = in.getDouble();
+		source.maxT = in.getDouble();
+		source.maxSetpoint_C = in.getDouble();
+		source.hysteresis_dC = in.getDouble();
+		source.depressesTemperature = in.getBool();
+		source.airflowFreedom = in.getDouble();
+		source.configuration = (HeatSource::COIL_CONFIG)getEnum(HeatSource::CONFIG_SUBMERGED, HeatSource::CONFIG_EXTERNAL);
+		source.typeOfHeatSource = (HEATSOURCE_TYPE)getEnum(TYPE_none, TYPE_extra);
+		source.lowestNode = in.getInt();
+		source.extrapolationMethod = (EXTRAP_METHOD)getEnum(EXTRAP_LINEAR, EXTRAP_NEAREST);
+		in.ok = in.ok && isPerfMapValid(source);
+		for (int link : { source.backupIndex, source.companionIndex, source.followedByIndex }) {
+			in.ok = in.ok && link >= -1 && link < sources;
+		}
+		in.ok = in.ok && isTankNode(source.lowestNode);
+		for (const std::vector<HeatingLogic> *logicSet : { &source.turnOnLogicSet, &source.shutOffLogicSet }) {
+			for (const HeatingLogic &logic : *logicSet) {
+				in.ok = in.ok && areLogicNodesValid(logic);
+			}
+		}
+		in.ok = in.ok && (source.standbyLogic == NULL || areLogicNodesValid(*source.standbyLogic));
+	}
+	for (int index : { model.compressorIndex, model.lowestElementIndex, model.highestElementIndex, model.VIPIndex }) {
+		in.ok = in.ok && index >= -1 && index < sources;
+	}
+	// the nodes the model indexes must be in the tank: the logic nodes spread over nodeDensity
+	// nodes each, and the inlets
+	in.ok = in.ok && model.nodeDensity >= 0 && 12 * model.nodeDensity <= nodes;
+	in.ok = in.ok && isTankNode(model.inletHeight) && isTankNode(model.inlet2Height);
+	if (!in.ok || in.p != in.end) {
+		if (hpwhVerbosity >= VRB_reluctant) {
+			msg("The model image is damaged, its contents do not make a model.  \n");
+		}
+		return HPWH_ABORT;
+	}
+
+	VERBOSITY verbosity = hpwhVerbosity;
+	void (*callback)(const std::string message, void* contextPtr) = messageCallback;
+	void *contextPtr = messageCallbackContextPtr;
+	*this = std::move(model);
+	hpwhVerbosity = verbosity;
+	messageCallback = callback;
+	messageCallbackContextPtr = contextPtr;
+	return 0;
+}
+
+int HPWH::HPWHinit_imageFile(string imageFile) {
+#if !defined(_WIN32)
+	// map the file rather than read it, the image is only looked at once
+	int fd = open(imageFile.c_str(), O_RDONLY);
+	struct stat fileStat;
+	if (fd < 0 || fstat(fd, &fileStat) != 0 || fileStat.st_size == 0) {
+		if (fd >= 0) {
+			close(fd);
+		}
+		if (hpwhVerbosity >= VRB_reluctant) {
+			msg("Model image file failed to open.  \n");
+		}
+		return HPWH_ABORT;
+	}
+	size_t size = (size_t)fileStat.st_size;
+	void *mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapped == MAP_FAILED) {
+		if (hpwhVerbosity >= VRB_reluctant) {
+			msg("Model image file could not be mapped.  \n");
+		}
+		return HPWH_ABORT;
+	}
+	int returnVal = HPWHinit_image(static_cast<const unsigned char *>(mapped), size);
+	munmap(mapped, size);
+	return returnVal;
+#else
+	std::ifstream inputFILE(imageFile.c_str(), std::ios::binary);
+	if (!inputFILE.is_open()) {
+		if (hpwhVerbosity >= VRB_reluctant) {
+			msg("Model image file failed to open.  \n");
+		}
+		return HPWH_ABORT;
+	}
+	std::vector<unsigned char> image((std::istreambuf_iterator<char>(inputFILE)), std::istreambuf_iterator<char>());
+	return HPWHinit_image(image);
+#endif
+}
+
+int HPWH::simulateAhead(int horizon, const AheadInputs &inputs, const std::vector<AheadCandidate> &candidates,
+	std::vector<AheadOutputs> &outputs, int numThreads /*=0*/) const {
+	// check everything up front, so a rollout can only fail in the simulation itself
+	size_t steps = (size_t)std::max(horizon, 0);
+	bool badInput = horizon < 1 || inputs.inletT_C.size() < steps || inputs.drawVolume_L.size() < steps ||
+		inputs.tankAmbientT_C.size() < steps || inputs.heatSourceAmbientT_C.size() < steps;
+	for (const AheadCandidate &candidate : candidates) {
+		badInput = badInput || (!candidate.DRstatus.empty() && candidate.DRstatus.size() < steps) ||
+			(!candidate.setpoint_C.empty() && candidate.setpoint_C.size() < steps);
+		for (size_t i = 0; i < candidate.setpoint_C.size() && !badInput; i++) {
+			double maxAllowedSetpoint_C;
+			badInput = !isNewSetpointPossible(candidate.setpoint_C[i], maxAllowedSetpoint_C);
+		}
+	}
+	if (badInput) {
+		if (hpwhVerbosity >= VRB_reluctant) {
+			msg("simulateAhead needs a positive horizon, inputs and trajectories at least that long, and setpoints the model can reach.  \n");
+		}
+		return HPWH_ABORT;
+	}
+
+	outputs.assign(candidates.size(), AheadOutputs());
+	if (numThreads < 1) {
+		numThreads = std::max(1, (int)std::thread::hardware_concurrency());
+	}
+	numThreads = std::min(numThreads, std::max(1, (int)candidates.size()));
+
+	// each thread takes the next candidate and rolls it out on its own copy
+	std::atomic<int> nextCandidate(0);
+	std::atomic<bool> failed(false);
+	auto worker = [&]() {
+		HPWH scratch;
+		for (int c = nextCandidate++; c < (int)candidates.size(); c = nextCandidate++) {
+			scratch = *this;
+			scratch.setVerbosity(VRB_silent);
+			const AheadCandidate &candidate = candidates[c];
+			AheadOutputs &out = outputs[c];
+			out.energyInput_kWh = 0.;
+			out.energyOutput_kWh = 0.;
+			out.drawVolume_L = 0.;
+			out.outletTemp_C = 0.;
+			out.minOutletTemp_C = 0.;
+			out.stepEnergyInput_kWh.assign(steps, 0.);
+			out.stepOutletTemp_C.assign(steps, 0.);
+			bool haveDraw = false;
+			for (size_t i = 0; i < steps; i++) {
+				if (!candidate.setpoint_C.empty() && candidate.setpoint_C[i] != scratch.setpoint_C) {
+					scratch.setSetpoint(candidate.setpoint_C[i]);
+				}
+				DRMODES DRstatus = candidate.DRstatus.empty() ? DR_ALLOW : candidate.DRstatus[i];
+				if (scratch.runOneStep(inputs.inletT_C[i], inputs.drawVolume_L[i], inputs.tankAmbientT_C[i],
+					inputs.heatSourceAmbientT_C[i], DRstatus) != 0) {
+					failed = true;
+					return;
+				}
+				for (int n = 0; n < scratch.numHeatSources; n++) {
+					out.stepEnergyInput_kWh[i] += scratch.setOfSources[n].energyInput_kWh;
+					out.energyOutput_kWh += scratch.setOfSources[n].energyOutput_kWh;
+				}
+				out.energyInput_kWh += out.stepEnergyInput_kWh[i];
+				if (inputs.drawVolume_L[i] > 0.) {
+					double outletT_C = scratch.outletTemp_C;
+					out.stepOutletTemp_C[i] = outletT_C;
+					out.outletTemp_C += inputs.drawVolume_L[i] * outletT_C;
+					out.drawVolume_L += inputs.drawVolume_L[i];
+					out.minOutletTemp_C = haveDraw ? std::min(out.minOutletTemp_C, outletT_C) : outletT_C;
+					haveDraw = true;
+				}
+			}
+			if (out.drawVolume_L > 0.) {
+				out.outletTemp_C /= out.drawVolume_L;
+			}
+			out.finalTankHeatContent_kJ = scratch.getTankHeatContent_kJ();
+		}
+	};
+
+	if (numThreads == 1) {
+		worker();
+	}
+	else {
+		std::vector<std::thread> threads;
+		for (int t = 0; t < numThreads; t++) {
+			threads.push_back(std::thread(worker));
+		}
+		for (auto &thread : threads) {
+			thread.join();
+		}
+	}
+
+	if (failed) {
+		if (hpwhVerbosity >= VRB_reluctant) {
+			msg("A simulateAhead rollout failed.  \n");
+		}
+		return HPWH_ABORT;
+	}
+	return 0;
+}
+
+int HPWH::getHPWHModel() const {
+	return hpwhModel;
+}
+
+bool HPWH::hasACompressor() const {
+	return compressorIndex >= 0;
+}
+
+double HPWH::getCompressorMinRuntime(UNITS units /*=UNITS_MIN*/) const {
+
+	if (hasACompressor()) {
+		double min_minutes = 10.;
+
+		if (units == UNITS_MIN) {
+			return min_minutes;
+		}
+		else if (units == UNITS_SEC) {
+			return MIN_TO_SEC(min_minutes);
+		}
+		else if (units == UNITS_HR) {
+			return MIN_TO_HR(min_minutes);
+		}
+		else {
+			if (hpwhVerbosity >= VRB_reluctant) {
+				msg("Incorrect unit specification for getCompressorMinRunTime.  \n");
+			}
+			return (double)HPWH_ABORT;
+		}
+	}
+	else {
+		if (hpwhVerbosity >= VRB_reluctant) {
+			msg("This HPWH has no compressor.  \n");
+		}
+		return (double)HPWH_ABORT;
+	}
+}
+
+
+int HPWH::getSizingFractions(double &aquaFract, double &useableFract) const {
+	double aFract = 1.;
+	double useFract = 1.;
+
+	if (!hasACompressor()) {
+		if (hpwhVerbosity >= VRB_reluctant) {
+			msg("Current model does not have a compressor.  \n");
+		}
+		return HPWH_ABORT;
+	}
+
+	// Every compressor must have at least one on logic
+	for( auto onLogic : setOfSources[compressorIndex].turnOnLogicSet) {
+		double tempA;
+
+		if (hpwhVerbosity >= VRB_emetic) {
+			msg("\tturnon logic: %s ", onLogic.description.c_str());
+		}
+		tempA = nodeWeightAvgFract(onLogic); // if standby logic will return 1
+		aFract = tempA < aFract ? tempA : aFract;
+	}
+	aquaFract = aFract;
+
+	// Compressors don't need to have an off logic
+	if (setOfSources[compressorIndex].shutOffLogicSet.size() != 0) {
+		for (auto offLogic : setOfSources[compressorIndex].shutOffLogicSet) {
+		
+			double tempUse;
+
+			if (hpwhVerbosity >= VRB_emetic) {
+				msg("\tshutsOff logic: %s ", offLogic.description.c_str());
+			}
+			if (offLogic.description == "large draw" || offLogic.description == "larger draw") {
+				tempUse = 1.; // These logics are just for checking if there's a big draw to switch to RE
+			}
+			else {
+				tempUse = 1. - nodeWeightAvgFract(offLogic);
+			}
+			useFract = tempUse < useFract ? tempUse : useFract; // Will return the smallest case of the useable fraction for multiple off logics
+		}
+		useableFract = useFract;
+	}
+	else {
+		if (hpwhVerbosity >= VRB_emetic) {
+			msg("\no shutoff logics present");
+		}
+		useableFract = 1.;
+	}
+
+	// Check if double's are approximately equally and adjust the relationship so it follows the relationship we expect. 
+	// The tolerance plays with 0.1 mm in position if the tank is 1m tall...
+	double temp = 1. - useableFract;
+	if (aboutEqual(aquaFract, temp)) {
+		useableFract = 1. - aquaFract + TOL_MINVALUE;
 	}
 
 	return 0;
@@ -2058,74 +3010,79 @@ void HPWH::updateTankTemps(double drawVolume_L, double inletT_C, double tankAmbi
 			lowInletT = inletT_C;
 			lowInletV = drawVolume_L - inletVol2_L;
 		}
-		//calculate how many nodes to draw (drawVolume_N)
-		drawVolume_N = drawVolume_L / volPerNode_LperNode;
-		if (drawVolume_L > tankVolume_L) {
-			if (hpwhVerbosity >= VRB_reluctant) {
-				//msg("WARNING: Drawing more than the tank volume in one step is undefined behavior.  Terminating simulation.  \n");
-				msg("WARNING: Drawing more than the tank volume in one step is undefined behavior.  Continuing simulation at your own risk.  \n");
-			}
-			//simHasFailed = true;
-			//return;
-			for (int i = 0; i < numNodes; i++){
-				outletTemp_C += tankTemps_C[i];
-				tankTemps_C[i] = (inletT_C * (drawVolume_L - inletVol2_L) + inletT2_C * inletVol2_L) / drawVolume_L;
+		if (doParcelDraws) {
+			drawTankParcels(lowInletH, lowInletV, lowInletT, highInletH, highInletV, highInletT);
+		}
+		else {
+			//calculate how many nodes to draw (drawVolume_N)
+			drawVolume_N = drawVolume_L / volPerNode_LperNode;
+			if (drawVolume_L > tankVolume_L) {
+				if (hpwhVerbosity >= VRB_reluctant) {
+					//msg("WARNING: Drawing more than the tank volume in one step is undefined behavior.  Terminating simulation.  \n");
+					msg("WARNING: Drawing more than the tank volume in one step is undefined behavior.  Continuing simulation at your own risk.  \n");
+				}
+				//simHasFailed = true;
+				//return;
+				for (int i = 0; i < numNodes; i++){
+					outletTemp_C += tankTemps_C[i];
+					tankTemps_C[i] = (inletT_C * (drawVolume_L - inletVol2_L) + inletT2_C * inletVol2_L) / drawVolume_L;
+				}
+				outletTemp_C = (outletTemp_C / numNodes * tankVolume_L + tankTemps_C[0] * (drawVolume_L - tankVolume_L))/drawVolume_L * (drawVolume_L / volPerNode_LperNode);
+
+				drawVolume_N = 0.;
 			}
-			outletTemp_C = (outletTemp_C / numNodes * tankVolume_L + tankTemps_C[0] * (drawVolume_L - tankVolume_L))/drawVolume_L * (drawVolume_L / volPerNode_LperNode);
 
-			drawVolume_N = 0.;
-		}
+			/////////////////////////////////////////////////////////////////////////////////////////////////
 
-		/////////////////////////////////////////////////////////////////////////////////////////////////
+			while (drawVolume_N > 0) {
 
-		while (drawVolume_N > 0) {
+				// Draw one node at a time
+				drawFraction = drawVolume_N > 1. ? 1. : drawVolume_N;
 
-			// Draw one node at a time
-			drawFraction = drawVolume_N > 1. ? 1. : drawVolume_N;
+				//add temperature for outletT average
+				outletTemp_C += drawFraction * tankTemps_C[numNodes - 1];
 
-			//add temperature for outletT average
-			outletTemp_C += drawFraction * tankTemps_C[numNodes - 1];
+				cumInletFraction = 0.;
+				for (int i = numNodes - 1; i >= lowInletH; i--) {
 
-			cumInletFraction = 0.;
-			for (int i = numNodes - 1; i >= lowInletH; i--) {
+					// Reset inlet inputs at this node. 
+					nodeInletFraction = 0.;
+					nodeInletTV = 0.;
 
-				// Reset inlet inputs at this node. 
-				nodeInletFraction = 0.;
-				nodeInletTV = 0.;
+					// Sum of all inlets Vi*Ti at this node
+					if (i == highInletH) {
+						nodeInletTV += highInletV * drawFraction / drawVolume_L * highInletT;
+						nodeInletFraction += highInletV * drawFraction / drawVolume_L;
+					}
+					if (i == lowInletH) {
+						nodeInletTV += lowInletV * drawFraction / drawVolume_L * lowInletT;
+						nodeInletFraction += lowInletV * drawFraction / drawVolume_L;
 
-				// Sum of all inlets Vi*Ti at this node
-				if (i == highInletH) {
-					nodeInletTV += highInletV * drawFraction / drawVolume_L * highInletT;
-					nodeInletFraction += highInletV * drawFraction / drawVolume_L;
-				}
-				if (i == lowInletH) {
-					nodeInletTV += lowInletV * drawFraction / drawVolume_L * lowInletT;
-					nodeInletFraction += lowInletV * drawFraction / drawVolume_L;
+						break; // if this is the bottom inlet break out of the four loop and use the boundary condition equation. 
+					}
+
+					// Look at the volume and temperature fluxes into this node
+					tankTemps_C[i] = (1. - (drawFraction - cumInletFraction)) * tankTemps_C[i] +
+						nodeInletTV +
+						(drawFraction - (cumInletFraction + nodeInletFraction)) * tankTemps_C[i - 1];
+
+					cumInletFraction += nodeInletFraction;
 
-					break; // if this is the bottom inlet break out of the four loop and use the boundary condition equation. 
 				}
 
-				// Look at the volume and temperature fluxes into this node
-				tankTemps_C[i] = (1. - (drawFraction - cumInletFraction)) * tankTemps_C[i] +
-					nodeInletTV +
-					(drawFraction - (cumInletFraction + nodeInletFraction)) * tankTemps_C[i - 1];
+				// Boundary condition equation because it shouldn't take anything from tankTemps_C[i - 1] but it also might not exist. 
+				tankTemps_C[lowInletH] = (1. - (drawFraction - cumInletFraction)) * tankTemps_C[lowInletH] + nodeInletTV;
 
-				cumInletFraction += nodeInletFraction;
+				drawVolume_N -= drawFraction;
 
+				mixTankInversions();			
 			}
 
-			// Boundary condition equation because it shouldn't take anything from tankTemps_C[i - 1] but it also might not exist. 
-			tankTemps_C[lowInletH] = (1. - (drawFraction - cumInletFraction)) * tankTemps_C[lowInletH] + nodeInletTV;
-
-			drawVolume_N -= drawFraction;
 
-			mixTankInversions();			
+			//fill in average outlet T - it is a weighted averaged, with weights == nodes drawn
+			this->outletTemp_C /= (drawVolume_L / volPerNode_LperNode);
 		}
 
-
-		//fill in average outlet T - it is a weighted averaged, with weights == nodes drawn
-		this->outletTemp_C /= (drawVolume_L / volPerNode_LperNode);
-
 		/////////////////////////////////////////////////////////////////////////////////////////////////
 
 		//Account for mixing at the bottom of the tank
@@ -2219,18 +3176,117 @@ void HPWH::updateTankTemps(double drawVolume_L, double inletT_C, double tankAmbi
 }  //end updateTankTemps
 
 
-// Inversion mixing modeled after bigladder EnergyPlus code PK
-void HPWH::mixTankInversions() {
-	bool hasInversion;
-	const double volumePerNode_L = tankVolume_L / numNodes;
-	//int numdos = 0;
-	if(doInversionMixing) {
-		do {
-			hasInversion = false;
-			//Start from the top and check downwards
-			for (int i = numNodes - 1; i > 0; i--) {
-				if (tankTemps_C[i] < tankTemps_C[i - 1]) {
-					// Temperature inversion!
+void HPWH::drawTankParcels(int lowInletH, double lowInletV_L, double lowInletT_C,
+	int highInletH, double highInletV_L, double highInletT_C) {
+	// Plug flow: the water below the low inlet does not move, the low inlet water pushes the water
+	// between the inlets up, and what rises past the high inlet mixes with the high inlet water
+	// in proportion to the two flows and pushes the water above up and out of the top.  The stacks
+	// are reused from draw to draw, so a draw step does not allocate.
+	static thread_local std::vector<TankParcel> lower, upper, stay, rising, remaining, outflow;
+	lower.clear();
+	upper.clear();
+
+	addTankParcel(lower, lowInletV_L, lowInletT_C);
+	for (int i = lowInletH; i < highInletH; i++) {
+		addTankParcel(lower, volPerNode_LperNode, tankTemps_C[i]);
+	}
+	splitTankParcels(lower, (highInletH - lowInletH) * volPerNode_LperNode, stay, rising);
+
+	if (lowInletV_L > 0.) {
+		const double ratio = highInletV_L / lowInletV_L;
+		for (const TankParcel &parcel : rising) {
+			addTankParcel(upper, parcel.vol_L * (1. + ratio), (parcel.T_C + ratio * highInletT_C) / (1. + ratio));
+		}
+	}
+	else {
+		addTankParcel(upper, highInletV_L, highInletT_C);
+	}
+	for (int i = highInletH; i < numNodes; i++) {
+		addTankParcel(upper, volPerNode_LperNode, tankTemps_C[i]);
+	}
+	splitTankParcels(upper, (numNodes - highInletH) * volPerNode_LperNode, remaining, outflow);
+
+	double outletTV = 0., outletV = 0.;
+	for (const TankParcel &parcel : outflow) {
+		outletTV += parcel.vol_L * parcel.T_C;
+		outletV += parcel.vol_L;
+	}
+	outletTemp_C = (outletV > 0.) ? outletTV / outletV : tankTemps_C[numNodes - 1];
+
+	resampleTankParcels(stay, lowInletH, highInletH);
+	resampleTankParcels(remaining, highInletH, numNodes);
+}
+
+void HPWH::addTankParcel(std::vector<TankParcel> &stack, double vol_L, double T_C) const {
+	if (vol_L <= 0.) {
+		return;
+	}
+	if (!stack.empty() && fabs(stack.back().T_C - T_C) <= parcelTolerance_dC) {
+		TankParcel &top = stack.back();
+		top.T_C = (top.vol_L * top.T_C + vol_L * T_C) / (top.vol_L + vol_L);
+		top.vol_L += vol_L;
+		return;
+	}
+	TankParcel parcel = { vol_L, T_C };
+	stack.push_back(parcel);
+}
+
+void HPWH::splitTankParcels(const std::vector<TankParcel> &stack, double bottomVol_L,
+	std::vector<TankParcel> &bottom, std::vector<TankParcel> &top) const {
+	bottom.clear();
+	top.clear();
+	double below_L = 0.;
+	for (const TankParcel &parcel : stack) {
+		if (below_L >= bottomVol_L) {
+			top.push_back(parcel);
+		}
+		else if (below_L + parcel.vol_L <= bottomVol_L) {
+			bottom.push_back(parcel);
+		}
+		else {
+			TankParcel part = { bottomVol_L - below_L, parcel.T_C };
+			bottom.push_back(part);
+			part.vol_L = parcel.vol_L - part.vol_L;
+			top.push_back(part);
+		}
+		below_L += parcel.vol_L;
+	}
+}
+
+void HPWH::resampleTankParcels(const std::vector<TankParcel> &stack, int firstNode, int endNode) {
+	size_t p = 0;
+	double left_L = stack.empty() ? 0. : stack[0].vol_L;
+	for (int i = firstNode; i < endNode; i++) {
+		double need_L = volPerNode_LperNode, nodeTV = 0.;
+		while (need_L > 0. && p < stack.size()) {
+			double take_L = std::min(need_L, left_L);
+			nodeTV += take_L * stack[p].T_C;
+			need_L -= take_L;
+			left_L -= take_L;
+			if (left_L <= 0.) {
+				p++;
+				left_L = (p < stack.size()) ? stack[p].vol_L : 0.;
+			}
+		}
+		// roundoff can leave the last node a hair short of water
+		if (volPerNode_LperNode - need_L > 0.) {
+			tankTemps_C[i] = nodeTV / (volPerNode_LperNode - need_L);
+		}
+	}
+}
+
+// Inversion mixing modeled after bigladder EnergyPlus code PK
+void HPWH::mixTankInversions() {
+	bool hasInversion;
+	const double volumePerNode_L = tankVolume_L / numNodes;
+	//int numdos = 0;
+	if(doInversionMixing) {
+		do {
+			hasInversion = false;
+			//Start from the top and check downwards
+			for (int i = numNodes - 1; i > 0; i--) {
+				if (tankTemps_C[i] < tankTemps_C[i - 1]) {
+					// Temperature inversion!
 					hasInversion = true;
 
 					//Mix this inversion mixing temperature by averaging all of the inverted nodes together together. 
@@ -2310,7 +3366,7 @@ bool HPWH::areAllHeatSourcesOff() const {
 	return allOff;
 }
 
-double HPWH::tankAvg_C(const std::vector<HPWH::NodeWeight> nodeWeights) const {
+double HPWH::tankAvg_C(const std::vector<HPWH::NodeWeight> &nodeWeights) const {
 	double sum = 0;
 	double totWeight = 0;
 
@@ -2339,118 +3395,23 @@ double HPWH::tankAvg_C(const std::vector<HPWH::NodeWeight> nodeWeights) const {
 //these are the HeatSource functions
 //the public functions
 HPWH::HeatSource::HeatSource(HPWH *parentInput)
-	:hpwh(parentInput), isOn(false), lockedOut(false), doDefrost(false), backupHeatSource(NULL), companionHeatSource(NULL),
-	followedByHeatSource(NULL), minT(-273.15), maxT(100), hysteresis_dC(0), airflowFreedom(1.0), maxSetpoint_C(100.),
-	typeOfHeatSource(TYPE_none), extrapolationMethod(EXTRAP_LINEAR), maxOut_at_LowT{100, -273.15}, standbyLogic(NULL)
+	:hpwh(parentInput), isOn(false), lockedOut(false), doDefrost(false), runtime_min(0.), energyInput_kWh(0.),
+	energyOutput_kWh(0.), isVIP(false), backupIndex(-1), companionIndex(-1), followedByIndex(-1),
+	condensity(), shrinkage(0.), maxOut_at_LowT{100, -273.15}, minT(-273.15), maxT(100),
+	maxSetpoint_C(100.), hysteresis_dC(0), depressesTemperature(false), airflowFreedom(1.0),
+	configuration(CONFIG_SUBMERGED), typeOfHeatSource(TYPE_none), lowestNode(0), extrapolationMethod(EXTRAP_LINEAR)
 {}
 
-HPWH::HeatSource::HeatSource(const HeatSource &hSource) {
-	hpwh = hSource.hpwh;
-	isOn = hSource.isOn;
-	lockedOut = hSource.lockedOut;
-	doDefrost = hSource.doDefrost;
-
-	runtime_min = hSource.runtime_min;
-	energyInput_kWh = hSource.energyInput_kWh;
-	energyOutput_kWh = hSource.energyOutput_kWh;
-
-	isVIP = hSource.isVIP;
-
-	if (hSource.backupHeatSource != NULL || hSource.companionHeatSource != NULL || hSource.followedByHeatSource != NULL) {
-		hpwh->simHasFailed = true;
-		if (hpwh->hpwhVerbosity >= VRB_reluctant) {
-			hpwh->msg("HeatSources cannot be copied if they contain pointers to other HeatSources\n");
-		}
-	}
-
-	for (int i = 0; i < CONDENSITY_SIZE; i++) {
-		condensity[i] = hSource.condensity[i];
-	}
-	shrinkage = hSource.shrinkage;
-
-	perfMap = hSource.perfMap;
-	
-	defrostMap = hSource.defrostMap;
-
-	//i think vector assignment works correctly here
-	turnOnLogicSet = hSource.turnOnLogicSet;
-	shutOffLogicSet = hSource.shutOffLogicSet;
-	standbyLogic = hSource.standbyLogic;
-
-	minT = hSource.minT;
-	maxT = hSource.maxT;
-	maxOut_at_LowT = hSource.maxOut_at_LowT;
-	hysteresis_dC = hSource.hysteresis_dC;
-	maxSetpoint_C = hSource.maxSetpoint_C;
-
-	depressesTemperature = hSource.depressesTemperature;
-	airflowFreedom = hSource.airflowFreedom;
-
-	configuration = hSource.configuration;
-	typeOfHeatSource = hSource.typeOfHeatSource;
-
-	lowestNode = hSource.lowestNode;
-
-	extrapolationMethod = hSource.extrapolationMethod;
+HPWH::HeatSource *HPWH::HeatSource::backupHeatSource() const {
+	return (backupIndex < 0) ? NULL : &hpwh->setOfSources[backupIndex];
 }
 
-HPWH::HeatSource& HPWH::HeatSource::operator=(const HeatSource &hSource) {
-	if (this == &hSource) {
-		return *this;
-	}
-
-	hpwh = hSource.hpwh;
-	isOn = hSource.isOn;
-	lockedOut = hSource.lockedOut;
-	doDefrost = hSource.doDefrost;
-
-	runtime_min = hSource.runtime_min;
-	energyInput_kWh = hSource.energyInput_kWh;
-	energyOutput_kWh = hSource.energyOutput_kWh;
-
-	isVIP = hSource.isVIP;
-
-	if (hSource.backupHeatSource != NULL || hSource.companionHeatSource != NULL || hSource.followedByHeatSource != NULL) {
-		hpwh->simHasFailed = true;
-		if (hpwh->hpwhVerbosity >= VRB_reluctant) {
-			hpwh->msg("HeatSources cannot be copied if they contain pointers to other HeatSources\n");
-		}
-	}
-	else {
-		companionHeatSource = NULL;
-		backupHeatSource = NULL;
-		followedByHeatSource = NULL;
-	}
-
-	for (int i = 0; i < CONDENSITY_SIZE; i++) {
-		condensity[i] = hSource.condensity[i];
-	}
-	shrinkage = hSource.shrinkage;
-
-	perfMap = hSource.perfMap;
-
-	defrostMap = hSource.defrostMap;
-
-	//i think vector assignment works correctly here
-	turnOnLogicSet = hSource.turnOnLogicSet;
-	shutOffLogicSet = hSource.shutOffLogicSet;
-	standbyLogic = hSource.standbyLogic;
-
-	minT = hSource.minT;
-	maxT = hSource.maxT;
-	maxOut_at_LowT = hSource.maxOut_at_LowT;
-	hysteresis_dC = hSource.hysteresis_dC;
-	maxSetpoint_C = hSource.maxSetpoint_C;
-
-	depressesTemperature = hSource.depressesTemperature;
-	airflowFreedom = hSource.airflowFreedom;
-
-	configuration = hSource.configuration;
-	typeOfHeatSource = hSource.typeOfHeatSource;
+HPWH::HeatSource *HPWH::HeatSource::companionHeatSource() const {
+	return (companionIndex < 0) ? NULL : &hpwh->setOfSources[companionIndex];
+}
 
-	lowestNode = hSource.lowestNode;
-	extrapolationMethod = hSource.extrapolationMethod;
-	return *this;
+HPWH::HeatSource *HPWH::HeatSource::followedByHeatSource() const {
+	return (followedByIndex < 0) ? NULL : &hpwh->setOfSources[followedByIndex];
 }
 
 
@@ -2474,7 +3435,7 @@ void HPWH::HeatSource::setCondensity(double cnd1, double cnd2, double cnd3, doub
 
 int HPWH::HeatSource::findParent() const {
 	for (int i = 0; i < hpwh->numHeatSources; ++i) {
-		if (this == hpwh->setOfSources[i].backupHeatSource) {
+		if (this == hpwh->setOfSources[i].backupHeatSource()) {
 			return i;
 		}
 	}
@@ -2626,12 +3587,12 @@ void HPWH::resetTopOffTimer() {
 void HPWH::HeatSource::engageHeatSource(DRMODES DR_signal) {
 	isOn = true;
 	hpwh->isHeating = true;
-	if (companionHeatSource != NULL &&
-		companionHeatSource->shutsOff() != true &&
-		companionHeatSource->isEngaged() == false &&
-		hpwh->shouldDRLockOut(companionHeatSource->typeOfHeatSource, DR_signal) == false)
+	if (companionHeatSource() != NULL &&
+		companionHeatSource()->shutsOff() != true &&
+		companionHeatSource()->isEngaged() == false &&
+		hpwh->shouldDRLockOut(companionHeatSource()->typeOfHeatSource, DR_signal) == false)
 	{
-		companionHeatSource->engageHeatSource(DR_signal);
+		companionHeatSource()->engageHeatSource(DR_signal);
 	}
 }
 
@@ -2847,10 +3808,10 @@ void HPWH::HeatSource::addHeat(double externalT_C, double minutesToRun) {
 	case CONFIG_SUBMERGED:
 	case CONFIG_WRAPPED:
 	{
-		static std::vector<double> heatDistribution(hpwh->numNodes);
-		//clear the heatDistribution vector, since it's static it is still holding the
-		//distribution from the last go around
+		// reused from step to step, so heating does not allocate
+		static thread_local std::vector<double> heatDistribution;
 		heatDistribution.clear();
+		heatDistribution.reserve(hpwh->numNodes);
 		//calcHeatDist takes care of the swooping for wrapped configurations
 		calcHeatDist(heatDistribution);
 
@@ -3487,14 +4448,12 @@ void HPWH::calcDerivedValues() {
 }
 
 void HPWH::calcDerivedHeatingValues(){
-	static char outputString[MAXOUTSTRING];  //this is used for debugging outputs
-
 	//condentropy/shrinkage
 	double condentropy = 0;
 	double alpha = 1, beta = 2;  // Mapping from condentropy to shrinkage
 	for (int i = 0; i < numHeatSources; i++) {
 		if (hpwhVerbosity >= VRB_emetic) {
-			msg(outputString, "Heat Source %d \n", i);
+			msg("Heat Source %d \n", i);
 		}
 
 		// Calculate condentropy and ==> shrinkage
@@ -3502,12 +4461,12 @@ void HPWH::calcDerivedHeatingValues(){
 		for (int j = 0; j < CONDENSITY_SIZE; j++) {
 			if (setOfSources[i].condensity[j] > 0) {
 				condentropy -= setOfSources[i].condensity[j] * log(setOfSources[i].condensity[j]);
-				if (hpwhVerbosity >= VRB_emetic)  msg(outputString, "condentropy %.2lf \n", condentropy);
+				if (hpwhVerbosity >= VRB_emetic)  msg("condentropy %.2lf \n", condentropy);
 			}
 		}
 		setOfSources[i].shrinkage = alpha + condentropy * beta;
 		if (hpwhVerbosity >= VRB_emetic) {
-			msg(outputString, "shrinkage %.2lf \n\n", setOfSources[i].shrinkage);
+			msg("shrinkage %.2lf \n\n", setOfSources[i].shrinkage);
 		}
 	}
 
@@ -3516,12 +4475,12 @@ void HPWH::calcDerivedHeatingValues(){
 	for (int i = 0; i < numHeatSources; i++) {
 		lowest = 0;
 		if (hpwhVerbosity >= VRB_emetic) {
-			msg(outputString, "Heat Source %d \n", i);
+			msg("Heat Source %d \n", i);
 		}
 
 		for (int j = 0; j < numNodes; j++) {
 			if (hpwhVerbosity >= VRB_emetic) {
-				msg(outputString, "j: %d  j/ (numNodes/CONDENSITY_SIZE) %d \n", j, j / (numNodes / CONDENSITY_SIZE));
+				msg("j: %d  j/ (numNodes/CONDENSITY_SIZE) %d \n", j, j / (numNodes / CONDENSITY_SIZE));
 			}
 
 			if (setOfSources[i].condensity[(j / (numNodes / CONDENSITY_SIZE))] > 0) {
@@ -3530,7 +4489,7 @@ void HPWH::calcDerivedHeatingValues(){
 			}
 		}
 		if (hpwhVerbosity >= VRB_emetic) {
-			msg(outputString, " lowest : %d \n", lowest);
+			msg(" lowest : %d \n", lowest);
 		}
 
 		setOfSources[i].lowestNode = lowest;
@@ -3573,11 +4532,11 @@ void HPWH::calcDerivedHeatingValues(){
 	}
 
 	if (hpwhVerbosity >= VRB_emetic) {
-		msg(outputString, " compressorIndex : %d \n", compressorIndex);
-		msg(outputString, " lowestElementIndex : %d \n", lowestElementIndex);
+		msg(" compressorIndex : %d \n", compressorIndex);
+		msg(" lowestElementIndex : %d \n", lowestElementIndex);
 	}	
 	if (hpwhVerbosity >= VRB_emetic) {
-		msg(outputString, " VIPIndex : %d \n", VIPIndex);
+		msg(" VIPIndex : %d \n", VIPIndex);
 	}
 
 	//heat source ability to depress temp
@@ -3715,7 +4674,265 @@ int HPWH::checkInputs() {
 	return returnVal;
 }
 
+namespace {
+// initialized HPWHs for the cached inits, shared by every thread
+struct PrototypeCache {
+	std::mutex mutex;
+	std::map<HPWH::MODELS, std::shared_ptr<const HPWH> > presets;
+	std::map<string, std::shared_ptr<const HPWH> > files;
+};
+
+PrototypeCache &prototypeCache() {
+	static PrototypeCache cache;
+	return cache;
+}
+}
+
+std::shared_ptr<const HPWH> HPWH::makePrototype() const {
+	std::shared_ptr<HPWH> prototype = std::make_shared<HPWH>(*this);
+	prototype->hpwhVerbosity = VRB_silent;
+	prototype->messageCallback = NULL;
+	prototype->messageCallbackContextPtr = NULL;
+	return prototype;
+}
+
+void HPWH::copyPrototype(const HPWH &prototype) {
+	VERBOSITY verbosity = hpwhVerbosity;
+	void (*callback)(const std::string message, void* contextPtr) = messageCallback;
+	void *contextPtr = messageCallbackContextPtr;
+	*this = prototype;
+	hpwhVerbosity = verbosity;
+	messageCallback = callback;
+	messageCallbackContextPtr = contextPtr;
+}
+
+int HPWH::HPWHinit_presetsCached(MODELS presetNum) {
+	PrototypeCache &cache = prototypeCache();
+	std::shared_ptr<const HPWH> prototype;
+	{
+		std::lock_guard<std::mutex> lock(cache.mutex);
+		auto found = cache.presets.find(presetNum);
+		if (found != cache.presets.end()) {
+			prototype = found->second;
+		}
+	}
+	if (prototype) {
+		copyPrototype(*prototype);
+		return 0;
+	}
+
+	// initialize outside the lock, if two threads race the first prototype stored is kept
+	if (HPWHinit_presets(presetNum) != 0) {
+		return HPWH_ABORT;
+	}
+	prototype = makePrototype();
+	std::lock_guard<std::mutex> lock(cache.mutex);
+	cache.presets.insert(std::make_pair(presetNum, prototype));
+	return 0;
+}
+
+void HPWH::clearPrototypeCache() {
+	PrototypeCache &cache = prototypeCache();
+	std::lock_guard<std::mutex> lock(cache.mutex);
+	cache.presets.clear();
+	cache.files.clear();
+}
+
 #ifndef HPWH_ABRIDGED
+int HPWH::HPWHinit_fileCached(string configFile) {
+	PrototypeCache &cache = prototypeCache();
+	std::shared_ptr<const HPWH> prototype;
+	{
+		std::lock_guard<std::mutex> lock(cache.mutex);
+		auto found = cache.files.find(configFile);
+		if (found != cache.files.end()) {
+			prototype = found->second;
+		}
+	}
+	if (prototype) {
+		copyPrototype(*prototype);
+		return 0;
+	}
+
+	if (HPWHinit_file(configFile) != 0) {
+		return HPWH_ABORT;
+	}
+	prototype = makePrototype();
+	std::lock_guard<std::mutex> lock(cache.mutex);
+	cache.files.insert(std::make_pair(configFile, prototype));
+	return 0;
+}
+
+namespace {
+// a whitespace separated word of a model file, pointing into the file buffer
+struct ConfigToken {
+	const char *begin;
+	size_t length;
+	ConfigToken() : begin(NULL), length(0) {}
+	bool is(const char *word) const {
+		return strlen(word) == length && memcmp(begin, word, length) == 0;
+	}
+	bool startsWith(const char *prefix, size_t n) const {
+		return length >= n && memcmp(begin, prefix, n) == 0;
+	}
+	string str() const { return string(begin, length); }
+};
+
+// walks the file buffer a line at a time, then a token at a time, without copying
+struct ConfigTokenizer {
+	const char *p, *end, *lineEnd;
+	int lineNumber;
+	ConfigTokenizer(const string &buffer) : p(buffer.data()), end(buffer.data() + buffer.size()), lineEnd(buffer.data()),
+		lineNumber(0) {}
+	bool nextLine() {
+		if (lineEnd >= end) {
+			return false;
+		}
+		p = (lineNumber == 0) ? lineEnd : lineEnd + 1;
+		if (p > end) {
+			return false;
+		}
+		const char *newline = static_cast<const char *>(memchr(p, '\n', end - p));
+		lineEnd = (newline == NULL) ? end : newline;
+		lineNumber++;
+		return true;
+	}
+	bool next(ConfigToken &token) {
+		while (p < lineEnd && isspace((unsigned char)*p)) {
+			p++;
+		}
+		token.begin = p;
+		while (p < lineEnd && !isspace((unsigned char)*p)) {
+			p++;
+		}
+		token.length = p - token.begin;
+		return token.length > 0;
+	}
+	bool nextDouble(double &value) {
+		ConfigToken token;
+		return next(token) && parseDouble(token, value);
+	}
+	bool nextInt(int &value) {
+		ConfigToken token;
+		return next(token) && parseInt(token, value);
+	}
+	static bool parseDouble(const ConfigToken &token, double &value) {
+		// strtod stops at the whitespace after the token, the buffer ends in a null
+		char *parsed;
+		value = strtod(token.begin, &parsed);
+		return parsed == token.begin + token.length;
+	}
+	static bool parseInt(const ConfigToken &token, int &value) {
+		char *parsed;
+		long number = strtol(token.begin, &parsed, 10);
+		value = (int)number;
+		return parsed == token.begin + token.length && number == value;
+	}
+};
+
+// the same numbers the original std::regex checks accepted
+bool isNodeNumber(const ConfigToken &token) {   // \d+
+	for (size_t i = 0; i < token.length; i++) {
+		if (!isdigit((unsigned char)token.begin[i])) {
+			return false;
+		}
+	}
+	return token.length > 0;
+}
+
+bool isNodeWeight(const ConfigToken &token) {   // -?\d*\.\d+(?:e-?\d+)?
+	const char *c = token.begin, *tokenEnd = token.begin + token.length;
+	auto digits = [&]() {
+		const char *start = c;
+		while (c < tokenEnd && isdigit((unsigned char)*c)) {
+			c++;
+		}
+		return c > start;
+	};
+	if (c < tokenEnd && *c == '-') {
+		c++;
+	}
+	digits();
+	if (c == tokenEnd || *c != '.') {
+		return false;
+	}
+	c++;
+	if (!digits()) {
+		return false;
+	}
+	if (c < tokenEnd && *c == 'e') {
+		c++;
+		if (c < tokenEnd && *c == '-') {
+			c++;
+		}
+		if (!digits()) {
+			return false;
+		}
+	}
+	return c == tokenEnd;
+}
+
+enum CONFIG_KEY {
+	KEY_unknown,
+	KEY_numNodes, KEY_volume, KEY_UA, KEY_depressTemp, KEY_mixOnDraw, KEY_setpoint, KEY_setpointFixed,
+	KEY_verbosity, KEY_numHeatSources, KEY_heatsource,
+	KEY_isVIP, KEY_isOn, KEY_minT, KEY_maxT, KEY_onlogic, KEY_offlogic, KEY_standbylogic, KEY_type,
+	KEY_coilConfig, KEY_condensity, KEY_nTemps, KEY_hysteresis, KEY_backupSource, KEY_companionSource,
+	KEY_followedBySource
+};
+
+const struct {
+	const char *name;
+	CONFIG_KEY key;
+} configKeywords[] = {
+	{ "numNodes", KEY_numNodes }, { "volume", KEY_volume }, { "UA", KEY_UA }, { "depressTemp", KEY_depressTemp },
+	{ "mixOnDraw", KEY_mixOnDraw }, { "setpoint", KEY_setpoint }, { "setpointFixed", KEY_setpointFixed },
+	{ "verbosity", KEY_verbosity }, { "numHeatSources", KEY_numHeatSources }, { "heatsource", KEY_heatsource },
+	{ "isVIP", KEY_isVIP }, { "isOn", KEY_isOn }, { "minT", KEY_minT }, { "maxT", KEY_maxT },
+	{ "onlogic", KEY_onlogic }, { "offlogic", KEY_offlogic }, { "standbylogic", KEY_standbylogic },
+	{ "type", KEY_type }, { "coilConfig", KEY_coilConfig }, { "condensity", KEY_condensity },
+	{ "nTemps", KEY_nTemps }, { "hysteresis", KEY_hysteresis }, { "backupSource", KEY_backupSource },
+	{ "companionSource", KEY_companionSource }, { "followedBySource", KEY_followedBySource }
+};
+
+// keyword dispatch through a small open addressed table, built once, so a lookup is one hash
+// and usually one compare instead of a walk down an if-chain
+struct ConfigKeywordTable {
+	static const size_t SLOTS = 64;   // a power of two, over twice the number of keywords
+	int slots[SLOTS];
+	static size_t hash(const char *word, size_t length) {
+		uint32_t h = 2166136261u;   // FNV-1a
+		for (size_t i = 0; i < length; i++) {
+			h = (h ^ (unsigned char)word[i]) * 16777619u;
+		}
+		return h & (SLOTS - 1);
+	}
+	ConfigKeywordTable() {
+		std::fill(slots, slots + SLOTS, -1);
+		for (int k = 0; k < (int)(sizeof(configKeywords) / sizeof(configKeywords[0])); k++) {
+			size_t slot = hash(configKeywords[k].name, strlen(configKeywords[k].name));
+			while (slots[slot] >= 0) {
+				slot = (slot + 1) & (SLOTS - 1);
+			}
+			slots[slot] = k;
+		}
+	}
+	CONFIG_KEY find(const ConfigToken &token) const {
+		for (size_t slot = hash(token.begin, token.length); slots[slot] >= 0; slot = (slot + 1) & (SLOTS - 1)) {
+			if (token.is(configKeywords[slots[slot]].name)) {
+				return configKeywords[slots[slot]].key;
+			}
+		}
+		return KEY_unknown;
+	}
+};
+
+CONFIG_KEY findConfigKeyword(const ConfigToken &token) {
+	static const ConfigKeywordTable table;
+	return table.find(token);
+}
+}
+
 int HPWH::HPWHinit_file(string configFile) {
 
 	setAllDefaults(); // reset all defaults if you're re-initilizing
@@ -3723,508 +4940,334 @@ int HPWH::HPWHinit_file(string configFile) {
 	// return 0 on success, HPWH_ABORT for failure
 
 	//open file, check and report errors
-	std::ifstream inputFILE;
-	inputFILE.open(configFile.c_str());
+	std::ifstream inputFILE(configFile.c_str(), std::ios::binary);
 	if (!inputFILE.is_open()) {
 		if (hpwhVerbosity >= VRB_reluctant) {
 			msg("Input file failed to open.  \n");
 		}
 		return HPWH_ABORT;
 	}
+	// read it whole, the tokens point into this buffer, whose terminating null stops strtod
+	string buffer;
+	inputFILE.seekg(0, std::ios::end);
+	buffer.resize((size_t)std::max((std::streamoff)0, (std::streamoff)inputFILE.tellg()));
+	inputFILE.seekg(0, std::ios::beg);
+	inputFILE.read(&buffer[0], buffer.size());
+	inputFILE.close();
 
 	//some variables that will be handy
-	int heatsource, sourceNum, nTemps;
-	string tempString, units;
-	double tempDouble, dblArray[12];
-
-	//being file processing, line by line
-	string line_s;
-	std::stringstream line_ss;
-	string token;
-	while (std::getline(inputFILE, line_s)) {
-		line_ss.clear();
-		line_ss.str(line_s);
-
-		//grab the first word, and start comparing
-		line_ss >> token;
-		if (token.at(0) == '#' || line_s.empty()) {
-			//if you hit a comment, skip to next line
-			continue;
+	ConfigTokenizer line(buffer);
+	ConfigToken keyword, specifier, word, units;
+	int heatsource = -1, sourceNum, nTemps;
+	double tempDouble;
+
+	// where an error is, only put together when there is one
+	auto location = [&]() {
+		string where = configFile + " line " + std::to_string(line.lineNumber) + ", " + keyword.str();
+		if (heatsource >= 0) {
+			where += " " + std::to_string(heatsource) + " " + specifier.str();
+		}
+		return where;
+	};
+	auto improper = [&](const char *what) {
+		if (hpwhVerbosity >= VRB_reluctant) {
+			msg("%s: improper %s.  \n", location().c_str(), what);
 		}
-		else if (token == "numNodes") {
-			line_ss >> numNodes;
+		return HPWH_ABORT;
+	};
+	// small readers for the value part of a line, false if it is missing or malformed
+	auto readUnits = [&](double &value, const char *unitsA, const char *unitsB) {
+		ConfigToken number;
+		if (!line.next(number)) {
+			return false;
 		}
-		else if (token == "volume") {
-			line_ss >> tempDouble >> units;
-			if (units == "gal")  tempDouble = GAL_TO_L(tempDouble);
-			else if (units == "L"); //do nothing, lol
-			else {
-				if (hpwhVerbosity >= VRB_reluctant) {
-					msg("Incorrect units specification for %s.  \n", token.c_str());
-				}
-				return HPWH_ABORT;
-			}
-			tankVolume_L = tempDouble;
+		// the units may follow the number directly, as in 37F
+		char *parsed;
+		value = strtod(number.begin, &parsed);
+		if (parsed == number.begin) {
+			return false;
 		}
-		else if (token == "UA") {
-			line_ss >> tempDouble >> units;
-			if (units != "kJperHrC") {
-				if (hpwhVerbosity >= VRB_reluctant) {
-					msg("Incorrect units specification for %s.  \n", token.c_str());
-				}
-				return HPWH_ABORT;
-			}
-			tankUA_kJperHrC = tempDouble;
+		if (parsed < number.begin + number.length) {
+			units.begin = parsed;
+			units.length = number.begin + number.length - parsed;
 		}
-		else if (token == "depressTemp") {
-			line_ss >> tempString;
-			if (tempString == "true") {
-				doTempDepression = true;
-			}
-			else if (tempString == "false") {
-				doTempDepression = false;
-			}
-			else {
-				if (hpwhVerbosity >= VRB_reluctant) {
-					msg("Improper value for %s\n", token.c_str());
-				}
-				return HPWH_ABORT;
-			}
+		else if (!line.next(units)) {
+			return false;
 		}
-		else if (token == "mixOnDraw") {
-			line_ss >> tempString;
-			if (tempString == "true") {
-				tankMixesOnDraw = true;
-			}
-			else if (tempString == "false") {
-				tankMixesOnDraw = false;
-			}
-			else {
-				if (hpwhVerbosity >= VRB_reluctant) {
-					msg("Improper value for %s\n", token.c_str());
-				}
-				return HPWH_ABORT;
-			}
+		return units.is(unitsA) || (unitsB != NULL && units.is(unitsB));
+	};
+	auto readTemperature = [&](double &value_C) {
+		if (!readUnits(value_C, "F", "C")) {
+			return false;
 		}
-		else if (token == "setpoint") {
-			line_ss >> tempDouble >> units;
-			if (units == "F")  tempDouble = F_TO_C(tempDouble);
-			else if (units == "C"); //do nothing, lol
-			else {
-				if (hpwhVerbosity >= VRB_reluctant) {
-					msg("Incorrect units specification for %s.  \n", token.c_str());
-				}
-				return HPWH_ABORT;
-			}
-			setpoint_C = tempDouble;
-			//tank will be set to setpoint at end of function
+		if (units.is("F")) {
+			value_C = F_TO_C(value_C);
 		}
-		else if (token == "setpointFixed") {
-			line_ss >> tempString;
-			if (tempString == "true")  setpointFixed = true;
-			else if (tempString == "false")  setpointFixed = false;
-			else {
-				if (hpwhVerbosity >= VRB_reluctant) {
-					msg("Improper value for %s\n", token.c_str());
-				}
-				return HPWH_ABORT;
-			}
+		return true;
+	};
+	auto readTemperatureDifference = [&](double &value_dC) {
+		if (!readUnits(value_dC, "F", "C")) {
+			return false;
 		}
-		else if (token == "verbosity") {
-			line_ss >> token;
-			if (token == "silent") {
-				hpwhVerbosity = VRB_silent;
-			}
-			else if (token == "reluctant") {
-				hpwhVerbosity = VRB_reluctant;
-			}
-			else if (token == "typical") {
-				hpwhVerbosity = VRB_typical;
-			}
-			else if (token == "emetic") {
-				hpwhVerbosity = VRB_emetic;
-			}
-			else {
-				if (hpwhVerbosity >= VRB_reluctant) {
-					msg("Incorrect verbosity on input.  \n");
-				}
-				return HPWH_ABORT;
-			}
+		if (units.is("F")) {
+			value_dC = dF_TO_dC(value_dC);
+		}
+		return true;
+	};
+	auto readBool = [&](bool &value) {
+		if (!line.next(word) || !(word.is("true") || word.is("false"))) {
+			return false;
+		}
+		value = word.is("true");
+		return true;
+	};
+
+	//being file processing, line by line
+	while (line.nextLine()) {
+		//grab the first word, and start comparing
+		if (!line.next(keyword) || keyword.begin[0] == '#') {
+			//if you hit a comment, skip to next line
+			continue;
 		}
+		heatsource = -1;
 
-		else if (token == "numHeatSources") {
-			line_ss >> numHeatSources;
+		switch (findConfigKeyword(keyword)) {
+		case KEY_numNodes:
+			if (!line.nextInt(numNodes)) return improper("number of nodes");
+			break;
+		case KEY_volume:
+			if (!readUnits(tempDouble, "gal", "L")) return improper("value or units");
+			tankVolume_L = units.is("gal") ? GAL_TO_L(tempDouble) : tempDouble;
+			break;
+		case KEY_UA:
+			if (!readUnits(tankUA_kJperHrC, "kJperHrC", NULL)) return improper("value or units");
+			break;
+		case KEY_depressTemp:
+			if (!readBool(doTempDepression)) return improper("value, it should be true or false,");
+			break;
+		case KEY_mixOnDraw:
+			if (!readBool(tankMixesOnDraw)) return improper("value, it should be true or false,");
+			break;
+		case KEY_setpoint:
+			//tank will be set to setpoint at end of function
+			if (!readTemperature(setpoint_C)) return improper("value or units");
+			break;
+		case KEY_setpointFixed:
+			if (!readBool(setpointFixed)) return improper("value, it should be true or false,");
+			break;
+		case KEY_verbosity:
+			line.next(word);
+			if (word.is("silent")) hpwhVerbosity = VRB_silent;
+			else if (word.is("reluctant")) hpwhVerbosity = VRB_reluctant;
+			else if (word.is("typical")) hpwhVerbosity = VRB_typical;
+			else if (word.is("emetic")) hpwhVerbosity = VRB_emetic;
+			else return improper("verbosity");
+			break;
+		case KEY_numHeatSources:
+			if (!line.nextInt(numHeatSources) || numHeatSources < 0) {
+				numHeatSources = 0;
+				return improper("number of heat sources");
+			}
+			delete[] setOfSources;
 			setOfSources = new HeatSource[numHeatSources];
 			for (int i = 0; i < numHeatSources; i++) {
 				setOfSources[i] = HeatSource(this);
 			}
-		}
-		else if (token == "heatsource") {
+			break;
+
+		case KEY_heatsource: {
 			if (numHeatSources == 0) {
-				msg("You must specify the number of heatsources before setting their properties.  \n");
+				msg("%s: you must specify the number of heatsources before setting their properties.  \n", location().c_str());
 				return HPWH_ABORT;
 			}
-			line_ss >> heatsource >> token;
-			if (token == "isVIP") {
-				line_ss >> tempString;
-				if (tempString == "true")  setOfSources[heatsource].isVIP = true;
-				else if (tempString == "false")  setOfSources[heatsource].isVIP = false;
-				else {
-					if (hpwhVerbosity >= VRB_reluctant) {
-						msg("Improper value for %s for heat source %d\n", token.c_str(), heatsource);
-					}
-					return HPWH_ABORT;
-				}
-			}
-			else if (token == "isOn") {
-				line_ss >> tempString;
-				if (tempString == "true")  setOfSources[heatsource].isOn = true;
-				else if (tempString == "false")  setOfSources[heatsource].isOn = false;
-				else {
-					if (hpwhVerbosity >= VRB_reluctant) {
-						msg("Improper value for %s for heat source %d\n", token.c_str(), heatsource);
-					}
-					return HPWH_ABORT;
-				}
-			}
-			else if (token == "minT") {
-				line_ss >> tempDouble >> units;
-				if (units == "F")  tempDouble = F_TO_C(tempDouble);
-				else if (units == "C"); //do nothing, lol
-				else {
-					if (hpwhVerbosity >= VRB_reluctant) {
-						msg("Incorrect units specification for %s.  \n", token.c_str());
-					}
-					return HPWH_ABORT;
-				}
-				setOfSources[heatsource].minT = tempDouble;
-			}
-			else if (token == "maxT") {
-				line_ss >> tempDouble >> units;
-				if (units == "F")  tempDouble = F_TO_C(tempDouble);
-				else if (units == "C"); //do nothing, lol
-				else {
-					if (hpwhVerbosity >= VRB_reluctant) {
-						msg("Incorrect units specification for %s.  \n", token.c_str());
-					}
-					return HPWH_ABORT;
-				}
-				setOfSources[heatsource].maxT = tempDouble;
+			if (!line.nextInt(sourceNum) || sourceNum < 0 || sourceNum >= numHeatSources) {
+				return improper("heat source number");
 			}
-			else if (token == "onlogic" || token == "offlogic" || token == "standbylogic" ) {
-				line_ss >> tempString;
-				if (tempString == "nodes") {
-					std::vector<int> nodeNums;
-					std::vector<double> weights;
-					std::string nextToken;
-					line_ss >> nextToken;
-					while (std::regex_match(nextToken, std::regex("\\d+"))) {
-						int nodeNum = std::stoi(nextToken);
-						if (nodeNum > 13 || nodeNum < 0) {
-							if (hpwhVerbosity >= VRB_reluctant) {
-								msg("Node number for heatsource %d %s must be between 0 and 13.  \n", heatsource, token.c_str());
-							}
-							return HPWH_ABORT;
-						}
-						nodeNums.push_back(nodeNum);
-						line_ss >> nextToken;
-					}
-					if (nextToken == "weights") {
-						line_ss >> nextToken;
-						while (std::regex_match(nextToken, std::regex("-?\\d*\\.\\d+(?:e-?\\d+)?"))) {
-							weights.push_back(std::stod(nextToken));
-							line_ss >> nextToken;
-						}
-					}
-					else {
-						for (auto n : nodeNums) {
-							n += 0; // used to get rid of unused variable compiler warning
-							weights.push_back(1.0);
-						}
-					}
-					if (nodeNums.size() != weights.size()) {
-						if (hpwhVerbosity >= VRB_reluctant) {
-							msg("Number of weights for heatsource %d %s (%d) does not macht number of nodes for %s (%d).  \n", heatsource, token.c_str(), weights.size(), token.c_str(), nodeNums.size());
-						}
-						return HPWH_ABORT;
-					}
-					if (nextToken != "absolute" && nextToken != "relative") {
-						if (hpwhVerbosity >= VRB_reluctant) {
-							msg("Improper definition, \"%s\", for heat source %d %s. Should be \"relative\" or \"absoute\".\n", nextToken.c_str(), heatsource, token.c_str());
-						}
-						return HPWH_ABORT;
-					}
-					bool absolute = (nextToken == "absolute");
-					std::string compareStr;
-					line_ss >> compareStr >> tempDouble >> units;
-					std::function<bool(double, double)> compare;
-					if (compareStr == "<") compare = std::less<double>();
-					else if (compareStr == ">") compare = std::greater<double>();
-					else {
-						if (hpwhVerbosity >= VRB_reluctant) {
-							msg("Improper comparison, \"%s\", for heat source %d %s. Should be \"<\" or \">\".\n", compareStr.c_str(), heatsource, token.c_str());
-						}
-						return HPWH_ABORT;
-					}
-					if (units == "F") {
-						if (absolute) {
-							tempDouble = F_TO_C(tempDouble);
-						}
-						else {
-							tempDouble = dF_TO_dC(tempDouble);
-						}
-					}
-					else if (units == "C"); //do nothing, lol
-					else {
-						if (hpwhVerbosity >= VRB_reluctant) {
-							msg("Incorrect units specification for %s from heatsource %d.  \n", token.c_str(), heatsource);
-						}
-						return HPWH_ABORT;
-					}
+			heatsource = sourceNum;
+			line.next(specifier);
+			HeatSource &source = setOfSources[heatsource];
+			CONFIG_KEY key = findConfigKeyword(specifier);
+
+			switch (key) {
+			case KEY_isVIP:
+				if (!readBool(source.isVIP)) return improper("value, it should be true or false,");
+				break;
+			case KEY_isOn:
+				if (!readBool(source.isOn)) return improper("value, it should be true or false,");
+				break;
+			case KEY_minT:
+				if (!readTemperature(source.minT)) return improper("value or units");
+				break;
+			case KEY_maxT:
+				if (!readTemperature(source.maxT)) return improper("value or units");
+				break;
+			case KEY_onlogic:
+			case KEY_offlogic:
+			case KEY_standbylogic:
+				line.next(word);
+				if (word.is("nodes")) {
 					std::vector<NodeWeight> nodeWeights;
-					for (size_t i = 0; i < nodeNums.size(); i++) {
-						nodeWeights.emplace_back(nodeNums[i], weights[i]);
-					}
-					HPWH::HeatingLogic logic("custom", nodeWeights, tempDouble, absolute, compare);
-					if (token == "onlogic") {
-						setOfSources[heatsource].addTurnOnLogic(logic);
-					}
-					else if (token == "offlogic") {
-						setOfSources[heatsource].addShutOffLogic(logic);
-					} 
-					else { // standby logic
-						setOfSources[heatsource].standbyLogic = new HPWH::HeatingLogic("standby logic", nodeWeights, tempDouble, absolute, compare);
-					}
-				}
-				else if (token == "onlogic") {
-					line_ss >> tempDouble >> units;
-					if (units == "F")  tempDouble = dF_TO_dC(tempDouble);
-					else if (units == "C"); //do nothing, lol
-					else {
-						if (hpwhVerbosity >= VRB_reluctant) {
-							msg("Incorrect units specification for %s from heatsource %d.  \n", token.c_str(), heatsource);
+					ConfigToken next;
+					line.next(next);
+					while (isNodeNumber(next)) {
+						int nodeNum;
+						if (!ConfigTokenizer::parseInt(next, nodeNum) || nodeNum > 13 || nodeNum < 0) {
+							return improper("node number, it must be between 0 and 13,");
 						}
-						return HPWH_ABORT;
-					}
-					if (tempString == "topThird") {
-						setOfSources[heatsource].addTurnOnLogic(HPWH::topThird(tempDouble));
-					}
-					else if (tempString == "bottomThird") {
-						setOfSources[heatsource].addTurnOnLogic(HPWH::bottomThird(tempDouble));
-					}
-					else if (tempString == "standby") {
-						setOfSources[heatsource].addTurnOnLogic(HPWH::standby(tempDouble));
-					}
-					else if (tempString == "bottomSixth") {
-						setOfSources[heatsource].addTurnOnLogic(HPWH::bottomSixth(tempDouble));
-					}
-					else if (tempString == "secondSixth") {
-						setOfSources[heatsource].addTurnOnLogic(HPWH::secondSixth(tempDouble));
+						nodeWeights.push_back(NodeWeight(nodeNum));
+						line.next(next);
 					}
-					else if (tempString == "thirdSixth") {
-						setOfSources[heatsource].addTurnOnLogic(HPWH::thirdSixth(tempDouble));
-					}
-					else if (tempString == "fourthSixth") {
-						setOfSources[heatsource].addTurnOnLogic(HPWH::fourthSixth(tempDouble));
-					}
-					else if (tempString == "fifthSixth") {
-						setOfSources[heatsource].addTurnOnLogic(HPWH::fifthSixth(tempDouble));
-					}
-					else if (tempString == "topSixth") {
-						setOfSources[heatsource].addTurnOnLogic(HPWH::topSixth(tempDouble));
-					}
-					else {
-						if (hpwhVerbosity >= VRB_reluctant) {
-							msg("Improper %s for heat source %d\n", token.c_str(), heatsource);
+					if (next.is("weights")) {
+						size_t nWeights = 0;
+						line.next(next);
+						while (isNodeWeight(next)) {
+							if (nWeights < nodeWeights.size()) {
+								ConfigTokenizer::parseDouble(next, nodeWeights[nWeights].weight);
+							}
+							nWeights++;
+							line.next(next);
 						}
-						return HPWH_ABORT;
-					}
-				}
-				else if (token == "offlogic") {
-					line_ss >> tempDouble >> units;
-					if (units == "F")  tempDouble = F_TO_C(tempDouble);
-					else if (units == "C"); //do nothing, lol
-					else {
-						if (hpwhVerbosity >= VRB_reluctant) {
-							msg("Incorrect units specification for %s from heatsource %d.  \n", token.c_str(), heatsource);
+						if (nWeights != nodeWeights.size()) {
+							return improper("number of weights, it does not match the number of nodes,");
 						}
-						return HPWH_ABORT;
 					}
-					if (tempString == "topNodeMaxTemp") {
-						setOfSources[heatsource].addShutOffLogic(HPWH::topNodeMaxTemp(tempDouble));
+					if (!next.is("absolute") && !next.is("relative")) {
+						return improper("definition, it should be relative or absolute,");
 					}
-					else if (tempString == "bottomNodeMaxTemp") {
-						setOfSources[heatsource].addShutOffLogic(HPWH::bottomNodeMaxTemp(tempDouble));
-					}
-					else if (tempString == "bottomTwelthMaxTemp") {
-						setOfSources[heatsource].addShutOffLogic(HPWH::bottomTwelthMaxTemp(tempDouble));
+					bool absolute = next.is("absolute");
+					std::function<bool(double, double)> compare;
+					line.next(word);
+					if (word.is("<")) compare = std::less<double>();
+					else if (word.is(">")) compare = std::greater<double>();
+					else return improper("comparison, it should be < or >,");
+					if (!(absolute ? readTemperature(tempDouble) : readTemperatureDifference(tempDouble))) {
+						return improper("value or units");
 					}
-					else if (tempString == "largeDraw") {
-						setOfSources[heatsource].addShutOffLogic(HPWH::largeDraw(tempDouble));
+					if (key == KEY_onlogic) {
+						source.addTurnOnLogic(HPWH::HeatingLogic("custom", nodeWeights, tempDouble, absolute, compare));
 					}
-					else if (tempString == "largerDraw") {
-						setOfSources[heatsource].addShutOffLogic(HPWH::largerDraw(tempDouble));
+					else if (key == KEY_offlogic) {
+						source.addShutOffLogic(HPWH::HeatingLogic("custom", nodeWeights, tempDouble, absolute, compare));
 					}
 					else {
-						if (hpwhVerbosity >= VRB_reluctant) {
-							msg("Improper %s for heat source %d\n", token.c_str(), heatsource);
-						}
-						return HPWH_ABORT;
+						source.standbyLogic = std::make_shared<HPWH::HeatingLogic>("standby logic", nodeWeights, tempDouble, absolute, compare);
 					}
 				}
-			}
-			else if (token == "type") {
-				line_ss >> tempString;
-				if (tempString == "resistor") {
-					setOfSources[heatsource].typeOfHeatSource = TYPE_resistance;
+				else if (key == KEY_onlogic) {
+					if (!readTemperatureDifference(tempDouble)) return improper("value or units");
+					if (word.is("topThird")) source.addTurnOnLogic(HPWH::topThird(tempDouble));
+					else if (word.is("bottomThird")) source.addTurnOnLogic(HPWH::bottomThird(tempDouble));
+					else if (word.is("standby")) source.addTurnOnLogic(HPWH::standby(tempDouble));
+					else if (word.is("bottomSixth")) source.addTurnOnLogic(HPWH::bottomSixth(tempDouble));
+					else if (word.is("secondSixth")) source.addTurnOnLogic(HPWH::secondSixth(tempDouble));
+					else if (word.is("thirdSixth")) source.addTurnOnLogic(HPWH::thirdSixth(tempDouble));
+					else if (word.is("fourthSixth")) source.addTurnOnLogic(HPWH::fourthSixth(tempDouble));
+					else if (word.is("fifthSixth")) source.addTurnOnLogic(HPWH::fifthSixth(tempDouble));
+					else if (word.is("topSixth")) source.addTurnOnLogic(HPWH::topSixth(tempDouble));
+					else return improper("logic");
 				}
-				else if (tempString == "compressor") {
-					setOfSources[heatsource].typeOfHeatSource = TYPE_compressor;
+				else if (key == KEY_offlogic) {
+					if (!readTemperature(tempDouble)) return improper("value or units");
+					if (word.is("topNodeMaxTemp")) source.addShutOffLogic(HPWH::topNodeMaxTemp(tempDouble));
+					else if (word.is("bottomNodeMaxTemp")) source.addShutOffLogic(HPWH::bottomNodeMaxTemp(tempDouble));
+					else if (word.is("bottomTwelthMaxTemp")) source.addShutOffLogic(HPWH::bottomTwelthMaxTemp(tempDouble));
+					else if (word.is("largeDraw")) source.addShutOffLogic(HPWH::largeDraw(tempDouble));
+					else if (word.is("largerDraw")) source.addShutOffLogic(HPWH::largerDraw(tempDouble));
+					else return improper("logic");
 				}
 				else {
-					if (hpwhVerbosity >= VRB_reluctant) {
-						msg("Improper %s for heat source %d\n", token.c_str(), heatsource);
-					}
-					return HPWH_ABORT;
+					return improper("logic, standby logic is given by nodes");
 				}
-			}
-			else if (token == "coilConfig") {
-				line_ss >> tempString;
-				if (tempString == "wrapped") {
-					setOfSources[heatsource].configuration = HeatSource::CONFIG_WRAPPED;
+				break;
+			case KEY_type:
+				line.next(word);
+				if (word.is("resistor")) source.typeOfHeatSource = TYPE_resistance;
+				else if (word.is("compressor")) source.typeOfHeatSource = TYPE_compressor;
+				else return improper("type");
+				break;
+			case KEY_coilConfig:
+				line.next(word);
+				if (word.is("wrapped")) source.configuration = HeatSource::CONFIG_WRAPPED;
+				else if (word.is("submerged")) source.configuration = HeatSource::CONFIG_SUBMERGED;
+				else if (word.is("external")) source.configuration = HeatSource::CONFIG_EXTERNAL;
+				else return improper("coil configuration");
+				break;
+			case KEY_condensity:
+				for (int i = 0; i < CONDENSITY_SIZE; i++) {
+					if (!line.nextDouble(source.condensity[i])) return improper("condensity, it needs 12 values,");
 				}
-				else if (tempString == "submerged") {
-					setOfSources[heatsource].configuration = HeatSource::CONFIG_SUBMERGED;
+				break;
+			case KEY_nTemps:
+				if (!line.nextInt(nTemps) || nTemps < 0) return improper("number of temperatures");
+				source.perfMap.resize(nTemps);
+				break;
+			case KEY_hysteresis:
+				if (!readTemperatureDifference(source.hysteresis_dC)) return improper("value or units");
+				break;
+			case KEY_backupSource:
+			case KEY_companionSource:
+			case KEY_followedBySource:
+				if (!line.nextInt(sourceNum) || sourceNum < -1 || sourceNum >= numHeatSources) {
+					return improper("heat source number");
 				}
-				else if (tempString == "external") {
-					setOfSources[heatsource].configuration = HeatSource::CONFIG_EXTERNAL;
+				if (key == KEY_backupSource) source.backupIndex = sourceNum;
+				else if (key == KEY_companionSource) source.companionIndex = sourceNum;
+				else source.followedByIndex = sourceNum;
+				break;
+			default: {
+				// the performance map: T<n>, then inPowT<n> and copT<n> followed by const, lin or quad
+				bool isTemperature = specifier.startsWith("T", 1);
+				bool isInPow = specifier.startsWith("inPowT", 6);
+				bool isCOP = specifier.startsWith("copT", 4);
+				size_t digitsStart = isTemperature ? 1 : isInPow ? 6 : isCOP ? 4 : specifier.length;
+				size_t digitsEnd = digitsStart;
+				while (digitsEnd < specifier.length && isdigit((unsigned char)specifier.begin[digitsEnd])) {
+					digitsEnd++;
 				}
-				else {
+				ConfigToken suffix;
+				suffix.begin = specifier.begin + digitsEnd;
+				suffix.length = specifier.length - digitsEnd;
+				bool isPerfMap = digitsEnd > digitsStart && (isTemperature ? suffix.length == 0 :
+					(suffix.is("const") || suffix.is("lin") || suffix.is("quad")));
+				if (!isPerfMap) {
 					if (hpwhVerbosity >= VRB_reluctant) {
-						msg("Improper %s for heat source %d\n", token.c_str(), heatsource);
-					}
-					return HPWH_ABORT;
-				}
-			}
-			else if (token == "condensity") {
-				line_ss >> dblArray[0] >> dblArray[1] >> dblArray[2] >> dblArray[3] >> dblArray[4] >> dblArray[5] >> dblArray[6] >> dblArray[7] >> dblArray[8] >> dblArray[9] >> dblArray[10] >> dblArray[11];
-				setOfSources[heatsource].setCondensity(dblArray[0], dblArray[1], dblArray[2], dblArray[3], dblArray[4], dblArray[5], dblArray[6], dblArray[7], dblArray[8], dblArray[9], dblArray[10], dblArray[11]);
-			}
-			else if (token == "nTemps") {
-				line_ss >> nTemps;
-				setOfSources[heatsource].perfMap.resize(nTemps);
-			}
-			else if (std::regex_match(token, std::regex("T\\d+"))) {
-				std::smatch match;
-				std::regex_match(token, match, std::regex("T(\\d+)"));
-				nTemps = std::stoi(match[1].str());
-				int maxTemps = (int)setOfSources[heatsource].perfMap.size();
-
-				if (maxTemps < nTemps) {
-					if (maxTemps == 0) {
-						if (true || hpwhVerbosity >= VRB_reluctant) {
-							msg("%s specified for heatsource %d before definition of nTemps.  \n", token.c_str(), heatsource);
-						}
-						return HPWH_ABORT;
-					}
-					else {
-						if (true || hpwhVerbosity >= VRB_reluctant) {
-							msg("Incorrect specification for %s from heatsource %d. nTemps, %d, is less than %d.  \n", token.c_str(), heatsource, maxTemps, nTemps);
-						}
-						return HPWH_ABORT;
+						msg("%s: improper specifier, ignored.  \n", location().c_str());
 					}
+					break;
 				}
-				line_ss >> tempDouble >> units;
-				//        if (units == "F")  tempDouble = F_TO_C(tempDouble);
-				if (units == "F");
-				//        else if (units == "C") ; //do nothing, lol
-				else if (units == "C") tempDouble = C_TO_F(tempDouble);
-				else {
+				nTemps = atoi(string(specifier.begin + digitsStart, digitsEnd - digitsStart).c_str());
+				int maxTemps = (int)source.perfMap.size();
+				if (maxTemps < nTemps || nTemps < 1) {
 					if (hpwhVerbosity >= VRB_reluctant) {
-						msg("Incorrect units specification for %s from heatsource %d.  \n", token.c_str(), heatsource);
+						msg("%s: the number of temperatures, nTemps, is %d, so it must be given first and at least %d.  \n",
+							location().c_str(), maxTemps, nTemps);
 					}
 					return HPWH_ABORT;
 				}
-				setOfSources[heatsource].perfMap[nTemps - 1].T_F = tempDouble;
-			}
-			else if (std::regex_match(token, std::regex("(?:inPow|cop)T\\d+(?:const|lin|quad)"))) {
-				std::smatch match;
-				std::regex_match(token, match, std::regex("(inPow|cop)T(\\d+)(const|lin|quad)"));
-				string var = match[1].str();
-				nTemps = std::stoi(match[2].str());
-				string coeff = match[3].str();
-				int coeff_num;
-				if (coeff == "const") {
-					coeff_num = 0;
-				}
-				else if (coeff == "lin") {
-					coeff_num = 1;
+				if (isTemperature) {
+					if (!readUnits(tempDouble, "F", "C")) return improper("value or units");
+					source.perfMap[nTemps - 1].T_F = units.is("C") ? C_TO_F(tempDouble) : tempDouble;
 				}
-				else if (coeff == "quad") {
-					coeff_num = 2;
-				}
-
-				int maxTemps = (int)setOfSources[heatsource].perfMap.size();
-
-				if (maxTemps < nTemps) {
-					if (maxTemps == 0) {
-						if (hpwhVerbosity >= VRB_reluctant) {
-							msg("%s specified for heatsource %d before definition of nTemps.  \n", token.c_str(), heatsource);
-						}
-						return HPWH_ABORT;
+				else {
+					if (!line.nextDouble(tempDouble)) return improper("coefficient");
+					// coefficients go in the order given, constant, linear then quadratic
+					if (isInPow) {
+						source.perfMap[nTemps - 1].inputPower_coeffs.push_back(tempDouble);
 					}
 					else {
-						if (hpwhVerbosity >= VRB_reluctant) {
-							msg("Incorrect specification for %s from heatsource %d. nTemps, %d, is less than %d.  \n", token.c_str(), heatsource, maxTemps, nTemps);
-						}
-						return HPWH_ABORT;
+						source.perfMap[nTemps - 1].COP_coeffs.push_back(tempDouble);
 					}
 				}
-				line_ss >> tempDouble;
-
-				if (var == "inPow") {
-					setOfSources[heatsource].perfMap[nTemps - 1].inputPower_coeffs.push_back(tempDouble);
-				}
-				else if (var == "cop") {
-					setOfSources[heatsource].perfMap[nTemps - 1].COP_coeffs.push_back(tempDouble);
-				}
-			}
-			else if (token == "hysteresis") {
-				line_ss >> tempDouble >> units;
-				if (units == "F")  tempDouble = dF_TO_dC(tempDouble);
-				else if (units == "C"); //do nothing, lol
-				else {
-					if (hpwhVerbosity >= VRB_reluctant) {
-						msg("Incorrect units specification for %s from heatsource %d.  \n", token.c_str(), heatsource);
-					}
-					return HPWH_ABORT;
-				}
-				setOfSources[heatsource].hysteresis_dC = tempDouble;
-			}
-			else if (token == "backupSource") {
-				line_ss >> sourceNum;
-				setOfSources[heatsource].backupHeatSource = &setOfSources[sourceNum];
-			}
-			else if (token == "companionSource") {
-				line_ss >> sourceNum;
-				setOfSources[heatsource].companionHeatSource = &setOfSources[sourceNum];
-			}
-			else if (token == "followedBySource") {
-				line_ss >> sourceNum;
-				setOfSources[heatsource].followedByHeatSource = &setOfSources[sourceNum];
+				break;
 			}
-			else {
-				if (hpwhVerbosity >= VRB_reluctant) {
-					msg("Improper specifier (%s) for heat source %d\n", token.c_str(), heatsource);
-				}
 			}
-
+			break;
 		} //end heatsource options
-		else {
-			msg("Improper keyword: %s  \n", token.c_str());
+
+		default:
+			msg("%s: improper keyword.  \n", location().c_str());
 			return HPWH_ABORT;
 		}
-
 	} //end while over lines
 
 
@@ -4234,7 +5277,7 @@ int HPWH::HPWHinit_file(string configFile) {
 	tankTemps_C = new double[numNodes];
 	resetTankToSetpoint();
 
-	nextTankTemps_C = new double[numNodes];
+	nextTankTemps_C = new double[numNodes]();
 
 	isHeating = false;
 	for (int i = 0; i < numHeatSources; i++) {
@@ -7,6 +7,7 @@
 #include <iostream>
 #include <iomanip>
 #include <functional>
+#include <memory>
 
 #include <cstdio>
 #include <cstdlib>   //for exit
@@ -51,7 +52,12 @@ class HPWH {
 
   HPWH();  /**< default constructor */
   HPWH(const HPWH &hpwh);  /**< copy constructor  */
-  HPWH & operator=(const HPWH &hpwh);  /**< assignment operator  */
+  HPWH & operator=(const HPWH &hpwh);
+  /**< assignment operator, copies the whole model and state.  Assigning to a HPWH of the same
+      model reuses its arrays, so it only copies values  */
+  HPWH(HPWH &&hpwh) noexcept;
+  HPWH & operator=(HPWH &&hpwh) noexcept;
+  /**< move constructor and assignment, hpwh is left empty  */
 	~HPWH(); /**< destructor just a couple dynamic arrays to destroy - could be replaced by vectors eventually?   */
 
 
@@ -253,6 +259,95 @@ class HPWH {
       description(desc), nodeWeights(n), decisionPoint(d), isAbsolute(a), compare(c) {};
   };
 
+  /** the part of a HPWH that changes from step to step - enough to restart a simulation
+      from a point in time on another HPWH initialized to the same model */
+  struct SimState {
+    std::vector<double> tankTemps_C;
+    /**< the node temperatures, 0 is the bottom node  */
+    std::vector<bool> heatSourcesOn;
+    /**< isOn for each heat source, in order of priority  */
+    std::vector<bool> heatSourcesLockedOut;
+    /**< lockedOut for each heat source, in order of priority  */
+    bool isHeating;
+    double setpoint_C;
+    DRMODES prevDRstatus;
+    double timerTOT;
+    double locationTemperature_C;
+  };
+
+  /** the inputs shared by every candidate of simulateAhead, one value per step  */
+  struct AheadInputs {
+    std::vector<double> inletT_C;
+    std::vector<double> drawVolume_L;
+    std::vector<double> tankAmbientT_C;
+    std::vector<double> heatSourceAmbientT_C;
+  };
+
+  /** one candidate control trajectory for simulateAhead, one value per step.  An empty
+      DRstatus runs DR_ALLOW, and an empty setpoint_C keeps the current setpoint  */
+  struct AheadCandidate {
+    std::vector<DRMODES> DRstatus;
+    std::vector<double> setpoint_C;
+  };
+
+  /** what one candidate does over the horizon  */
+  struct AheadOutputs {
+    double energyInput_kWh;                   /**< summed over heat sources and steps */
+    double energyOutput_kWh;
+    double drawVolume_L;
+    double outletTemp_C;                      /**< draw weighted outlet temperature, 0 with no draws */
+    double minOutletTemp_C;                   /**< the coldest outlet temperature of a draw, 0 with no draws */
+    double finalTankHeatContent_kJ;
+    std::vector<double> stepEnergyInput_kWh;  /**< the energy input of each step */
+    std::vector<double> stepOutletTemp_C;     /**< the outlet temperature of each step, 0 with no draw */
+  };
+
+  static const int STEP_HEATSOURCES = 4;  /**< the most heat sources StepOutputs holds, the presets have at most 3 */
+  static const int STEP_TCOUPLES = 6;     /**< the number of simulated thermocouples in StepOutputs */
+
+  /** the outputs of one step, gathered by getStepOutputs in one call, in SI units.  Plain data
+      of a fixed size, so a fleet can keep them in a contiguous buffer  */
+  struct StepOutputs {
+    int numHeatSources;                                 /**< the heat source entries filled, the rest are 0 */
+    double heatSourceEnergyInput_kWh[STEP_HEATSOURCES];
+    double heatSourceEnergyOutput_kWh[STEP_HEATSOURCES];
+    double heatSourceRunTime_min[STEP_HEATSOURCES];
+    double outletTemp_C;                                /**< 0 when no draw occurs */
+    double standbyLosses_kWh;
+    double energyRemovedFromEnvironment_kWh;
+    double tankHeatContent_kJ;
+    double simTcouples_C[STEP_TCOUPLES];                /**< getNthSimTcouple(i + 1, STEP_TCOUPLES), 0 at the bottom */
+  };
+
+  /** the per step inputs of runNSteps, each a caller owned array of N values.  The first four
+      are required, the rest may be left NULL  */
+  struct StepInputs {
+    double *inletT_C = NULL;
+    double *drawVolume_L = NULL;
+    double *tankAmbientT_C = NULL;
+    double *heatSourceAmbientT_C = NULL;
+    DRMODES *DRstatus = NULL;                     /**< NULL runs every step at DR_ALLOW */
+    double *inletVol2_L = NULL;                   /**< the second inlet, both or neither of these two */
+    double *inletT2_C = NULL;
+    double *setpoint_C = NULL;                    /**< NULL keeps the setpoint, else it is set before each step */
+    std::vector<double> *nodePowerExtra_W = NULL; /**< N vectors as runOneStep takes, empty for none */
+  };
+
+  /** caller owned arrays for the per step results of runNSteps, one array per output.  Any may
+      be NULL to skip it.  The heat source arrays hold N * getNumHeatSources() values and the
+      thermocouples N * STEP_TCOUPLES, step by step, so step i of heat source j is at
+      i * getNumHeatSources() + j  */
+  struct StepOutputArrays {
+    double *outletTemp_C = NULL;
+    double *standbyLosses_kWh = NULL;
+    double *energyRemovedFromEnvironment_kWh = NULL;
+    double *tankHeatContent_kJ = NULL;
+    double *heatSourceEnergyInput_kWh = NULL;
+    double *heatSourceEnergyOutput_kWh = NULL;
+    double *heatSourceRunTime_min = NULL;
+    double *simTcouples_C = NULL;
+  };
+
   HeatingLogic topThird(double d) const;
   HeatingLogic topThird_absolute(double d) const;
 	HeatingLogic bottomThird(double d) const;
@@ -309,6 +404,31 @@ class HPWH {
 	 * The return value is 0 for successful initialization, HPWH_ABORT otherwise
 	 */
 
+	struct PresetInfo {
+		MODELS model;
+		const char *name;          /**< the enum name without MODELS_, e.g. "AOSmithHPTU80" */
+		const char *description;
+	};
+	static const std::vector<PresetInfo> &getPresets();
+	/**< every model HPWHinit_presets accepts, in the order MODELS declares them, for tools that list or loop over them  */
+	static const PresetInfo *findPreset(MODELS presetNum);
+	static const PresetInfo *findPreset(const std::string &name);
+	/**< looks up a preset by enum, or by name or one of the older names the test tools use
+	 * (e.g. "Voltex60", "GE502014"), in constant time.  Returns NULL if there is no such preset  */
+
+	int HPWHinit_presetsCached(MODELS presetNum);
+	int HPWHinit_fileCached(std::string configFile);
+	/**< These are HPWHinit_presets and HPWHinit_file through a process wide prototype cache.
+	 * The first call for a preset, or a file path, initializes the model as usual and keeps a
+	 * copy; later calls, from any thread, copy that prototype instead of re-initializing.
+	 * The verbosity and message callback of this HPWH are kept.  A file is read only once,
+	 * so call clearPrototypeCache if it changes.  Failed initializations are not cached.
+	 *
+	 * The return value is 0 for successful initialization, HPWH_ABORT otherwise
+	 */
+	static void clearPrototypeCache();
+	/**< empties the prototype cache, so the next cached init of each model re-initializes  */
+
   int HPWHinit_resTank();  /**< Default resistance tank, EF 0.95, volume 47.5 */
   int HPWHinit_resTank(double tankVol_L, double energyFactor, double upperPower_W, double lowerPower_W);
   /**< This function will initialize a HPWH object to be a resistance tank.  Since
@@ -356,6 +476,23 @@ class HPWH {
 			nodePowerExtra_W);
 	};
 
+	/** An overloaded function that takes inletT_C and gathers the outputs of the step into
+	 * outputs, as getStepOutputs does  */
+	int runOneStep(double inletT_C, double drawVolume_L, double ambientT_C,
+		double externalT_C, DRMODES DRstatus, StepOutputs &outputs) {
+		setInletT(inletT_C);
+		int result = runOneStep(drawVolume_L, ambientT_C, externalT_C, DRstatus);
+		return (result == 0) ? getStepOutputs(outputs) : result;
+	};
+
+	int getStepOutputs(StepOutputs &outputs) const;
+	/**< Fills outputs with the energy, run time, outlet, standby, environment, heat content and
+	 * thermocouple outputs of the last step, with the same values the single getters return in SI units
+	 *
+	 * The return value is 0 on success, HPWH_ABORT if the model has more than STEP_HEATSOURCES heat
+	 * sources or fewer nodes than STEP_TCOUPLES
+	 */
+
 
 	int runNSteps(int N,  double *inletT_C, double *drawVolume_L,
                   double *tankAmbientT_C, double *heatSourceAmbientT_C,
@@ -367,6 +504,14 @@ class HPWH {
 	 * The return value is 0 for successful simulation run, HPWH_ABORT otherwise
 	 */
 
+	int runNSteps(int N, const StepInputs &inputs, StepOutputArrays *outputs = NULL);
+	/**< As runNSteps above, with every input of runOneStep and a setpoint for each step, and
+	 * the results of each step written to outputs when it is given.  The outlet temperature
+	 * left behind is 0 when nothing was drawn
+	 *
+	 * The return value is 0 for successful simulation run, HPWH_ABORT otherwise
+	 */
+
 	/** Setters for the what are typically input variables  */
 	void setInletT(double newInletT_C) { member_inletT_C = newInletT_C; };
 	void setMinutesPerStep(double newMinutesPerStep) { minutesPerStep = newMinutesPerStep; };
@@ -442,6 +587,16 @@ class HPWH {
   int setDoConduction(bool doCondu);
   /**< This is a simple setter for doing internal conduction and nodal heatloss, default is true*/
 
+  int setDoParcelDraws(bool doParcels, double mergeTolerance_dC = 0.);
+  /**< When true, draws are modeled as plug flow of variable volume water parcels: the draw
+      is taken from the top, the inlet water enters as new parcels at the inlet heights, and
+      the parcels are resampled onto the nodes once per step.  Adjacent parcels within
+      mergeTolerance_dC are merged.  Draws larger than the tank volume are handled exactly.
+      Default is false, which uses the node by node draw model */
+
+  double getMaxStableMinutesPerStep() const;
+  /**< returns the longest step, in minutes, for which the conduction calculation is stable */
+
   int setUA(double UA, UNITS units = UNITS_kJperHrC);
   /**< This is a setter for the UA, with or without units specified - default is metric, kJperHrC */
 
@@ -581,15 +736,80 @@ class HPWH {
   double getLocationTemp_C() const;
   int setMaxTempDepression(double maxDepression, UNITS units = UNITS_C);
 
+  int getSimState(SimState &state) const;
+  /**< copies the tank temperatures, heat source states, and timers into state */
+  int setSimState(const SimState &state);
+  /**< restores a state taken with getSimState from a HPWH initialized to the same model
+      returns HPWH_ABORT if the number of nodes or heat sources does not match */
+
+  int saveState(std::vector<unsigned char> &buffer) const;
+  /**< writes the simulation state and the outputs of the last step into buffer, as a
+      versioned little endian binary snapshot ending in a CRC-32.  Returns 0 */
+  int loadState(const unsigned char *data, size_t size);
+  int loadState(const std::vector<unsigned char> &buffer) { return loadState(buffer.data(), buffer.size()); }
+  /**< restores a snapshot from saveState onto a HPWH initialized to the same model, after which
+      the simulation continues bit for bit as it would have.  Returns HPWH_ABORT, and leaves the
+      HPWH unchanged, if the snapshot is damaged, of another version or of another model */
+  static const int STATE_VERSION = 1;
+  /**< the version written by saveState */
+
+  int compileModel(std::vector<unsigned char> &image) const;
+  int compileModelFile(std::string imageFile) const;
+  /**< writes the whole model - configuration, heat sources with their maps and logic, and the
+      current tank state - as a versioned little endian binary image ending in a CRC-32, into
+      image or the file imageFile.  Compile right after an init to get the model as it starts.
+      Returns HPWH_ABORT if a heating logic compares with anything but std::less or
+      std::greater, or the file can not be written */
+  int HPWHinit_image(const unsigned char *image, size_t size);
+  int HPWHinit_image(const std::vector<unsigned char> &image) { return HPWHinit_image(image.data(), image.size()); }
+  int HPWHinit_imageFile(std::string imageFile);
+  /**< initializes from a compiled image, in memory or in a file that is memory mapped where
+      the platform allows, without any parsing, after which the HPWH simulates bit for bit as
+      the compiled one.  The verbosity and message callback are kept.  Returns HPWH_ABORT, and
+      leaves the HPWH unchanged, if the image is damaged or of another version */
+  static const int MODEL_IMAGE_VERSION = 1;
+  /**< the version written by compileModel */
+
+  int simulateAhead(int horizon, const AheadInputs &inputs, const std::vector<AheadCandidate> &candidates,
+                    std::vector<AheadOutputs> &outputs, int numThreads = 0) const;
+  /**< runs each candidate horizon steps ahead from the current state, on private copies of this
+      HPWH, which is not changed.  Candidates are spread over numThreads threads, 0 for the
+      hardware concurrency, and the outputs do not depend on the number of threads.  The copies
+      are silent.  Returns HPWH_ABORT if an input or trajectory is shorter than horizon, a
+      setpoint can not be reached, or a step fails  */
+
 
  private:
   class HeatSource;
 
   void setAllDefaults(); /**< sets all the defaults default */
+  void copyValues(const HPWH &hpwh);
+  /**< copies everything but the node and heat source arrays, for the copy and move  */
+  std::shared_ptr<const HPWH> makePrototype() const;
+  /**< a copy for the prototype cache, silent and without the message callback  */
+  void copyPrototype(const HPWH &prototype);
+  /**< copies a cached prototype, keeping this HPWH's verbosity and message callback  */
 
 	void updateTankTemps(double draw, double inletT, double ambientT, double inletVol2_L, double inletT2_L);
 	void mixTankInversions();
 	/**< Mixes the any temperature inversions in the tank after all the temperature calculations  */
+
+	struct TankParcel {
+		double vol_L;
+		double T_C;
+	};
+	void drawTankParcels(int lowInletH, double lowInletV_L, double lowInletT_C,
+		int highInletH, double highInletV_L, double highInletT_C);
+	/**< Plug flow draw of the parcel model, sets outletTemp_C, see setDoParcelDraws  */
+	void addTankParcel(std::vector<TankParcel> &stack, double vol_L, double T_C) const;
+	/**< Puts a parcel on top of stack, merging it with the top parcel if within parcelTolerance_dC  */
+	void splitTankParcels(const std::vector<TankParcel> &stack, double bottomVol_L,
+		std::vector<TankParcel> &bottom, std::vector<TankParcel> &top) const;
+	/**< Splits stack into the bottom bottomVol_L of water and the rest  */
+	void resampleTankParcels(const std::vector<TankParcel> &stack, int firstNode, int endNode);
+	/**< Sets nodes firstNode to endNode - 1 to the volume weighted temperatures of stack  */
+	double simTcouple_C(int iTCouple, int nTCouple) const;
+	/**< the unchecked average behind getNthSimTcouple and getStepOutputs  */
 	bool areAllHeatSourcesOff() const;
 	/**< test if all the heat sources are off  */
 	void turnAllHeatSourcesOff();
@@ -600,7 +820,7 @@ class HPWH {
 	void addExtraHeat(std::vector<double>* nodePowerExtra_W, double tankAmbientT_C);
 	/**< adds extra heat defined by the user. Where nodeExtraHeat[] is a vector of heat quantities to be added during the step.  nodeExtraHeat[ 0] would go to bottom node, 1 to next etc.  */
 
-  double tankAvg_C(const std::vector<NodeWeight> nodeWeights) const;
+  double tankAvg_C(const std::vector<NodeWeight> &nodeWeights) const;
 	/**< functions to calculate what the temperature in a portion of the tank is  */
   double nodeWeightAvgFract(HeatingLogic logic) const;
   /**< function to calculate where the average node for a logic set is. */
@@ -751,6 +971,11 @@ class HPWH {
   bool doConduction;
   /**<  If and only if true will model conduction between the internal nodes of the tank  */
 
+  bool doParcelDraws;
+  /**<  If and only if true will model draws as plug flow of water parcels, see setDoParcelDraws  */
+  double parcelTolerance_dC;
+  /**<  the largest temperature difference between parcels that are merged  */
+
 };  //end of HPWH class
 
 
@@ -760,13 +985,12 @@ class HPWH::HeatSource {
  public:
   friend class HPWH;
 
-	HeatSource(){}  /**< default constructor, does not create a useful HeatSource */
+	HeatSource() : backupIndex(-1), companionIndex(-1), followedByIndex(-1) {}
+	/**< default constructor, does not create a useful HeatSource */
 	HeatSource(HPWH *parentHPWH);
   /**< constructor assigns a pointer to the hpwh that owns this heat source  */
-  HeatSource(const HeatSource &hSource);  ///copy constructor
-  HeatSource& operator=(const HeatSource &hSource); ///assignment operator
-  /**< the copy constructor and assignment operator basically just checks if there
-      are backup/companion pointers - these can't be copied */
+  /**< the implicit copy and move copy everything but leave hpwh pointing at the old owner,
+      the HPWH copy and move point it at the new one */
 
   void setupAsResistiveElement(int node, double Watts);
   /**< configure the heat source to be a resisive element, positioned at the
@@ -863,15 +1087,19 @@ class HPWH::HeatSource {
 // these are the heat source property variables
 	bool isVIP;
 	/**< is this heat source a high priority heat source? (e.g. upper resisitor) */
-	HeatSource* backupHeatSource;
-	/**< a pointer to the heat source which serves as backup to this one
-      should be NULL if no backup exists */
-	HeatSource* companionHeatSource;
-	/**< a pointer to the heat source which will run concurrently with this one
-      it still will only turn on if shutsOff is false */
-
-  HeatSource* followedByHeatSource;
-	/**< a pointer to the heat source which will attempt to run after this one */
+	int backupIndex;
+	/**< the index in setOfSources of the heat source which serves as backup to this one
+      should be -1 if no backup exists */
+	int companionIndex;
+	/**< the index of the heat source which will run concurrently with this one
+      it still will only turn on if shutsOff is false, -1 if none */
+	int followedByIndex;
+	/**< the index of the heat source which will attempt to run after this one, -1 if none */
+
+	HeatSource *backupHeatSource() const;
+	HeatSource *companionHeatSource() const;
+	HeatSource *followedByHeatSource() const;
+	/**< the heat sources above, from the owning hpwh, NULL if there is none */
 
 	double condensity[CONDENSITY_SIZE];
 	/**< The condensity function is always composed of 12 nodes.
@@ -900,7 +1128,7 @@ class HPWH::HeatSource {
 	/** a vector to hold the set of logical choices that can cause an element to turn off */
 	std::vector<HeatingLogic> shutOffLogicSet;
 	/** a single logic that checks the bottom point is below a temperature so the system doesn't short cycle*/
-	HeatingLogic *standbyLogic;
+	std::shared_ptr<HeatingLogic> standbyLogic;
 
 	struct defrostPoint {
 		double T_F;
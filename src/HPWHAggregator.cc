@@ -0,0 +1,176 @@
+/*
+ * Deterministic fleet totals over many HPWH simulations
+ */
+
+#include "HPWHAggregator.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace {
+typedef std::chrono::steady_clock aggregatorClock;
+
+// the block sums of a window take about this many Totals, 7 MB
+const long WINDOW_TOTALS = 1 << 16;
+
+template <typename T>
+T *offsetArray(T *array, long offset) {
+	return (array == NULL) ? NULL : array + offset;
+}
+
+// the pairwise sum of count Totals, stride apart from sums
+HPWHAggregator::Totals pairwiseSum(const HPWHAggregator::Totals *sums, long count, long stride) {
+	if (count == 1) {
+		return sums[0];
+	}
+	long half = count / 2;
+	HPWHAggregator::Totals sum = pairwiseSum(sums, half, stride);
+	HPWHAggregator::addTotals(sum, pairwiseSum(sums + half * stride, count - half, stride));
+	return sum;
+}
+
+// steps the tanks of a block through the intervals of a window, adding each tank's results to
+// the block's sums for each interval in turn
+int stepBlock(std::vector<HPWHAggregator::Tank> &tanks, long block, long firstStep, long windowIntervals,
+	int intervalSteps, HPWHAggregator::Totals *sums, long &failedTank) {
+	long end = std::min((long)tanks.size(), (block + 1) * HPWHAggregator::BLOCK_TANKS);
+	for (long t = block * HPWHAggregator::BLOCK_TANKS; t < end; t++) {
+		HPWH &hpwh = *tanks[t].hpwh;
+		const HPWH::StepInputs &inputs = tanks[t].inputs;
+		for (long k = 0; k < windowIntervals; k++) {
+			long begin = firstStep + k * intervalSteps;
+			HPWH::StepInputs in = inputs;
+			in.inletT_C = offsetArray(inputs.inletT_C, begin);
+			in.drawVolume_L = offsetArray(inputs.drawVolume_L, begin);
+			in.tankAmbientT_C = offsetArray(inputs.tankAmbientT_C, begin);
+			in.heatSourceAmbientT_C = offsetArray(inputs.heatSourceAmbientT_C, begin);
+			in.DRstatus = offsetArray(inputs.DRstatus, begin);
+			in.inletVol2_L = offsetArray(inputs.inletVol2_L, begin);
+			in.inletT2_C = offsetArray(inputs.inletT2_C, begin);
+			in.setpoint_C = offsetArray(inputs.setpoint_C, begin);
+			in.nodePowerExtra_W = offsetArray(inputs.nodePowerExtra_W, begin);
+			// runNSteps leaves the interval's sums in the HPWH
+			if (hpwh.runNSteps(intervalSteps, in) != 0) {
+				failedTank = t;
+				return HPWH::HPWH_ABORT;
+			}
+
+			HPWHAggregator::Totals &sum = sums[k];
+			bool heating = false;
+			bool typeHeating[HPWHAggregator::NUM_TYPES] = { false, false, false, false };
+			for (int j = 0; j < hpwh.getNumHeatSources(); j++) {
+				int type = hpwh.getNthHeatSourceType(j);
+				sum.energyInput_kWh[type] += hpwh.getNthHeatSourceEnergyInput(j);
+				sum.energyOutput_kWh[type] += hpwh.getNthHeatSourceEnergyOutput(j);
+				if (hpwh.getNthHeatSourceRunTime(j) > 0.) {
+					heating = typeHeating[type] = true;
+				}
+			}
+			sum.standbyLosses_kWh += hpwh.getStandbyLosses();
+			sum.tanksHeating += heating ? 1 : 0;
+			for (int type = 0; type < HPWHAggregator::NUM_TYPES; type++) {
+				sum.tanksHeatingByType[type] += typeHeating[type] ? 1 : 0;
+			}
+		}
+	}
+	return 0;
+}
+}
+
+HPWHAggregator::HPWHAggregator() : intervalSteps(1), failedTank(-1), reduceSeconds(0.)
+{
+	numThreads = std::max(1, (int)std::thread::hardware_concurrency());
+}
+
+int HPWHAggregator::setNumThreads(int threads) {
+	if (threads < 1) {
+		return HPWH::HPWH_ABORT;
+	}
+	numThreads = threads;
+	return 0;
+}
+
+int HPWHAggregator::setIntervalSteps(int steps) {
+	if (steps < 1) {
+		return HPWH::HPWH_ABORT;
+	}
+	intervalSteps = steps;
+	return 0;
+}
+
+void HPWHAggregator::addTotals(Totals &sum, const Totals &totals) {
+	for (int type = 0; type < NUM_TYPES; type++) {
+		sum.energyInput_kWh[type] += totals.energyInput_kWh[type];
+		sum.energyOutput_kWh[type] += totals.energyOutput_kWh[type];
+		sum.tanksHeatingByType[type] += totals.tanksHeatingByType[type];
+	}
+	sum.standbyLosses_kWh += totals.standbyLosses_kWh;
+	sum.tanksHeating += totals.tanksHeating;
+}
+
+int HPWHAggregator::run(std::vector<Tank> &tanks, long steps, TotalsFunc totalsFunc) {
+	failedTank = -1;
+	reduceSeconds = 0.;
+	if (steps < 0 || steps % intervalSteps != 0 || !totalsFunc) {
+		return HPWH::HPWH_ABORT;
+	}
+	for (const Tank &tank : tanks) {
+		if (tank.hpwh == NULL || tank.inputs.inletT_C == NULL || tank.inputs.drawVolume_L == NULL ||
+			tank.inputs.tankAmbientT_C == NULL || tank.inputs.heatSourceAmbientT_C == NULL) {
+			return HPWH::HPWH_ABORT;
+		}
+	}
+
+	const long intervals = steps / intervalSteps;
+	const long blocks = std::max(1L, ((long)tanks.size() + BLOCK_TANKS - 1) / BLOCK_TANKS);
+	const long windowIntervals = std::max(1L, std::min(intervals, WINDOW_TOTALS / blocks));
+	const int threads = (int)std::min((long)numThreads, blocks);
+	const Totals zero = Totals();
+	std::vector<Totals> blockSums(blocks * windowIntervals);
+	std::vector<long> blockFailures(blocks);
+
+	for (long firstInterval = 0; firstInterval < intervals; firstInterval += windowIntervals) {
+		const long window = std::min(windowIntervals, intervals - firstInterval);
+		std::fill(blockSums.begin(), blockSums.end(), zero);
+		std::fill(blockFailures.begin(), blockFailures.end(), -1L);
+
+		// the workers take blocks in turn, and each block's sums are its own
+		std::atomic<long> nextBlock(0);
+		auto worker = [&]() {
+			for (long block = nextBlock++; block < blocks; block = nextBlock++) {
+				stepBlock(tanks, block, firstInterval * intervalSteps, window, intervalSteps,
+					&blockSums[block * windowIntervals], blockFailures[block]);
+			}
+		};
+		if (threads == 1) {
+			worker();
+		}
+		else {
+			std::vector<std::thread> workers;
+			for (int t = 0; t < threads; t++) {
+				workers.push_back(std::thread(worker));
+			}
+			for (auto &thread : workers) {
+				thread.join();
+			}
+		}
+		for (long block = 0; block < blocks && failedTank < 0; block++) {
+			failedTank = blockFailures[block];
+		}
+		if (failedTank >= 0) {
+			return HPWH::HPWH_ABORT;
+		}
+
+		for (long k = 0; k < window; k++) {
+			aggregatorClock::time_point reduceStart = aggregatorClock::now();
+			Totals totals = pairwiseSum(&blockSums[k], blocks, windowIntervals);
+			reduceSeconds += std::chrono::duration<double>(aggregatorClock::now() - reduceStart).count();
+			if (totalsFunc(firstInterval + k, totals) != 0) {
+				return HPWH::HPWH_ABORT;
+			}
+		}
+	}
+	return 0;
+}
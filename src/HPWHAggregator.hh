@@ -0,0 +1,77 @@
+#ifndef HPWHAGGREGATOR_hh
+#define HPWHAGGREGATOR_hh
+
+#include "HPWH.hh"
+
+#include <functional>
+#include <vector>
+
+/** Steps a fleet of tanks on a pool of threads and sums their results over the fleet for each
+ *  interval of steps: the energy input and output of the heat sources by type, the standby
+ *  losses and the number of tanks heating.
+ *
+ *  The sums are bit for bit the same whatever the number of threads.  The fleet is cut into
+ *  blocks of BLOCK_TANKS tanks in order, each block is summed tank by tank by one worker, and
+ *  the block sums are added by a pairwise tree over the blocks.  The blocks and the tree depend
+ *  only on the number of tanks, so threads change who adds a block but never the order of any
+ *  addition.  The tree also keeps the rounding error of a large fleet down to that of a block.
+ *
+ *  The run goes window by window, each some intervals long: every tank is stepped through the
+ *  window, then the window's intervals are reduced and handed on in order.  The windows are
+ *  sized so that the block sums of one take a few megabytes whatever the fleet.
+ */
+class HPWHAggregator {
+ public:
+  static const int NUM_TYPES = 4;
+  /**< the HPWH::HEATSOURCE_TYPE values, TYPE_none to TYPE_extra, the totals are kept by  */
+  static const int BLOCK_TANKS = 64;
+  /**< the tanks summed in order into one leaf of the reduction tree  */
+
+  /** a tank of the fleet */
+  struct Tank {
+    HPWH *hpwh = NULL;        /**< set up by the caller and stepped in place */
+    HPWH::StepInputs inputs;  /**< the caller's arrays for the whole run, as runNSteps takes them.
+                                   Tanks may share arrays */
+  };
+
+  /** the fleet's results over one interval */
+  struct Totals {
+    double energyInput_kWh[NUM_TYPES];   /**< by HPWH::HEATSOURCE_TYPE */
+    double energyOutput_kWh[NUM_TYPES];  /**< by HPWH::HEATSOURCE_TYPE */
+    double standbyLosses_kWh;
+    long tanksHeating;                   /**< tanks with a heat source that ran in the interval */
+    long tanksHeatingByType[NUM_TYPES];  /**< tanks with a heat source of the type that ran */
+  };
+
+  typedef std::function<int(long interval, const Totals &totals)> TotalsFunc;
+  /**< takes the totals of each interval in order, on the thread that called run.  Returns 0,
+      or HPWH::HPWH_ABORT to stop the run  */
+
+  HPWHAggregator();
+
+  int setNumThreads(int threads);
+  /**< the number of workers, default is the hardware concurrency  */
+  int setIntervalSteps(int steps);
+  /**< the steps summed into each interval, default is 1  */
+
+  int run(std::vector<Tank> &tanks, long steps, TotalsFunc totalsFunc);
+  /**< steps every tank steps one minute steps and passes the fleet totals of each interval to
+      totalsFunc.  steps must be a whole number of intervals
+      returns 0 for success, HPWH::HPWH_ABORT if a tank failed or totalsFunc stopped the run  */
+
+  long getFailedTank() const { return failedTank; }
+  /**< the first tank to fail in the last run, -1 if none did  */
+  double getReduceSeconds() const { return reduceSeconds; }
+  /**< the time the last run spent adding up block sums, to show what aggregating costs  */
+
+  static void addTotals(Totals &sum, const Totals &totals);
+  /**< adds totals to sum, field by field  */
+
+ private:
+  int numThreads;
+  int intervalSteps;
+  long failedTank;
+  double reduceSeconds;
+};
+
+#endif
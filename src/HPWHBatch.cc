@@ -0,0 +1,204 @@
+/*
+ * Work stealing batch runner for independent HPWH simulations
+ */
+
+#include "HPWHBatch.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <numeric>
+#include <thread>
+
+namespace {
+typedef std::chrono::steady_clock batchClock;
+
+// the next chunk of a job
+struct BatchTask {
+	int job;
+	long begin;
+};
+
+// a worker's tasks, the worker takes from the back and thieves from the front.  Chunks are
+// long, so a lock per queue costs nothing next to them
+struct TaskQueue {
+	std::mutex mutex;
+	std::deque<BatchTask> tasks;
+
+	void push(const BatchTask &task) {
+		std::lock_guard<std::mutex> lock(mutex);
+		tasks.push_back(task);
+	}
+	bool popBack(BatchTask &task) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (tasks.empty()) {
+			return false;
+		}
+		task = tasks.back();
+		tasks.pop_back();
+		return true;
+	}
+	bool popFront(BatchTask &task) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (tasks.empty()) {
+			return false;
+		}
+		task = tasks.front();
+		tasks.pop_front();
+		return true;
+	}
+};
+
+template <typename T>
+T *offsetArray(T *array, long offset) {
+	return (array == NULL) ? NULL : array + offset;
+}
+}
+
+HPWHBatch::HPWHBatch() : chunkSteps(43200), wallSeconds(0.)
+{
+	numThreads = std::max(1, (int)std::thread::hardware_concurrency());
+}
+
+int HPWHBatch::setNumThreads(int threads) {
+	if (threads < 1) {
+		return HPWH::HPWH_ABORT;
+	}
+	numThreads = threads;
+	return 0;
+}
+
+int HPWHBatch::setChunkSteps(long steps) {
+	if (steps < 1) {
+		return HPWH::HPWH_ABORT;
+	}
+	chunkSteps = steps;
+	return 0;
+}
+
+int HPWHBatch::run(std::vector<Job> &jobs) {
+	for (const Job &job : jobs) {
+		if (job.hpwh == NULL || job.steps < 0 || !job.runChunk) {
+			return HPWH::HPWH_ABORT;
+		}
+	}
+	batchClock::time_point start = batchClock::now();
+
+	// deal the jobs out longest first, so the long ones start early and the short ones fill in
+	std::vector<double> cost(jobs.size());
+	for (size_t j = 0; j < jobs.size(); j++) {
+		cost[j] = (jobs[j].cost > 0.) ? jobs[j].cost : (double)jobs[j].steps * std::max(1, jobs[j].hpwh->getNumNodes());
+	}
+	std::vector<int> order(jobs.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return cost[a] > cost[b]; });
+
+	std::vector<TaskQueue> queues(numThreads);
+	int queued = 0;
+	for (int j : order) {
+		jobs[j].status = 0;
+		if (jobs[j].steps > 0) {
+			BatchTask task = { j, 0 };
+			queues[queued++ % numThreads].push(task);
+		}
+	}
+
+	WorkerStats noStats = { 0, 0, 0, 0, 0., 0. };
+	workerStats.assign(numThreads, noStats);
+	std::atomic<int> jobsLeft(queued);
+	auto worker = [&](int w) {
+		WorkerStats &stats = workerStats[w];
+		while (jobsLeft > 0) {
+			BatchTask task;
+			bool haveTask = queues[w].popBack(task);
+			for (int v = 1; !haveTask && v < numThreads; v++) {
+				haveTask = queues[(w + v) % numThreads].popFront(task);
+				stats.steals += haveTask ? 1 : 0;
+			}
+			if (!haveTask) {
+				// every job left is in the middle of a chunk on another worker
+				std::this_thread::sleep_for(std::chrono::microseconds(100));
+				continue;
+			}
+
+			Job &job = jobs[task.job];
+			long end = std::min(job.steps, task.begin + chunkSteps);
+			batchClock::time_point chunkStart = batchClock::now();
+			int result = job.runChunk(*job.hpwh, task.begin, end);
+			stats.busySeconds += std::chrono::duration<double>(batchClock::now() - chunkStart).count();
+			stats.chunks++;
+			stats.steps += end - task.begin;
+
+			if (result != 0 || end == job.steps) {
+				job.status = (result == 0) ? 0 : HPWH::HPWH_ABORT;
+				stats.jobsFinished++;
+				jobsLeft--;
+			}
+			else {
+				BatchTask next = { task.job, end };
+				queues[w].push(next);
+			}
+		}
+	};
+
+	if (numThreads == 1) {
+		worker(0);
+	}
+	else {
+		std::vector<std::thread> threads;
+		for (int t = 0; t < numThreads; t++) {
+			threads.push_back(std::thread(worker, t));
+		}
+		for (auto &thread : threads) {
+			thread.join();
+		}
+	}
+
+	wallSeconds = std::chrono::duration<double>(batchClock::now() - start).count();
+	bool failed = false;
+	for (WorkerStats &stats : workerStats) {
+		stats.utilization = (wallSeconds > 0.) ? stats.busySeconds / wallSeconds : 0.;
+	}
+	for (const Job &job : jobs) {
+		failed = failed || job.status != 0;
+	}
+	return failed ? HPWH::HPWH_ABORT : 0;
+}
+
+HPWHBatch::ChunkFunc HPWHBatch::runNStepsChunks(const HPWH::StepInputs &inputs,
+	const HPWH::StepOutputArrays *outputs /*=NULL*/) {
+	bool haveOutputs = outputs != NULL;
+	HPWH::StepOutputArrays allOutputs;
+	if (haveOutputs) {
+		allOutputs = *outputs;
+	}
+	return [inputs, allOutputs, haveOutputs](HPWH &hpwh, long begin, long end) {
+		HPWH::StepInputs in = inputs;
+		in.inletT_C = offsetArray(inputs.inletT_C, begin);
+		in.drawVolume_L = offsetArray(inputs.drawVolume_L, begin);
+		in.tankAmbientT_C = offsetArray(inputs.tankAmbientT_C, begin);
+		in.heatSourceAmbientT_C = offsetArray(inputs.heatSourceAmbientT_C, begin);
+		in.DRstatus = offsetArray(inputs.DRstatus, begin);
+		in.inletVol2_L = offsetArray(inputs.inletVol2_L, begin);
+		in.inletT2_C = offsetArray(inputs.inletT2_C, begin);
+		in.setpoint_C = offsetArray(inputs.setpoint_C, begin);
+		in.nodePowerExtra_W = offsetArray(inputs.nodePowerExtra_W, begin);
+		if (!haveOutputs) {
+			return hpwh.runNSteps((int)(end - begin), in);
+		}
+
+		long perStep = hpwh.getNumHeatSources();
+		HPWH::StepOutputArrays out;
+		out.outletTemp_C = offsetArray(allOutputs.outletTemp_C, begin);
+		out.standbyLosses_kWh = offsetArray(allOutputs.standbyLosses_kWh, begin);
+		out.energyRemovedFromEnvironment_kWh = offsetArray(allOutputs.energyRemovedFromEnvironment_kWh, begin);
+		out.tankHeatContent_kJ = offsetArray(allOutputs.tankHeatContent_kJ, begin);
+		out.heatSourceEnergyInput_kWh = offsetArray(allOutputs.heatSourceEnergyInput_kWh, begin * perStep);
+		out.heatSourceEnergyOutput_kWh = offsetArray(allOutputs.heatSourceEnergyOutput_kWh, begin * perStep);
+		out.heatSourceRunTime_min = offsetArray(allOutputs.heatSourceRunTime_min, begin * perStep);
+		out.simTcouples_C = offsetArray(allOutputs.simTcouples_C, begin * HPWH::STEP_TCOUPLES);
+		return hpwh.runNSteps((int)(end - begin), in, &out);
+	};
+}
@@ -0,0 +1,74 @@
+#ifndef HPWHBATCH_hh
+#define HPWHBATCH_hh
+
+#include "HPWH.hh"
+
+#include <functional>
+#include <vector>
+
+/** Runs a batch of independent simulations on a pool of threads with work stealing.
+ *
+ *  Each job is split into chunks of steps, run in order on the job's own HPWH, so the tank
+ *  state carries from one chunk to the next.  Jobs are dealt to the workers longest first.
+ *  A worker runs the chunks of its own jobs newest first, so it keeps going on the job it has
+ *  just run, and when it runs out it steals the oldest task of another worker: a job that
+ *  has not started or the next chunk of one that has.  A long job therefore moves to a free
+ *  worker instead of holding up the ones queued behind it.
+ *
+ *  A job's chunks never run at the same time, so the results are the same as running each
+ *  job alone, whatever the number of threads.
+ */
+class HPWHBatch {
+ public:
+  typedef std::function<int(HPWH &hpwh, long begin, long end)> ChunkFunc;
+  /**< runs steps begin to end - 1 of a job on its HPWH, returns 0 or HPWH::HPWH_ABORT.  The
+      chunks of a job run one after another, so it may keep running totals  */
+
+  struct Job {
+    HPWH *hpwh = NULL;     /**< set up by the caller and stepped in place */
+    long steps = 0;        /**< the length of the run */
+    ChunkFunc runChunk;
+    double cost = 0.;      /**< the relative cost of the job, to start the longest first.
+                                0 estimates it as steps times nodes */
+    int status = 0;        /**< set by run, 0 or HPWH::HPWH_ABORT.  A failed job stops at
+                                that chunk, the others carry on */
+  };
+
+  struct WorkerStats {
+    long chunks;           /**< the chunks run */
+    long steps;            /**< the steps in those chunks */
+    long steals;           /**< the tasks taken from other workers */
+    long jobsFinished;
+    double busySeconds;    /**< time spent running chunks */
+    double utilization;    /**< busySeconds over the wall time of the batch */
+  };
+
+  HPWHBatch();
+
+  int setNumThreads(int threads);
+  /**< the number of workers, default is the hardware concurrency  */
+  int setChunkSteps(long steps);
+  /**< the length of a chunk, default is 43200, thirty days of minutes  */
+
+  int run(std::vector<Job> &jobs);
+  /**< runs every job to its end or first failure
+      returns 0 if all succeeded, HPWH::HPWH_ABORT otherwise  */
+
+  const std::vector<WorkerStats> &getWorkerStats() const { return workerStats; }
+  /**< what each worker did in the last run  */
+  double getWallSeconds() const { return wallSeconds; }
+  /**< the wall time of the last run  */
+
+  static ChunkFunc runNStepsChunks(const HPWH::StepInputs &inputs, const HPWH::StepOutputArrays *outputs = NULL);
+  /**< a ChunkFunc running each chunk with HPWH::runNSteps over that part of inputs, and
+      writing that part of outputs when given.  The arrays are the caller's and must outlive
+      the run.  Note runNSteps leaves the sums of the last chunk in the HPWH, not of the run  */
+
+ private:
+  int numThreads;
+  long chunkSteps;
+  std::vector<WorkerStats> workerStats;
+  double wallSeconds;
+};
+
+#endif
@@ -0,0 +1,357 @@
+/*
+ * Monte Carlo draw schedule ensembles with streaming statistics
+ */
+
+#include "HPWHEnsemble.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <random>
+#include <thread>
+
+namespace {
+// the steps run per call to runNSteps, so the per step outputs need only this much room
+const long ENSEMBLE_BLOCK_STEPS = 1440;
+
+template <typename T>
+T *offsetArray(T *array, long offset) {
+	return (array == NULL) ? NULL : array + offset;
+}
+
+// uniform on [0, 1) from the 53 high bits, so the numbers are the same with any standard library
+double uniform01(std::mt19937_64 &rng) {
+	return (rng() >> 11) * (1.0 / 9007199254740992.0);
+}
+}
+
+HPWHEnsemble::Statistic::Statistic(const std::vector<double> &quantileProbabilities /*=...*/) :
+	count(0), mean(0.), m2(0.), min(0.), max(0.), probabilities(quantileProbabilities)
+{
+}
+
+void HPWHEnsemble::Statistic::add(double x) {
+	count++;
+	double delta = x - mean;
+	mean += delta / count;
+	m2 += delta * (x - mean);
+	min = (count == 1) ? x : std::min(min, x);
+	max = (count == 1) ? x : std::max(max, x);
+
+	if (count <= EXACT_VALUES) {
+		firstValues.push_back(x);
+		if (count == EXACT_VALUES) {
+			std::vector<double> sorted(firstValues);
+			std::sort(sorted.begin(), sorted.end());
+			quantiles.assign(probabilities.size(), P2Quantile());
+			for (size_t i = 0; i < probabilities.size(); i++) {
+				quantiles[i].p = probabilities[i];
+				quantiles[i].start(sorted);
+			}
+		}
+		return;
+	}
+	for (P2Quantile &quantile : quantiles) {
+		quantile.add(x);
+	}
+}
+
+double HPWHEnsemble::Statistic::getVariance() const {
+	return (count < 2) ? 0. : m2 / (count - 1);
+}
+
+double HPWHEnsemble::Statistic::getQuantile(int i) const {
+	if (i < 0 || i >= (int)probabilities.size() || count == 0) {
+		return 0.;
+	}
+	if (count > EXACT_VALUES) {
+		return quantiles[i].heights[2];
+	}
+	// interpolate the sorted values
+	std::vector<double> sorted(firstValues);
+	std::sort(sorted.begin(), sorted.end());
+	double rank = probabilities[i] * (count - 1);
+	int below = (int)rank;
+	if (below >= count - 1) {
+		return sorted[count - 1];
+	}
+	return sorted[below] + (rank - below) * (sorted[below + 1] - sorted[below]);
+}
+
+void HPWHEnsemble::Statistic::P2Quantile::start(const std::vector<double> &sorted) {
+	// the markers at the sample's min, p/2, p, (1+p)/2 quantiles and max, at distinct ranks
+	double n = (double)sorted.size();
+	increments[0] = 0.;
+	increments[1] = p / 2.;
+	increments[2] = p;
+	increments[3] = (1. + p) / 2.;
+	increments[4] = 1.;
+	for (int i = 0; i < 5; i++) {
+		desired[i] = 1. + (n - 1.) * increments[i];
+		positions[i] = std::floor(desired[i] + 0.5);
+	}
+	for (int i = 1; i < 5; i++) {
+		positions[i] = std::max(positions[i], positions[i - 1] + 1.);
+	}
+	for (int i = 3; i >= 0; i--) {
+		positions[i] = std::min(positions[i], positions[i + 1] - 1.);
+	}
+	for (int i = 0; i < 5; i++) {
+		heights[i] = sorted[(size_t)positions[i] - 1];
+	}
+}
+
+void HPWHEnsemble::Statistic::P2Quantile::add(double x) {
+	// the cell x falls in, stretching the ends if it is outside them
+	int k;
+	if (x < heights[0]) {
+		heights[0] = x;
+		k = 0;
+	}
+	else if (x >= heights[4]) {
+		heights[4] = x;
+		k = 3;
+	}
+	else {
+		k = 0;
+		while (x >= heights[k + 1]) {
+			k++;
+		}
+	}
+	for (int i = k + 1; i < 5; i++) {
+		positions[i] += 1.;
+	}
+	for (int i = 0; i < 5; i++) {
+		desired[i] += increments[i];
+	}
+
+	// move the middle markers toward their desired positions, piecewise parabolic if that
+	// keeps the heights in order, else linear
+	for (int i = 1; i < 4; i++) {
+		double d = desired[i] - positions[i];
+		if ((d >= 1. && positions[i + 1] - positions[i] > 1.) || (d <= -1. && positions[i - 1] - positions[i] < -1.)) {
+			int s = (d > 0.) ? 1 : -1;
+			double parabolic = heights[i] + s / (positions[i + 1] - positions[i - 1]) *
+				((positions[i] - positions[i - 1] + s) * (heights[i + 1] - heights[i]) / (positions[i + 1] - positions[i]) +
+				(positions[i + 1] - positions[i] - s) * (heights[i] - heights[i - 1]) / (positions[i] - positions[i - 1]));
+			if (heights[i - 1] < parabolic && parabolic < heights[i + 1]) {
+				heights[i] = parabolic;
+			}
+			else {
+				heights[i] += s * (heights[i + s] - heights[i]) / (positions[i + s] - positions[i]);
+			}
+			positions[i] += s;
+		}
+	}
+}
+
+HPWHEnsemble::HPWHEnsemble(InitFunc init) : initFunc(init), peakWindow_min(60)
+{
+	numThreads = std::max(1, (int)std::thread::hardware_concurrency());
+	quantileProbabilities = { 0.05, 0.5, 0.95 };
+	comfortTemp_C = F_TO_C(105.);
+}
+
+int HPWHEnsemble::setNumThreads(int threads) {
+	if (threads < 1) {
+		return HPWH::HPWH_ABORT;
+	}
+	numThreads = threads;
+	return 0;
+}
+
+int HPWHEnsemble::setQuantiles(const std::vector<double> &probabilities) {
+	for (double p : probabilities) {
+		if (!(p > 0. && p < 1.)) {
+			return HPWH::HPWH_ABORT;
+		}
+	}
+	quantileProbabilities = probabilities;
+	return 0;
+}
+
+int HPWHEnsemble::setComfortTemp(double comfortTemp, HPWH::UNITS units /*=UNITS_C*/) {
+	if (units == HPWH::UNITS_C) {
+		comfortTemp_C = comfortTemp;
+	}
+	else if (units == HPWH::UNITS_F) {
+		comfortTemp_C = F_TO_C(comfortTemp);
+	}
+	else {
+		return HPWH::HPWH_ABORT;
+	}
+	return 0;
+}
+
+int HPWHEnsemble::setPeakWindow(int minutes) {
+	if (minutes < 1) {
+		return HPWH::HPWH_ABORT;
+	}
+	peakWindow_min = minutes;
+	return 0;
+}
+
+int HPWHEnsemble::run(long realizations, long steps, const HPWH::StepInputs &inputs, DrawGenerator draws) {
+	energyInput_kWh = Statistic(quantileProbabilities);
+	minutesBelowComfort = Statistic(quantileProbabilities);
+	peakDemand_kW = Statistic(quantileProbabilities);
+	if (realizations < 0 || steps < 1 || !draws) {
+		return HPWH::HPWH_ABORT;
+	}
+
+	// results that finish early wait for the ones before them, at most window of them
+	const long window = 2 * numThreads;
+	std::mutex mutex;
+	std::condition_variable changed;
+	long nextRealization = 0;
+	long nextToAdd = 0;
+	std::map<long, RunMetrics> pending;
+	bool failed = false;
+
+	auto worker = [&]() {
+		HPWH initial, hpwh;
+		std::vector<double> drawVolume_L(steps);
+		bool ok = initFunc(initial) == 0;
+		while (true) {
+			long r;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				failed = failed || !ok;
+				changed.wait(lock, [&]() {
+					return failed || nextRealization >= realizations || nextRealization - nextToAdd < window;
+				});
+				if (failed || nextRealization >= realizations) {
+					changed.notify_all();
+					return;
+				}
+				r = nextRealization++;
+			}
+
+			RunMetrics metrics;
+			std::fill(drawVolume_L.begin(), drawVolume_L.end(), 0.);
+			hpwh = initial;
+			ok = draws(r, drawVolume_L) == 0 && (long)drawVolume_L.size() == steps &&
+				runRealization(hpwh, steps, inputs, drawVolume_L, metrics) == 0;
+			if (!ok) {
+				continue;
+			}
+
+			std::lock_guard<std::mutex> lock(mutex);
+			pending[r] = metrics;
+			for (auto next = pending.find(nextToAdd); next != pending.end(); next = pending.find(nextToAdd)) {
+				energyInput_kWh.add(next->second.energyInput_kWh);
+				minutesBelowComfort.add(next->second.minutesBelowComfort);
+				peakDemand_kW.add(next->second.peakDemand_kW);
+				pending.erase(next);
+				nextToAdd++;
+			}
+			changed.notify_all();
+		}
+	};
+
+	if (numThreads == 1) {
+		worker();
+	}
+	else {
+		std::vector<std::thread> threads;
+		for (int t = 0; t < numThreads; t++) {
+			threads.push_back(std::thread(worker));
+		}
+		for (auto &thread : threads) {
+			thread.join();
+		}
+	}
+	return failed ? HPWH::HPWH_ABORT : 0;
+}
+
+int HPWHEnsemble::runRealization(HPWH &hpwh, long steps, const HPWH::StepInputs &inputs,
+	std::vector<double> &drawVolume_L, RunMetrics &metrics) const {
+	int numHeatSources = hpwh.getNumHeatSources();
+	std::vector<double> outletTemp_C(ENSEMBLE_BLOCK_STEPS);
+	std::vector<double> energyInput(ENSEMBLE_BLOCK_STEPS * std::max(1, numHeatSources));
+	HPWH::StepOutputArrays out;
+	out.outletTemp_C = outletTemp_C.data();
+	out.heatSourceEnergyInput_kWh = energyInput.data();
+
+	// the energy of the last peakWindow_min steps, in a ring
+	std::vector<double> recent_kWh(peakWindow_min, 0.);
+	double windowSum_kWh = 0.;
+	double peakWindow_kWh = 0.;
+	metrics.energyInput_kWh = 0.;
+	metrics.minutesBelowComfort = 0.;
+
+	for (long begin = 0; begin < steps; begin += ENSEMBLE_BLOCK_STEPS) {
+		long n = std::min(ENSEMBLE_BLOCK_STEPS, steps - begin);
+		HPWH::StepInputs in = inputs;
+		in.inletT_C = offsetArray(inputs.inletT_C, begin);
+		in.drawVolume_L = drawVolume_L.data() + begin;
+		in.tankAmbientT_C = offsetArray(inputs.tankAmbientT_C, begin);
+		in.heatSourceAmbientT_C = offsetArray(inputs.heatSourceAmbientT_C, begin);
+		in.DRstatus = offsetArray(inputs.DRstatus, begin);
+		in.inletVol2_L = offsetArray(inputs.inletVol2_L, begin);
+		in.inletT2_C = offsetArray(inputs.inletT2_C, begin);
+		in.setpoint_C = offsetArray(inputs.setpoint_C, begin);
+		in.nodePowerExtra_W = offsetArray(inputs.nodePowerExtra_W, begin);
+		if (hpwh.runNSteps((int)n, in, &out) != 0) {
+			return HPWH::HPWH_ABORT;
+		}
+
+		for (long i = 0; i < n; i++) {
+			double step_kWh = 0.;
+			for (int h = 0; h < numHeatSources; h++) {
+				step_kWh += energyInput[i * numHeatSources + h];
+			}
+			metrics.energyInput_kWh += step_kWh;
+			if (drawVolume_L[begin + i] > 0. && outletTemp_C[i] < comfortTemp_C) {
+				metrics.minutesBelowComfort += 1.;
+			}
+			long step = begin + i;
+			windowSum_kWh += step_kWh - recent_kWh[step % peakWindow_min];
+			recent_kWh[step % peakWindow_min] = step_kWh;
+			if (step + 1 >= peakWindow_min) {
+				peakWindow_kWh = std::max(peakWindow_kWh, windowSum_kWh);
+			}
+		}
+	}
+
+	// a run shorter than the window peaks at its mean
+	long windowSteps = std::min((long)peakWindow_min, steps);
+	if (steps < peakWindow_min) {
+		peakWindow_kWh = windowSum_kWh;
+	}
+	metrics.peakDemand_kW = peakWindow_kWh * 60. / windowSteps;
+	return 0;
+}
+
+HPWHEnsemble::DrawGenerator HPWHEnsemble::resampledDays(const std::vector<double> &baseDraws_L, unsigned long seed,
+	int maxShift_min /*=30*/, double volumeSpread /*=0.2*/) {
+	const long day = 1440;
+	long baseDays = std::max(1L, (long)baseDraws_L.size() / day);
+	return [baseDraws_L, seed, maxShift_min, volumeSpread, baseDays](long realization, std::vector<double> &drawVolume_L) {
+		if ((long)baseDraws_L.size() < day || maxShift_min < 0 || volumeSpread < 0. || volumeSpread > 1.) {
+			return HPWH::HPWH_ABORT;
+		}
+		std::seed_seq seeds = { (unsigned long)realization, seed };
+		std::mt19937_64 rng(seeds);
+		std::fill(drawVolume_L.begin(), drawVolume_L.end(), 0.);
+		long steps = drawVolume_L.size();
+		for (long dayStart = 0; dayStart < steps; dayStart += day) {
+			long baseStart = day * (long)(rng() % baseDays);
+			double scale = 1. + volumeSpread * (2. * uniform01(rng) - 1.);
+			for (long m = 0; m < day; m++) {
+				double draw_L = baseDraws_L[baseStart + m];
+				if (draw_L <= 0.) {
+					continue;
+				}
+				long shift = (long)(rng() % (2 * maxShift_min + 1)) - maxShift_min;
+				long to = dayStart + ((m + shift) % day + day) % day;
+				if (to < steps) {
+					drawVolume_L[to] += scale * draw_L;
+				}
+			}
+		}
+		return 0;
+	};
+}
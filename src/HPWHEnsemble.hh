@@ -0,0 +1,125 @@
+#ifndef HPWHENSEMBLE_hh
+#define HPWHENSEMBLE_hh
+
+#include "HPWH.hh"
+
+#include <functional>
+#include <vector>
+
+/** Runs one model through an ensemble of stochastic draw schedules and keeps streaming
+ *  statistics of the results.
+ *
+ *  Each realization runs from the same initial tank with its own draws and otherwise the same
+ *  inputs.  Only three numbers are kept per realization, the energy input, the minutes that
+ *  hot water was drawn below the comfort temperature and the peak demand, and they go straight
+ *  into running statistics: mean and variance by Welford's method and quantiles by the P^2
+ *  algorithm, which keeps five markers per quantile after a first exact sample.  Memory does
+ *  not grow with the number of realizations.
+ *
+ *  Workers hand out realizations in order and the results are added in realization order, so
+ *  the statistics are the same whatever the number of threads.
+ */
+class HPWHEnsemble {
+ public:
+  typedef std::function<int(HPWH &hpwh)> InitFunc;
+  /**< initializes a HPWH to the model being simulated, returns 0 or HPWH::HPWH_ABORT.
+      It is called once per worker, and every realization starts from a copy of the result  */
+  typedef std::function<int(long realization, std::vector<double> &drawVolume_L)> DrawGenerator;
+  /**< fills drawVolume_L, already sized to the number of steps, with the draws of a
+      realization, returns 0 or HPWH::HPWH_ABORT.  It is called from the workers, so it must
+      give the same draws for the same realization whichever thread asks  */
+
+  /** streaming statistics of a stream of values */
+  class Statistic {
+   public:
+    static const int EXACT_VALUES = 64;
+    /**< the values kept to give exact quantiles, the P^2 markers start from them  */
+
+    Statistic(const std::vector<double> &quantileProbabilities = std::vector<double>());
+    void add(double x);
+
+    long getCount() const { return count; }
+    double getMean() const { return mean; }
+    double getVariance() const;
+    /**< the sample variance, 0 for fewer than two values  */
+    double getMin() const { return min; }
+    double getMax() const { return max; }
+    double getQuantile(int i) const;
+    /**< the ith quantile of setQuantiles, exact up to EXACT_VALUES values and estimated after  */
+
+   private:
+    /** the P^2 estimator of one quantile, Jain and Chlamtac (1985), started from a sorted
+        sample instead of the first five values */
+    struct P2Quantile {
+      double p;
+      double heights[5];
+      double positions[5];
+      double desired[5];
+      double increments[5];
+      void start(const std::vector<double> &sorted);
+      void add(double x);
+    };
+
+    long count;
+    double mean;
+    double m2;
+    double min;
+    double max;
+    std::vector<double> firstValues;
+    std::vector<double> probabilities;
+    std::vector<P2Quantile> quantiles;
+  };
+
+  HPWHEnsemble(InitFunc init);
+
+  int setNumThreads(int threads);
+  /**< the number of workers, default is the hardware concurrency  */
+  int setQuantiles(const std::vector<double> &probabilities);
+  /**< the quantiles to estimate, each strictly between 0 and 1, default 0.05, 0.5 and 0.95  */
+  int setComfortTemp(double comfortTemp, HPWH::UNITS units = HPWH::UNITS_C);
+  /**< the lowest outlet temperature counted as comfortable, default 105 F  */
+  int setPeakWindow(int minutes);
+  /**< peak demand is the largest mean power over this many minutes, default 60  */
+
+  int run(long realizations, long steps, const HPWH::StepInputs &inputs, DrawGenerator draws);
+  /**< runs each realization for steps one minute steps of HPWH::runNSteps.  The arrays of
+      inputs apply to every realization, inputs.drawVolume_L is ignored
+      returns 0 for success, HPWH::HPWH_ABORT if a realization failed  */
+
+  long getRealizations() const { return energyInput_kWh.getCount(); }
+  const Statistic &getEnergyInput() const { return energyInput_kWh; }
+  /**< the energy input of the heat sources over the run, kWh  */
+  const Statistic &getMinutesBelowComfort() const { return minutesBelowComfort; }
+  /**< the minutes with a draw and an outlet temperature below the comfort temperature  */
+  const Statistic &getPeakDemand() const { return peakDemand_kW; }
+  /**< the peak demand, kW  */
+
+  static DrawGenerator resampledDays(const std::vector<double> &baseDraws_L, unsigned long seed,
+                                     int maxShift_min = 30, double volumeSpread = 0.2);
+  /**< draws built day by day from the days of baseDraws_L, chosen at random.  Each draw is
+      moved by up to maxShift_min minutes within its day and each day's volumes are scaled by
+      a factor from 1 - volumeSpread to 1 + volumeSpread.  The realization and seed fix the
+      random numbers  */
+
+ private:
+  struct RunMetrics {
+    double energyInput_kWh;
+    double minutesBelowComfort;
+    double peakDemand_kW;
+  };
+
+  int runRealization(HPWH &hpwh, long steps, const HPWH::StepInputs &inputs,
+                     std::vector<double> &drawVolume_L, RunMetrics &metrics) const;
+
+  InitFunc initFunc;
+  int numThreads;
+  std::vector<double> quantileProbabilities;
+  double comfortTemp_C;
+  int peakWindow_min;
+
+  Statistic energyInput_kWh;
+  Statistic minutesBelowComfort;
+  Statistic peakDemand_kW;
+};
+
+#endif
@@ -0,0 +1,87 @@
+/*
+ * Flyweight HPWH: one shared model configuration, many small tank states
+ */
+
+#include "HPWHModel.hh"
+
+HPWHModel::HPWHModel() : initialized(false) {}
+
+int HPWHModel::init(InitFunc init) {
+	if (init(prototype) != 0) {
+		return HPWH::HPWH_ABORT;
+	}
+	initialized = true;
+	return prototype.getSimState(initialState);
+}
+
+int HPWHModel::initWorkspace(HPWH &workspace) const {
+	if (!initialized) {
+		return HPWH::HPWH_ABORT;
+	}
+	workspace = prototype;
+	return 0;
+}
+
+
+HPWHState::HPWHState(std::shared_ptr<const HPWHModel> sharedModel) : model(sharedModel), state(sharedModel->getInitialState()),
+	outletTemp_C(0.), standbyLosses_kWh(0.)
+{
+	energyInput_kWh.assign(state.heatSourcesOn.size(), 0.);
+	energyOutput_kWh.assign(state.heatSourcesOn.size(), 0.);
+}
+
+int HPWHState::runOneStep(HPWH &workspace, double inletT_C, double drawVolume_L, double tankAmbientT_C,
+	double heatSourceAmbientT_C, HPWH::DRMODES DRstatus) {
+	if (workspace.setSimState(state) != 0) {
+		return HPWH::HPWH_ABORT;
+	}
+	if (workspace.runOneStep(inletT_C, drawVolume_L, tankAmbientT_C, heatSourceAmbientT_C, DRstatus) != 0) {
+		// a failed step leaves simHasFailed set, which setSimState does not clear, so start the
+		// workspace over for the states stepped in it next
+		model->initWorkspace(workspace);
+		return HPWH::HPWH_ABORT;
+	}
+	workspace.getSimState(state);
+	for (size_t i = 0; i < energyInput_kWh.size(); i++) {
+		energyInput_kWh[i] = workspace.getNthHeatSourceEnergyInput((int)i);
+		energyOutput_kWh[i] = workspace.getNthHeatSourceEnergyOutput((int)i);
+	}
+	outletTemp_C = workspace.getOutletTemp();
+	standbyLosses_kWh = workspace.getStandbyLosses();
+	return 0;
+}
+
+int HPWHState::setSetpoint(double newSetpoint_C) {
+	double maxAllowedSetpoint_C;
+	if (!model->getPrototype().isNewSetpointPossible(newSetpoint_C, maxAllowedSetpoint_C)) {
+		return HPWH::HPWH_ABORT;
+	}
+	state.setpoint_C = newSetpoint_C;
+	return 0;
+}
+
+int HPWHState::setSimState(const HPWH::SimState &newState) {
+	if (newState.tankTemps_C.size() != state.tankTemps_C.size() ||
+		newState.heatSourcesOn.size() != state.heatSourcesOn.size() ||
+		newState.heatSourcesLockedOut.size() != state.heatSourcesLockedOut.size()) {
+		return HPWH::HPWH_ABORT;
+	}
+	state = newState;
+	return 0;
+}
+
+double HPWHState::getNthHeatSourceEnergyInput(int N) const {
+	return (N >= 0 && N < (int)energyInput_kWh.size()) ? energyInput_kWh[N] : 0.;
+}
+
+double HPWHState::getNthHeatSourceEnergyOutput(int N) const {
+	return (N >= 0 && N < (int)energyOutput_kWh.size()) ? energyOutput_kWh[N] : 0.;
+}
+
+double HPWHState::getEnergyInput() const {
+	double sum = 0.;
+	for (double e : energyInput_kWh) {
+		sum += e;
+	}
+	return sum;
+}
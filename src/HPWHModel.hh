@@ -0,0 +1,87 @@
+#ifndef HPWHMODEL_hh
+#define HPWHMODEL_hh
+
+#include "HPWH.hh"
+
+#include <functional>
+#include <memory>
+
+/** The flyweight form of a HPWH, for fleets of many tanks of the same model.
+ *
+ *  A HPWH carries its whole configuration: performance maps, defrost maps, heating logic
+ *  with its descriptions and comparators, condensities and geometry.  In a fleet that
+ *  configuration is the same for every tank of a preset.  A HPWHModel holds it once, as an
+ *  initialized HPWH that is never stepped, and is shared read only, through a
+ *  std::shared_ptr<const HPWHModel>, by any number of HPWHStates.  A HPWHState holds only
+ *  what changes as a tank runs, a HPWH::SimState and the outputs of the last step.
+ *
+ *  A state is stepped in a workspace, a HPWH initialized to the model with initWorkspace:
+ *  the state is loaded into the workspace, the workspace runs one step, and the new state
+ *  is stored back.  One workspace per thread is enough for any number of states, and the
+ *  results are identical to stepping a separate HPWH per tank.
+ */
+class HPWHModel {
+ public:
+  typedef std::function<int(HPWH &hpwh)> InitFunc;
+  /**< initializes a HPWH to the model, returns 0 or HPWH::HPWH_ABORT.  It should set
+      everything that is not part of HPWH::SimState (the preset, tank size, inlet heights, ...)  */
+
+  HPWHModel();
+  HPWHModel(const HPWHModel &) = delete;
+  HPWHModel &operator=(const HPWHModel &) = delete;
+  /**< a model is shared, not copied  */
+
+  int init(InitFunc init);
+  /**< initializes the model, returns 0 or HPWH::HPWH_ABORT  */
+  int initWorkspace(HPWH &workspace) const;
+  /**< copies the model into a HPWH, for stepping HPWHStates, returns 0 or HPWH::HPWH_ABORT  */
+
+  const HPWH &getPrototype() const { return prototype; }
+  /**< the configured, never stepped, HPWH, for queries of the model  */
+  const HPWH::SimState &getInitialState() const { return initialState; }
+  /**< the state of a freshly initialized tank  */
+
+ private:
+  bool initialized;
+  HPWH prototype;
+  HPWH::SimState initialState;
+};
+
+
+class HPWHState {
+ public:
+  HPWHState(std::shared_ptr<const HPWHModel> model);
+  /**< a tank of model, starting from the model's initial state  */
+
+  int runOneStep(HPWH &workspace, double inletT_C, double drawVolume_L, double tankAmbientT_C,
+                 double heatSourceAmbientT_C, HPWH::DRMODES DRstatus);
+  /**< advances the tank one step in workspace, which must have been set up with the model's
+      initWorkspace.  Returns 0, or HPWH::HPWH_ABORT and leaves the state unchanged.  A step
+      that fails sets the workspace up again with initWorkspace, ready for the next state  */
+
+  int setSetpoint(double newSetpoint_C);
+  /**< returns HPWH::HPWH_ABORT if the model can not reach the setpoint  */
+  double getSetpoint() const { return state.setpoint_C; }
+  int setSimState(const HPWH::SimState &newState);
+  /**< returns HPWH::HPWH_ABORT if the number of nodes or heat sources does not match the model  */
+  const HPWH::SimState &getSimState() const { return state; }
+  const HPWHModel &getModel() const { return *model; }
+
+  double getNthHeatSourceEnergyInput(int N) const;
+  double getNthHeatSourceEnergyOutput(int N) const;
+  /**< the energy in kWh of the last step, 0 for N out of bounds  */
+  double getEnergyInput() const;
+  /**< the total input energy of the last step in kWh  */
+  double getOutletTemp() const { return outletTemp_C; }
+  double getStandbyLosses() const { return standbyLosses_kWh; }
+
+ private:
+  std::shared_ptr<const HPWHModel> model;
+  HPWH::SimState state;
+  std::vector<double> energyInput_kWh;
+  std::vector<double> energyOutput_kWh;
+  double outletTemp_C;
+  double standbyLosses_kWh;
+};
+
+#endif
@@ -0,0 +1,291 @@
+/*
+ * Parareal parallel-in-time driver for a single HPWH
+ */
+
+#include "HPWHParareal.hh"
+
+#include <algorithm>
+#include <thread>
+
+HPWHParareal::HPWHParareal(InitFunc init) : initFunc(init), numSlices(16), maxIterations(0),
+	tolerance_dC(0.), coarseMinutes(15), haveInitialState(false)
+{
+	numThreads = std::max(1, (int)std::thread::hardware_concurrency());
+}
+
+int HPWHParareal::setNumSlices(int slices) {
+	if (slices < 1) {
+		return HPWH::HPWH_ABORT;
+	}
+	numSlices = slices;
+	return 0;
+}
+
+int HPWHParareal::setNumThreads(int threads) {
+	if (threads < 1) {
+		return HPWH::HPWH_ABORT;
+	}
+	numThreads = threads;
+	return 0;
+}
+
+int HPWHParareal::setMaxIterations(int iterations) {
+	if (iterations < 0) {
+		return HPWH::HPWH_ABORT;
+	}
+	maxIterations = iterations;
+	return 0;
+}
+
+int HPWHParareal::setTolerance(double tol_dC) {
+	if (tol_dC < 0.) {
+		return HPWH::HPWH_ABORT;
+	}
+	tolerance_dC = tol_dC;
+	return 0;
+}
+
+int HPWHParareal::setCoarseMinutesPerStep(int minutes) {
+	if (minutes < 1) {
+		return HPWH::HPWH_ABORT;
+	}
+	coarseMinutes = minutes;
+	return 0;
+}
+
+int HPWHParareal::setInitialState(const HPWH::SimState &state) {
+	initialState = state;
+	haveInitialState = true;
+	return 0;
+}
+
+int HPWHParareal::runFine(HPWH &hpwh, const Inputs &in, int begin, int end,
+	const HPWH::SimState &start, HPWH::SimState &finish, SliceOutputs &out) const {
+
+	int nHS = hpwh.getNumHeatSources();
+	out.energyInput_kWh.assign(nHS, 0.);
+	out.energyOutput_kWh.assign(nHS, 0.);
+	out.runTime_min.assign(nHS, 0.);
+	out.energyRemovedFromEnvironment_kWh = 0.;
+	out.standbyLosses_kWh = 0.;
+	out.drawVolume_L = 0.;
+	out.outletTempVolume_CL = 0.;
+
+	if (hpwh.setSimState(start) != 0) {
+		return HPWH::HPWH_ABORT;
+	}
+	hpwh.setMinutesPerStep(1.);
+
+	for (int i = begin; i < end; i++) {
+		if (hpwh.runOneStep(in.inletT_C[i], in.drawVolume_L[i], in.tankAmbientT_C[i],
+			in.heatSourceAmbientT_C[i], in.DRstatus[i]) != 0) {
+			return HPWH::HPWH_ABORT;
+		}
+		for (int j = 0; j < nHS; j++) {
+			out.energyInput_kWh[j] += hpwh.getNthHeatSourceEnergyInput(j);
+			out.energyOutput_kWh[j] += hpwh.getNthHeatSourceEnergyOutput(j);
+			out.runTime_min[j] += hpwh.getNthHeatSourceRunTime(j);
+		}
+		out.energyRemovedFromEnvironment_kWh += hpwh.getEnergyRemovedFromEnvironment();
+		out.standbyLosses_kWh += hpwh.getStandbyLosses();
+		out.drawVolume_L += in.drawVolume_L[i];
+		out.outletTempVolume_CL += hpwh.getOutletTemp() * in.drawVolume_L[i];
+	}
+	return hpwh.getSimState(finish);
+}
+
+int HPWHParareal::runCoarse(HPWH &hpwh, int coarseStep, const Inputs &in, int begin, int end,
+	const HPWH::SimState &start, HPWH::SimState &finish) const {
+
+	if (hpwh.setSimState(start) != 0) {
+		return HPWH::HPWH_ABORT;
+	}
+
+	for (int i = begin; i < end; i += coarseStep) {
+		int steps = std::min(coarseStep, end - i);
+		double draw_L = 0., inletTV = 0., inletTSum = 0., tankAmbientT_C = 0., heatSourceAmbientT_C = 0.;
+		for (int j = i; j < i + steps; j++) {
+			draw_L += in.drawVolume_L[j];
+			inletTV += in.inletT_C[j] * in.drawVolume_L[j];
+			inletTSum += in.inletT_C[j];
+			tankAmbientT_C += in.tankAmbientT_C[j];
+			heatSourceAmbientT_C += in.heatSourceAmbientT_C[j];
+		}
+		double inletT_C = (draw_L > 0.) ? inletTV / draw_L : inletTSum / steps;
+
+		hpwh.setMinutesPerStep(steps);
+		if (hpwh.runOneStep(inletT_C, draw_L, tankAmbientT_C / steps, heatSourceAmbientT_C / steps,
+			in.DRstatus[i]) != 0) {
+			return HPWH::HPWH_ABORT;
+		}
+	}
+	return hpwh.getSimState(finish);
+}
+
+void HPWHParareal::correct(const HPWH::SimState &fine, const HPWH::SimState &coarseNew,
+	const HPWH::SimState &coarseOld, HPWH::SimState &corrected) {
+	corrected = fine;
+	// the difference is taken first so an unchanged coarse prediction leaves the fine state exactly as is
+	for (size_t i = 0; i < fine.tankTemps_C.size(); i++) {
+		corrected.tankTemps_C[i] += (coarseNew.tankTemps_C[i] - coarseOld.tankTemps_C[i]);
+	}
+	corrected.locationTemperature_C += (coarseNew.locationTemperature_C - coarseOld.locationTemperature_C);
+}
+
+bool HPWHParareal::sameState(const HPWH::SimState &a, const HPWH::SimState &b) {
+	bool discreteChange;
+	return stateChange(a, b, discreteChange) == 0. && !discreteChange;
+}
+
+double HPWHParareal::stateChange(const HPWH::SimState &a, const HPWH::SimState &b, bool &discreteChange) {
+	double change = 0.;
+	for (size_t i = 0; i < a.tankTemps_C.size(); i++) {
+		change += fabs(a.tankTemps_C[i] - b.tankTemps_C[i]);
+	}
+	change /= a.tankTemps_C.size();
+	change = std::max(change, fabs(a.locationTemperature_C - b.locationTemperature_C));
+
+	discreteChange = a.heatSourcesOn != b.heatSourcesOn || a.heatSourcesLockedOut != b.heatSourcesLockedOut ||
+		a.isHeating != b.isHeating || a.setpoint_C != b.setpoint_C || a.prevDRstatus != b.prevDRstatus ||
+		a.timerTOT != b.timerTOT;
+	return change;
+}
+
+int HPWHParareal::run(int N, const double *inletT_C, const double *drawVolume_L,
+	const double *tankAmbientT_C, const double *heatSourceAmbientT_C,
+	const HPWH::DRMODES *DRstatus, Results &results) {
+
+	if (N < 1) {
+		return HPWH::HPWH_ABORT;
+	}
+	Inputs in = { inletT_C, drawVolume_L, tankAmbientT_C, heatSourceAmbientT_C, DRstatus };
+
+	int P = std::min(numSlices, N);
+	int nThreads = std::min(numThreads, P);
+	std::vector<int> sliceStart(P + 1);
+	for (int n = 0; n <= P; n++) {
+		sliceStart[n] = (int)((long long)N * n / P);
+	}
+
+	// one fine model per thread, and a coarse model for the sequential sweeps
+	std::vector<HPWH> fineModels(nThreads);
+	for (int t = 0; t < nThreads; t++) {
+		if (initFunc(fineModels[t]) != 0) {
+			return HPWH::HPWH_ABORT;
+		}
+	}
+	HPWH coarseModel;
+	if (initFunc(coarseModel) != 0 || coarseModel.setDoTempDepression(false) != 0) {
+		return HPWH::HPWH_ABORT;
+	}
+	// keep the coarse steps short enough for the conduction calculation to be stable
+	int coarseStep = std::max(1, std::min(coarseMinutes, (int)coarseModel.getMaxStableMinutesPerStep()));
+
+	std::vector<HPWH::SimState> U(P + 1);
+	if (haveInitialState) {
+		U[0] = initialState;
+	}
+	else {
+		fineModels[0].getSimState(U[0]);
+	}
+
+	// initial prediction, a coarse sweep through the whole run
+	std::vector<HPWH::SimState> G(P), coarseFrom(P);
+	for (int n = 0; n < P; n++) {
+		if (runCoarse(coarseModel, coarseStep, in, sliceStart[n], sliceStart[n + 1], U[n], G[n]) != 0) {
+			return HPWH::HPWH_ABORT;
+		}
+		coarseFrom[n] = U[n];
+		U[n + 1] = G[n];
+	}
+
+	std::vector<HPWH::SimState> F(P), refinedFrom(P);
+	std::vector<SliceOutputs> outputs(P);
+	std::vector<bool> refined(P, false);
+	std::vector<int> toRefine, sliceResult(P);
+
+	results.converged = false;
+	int k;
+	for (k = 1; maxIterations == 0 || k <= maxIterations; k++) {
+		// refine, concurrently, the slices whose start state changed
+		toRefine.clear();
+		for (int n = 0; n < P; n++) {
+			if (!refined[n] || !sameState(U[n], refinedFrom[n])) {
+				toRefine.push_back(n);
+				refinedFrom[n] = U[n];
+				refined[n] = true;
+			}
+		}
+		std::vector<std::thread> threads;
+		for (int t = 0; t < nThreads; t++) {
+			threads.push_back(std::thread([&, t]() {
+				for (size_t i = t; i < toRefine.size(); i += nThreads) {
+					int n = toRefine[i];
+					sliceResult[n] = runFine(fineModels[t], in, sliceStart[n], sliceStart[n + 1], U[n], F[n], outputs[n]);
+				}
+			}));
+		}
+		for (auto &thread : threads) {
+			thread.join();
+		}
+		for (int n : toRefine) {
+			if (sliceResult[n] != 0) {
+				return HPWH::HPWH_ABORT;
+			}
+		}
+
+		// correct the start states in order
+		double change = 0.;
+		bool discreteChange = false;
+		HPWH::SimState newStart = U[0];
+		for (int n = 0; n < P; n++) {
+			HPWH::SimState coarseNew;
+			if (sameState(newStart, coarseFrom[n])) {
+				coarseNew = G[n];
+			}
+			else if (runCoarse(coarseModel, coarseStep, in, sliceStart[n], sliceStart[n + 1], newStart, coarseNew) != 0) {
+				return HPWH::HPWH_ABORT;
+			}
+			coarseFrom[n] = newStart;
+
+			correct(F[n], coarseNew, G[n], newStart);
+			G[n] = coarseNew;
+
+			bool sliceDiscreteChange;
+			change = std::max(change, stateChange(newStart, U[n + 1], sliceDiscreteChange));
+			discreteChange = discreteChange || sliceDiscreteChange;
+			U[n + 1] = newStart;
+		}
+
+		if (change <= tolerance_dC && !discreteChange) {
+			results.converged = true;
+			break;
+		}
+	}
+	results.iterations = (maxIterations > 0 && k > maxIterations) ? maxIterations : k;
+
+	// sum up the refined slices, in order
+	int nHS = fineModels[0].getNumHeatSources();
+	results.energyInput_kWh.assign(nHS, 0.);
+	results.energyOutput_kWh.assign(nHS, 0.);
+	results.runTime_min.assign(nHS, 0.);
+	results.energyRemovedFromEnvironment_kWh = 0.;
+	results.standbyLosses_kWh = 0.;
+	results.drawVolume_L = 0.;
+	double outletTempVolume_CL = 0.;
+	for (int n = 0; n < P; n++) {
+		for (int j = 0; j < nHS; j++) {
+			results.energyInput_kWh[j] += outputs[n].energyInput_kWh[j];
+			results.energyOutput_kWh[j] += outputs[n].energyOutput_kWh[j];
+			results.runTime_min[j] += outputs[n].runTime_min[j];
+		}
+		results.energyRemovedFromEnvironment_kWh += outputs[n].energyRemovedFromEnvironment_kWh;
+		results.standbyLosses_kWh += outputs[n].standbyLosses_kWh;
+		results.drawVolume_L += outputs[n].drawVolume_L;
+		outletTempVolume_CL += outputs[n].outletTempVolume_CL;
+	}
+	results.outletTemp_C = (results.drawVolume_L > 0.) ? outletTempVolume_CL / results.drawVolume_L : 0.;
+	results.finalState = F[P - 1];
+
+	return 0;
+}
@@ -0,0 +1,110 @@
+#ifndef HPWHPARAREAL_hh
+#define HPWHPARAREAL_hh
+
+#include "HPWH.hh"
+
+/** Runs a long simulation of one HPWH with the Parareal parallel-in-time method.
+ *
+ *  The run is split into time slices.  A cheap coarse propagator (long steps, no
+ *  temperature depression) predicts the state at the start of each
+ *  slice, the slices are refined concurrently with the full one minute runOneStep model,
+ *  and the predictions are corrected until the slice start states stop changing.
+ *
+ *  Every slice is refined from the same start state, and the corrections are applied in
+ *  slice order, regardless of the number of threads, so the result is deterministic.
+ *  With a tolerance of zero the iteration only stops once every slice start state
+ *  matches the sequential run exactly, so the final state is identical to running
+ *  runOneStep minute by minute.
+ */
+class HPWHParareal {
+ public:
+  typedef std::function<int(HPWH &hpwh)> InitFunc;
+  /**< initializes a HPWH to the model being simulated, returns 0 or HPWH::HPWH_ABORT.
+      It is called once per worker, so it should set everything that is not part of
+      HPWH::SimState (the model, tank size, inlet heights, ...)  */
+
+  struct Results {
+    std::vector<double> energyInput_kWh;   /**< energy input of each heat source */
+    std::vector<double> energyOutput_kWh;  /**< energy output of each heat source */
+    std::vector<double> runTime_min;       /**< run time of each heat source */
+    double energyRemovedFromEnvironment_kWh;
+    double standbyLosses_kWh;
+    double drawVolume_L;                   /**< the total volume drawn */
+    double outletTemp_C;                   /**< draw weighted outlet temperature, 0 with no draws */
+    int iterations;                        /**< the number of Parareal iterations taken */
+    bool converged;                        /**< false if maxIterations stopped the iteration */
+    HPWH::SimState finalState;             /**< the state at the end of the run */
+  };
+
+  HPWHParareal(InitFunc init);
+
+  int setNumSlices(int slices);
+  /**< the number of time slices, default is 16  */
+  int setNumThreads(int threads);
+  /**< the number of threads refining slices, default is the hardware concurrency  */
+  int setMaxIterations(int iterations);
+  /**< stops the iteration early, 0 (the default) iterates until convergence, which
+      always takes at most numSlices + 1 iterations  */
+  int setTolerance(double tol_dC);
+  /**< the largest change between iterations, in any slice start state, of the node
+      temperatures averaged over the tank that counts as converged.  The default is 0,
+      which only converges when every start state is exactly the sequential one  */
+  int setCoarseMinutesPerStep(int minutes);
+  /**< the step length of the coarse propagator, default is 15 minutes.  It is shortened
+      if needed to keep the conduction calculation stable  */
+
+  int setInitialState(const HPWH::SimState &state);
+  /**< starts the run from state instead of a freshly initialized tank */
+
+  int run(int N, const double *inletT_C, const double *drawVolume_L,
+          const double *tankAmbientT_C, const double *heatSourceAmbientT_C,
+          const HPWH::DRMODES *DRstatus, Results &results);
+  /**< runs N one minute steps with the same inputs as HPWH::runNSteps
+      returns 0 for success, HPWH::HPWH_ABORT otherwise  */
+
+ private:
+  struct Inputs {
+    const double *inletT_C;
+    const double *drawVolume_L;
+    const double *tankAmbientT_C;
+    const double *heatSourceAmbientT_C;
+    const HPWH::DRMODES *DRstatus;
+  };
+
+  struct SliceOutputs {
+    std::vector<double> energyInput_kWh;
+    std::vector<double> energyOutput_kWh;
+    std::vector<double> runTime_min;
+    double energyRemovedFromEnvironment_kWh;
+    double standbyLosses_kWh;
+    double drawVolume_L;
+    double outletTempVolume_CL;
+  };
+
+  int runFine(HPWH &hpwh, const Inputs &in, int begin, int end,
+              const HPWH::SimState &start, HPWH::SimState &finish, SliceOutputs &out) const;
+  /**< the fine propagator, runOneStep every minute of the slice */
+  int runCoarse(HPWH &hpwh, int coarseStep, const Inputs &in, int begin, int end,
+                const HPWH::SimState &start, HPWH::SimState &finish) const;
+  /**< the coarse propagator, coarseStep minute long steps with averaged inputs */
+
+  static void correct(const HPWH::SimState &fine, const HPWH::SimState &coarseNew,
+                      const HPWH::SimState &coarseOld, HPWH::SimState &corrected);
+  /**< the Parareal update fine + (coarseNew - coarseOld), continuous values only.
+      On/off states and timers cannot be corrected, so they are taken from fine */
+  static bool sameState(const HPWH::SimState &a, const HPWH::SimState &b);
+  static double stateChange(const HPWH::SimState &a, const HPWH::SimState &b, bool &discreteChange);
+  /**< the mean absolute node temperature difference, discreteChange is set if the
+      on/off states or timers differ */
+
+  InitFunc initFunc;
+  int numSlices;
+  int numThreads;
+  int maxIterations;
+  double tolerance_dC;
+  int coarseMinutes;
+  bool haveInitialState;
+  HPWH::SimState initialState;
+};
+
+#endif
@@ -0,0 +1,169 @@
+/*
+ * Central plants of HPWH tanks in series and parallel with recirculation
+ */
+
+#include "HPWHPlant.hh"
+
+#include <cmath>
+
+namespace {
+template <typename T>
+T *offsetArray(T *array, long offset) {
+	return (array == NULL) ? NULL : array + offset;
+}
+}
+
+HPWHPlant::HPWHPlant() : recircFlow_Lpermin(0.), loopLoss_W(0.), returnStage(-1)
+{
+}
+
+int HPWHPlant::addStage(const HPWH &tank, int count /*=1*/) {
+	if (count < 1) {
+		return HPWH::HPWH_ABORT;
+	}
+	return addStage(std::vector<HPWH>(count, tank), std::vector<double>(count, 1. / count));
+}
+
+int HPWHPlant::addStage(const std::vector<HPWH> &tanks, const std::vector<double> &flowFractions) {
+	if (tanks.empty() || tanks.size() != flowFractions.size()) {
+		return HPWH::HPWH_ABORT;
+	}
+	double total = 0.;
+	for (double fraction : flowFractions) {
+		if (!(fraction > 0.)) {
+			return HPWH::HPWH_ABORT;
+		}
+		total += fraction;
+	}
+	if (std::fabs(total - 1.) > 1.e-9) {
+		return HPWH::HPWH_ABORT;
+	}
+	Stage stage;
+	stage.tanks = tanks;
+	stage.flowFractions = flowFractions;
+	stages.push_back(stage);
+	return 0;
+}
+
+int HPWHPlant::setRecirculation(double flow_Lpermin, double loss_W, int stage /*=-1*/) {
+	if (flow_Lpermin < 0. || loss_W < 0. || stage < -1) {
+		return HPWH::HPWH_ABORT;
+	}
+	recircFlow_Lpermin = flow_Lpermin;
+	loopLoss_W = loss_W;
+	returnStage = stage;
+	return 0;
+}
+
+int HPWHPlant::getNumTanks(int stage) const {
+	return (stage < 0 || stage >= (int)stages.size()) ? 0 : (int)stages[stage].tanks.size();
+}
+
+HPWH *HPWHPlant::getTank(int stage, int tank) {
+	if (tank < 0 || tank >= getNumTanks(stage)) {
+		return NULL;
+	}
+	return &stages[stage].tanks[tank];
+}
+
+int HPWHPlant::runNSteps(long N, const Inputs &inputs, OutputArrays *outputs /*=NULL*/) {
+	const int numStages = (int)stages.size();
+	const int recircStage = (returnStage < 0) ? numStages - 1 : returnStage;
+	if (N < 0 || numStages == 0 || recircStage >= numStages || inputs.inletT_C == NULL || inputs.drawVolume_L == NULL ||
+		inputs.tankAmbientT_C == NULL || inputs.heatSourceAmbientT_C == NULL) {
+		return HPWH::HPWH_ABORT;
+	}
+	// the temperature the loop loses, for one minute of recirculation flow
+	const double loopDrop_C = (recircFlow_Lpermin > 0.) ?
+		loopLoss_W * 60. / 1000. / (recircFlow_Lpermin * HPWH::DENSITYWATER_kgperL * HPWH::CPWATER_kJperkgC) : 0.;
+	const Stage &last = stages.back();
+
+	for (long i = 0; i < N; i++) {
+		HPWH::DRMODES DRstatus = (inputs.DRstatus == NULL) ? HPWH::DR_ALLOW : inputs.DRstatus[i];
+		double returnT_C = 0.;
+		if (recircFlow_Lpermin > 0.) {
+			double supplyT_C = 0.;
+			for (size_t k = 0; k < last.tanks.size(); k++) {
+				supplyT_C += last.tanks[k].getTankNodeTemp(last.tanks[k].getNumNodes() - 1) * last.flowFractions[k];
+			}
+			returnT_C = supplyT_C - loopDrop_C;
+		}
+
+		// stage by stage, each sending its mixed outlet on to the next
+		double flowT_C = inputs.inletT_C[i];
+		double energyInput_kWh = 0.;
+		for (int s = 0; s < numStages; s++) {
+			Stage &stage = stages[s];
+			double flow_L = inputs.drawVolume_L[i] + ((s >= recircStage) ? recircFlow_Lpermin : 0.);
+			double return_L = (s == recircStage) ? recircFlow_Lpermin : 0.;
+			double mixedT_C = 0.;
+			double stageEnergyInput_kWh = 0.;
+			for (size_t k = 0; k < stage.tanks.size(); k++) {
+				HPWH &tank = stage.tanks[k];
+				double fraction = stage.flowFractions[k];
+				if (tank.runOneStep(flowT_C, flow_L * fraction, inputs.tankAmbientT_C[i], inputs.heatSourceAmbientT_C[i],
+						DRstatus, return_L * fraction, returnT_C) != 0) {
+					return HPWH::HPWH_ABORT;
+				}
+				mixedT_C += tank.getOutletTemp() * fraction;
+				for (int j = 0; j < tank.getNumHeatSources(); j++) {
+					stageEnergyInput_kWh += tank.getNthHeatSourceEnergyInput(j);
+				}
+			}
+			flowT_C = (flow_L > 0.) ? mixedT_C : 0.;
+			energyInput_kWh += stageEnergyInput_kWh;
+			if (outputs != NULL && outputs->stageEnergyInput_kWh != NULL) {
+				outputs->stageEnergyInput_kWh[i * numStages + s] = stageEnergyInput_kWh;
+			}
+		}
+
+		if (outputs != NULL) {
+			if (outputs->supplyT_C != NULL) outputs->supplyT_C[i] = flowT_C;
+			if (outputs->returnT_C != NULL) outputs->returnT_C[i] = returnT_C;
+			if (outputs->energyInput_kWh != NULL) outputs->energyInput_kWh[i] = energyInput_kWh;
+		}
+	}
+	return 0;
+}
+
+HPWHBatch::Job HPWHPlant::batchJob(long steps, const Inputs &inputs, const OutputArrays *outputs /*=NULL*/) {
+	HPWHBatch::Job job;
+	job.steps = steps;
+	if (stages.empty()) {
+		return job;
+	}
+	// the batch deals jobs by the nodes they step
+	long nodes = 0;
+	for (const Stage &stage : stages) {
+		for (const HPWH &tank : stage.tanks) {
+			nodes += tank.getNumNodes();
+		}
+	}
+	job.hpwh = &stages[0].tanks[0];
+	job.cost = (double)steps * nodes;
+
+	bool haveOutputs = outputs != NULL;
+	OutputArrays allOutputs;
+	if (haveOutputs) {
+		allOutputs = *outputs;
+	}
+	HPWHPlant *plant = this;
+	job.runChunk = [plant, inputs, allOutputs, haveOutputs](HPWH &, long begin, long end) {
+		Inputs in;
+		in.inletT_C = offsetArray(inputs.inletT_C, begin);
+		in.drawVolume_L = offsetArray(inputs.drawVolume_L, begin);
+		in.tankAmbientT_C = offsetArray(inputs.tankAmbientT_C, begin);
+		in.heatSourceAmbientT_C = offsetArray(inputs.heatSourceAmbientT_C, begin);
+		in.DRstatus = offsetArray(inputs.DRstatus, begin);
+		if (!haveOutputs) {
+			return plant->runNSteps(end - begin, in);
+		}
+		OutputArrays out;
+		out.supplyT_C = offsetArray(allOutputs.supplyT_C, begin);
+		out.returnT_C = offsetArray(allOutputs.returnT_C, begin);
+		out.energyInput_kWh = offsetArray(allOutputs.energyInput_kWh, begin);
+		out.stageEnergyInput_kWh = offsetArray(allOutputs.stageEnergyInput_kWh, begin * plant->getNumStages());
+		return plant->runNSteps(end - begin, in, &out);
+	};
+	return job;
+}
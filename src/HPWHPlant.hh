@@ -0,0 +1,87 @@
+#ifndef HPWHPLANT_hh
+#define HPWHPLANT_hh
+
+#include "HPWH.hh"
+#include "HPWHBatch.hh"
+
+#include <vector>
+
+/** A central water heating plant: stages of tanks in series, each stage one tank or several in
+ *  parallel, with a recirculation loop.
+ *
+ *  Each step, cold water enters the first stage and the water drawn at the fixtures leaves the
+ *  last.  A stage splits its flow between its tanks by fixed fractions, and the volume weighted
+ *  mix of their outlets is the inlet temperature of the next stage for the same step.
+ *  Recirculation flow leaves the last stage with the draw, loses the loop's heat, and comes back
+ *  through the second inlet of the tanks of the return stage, so the stages from the return
+ *  stage on carry both flows.  The return temperature is the supply temperature, the top node
+ *  temperature of the last stage's tanks at the start of the step, less the loop losses over the
+ *  recirculation flow.
+ *
+ *  A single pass Colmac or Nyle primary with a temperature maintenance swing tank, one made by
+ *  HPWHinit_resSwingTank, is two stages with the return to the second.
+ *
+ *  The plant owns its tanks and steps them in place, handing each stage only the temperature of
+ *  the water the stage before sent on.  Plants are independent of each other, so batchJob lets
+ *  HPWHBatch run many at once.
+ */
+class HPWHPlant {
+ public:
+  /** the per step inputs of runNSteps, each a caller owned array of N values.  The first four
+      are required  */
+  struct Inputs {
+    double *inletT_C = NULL;              /**< the cold water into the first stage */
+    double *drawVolume_L = NULL;          /**< the hot water drawn at the fixtures */
+    double *tankAmbientT_C = NULL;        /**< the same for every tank */
+    double *heatSourceAmbientT_C = NULL;
+    HPWH::DRMODES *DRstatus = NULL;       /**< NULL runs every step at DR_ALLOW */
+  };
+
+  /** caller owned arrays for the per step results of runNSteps, any may be NULL to skip it  */
+  struct OutputArrays {
+    double *supplyT_C = NULL;             /**< the mixed outlet of the last stage, 0 with no flow */
+    double *returnT_C = NULL;             /**< the recirculation return, 0 without recirculation */
+    double *energyInput_kWh = NULL;       /**< of every heat source of every tank */
+    double *stageEnergyInput_kWh = NULL;  /**< N * getNumStages() values, step by step */
+  };
+
+  HPWHPlant();
+
+  int addStage(const HPWH &tank, int count = 1);
+  /**< adds a stage after the others of count copies of tank in parallel, sharing the flow equally  */
+  int addStage(const std::vector<HPWH> &tanks, const std::vector<double> &flowFractions);
+  /**< adds a stage after the others of tanks in parallel, each taking its fraction of the flow.
+      The fractions must be positive and add up to 1  */
+  int setRecirculation(double flow_Lpermin, double loopLoss_W, int returnStage = -1);
+  /**< the recirculation flow and the heat the loop loses, returning to the second inlet of the
+      tanks of returnStage, -1 for the last stage.  The default is no recirculation  */
+
+  int getNumStages() const { return (int)stages.size(); }
+  int getNumTanks(int stage) const;
+  /**< the tanks of a stage, 0 if there is no such stage  */
+  HPWH *getTank(int stage, int tank);
+  /**< a tank of the plant, to set up or read, NULL if there is no such tank  */
+
+  int runNSteps(long N, const Inputs &inputs, OutputArrays *outputs = NULL);
+  /**< runs the plant for N one minute steps
+      returns 0 for success, HPWH::HPWH_ABORT if an input is missing, the return stage is past
+      the last stage or a tank fails  */
+
+  HPWHBatch::Job batchJob(long steps, const Inputs &inputs, const OutputArrays *outputs = NULL);
+  /**< a job for HPWHBatch running the plant through runNSteps, chunk by chunk over that part of
+      the arrays.  The plant and the arrays must outlive the batch, and the plant must have a
+      stage  */
+
+ private:
+  struct Stage {
+    std::vector<HPWH> tanks;
+    std::vector<double> flowFractions;
+  };
+
+  std::vector<Stage> stages;
+  double recircFlow_Lpermin;
+  double loopLoss_W;
+  int returnStage;
+};
+
+#endif
@@ -0,0 +1,580 @@
+/*
+ * Reduced order surrogate of a HPWH, fitted from the full model
+ */
+
+#include "HPWHSurrogate.hh"
+
+#include <algorithm>
+#include <fstream>
+
+static const HPWH::DRMODES DR_LOCKOUT_ALL = static_cast<HPWH::DRMODES>(HPWH::DR_LOC | HPWH::DR_LOR);
+static const int NUM_OUTLET_BINS = 41;
+static const double DRAW_RATE_FRACTION = 0.02;   // of the tank per minute, in the recovery experiments
+static const int IDLE_MINUTES = 60;              // after a draw with no heating, a recovery is given up
+
+static double tankHeatCapacity_kJperC(double volume_L) {
+	return volume_L * HPWH::DENSITYWATER_kgperL * HPWH::CPWATER_kJperkgC;
+}
+
+static double median(std::vector<double> values) {
+	if (values.empty()) {
+		return 0.;
+	}
+	std::sort(values.begin(), values.end());
+	size_t n = values.size();
+	return (n % 2 == 1) ? values[n / 2] : 0.5 * (values[n / 2 - 1] + values[n / 2]);
+}
+
+void HPWHSurrogate::Model::addOutletSample(Bins &outletBins, double drawnFraction, double outletFraction) {
+	int bin = (int)std::floor(std::max(0., std::min(1., drawnFraction)) * (NUM_OUTLET_BINS - 1) + 0.5);
+	outletBins.sum[bin] += outletFraction;
+	outletBins.count[bin]++;
+}
+
+// the index of the lower of the two points bracketing x, and the weight of the upper one
+static void bracket(const std::vector<double> &axis, double x, int &i, double &w) {
+	if (axis.size() < 2 || x <= axis.front()) {
+		i = 0;
+		w = 0.;
+		return;
+	}
+	if (x >= axis.back()) {
+		i = (int)axis.size() - 2;
+		w = 1.;
+		return;
+	}
+	i = (int)(std::upper_bound(axis.begin(), axis.end(), x) - axis.begin()) - 1;
+	w = (x - axis[i]) / (axis[i + 1] - axis[i]);
+}
+
+HPWHSurrogate::FitOptions::FitOptions() : randomDrawDays(3), tankTStep_dC(2.5), maxRecoveryMinutes(24 * 60) {
+	for (double T_C = -10.; T_C <= 40.; T_C += 2.5) {
+		ambientTs_C.push_back(T_C);
+	}
+	inletTs_C = { 5., 15., 25. };
+	drawFractions = { 0.1, 0.25, 0.5, 0.8 };
+	tanksPerDay = { 0.5, 1., 2. };
+}
+
+int HPWHSurrogate::Model::tableFor(HPWH::DRMODES DRstatus) {
+	bool lockCompressor = (DRstatus & HPWH::DR_LOC) != 0;
+	bool lockResistance = (DRstatus & HPWH::DR_LOR) != 0;
+	if (lockCompressor && lockResistance) {
+		return -1;
+	}
+	if (lockCompressor) {
+		return TABLE_LOC;
+	}
+	if (lockResistance) {
+		return TABLE_LOR;
+	}
+	return TABLE_ALLOW;
+}
+
+int HPWHSurrogate::Model::tableIndex(int table, int source, int quantity) const {
+	return (table * numHeatSources + source) * NUM_QUANTITIES + quantity;
+}
+
+HPWHSurrogate::Model::Cell HPWHSurrogate::Model::locate(double ambientT_C, double inletT_C, double tankT_C) const {
+	Cell cell;
+	int i, k;
+	bracket(ambientTs_C, ambientT_C, i, cell.wAmbient);
+	bracket(inletTs_C, inletT_C, k, cell.wInlet);
+	bracket(tankTs_C, tankT_C, cell.j, cell.wTank);
+	int nI = (int)inletTs_C.size(), nT = (int)tankTs_C.size();
+	int i1 = std::min(i + 1, (int)ambientTs_C.size() - 1), k1 = std::min(k + 1, nI - 1);
+	cell.j1 = std::min(cell.j + 1, nT - 1);
+	cell.row00 = (i * nI + k) * nT;
+	cell.row01 = (i * nI + k1) * nT;
+	cell.row10 = (i1 * nI + k) * nT;
+	cell.row11 = (i1 * nI + k1) * nT;
+	return cell;
+}
+
+double HPWHSurrogate::Model::lookup(const std::vector<double> &values, const Cell &cell) {
+	auto along = [&](int row) {
+		return (1. - cell.wTank) * values[row + cell.j] + cell.wTank * values[row + cell.j1];
+	};
+	return (1. - cell.wAmbient) * ((1. - cell.wInlet) * along(cell.row00) + cell.wInlet * along(cell.row01)) +
+		cell.wAmbient * ((1. - cell.wInlet) * along(cell.row10) + cell.wInlet * along(cell.row11));
+}
+
+double HPWHSurrogate::Model::outletFraction(double drawnFraction) const {
+	double x = std::max(0., std::min(1., drawnFraction)) * (outletFractions.size() - 1);
+	int i = std::min((int)x, (int)outletFractions.size() - 2);
+	double w = x - i;
+	return (1. - w) * outletFractions[i] + w * outletFractions[i + 1];
+}
+
+int HPWHSurrogate::Model::runStep(HPWH &hpwh, double inletT_C, double drawVolume_L, double ambientT_C,
+	HPWH::DRMODES DRstatus, bool &wasHeating, Samples &samples) const {
+
+	int table = tableFor(DRstatus);
+	int ambient = (int)(std::find(ambientTs_C.begin(), ambientTs_C.end(), ambientT_C) - ambientTs_C.begin());
+	int inlet = (int)(std::find(inletTs_C.begin(), inletTs_C.end(), inletT_C) - inletTs_C.begin());
+	int nI = (int)inletTs_C.size(), nT = (int)tankTs_C.size();
+	double capacity_kJperC = tankHeatCapacity_kJperC(volume_L);
+	double setpointT_C = hpwh.getSetpoint();
+	double startT_C = hpwh.getTankHeatContent_kJ() / capacity_kJperC;
+
+	if (hpwh.runOneStep(inletT_C, drawVolume_L, ambientT_C, ambientT_C, DRstatus) != 0) {
+		return HPWH::HPWH_ABORT;
+	}
+
+	bool isHeating = false;
+	for (int s = 0; s < numHeatSources; s++) {
+		isHeating = isHeating || hpwh.isNthHeatSourceRunning(s) == 1;
+	}
+
+	// only whole minutes of heating describe the heating rate, the last partial one is left out
+	if (isHeating && table >= 0) {
+		int j = (int)std::floor((startT_C - tankTs_C.front()) / (tankTs_C[1] - tankTs_C[0]) + 0.5);
+		j = std::max(0, std::min(nT - 1, j));
+		int bin = (ambient * nI + inlet) * nT + j;
+		for (int s = 0; s < numHeatSources; s++) {
+			double values[NUM_QUANTITIES];
+			values[INPUT_KW] = hpwh.getNthHeatSourceEnergyInput(s) * 60.;
+			values[OUTPUT_KW] = hpwh.getNthHeatSourceEnergyOutput(s) * 60.;
+			values[RUN_FRACTION] = hpwh.getNthHeatSourceRunTime(s);
+			for (int q = 0; q < NUM_QUANTITIES; q++) {
+				Bins &b = samples.tables[tableIndex(table, s, q)];
+				b.sum[bin] += values[q];
+				b.count[bin]++;
+			}
+		}
+	}
+
+	if (drawVolume_L > 0. && setpointT_C - inletT_C >= 1.) {
+		addOutletSample(samples.outlet, (setpointT_C - startT_C) / (setpointT_C - inletT_C),
+			(hpwh.getOutletTemp() - inletT_C) / (setpointT_C - inletT_C));
+	}
+	if (table == TABLE_ALLOW) {
+		// the deficit that turned heating on is the one before the heat was added
+		double deficit_kJ = capacity_kJperC * (setpointT_C - startT_C) +
+			drawVolume_L * HPWH::DENSITYWATER_kgperL * HPWH::CPWATER_kJperkgC * (hpwh.getOutletTemp() - inletT_C);
+		if (isHeating && !wasHeating) {
+			samples.turnOns_kJ.push_back(deficit_kJ);
+		}
+		if (!isHeating && wasHeating) {
+			samples.turnOffs_kJ.push_back(capacity_kJperC * setpointT_C - hpwh.getTankHeatContent_kJ());
+		}
+	}
+	wasHeating = isHeating;
+	return 0;
+}
+
+int HPWHSurrogate::Model::runRecovery(HPWH &hpwh, double ambientT_C, double inletT_C, double drawFraction,
+	HPWH::DRMODES DRstatus, int maxMinutes, Samples &samples) const {
+
+	double drawLeft_L = drawFraction * volume_L;
+	bool wasHeating = false, everHeated = false;
+	int idleMinutes = 0;
+	for (int minute = 0; minute < maxMinutes; minute++) {
+		double draw_L = std::min(drawLeft_L, DRAW_RATE_FRACTION * volume_L);
+		drawLeft_L -= draw_L;
+		bool hadBeenHeating = wasHeating;
+		if (runStep(hpwh, inletT_C, draw_L, ambientT_C, DRstatus, wasHeating, samples) != 0) {
+			return HPWH::HPWH_ABORT;
+		}
+		everHeated = everHeated || wasHeating;
+
+		if (drawLeft_L <= 0.) {
+			if (!wasHeating && hadBeenHeating) {
+				break;
+			}
+			idleMinutes = wasHeating ? 0 : idleMinutes + 1;
+			if (!everHeated && idleMinutes >= IDLE_MINUTES) {
+				break;
+			}
+		}
+	}
+	return 0;
+}
+
+int HPWHSurrogate::Model::runRandomDraws(HPWH &hpwh, double ambientT_C, double inletT_C, double tanksPerDay,
+	int days, unsigned seed, Samples &samples) const {
+
+	// draws of 2 to 20% of the tank at DRAW_RATE_FRACTION of the tank a minute, at random times.
+	// The generator is hand rolled so the fit does not depend on the standard library
+	const double meanDraw_L = 0.11 * volume_L;
+	const double startChance = tanksPerDay * volume_L / meanDraw_L / (24. * 60.);
+	unsigned state = seed;
+	auto uniform = [&state]() {
+		state = state * 1664525u + 1013904223u;
+		return (state >> 8) / 16777216.;
+	};
+
+	bool wasHeating = false;
+	double drawLeft_L = 0.;
+	for (int minute = 0; minute < days * 24 * 60; minute++) {
+		if (drawLeft_L <= 0. && uniform() < startChance) {
+			drawLeft_L = (0.02 + 0.18 * uniform()) * volume_L;
+		}
+		double draw_L = std::min(drawLeft_L, DRAW_RATE_FRACTION * volume_L);
+		drawLeft_L -= draw_L;
+		if (runStep(hpwh, inletT_C, draw_L, ambientT_C, HPWH::DR_ALLOW, wasHeating, samples) != 0) {
+			return HPWH::HPWH_ABORT;
+		}
+	}
+	return 0;
+}
+
+int HPWHSurrogate::Model::runDrawDown(HPWH &hpwh, double inletT_C, double drawRate_LperMin, Samples &samples) const {
+	bool wasHeating = false;
+	for (double drawn_L = 0.; drawn_L < 1.2 * volume_L; drawn_L += drawRate_LperMin) {
+		if (runStep(hpwh, inletT_C, drawRate_LperMin, 20., DR_LOCKOUT_ALL, wasHeating, samples) != 0) {
+			return HPWH::HPWH_ABORT;
+		}
+	}
+	return 0;
+}
+
+void HPWHSurrogate::Model::fillTable(const Bins &bins, int nAmbients, int nInlets, int nTankTs,
+	std::vector<double> &values) {
+	int nRows = nAmbients * nInlets;
+	values.assign(nRows * nTankTs, 0.);
+	std::vector<bool> rowFilled(nRows, false);
+	for (int r = 0; r < nRows; r++) {
+		double *row = &values[r * nTankTs];
+		std::vector<int> filled;
+		for (int j = 0; j < nTankTs; j++) {
+			int k = r * nTankTs + j;
+			if (bins.count[k] > 0) {
+				row[j] = bins.sum[k] / bins.count[k];
+				filled.push_back(j);
+			}
+		}
+		if (filled.empty()) {
+			continue;
+		}
+		rowFilled[r] = true;
+		// interpolate between the filled temperatures, and hold the end values beyond them
+		for (int j = 0; j < nTankTs; j++) {
+			if (bins.count[r * nTankTs + j] > 0) {
+				continue;
+			}
+			size_t n = std::upper_bound(filled.begin(), filled.end(), j) - filled.begin();
+			if (n == 0) {
+				row[j] = row[filled.front()];
+			}
+			else if (n == filled.size()) {
+				row[j] = row[filled.back()];
+			}
+			else {
+				int lo = filled[n - 1], hi = filled[n];
+				double w = (double)(j - lo) / (hi - lo);
+				row[j] = (1. - w) * row[lo] + w * row[hi];
+			}
+		}
+	}
+	// rows where nothing ran take the nearest ambient with the same inlet that did, and failing that the nearest inlet
+	std::vector<bool> fromData = rowFilled;
+	auto copyRow = [&](int to, int from) {
+		std::copy(values.begin() + from * nTankTs, values.begin() + (from + 1) * nTankTs, values.begin() + to * nTankTs);
+		rowFilled[to] = true;
+	};
+	for (int i = 0; i < nAmbients; i++) {
+		for (int k = 0; k < nInlets; k++) {
+			for (int d = 1; d < nAmbients && !rowFilled[i * nInlets + k]; d++) {
+				if (i - d >= 0 && fromData[(i - d) * nInlets + k]) {
+					copyRow(i * nInlets + k, (i - d) * nInlets + k);
+				}
+				else if (i + d < nAmbients && fromData[(i + d) * nInlets + k]) {
+					copyRow(i * nInlets + k, (i + d) * nInlets + k);
+				}
+			}
+		}
+	}
+	fromData = rowFilled;
+	for (int i = 0; i < nAmbients; i++) {
+		for (int k = 0; k < nInlets; k++) {
+			for (int d = 1; d < nInlets && !rowFilled[i * nInlets + k]; d++) {
+				if (k - d >= 0 && fromData[i * nInlets + k - d]) {
+					copyRow(i * nInlets + k, i * nInlets + k - d);
+				}
+				else if (k + d < nInlets && fromData[i * nInlets + k + d]) {
+					copyRow(i * nInlets + k, i * nInlets + k + d);
+				}
+			}
+		}
+	}
+}
+
+int HPWHSurrogate::Model::fit(InitFunc init, const FitOptions &options) {
+	if (options.ambientTs_C.empty() || options.inletTs_C.empty() || options.drawFractions.empty() ||
+		options.tankTStep_dC <= 0. || options.maxRecoveryMinutes < 1 ||
+		!std::is_sorted(options.ambientTs_C.begin(), options.ambientTs_C.end()) ||
+		!std::is_sorted(options.inletTs_C.begin(), options.inletTs_C.end())) {
+		return HPWH::HPWH_ABORT;
+	}
+
+	HPWH hpwh;
+	if (init(hpwh) != 0) {
+		return HPWH::HPWH_ABORT;
+	}
+	double baseUA_kJperHrC, fittingsUA_kJperHrC;
+	hpwh.getUA(baseUA_kJperHrC);
+	hpwh.getFittingsUA(fittingsUA_kJperHrC);
+	volume_L = hpwh.getTankSize();
+	UA_kJperHrC = baseUA_kJperHrC + fittingsUA_kJperHrC;
+	setpoint_C = hpwh.getSetpoint();
+	numHeatSources = hpwh.getNumHeatSources();
+
+	std::vector<double> setpoints = options.setpoints_C;
+	if (setpoints.empty() || hpwh.isSetpointFixed()) {
+		setpoints.assign(1, setpoint_C);
+	}
+
+	ambientTs_C = options.ambientTs_C;
+	inletTs_C = options.inletTs_C;
+	double lowT_C = inletTs_C.front() - options.tankTStep_dC;
+	double highT_C = *std::max_element(setpoints.begin(), setpoints.end()) + options.tankTStep_dC;
+	tankTs_C.clear();
+	for (double T = lowT_C; T < highT_C + 0.5 * options.tankTStep_dC; T += options.tankTStep_dC) {
+		tankTs_C.push_back(T);
+	}
+	int nA = (int)ambientTs_C.size(), nI = (int)inletTs_C.size(), nT = (int)tankTs_C.size();
+
+	Samples samples;
+	Bins emptyBins;
+	emptyBins.sum.assign(nA * nI * nT, 0.);
+	emptyBins.count.assign(nA * nI * nT, 0);
+	samples.tables.assign(NUM_TABLES * numHeatSources * NUM_QUANTITIES, emptyBins);
+	samples.outlet.sum.assign(NUM_OUTLET_BINS, 0.);
+	samples.outlet.count.assign(NUM_OUTLET_BINS, 0);
+
+	const HPWH::DRMODES modes[NUM_TABLES] = { HPWH::DR_ALLOW, HPWH::DR_LOC, HPWH::DR_LOR };
+	unsigned seed = 1;
+	for (double setpointT_C : setpoints) {
+		auto startAtSetpoint = [&]() {
+			if (init(hpwh) != 0) {
+				return (int)HPWH::HPWH_ABORT;
+			}
+			if (setpointT_C != hpwh.getSetpoint() && hpwh.setSetpoint(setpointT_C) != 0) {
+				return (int)HPWH::HPWH_ABORT;
+			}
+			return hpwh.resetTankToSetpoint();
+		};
+
+		for (double inletT_C : inletTs_C) {
+			for (double ambientT_C : ambientTs_C) {
+				for (int table = 0; table < NUM_TABLES; table++) {
+					for (double drawFraction : options.drawFractions) {
+						if (startAtSetpoint() != 0 ||
+							runRecovery(hpwh, ambientT_C, inletT_C, drawFraction, modes[table], options.maxRecoveryMinutes,
+								samples) != 0) {
+							return HPWH::HPWH_ABORT;
+						}
+					}
+				}
+				for (double tanks : options.tanksPerDay) {
+					if (startAtSetpoint() != 0 ||
+						runRandomDraws(hpwh, ambientT_C, inletT_C, tanks, options.randomDrawDays, seed++, samples) != 0) {
+						return HPWH::HPWH_ABORT;
+					}
+				}
+			}
+			// a slow draw and a fast one for the outlet temperature of a well drawn down tank
+			for (double drawRate_LperMin : { 0.01 * volume_L, 0.1 * volume_L }) {
+				if (startAtSetpoint() != 0 || runDrawDown(hpwh, inletT_C, drawRate_LperMin, samples) != 0) {
+					return HPWH::HPWH_ABORT;
+				}
+			}
+		}
+	}
+
+	turnOnDeficit_kJ = median(samples.turnOns_kJ);
+	turnOffDeficit_kJ = std::min(median(samples.turnOffs_kJ), turnOnDeficit_kJ);
+
+	tables.assign(samples.tables.size(), std::vector<double>());
+	for (size_t k = 0; k < samples.tables.size(); k++) {
+		fillTable(samples.tables[k], nA, nI, nT, tables[k]);
+	}
+	fillTable(samples.outlet, 1, 1, NUM_OUTLET_BINS, outletFractions);
+	return 0;
+}
+
+int HPWHSurrogate::Model::writeFile(const std::string &fileName) const {
+	std::ofstream file(fileName.c_str());
+	if (!file.is_open()) {
+		return HPWH::HPWH_ABORT;
+	}
+	file << std::setprecision(17);
+	file << "HPWHSurrogate 1\n";
+	file << "volume_L " << volume_L << "\n";
+	file << "UA_kJperHrC " << UA_kJperHrC << "\n";
+	file << "setpoint_C " << setpoint_C << "\n";
+	file << "turnOnDeficit_kJ " << turnOnDeficit_kJ << "\n";
+	file << "turnOffDeficit_kJ " << turnOffDeficit_kJ << "\n";
+	file << "numHeatSources " << numHeatSources << "\n";
+	auto writeList = [&](const char *name, const std::vector<double> &values) {
+		file << name << " " << values.size();
+		for (double value : values) {
+			file << " " << value;
+		}
+		file << "\n";
+	};
+	writeList("ambientTs_C", ambientTs_C);
+	writeList("inletTs_C", inletTs_C);
+	writeList("tankTs_C", tankTs_C);
+	writeList("outletFractions", outletFractions);
+	for (const std::vector<double> &table : tables) {
+		writeList("table", table);
+	}
+	return file.good() ? 0 : HPWH::HPWH_ABORT;
+}
+
+int HPWHSurrogate::Model::readFile(const std::string &fileName) {
+	std::ifstream file(fileName.c_str());
+	if (!file.is_open()) {
+		return HPWH::HPWH_ABORT;
+	}
+	std::string token;
+	int version;
+	file >> token >> version;
+	if (token != "HPWHSurrogate" || version != 1) {
+		return HPWH::HPWH_ABORT;
+	}
+	auto readValue = [&](const char *name, double &value) {
+		file >> token >> value;
+		return file.good() && token == name;
+	};
+	auto readList = [&](const char *name, std::vector<double> &values) {
+		size_t n;
+		file >> token >> n;
+		if (!file.good() || token != name || n > 1000000) {
+			return false;
+		}
+		values.resize(n);
+		for (double &value : values) {
+			file >> value;
+		}
+		return !file.fail();
+	};
+	double sources;
+	if (!readValue("volume_L", volume_L) || !readValue("UA_kJperHrC", UA_kJperHrC) ||
+		!readValue("setpoint_C", setpoint_C) || !readValue("turnOnDeficit_kJ", turnOnDeficit_kJ) ||
+		!readValue("turnOffDeficit_kJ", turnOffDeficit_kJ) || !readValue("numHeatSources", sources) ||
+		!readList("ambientTs_C", ambientTs_C) || !readList("inletTs_C", inletTs_C) ||
+		!readList("tankTs_C", tankTs_C) || !readList("outletFractions", outletFractions) ||
+		ambientTs_C.empty() || inletTs_C.empty() || tankTs_C.size() < 2 || outletFractions.size() < 2) {
+		return HPWH::HPWH_ABORT;
+	}
+	numHeatSources = (int)sources;
+	tables.assign(NUM_TABLES * numHeatSources * NUM_QUANTITIES, std::vector<double>());
+	for (std::vector<double> &table : tables) {
+		if (!readList("table", table) || table.size() != ambientTs_C.size() * inletTs_C.size() * tankTs_C.size()) {
+			return HPWH::HPWH_ABORT;
+		}
+	}
+	return 0;
+}
+
+HPWHSurrogate::HPWHSurrogate(std::shared_ptr<const Model> fitted) : model(fitted), outletTemp_C(0.),
+	standbyLosses_kWh(0.)
+{
+	setpoint_C = model->setpoint_C;
+	energyInput_kWh.assign(model->numHeatSources, 0.);
+	energyOutput_kWh.assign(model->numHeatSources, 0.);
+	runTime_min.assign(model->numHeatSources, 0.);
+	resetTankToSetpoint();
+}
+
+int HPWHSurrogate::setSetpoint(double newSetpoint_C) {
+	if (newSetpoint_C <= 0. || newSetpoint_C >= 100.) {
+		return HPWH::HPWH_ABORT;
+	}
+	setpoint_C = newSetpoint_C;
+	return 0;
+}
+
+void HPWHSurrogate::resetTankToSetpoint() {
+	tankT_C = setpoint_C;
+	heating = false;
+}
+
+int HPWHSurrogate::runOneStep(double inletT_C, double drawVolume_L, double tankAmbientT_C,
+	double heatSourceAmbientT_C, HPWH::DRMODES DRstatus) {
+	if (drawVolume_L < 0.) {
+		return HPWH::HPWH_ABORT;
+	}
+	const Model &m = *model;
+	const double capacity_kJperC = tankHeatCapacity_kJperC(m.volume_L);
+	std::fill(energyInput_kWh.begin(), energyInput_kWh.end(), 0.);
+	std::fill(energyOutput_kWh.begin(), energyOutput_kWh.end(), 0.);
+	std::fill(runTime_min.begin(), runTime_min.end(), 0.);
+
+	// the draw, in pieces of a few percent of the tank so the outlet temperature follows the draw down
+	outletTemp_C = 0.;
+	if (drawVolume_L > 0.) {
+		double fullT_C = std::max(setpoint_C, tankT_C);
+		double left_L = drawVolume_L, outletTV = 0.;
+		while (left_L > 0.) {
+			double piece_L = std::min(left_L, DRAW_RATE_FRACTION * m.volume_L);
+			double drawnFraction = (fullT_C - inletT_C > 0.1) ? (fullT_C - tankT_C) / (fullT_C - inletT_C) : 1.;
+			double pieceT_C = inletT_C + m.outletFraction(drawnFraction) * (fullT_C - inletT_C);
+			outletTV += piece_L * pieceT_C;
+			tankT_C -= piece_L / m.volume_L * (pieceT_C - inletT_C);
+			left_L -= piece_L;
+		}
+		outletTemp_C = outletTV / drawVolume_L;
+	}
+
+	double standbyLosses_kJ = m.UA_kJperHrC * (tankT_C - tankAmbientT_C) / 60.;
+	tankT_C -= standbyLosses_kJ / capacity_kJperC;
+	standbyLosses_kWh = KJ_TO_KWH(standbyLosses_kJ);
+
+	// heating
+	double deficit_kJ = capacity_kJperC * (setpoint_C - tankT_C);
+	int table = Model::tableFor(DRstatus);
+	if (!heating && deficit_kJ > m.turnOnDeficit_kJ) {
+		heating = true;
+	}
+	if (heating) {
+		const Model::Cell cell = m.locate(heatSourceAmbientT_C, inletT_C, tankT_C);
+		double output_kW = 0.;
+		if (table >= 0) {
+			for (int s = 0; s < m.numHeatSources; s++) {
+				output_kW += Model::lookup(m.tables[m.tableIndex(table, s, Model::OUTPUT_KW)], cell);
+			}
+		}
+		double room_kJ = deficit_kJ - m.turnOffDeficit_kJ;
+		if (output_kW <= 0. || room_kJ <= 0.) {
+			heating = false;
+		}
+		else {
+			double fraction = std::min(1., room_kJ / (output_kW * 60.));
+			for (int s = 0; s < m.numHeatSources; s++) {
+				energyInput_kWh[s] = fraction / 60. *
+					Model::lookup(m.tables[m.tableIndex(table, s, Model::INPUT_KW)], cell);
+				energyOutput_kWh[s] = fraction / 60. *
+					Model::lookup(m.tables[m.tableIndex(table, s, Model::OUTPUT_KW)], cell);
+				runTime_min[s] = fraction *
+					Model::lookup(m.tables[m.tableIndex(table, s, Model::RUN_FRACTION)], cell);
+			}
+			tankT_C += fraction * output_kW * 60. / capacity_kJperC;
+			heating = fraction >= 1.;
+		}
+	}
+	return 0;
+}
+
+double HPWHSurrogate::getNthHeatSourceEnergyInput(int N) const {
+	return (N >= 0 && N < (int)energyInput_kWh.size()) ? energyInput_kWh[N] : 0.;
+}
+
+double HPWHSurrogate::getNthHeatSourceEnergyOutput(int N) const {
+	return (N >= 0 && N < (int)energyOutput_kWh.size()) ? energyOutput_kWh[N] : 0.;
+}
+
+double HPWHSurrogate::getNthHeatSourceRunTime(int N) const {
+	return (N >= 0 && N < (int)runTime_min.size()) ? runTime_min[N] : 0.;
+}
+
+double HPWHSurrogate::getEnergyInput() const {
+	double total_kWh = 0.;
+	for (double e : energyInput_kWh) {
+		total_kWh += e;
+	}
+	return total_kWh;
+}
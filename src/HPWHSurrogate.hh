@@ -0,0 +1,150 @@
+#ifndef HPWHSURROGATE_hh
+#define HPWHSURROGATE_hh
+
+#include "HPWH.hh"
+
+#include <functional>
+#include <memory>
+
+/** A reduced order stand-in for a HPWH, for fleet studies that need the aggregate behavior of
+ *  very many tanks rather than the detail of any one of them.
+ *
+ *  The tank is a single state, its average temperature, plus whether it is heating.  A
+ *  HPWHSurrogate::Model is fitted to a preset by driving the full model through designed
+ *  experiments over a sweep of ambient temperatures, inlet temperatures and setpoints: draws
+ *  of several sizes followed by recoveries in each DR mode, days of random draws, and draw
+ *  downs with heating locked out.  It holds:
+ *    - the heat deficits at which heating turns on and off
+ *    - lookup tables of the input power, output power and run fraction of every heat source
+ *      over ambient, inlet and average tank temperature, for each DR mode
+ *    - the outlet temperature, as a fraction of the way from the inlet temperature to the
+ *      setpoint, against how much of the tank has been drawn down
+ *  One Model is shared by every surrogate tank of that preset, each of which only stores a few
+ *  numbers of state, and a step is a handful of table lookups.
+ */
+class HPWHSurrogate {
+ public:
+  typedef std::function<int(HPWH &hpwh)> InitFunc;
+  /**< initializes a HPWH to the model being fitted, returns 0 or HPWH::HPWH_ABORT  */
+
+  struct FitOptions {
+    std::vector<double> ambientTs_C;      /**< the ambient temperatures of the table, and of the experiments */
+    std::vector<double> inletTs_C;        /**< the inlet temperatures of the table, and of the experiments */
+    std::vector<double> setpoints_C;      /**< the setpoints of the experiments, empty uses the model setpoint */
+    std::vector<double> drawFractions;    /**< the sizes of the draws before each recovery, as a fraction of the tank */
+    std::vector<double> tanksPerDay;      /**< the daily volumes, in tanks, of the random draw experiments */
+    int randomDrawDays;                   /**< the length of each random draw experiment */
+    double tankTStep_dC;                  /**< the spacing of the tank temperature table */
+    int maxRecoveryMinutes;               /**< how long a recovery is followed before giving up */
+    FitOptions();
+  };
+
+  class Model {
+   public:
+    int fit(InitFunc init, const FitOptions &options = FitOptions());
+    /**< runs the experiments and builds the tables, returns 0 or HPWH::HPWH_ABORT  */
+
+    int writeFile(const std::string &fileName) const;
+    int readFile(const std::string &fileName);
+    /**< saves and loads a fitted model as text, both return 0 or HPWH::HPWH_ABORT  */
+
+    int getNumHeatSources() const { return numHeatSources; }
+    double getFittedSetpoint() const { return setpoint_C; }
+
+   private:
+    friend class HPWHSurrogate;
+
+    enum DRTABLE { TABLE_ALLOW, TABLE_LOC, TABLE_LOR, NUM_TABLES };
+    enum QUANTITY { INPUT_KW, OUTPUT_KW, RUN_FRACTION, NUM_QUANTITIES };
+
+    struct Bins {
+      std::vector<double> sum;
+      std::vector<int> count;
+    };
+
+    static int tableFor(HPWH::DRMODES DRstatus);
+    /**< the table for DRstatus, -1 if all heating is locked out  */
+    int tableIndex(int table, int source, int quantity) const;
+    struct Cell {
+      int row00, row01, row10, row11;   /**< the offsets of the four (ambient, inlet) rows around the point */
+      int j, j1;
+      double wAmbient, wInlet, wTank;
+    };
+    Cell locate(double ambientT_C, double inletT_C, double tankT_C) const;
+    /**< finds the table cell around a point, clamped at the edges  */
+    static double lookup(const std::vector<double> &values, const Cell &cell);
+    /**< trilinear interpolation in an ambient by inlet by tank temperature table  */
+    double outletFraction(double drawnFraction) const;
+
+    struct Samples {
+      std::vector<Bins> tables;
+      Bins outlet;
+      std::vector<double> turnOns_kJ;
+      std::vector<double> turnOffs_kJ;
+    };
+
+    int runStep(HPWH &hpwh, double inletT_C, double drawVolume_L, double ambientT_C, HPWH::DRMODES DRstatus,
+                bool &wasHeating, Samples &samples) const;
+    /**< runs the full model one minute and bins what it did, returns 0 or HPWH::HPWH_ABORT.
+        Turn on and off deficits are only taken from normal (DR_ALLOW) operation  */
+    int runRecovery(HPWH &hpwh, double ambientT_C, double inletT_C, double drawFraction,
+                    HPWH::DRMODES DRstatus, int maxMinutes, Samples &samples) const;
+    /**< draws drawFraction of the tank from setpoint, then runs until heating stops  */
+    int runRandomDraws(HPWH &hpwh, double ambientT_C, double inletT_C, double tanksPerDay, int days,
+                       unsigned seed, Samples &samples) const;
+    /**< runs days of randomly timed and sized draws totalling tanksPerDay tank volumes a day  */
+    int runDrawDown(HPWH &hpwh, double inletT_C, double drawRate_LperMin, Samples &samples) const;
+    /**< draws 1.2 tanks with heating locked out, binning the outlet temperature  */
+    static void addOutletSample(Bins &outletBins, double drawnFraction, double outletFraction);
+    static void fillTable(const Bins &bins, int nAmbients, int nInlets, int nTankTs, std::vector<double> &values);
+    /**< averages the bins, interpolating along tank temperature and then copying across ambients
+        and inlets to fill gaps  */
+
+    double volume_L;
+    double UA_kJperHrC;
+    double setpoint_C;
+    double turnOnDeficit_kJ;
+    double turnOffDeficit_kJ;
+    int numHeatSources;
+    std::vector<double> ambientTs_C;
+    std::vector<double> inletTs_C;
+    std::vector<double> tankTs_C;
+    std::vector<double> outletFractions;   /**< at evenly spaced drawn fractions from 0 to 1 */
+    std::vector<std::vector<double> > tables;
+  };
+
+  HPWHSurrogate(std::shared_ptr<const Model> model);
+
+  int setSetpoint(double newSetpoint_C);
+  double getSetpoint() const { return setpoint_C; }
+  void resetTankToSetpoint();
+
+  int runOneStep(double inletT_C, double drawVolume_L, double tankAmbientT_C,
+                 double heatSourceAmbientT_C, HPWH::DRMODES DRstatus);
+  /**< advances one minute, returns 0 or HPWH::HPWH_ABORT  */
+
+  double getNthHeatSourceEnergyInput(int N) const;
+  double getNthHeatSourceEnergyOutput(int N) const;
+  double getNthHeatSourceRunTime(int N) const;
+  /**< the energy in kWh and run time in minutes of the last step, 0 for N out of bounds */
+  double getEnergyInput() const;
+  /**< the total input energy of the last step in kWh */
+  double getOutletTemp() const { return outletTemp_C; }
+  /**< the average outlet temperature of the last step, 0 with no draw */
+  double getStandbyLosses() const { return standbyLosses_kWh; }
+  double getAverageTankTemp() const { return tankT_C; }
+  bool isHeating() const { return heating; }
+
+ private:
+  std::shared_ptr<const Model> model;
+  double setpoint_C;
+  double tankT_C;
+  bool heating;
+  double outletTemp_C;
+  double standbyLosses_kWh;
+  std::vector<double> energyInput_kWh;
+  std::vector<double> energyOutput_kWh;
+  std::vector<double> runTime_min;
+};
+
+#endif
@@ -0,0 +1,229 @@
+#include "HPWHcapi.h"
+#include "HPWH.hh"
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+static_assert(HPWH_C_ABORT == HPWH::HPWH_ABORT, "HPWH_C_ABORT is HPWH::HPWH_ABORT");
+static_assert(HPWH_C_HEAT_SOURCES == HPWH::STEP_HEATSOURCES, "HPWH_C_HEAT_SOURCES is HPWH::STEP_HEATSOURCES");
+static_assert(HPWH_C_TCOUPLES == HPWH::STEP_TCOUPLES, "HPWH_C_TCOUPLES is HPWH::STEP_TCOUPLES");
+
+struct HPWHFleet {
+	std::vector<HPWH> tanks;
+};
+
+// the last failure on each thread, so calls failing on different threads at once each keep their own
+struct FleetError {
+	const HPWHFleet *fleet;
+	char message[256];
+};
+static thread_local FleetError lastError = { NULL, "" };
+
+static int fail(const HPWHFleet *fleet, const char *format, ...) {
+	if (fleet != NULL) {
+		va_list args;
+		va_start(args, format);
+		vsnprintf(lastError.message, sizeof(lastError.message), format, args);
+		va_end(args);
+		lastError.fleet = fleet;
+	}
+	return HPWH_C_ABORT;
+}
+
+static bool isTank(const HPWHFleet *fleet, int tank) {
+	return fleet != NULL && tank >= 0 && tank < (int)fleet->tanks.size();
+}
+
+static int addTanks(HPWHFleet *fleet, const HPWH &prototype, int count, int *firstTank) {
+	if (firstTank != NULL) {
+		*firstTank = (int)fleet->tanks.size();
+	}
+	try {
+		fleet->tanks.reserve(fleet->tanks.size() + count);
+		for (int i = 0; i < count; i++) {
+			fleet->tanks.push_back(prototype);
+		}
+	}
+	catch (...) {
+		return fail(fleet, "Out of memory for %d tanks", count);
+	}
+	return 0;
+}
+
+int hpwh_c_api_version(void) {
+	return HPWH_C_API_VERSION;
+}
+
+const char *hpwh_version(void) {
+	static const std::string version = HPWH::getVersion();
+	return version.c_str();
+}
+
+HPWHFleet *hpwh_fleet_create(void) {
+	try {
+		return new HPWHFleet;
+	}
+	catch (...) {
+		return NULL;
+	}
+}
+
+void hpwh_fleet_destroy(HPWHFleet *fleet) {
+	// a fleet created later at the same address starts with no error
+	if (lastError.fleet == fleet) {
+		lastError.fleet = NULL;
+	}
+	delete fleet;
+}
+
+int hpwh_fleet_add_preset(HPWHFleet *fleet, const char *presetName, int count, int *firstTank) {
+	if (fleet == NULL || presetName == NULL || count <= 0) {
+		return fail(fleet, "Add at least one tank of a named preset");
+	}
+	const HPWH::PresetInfo *preset = HPWH::findPreset(presetName);
+	HPWH prototype;
+	if (preset == NULL || prototype.HPWHinit_presetsCached(preset->model) != 0) {
+		return fail(fleet, "There is no preset %s", presetName);
+	}
+	return addTanks(fleet, prototype, count, firstTank);
+}
+
+int hpwh_fleet_add_file(HPWHFleet *fleet, const char *modelFile, int count, int *firstTank) {
+	if (fleet == NULL || modelFile == NULL || count <= 0) {
+		return fail(fleet, "Add at least one tank of a model file");
+	}
+	HPWH prototype;
+	if (prototype.HPWHinit_fileCached(modelFile) != 0) {
+		return fail(fleet, "Could not read the model file %s", modelFile);
+	}
+	return addTanks(fleet, prototype, count, firstTank);
+}
+
+int hpwh_fleet_size(const HPWHFleet *fleet) {
+	return (fleet == NULL) ? 0 : (int)fleet->tanks.size();
+}
+
+int hpwh_fleet_num_nodes(const HPWHFleet *fleet, int tank) {
+	return isTank(fleet, tank) ? fleet->tanks[tank].getNumNodes() : fail(fleet, "There is no tank %d", tank);
+}
+
+int hpwh_fleet_num_heat_sources(const HPWHFleet *fleet, int tank) {
+	return isTank(fleet, tank) ? fleet->tanks[tank].getNumHeatSources() : fail(fleet, "There is no tank %d", tank);
+}
+
+int hpwh_fleet_tank_temps(const HPWHFleet *fleet, int tank, double *tankTemps_C, int numNodes) {
+	if (!isTank(fleet, tank) || tankTemps_C == NULL || numNodes != fleet->tanks[tank].getNumNodes()) {
+		return fail(fleet, "Tank %d does not have %d nodes", tank, numNodes);
+	}
+	for (int i = 0; i < numNodes; i++) {
+		tankTemps_C[i] = fleet->tanks[tank].getTankNodeTemp(i);
+	}
+	return 0;
+}
+
+int hpwh_fleet_set_setpoint(HPWHFleet *fleet, int firstTank, int numTanks, double setpoint_C) {
+	if (numTanks < 0 || !isTank(fleet, firstTank) || firstTank + numTanks > (int)fleet->tanks.size()) {
+		return fail(fleet, "There are no tanks %d to %d", firstTank, firstTank + numTanks - 1);
+	}
+	for (int t = firstTank; t < firstTank + numTanks; t++) {
+		if (fleet->tanks[t].setSetpoint(setpoint_C) != 0) {
+			return fail(fleet, "Tank %d cannot have a setpoint of %g C", t, setpoint_C);
+		}
+	}
+	return 0;
+}
+
+int hpwh_fleet_reset_to_setpoint(HPWHFleet *fleet, int firstTank, int numTanks) {
+	if (numTanks < 0 || !isTank(fleet, firstTank) || firstTank + numTanks > (int)fleet->tanks.size()) {
+		return fail(fleet, "There are no tanks %d to %d", firstTank, firstTank + numTanks - 1);
+	}
+	for (int t = firstTank; t < firstTank + numTanks; t++) {
+		if (fleet->tanks[t].resetTankToSetpoint() != 0) {
+			return fail(fleet, "Tank %d could not be reset to its setpoint", t);
+		}
+	}
+	return 0;
+}
+
+int hpwh_fleet_step(HPWHFleet *fleet, int firstTank, int numTanks, int numSteps,
+                    const HPWHStepInputs *inputs, const HPWHStepOutputs *outputs) {
+	if (fleet == NULL || numTanks < 0 || numSteps < 0 || firstTank < 0 ||
+		firstTank + numTanks > (int)fleet->tanks.size()) {
+		return fail(fleet, "There are no tanks %d to %d", firstTank, firstTank + numTanks - 1);
+	}
+	if (inputs == NULL || inputs->inletT_C == NULL || inputs->drawVolume_L == NULL ||
+		inputs->tankAmbientT_C == NULL || inputs->heatSourceAmbientT_C == NULL) {
+		return fail(fleet, "The step needs the inlet, draw and ambient inputs");
+	}
+	for (int t = firstTank; t < firstTank + numTanks && outputs != NULL; t++) {
+		if (fleet->tanks[t].getNumHeatSources() > HPWH_C_HEAT_SOURCES || fleet->tanks[t].getNumNodes() < HPWH_C_TCOUPLES) {
+			return fail(fleet, "Tank %d has more than %d heat sources or fewer than %d nodes", t,
+				HPWH_C_HEAT_SOURCES, HPWH_C_TCOUPLES);
+		}
+	}
+
+	const unsigned shared = inputs->shared;
+	HPWH::StepOutputs step;
+	for (int t = 0; t < numTanks; t++) {
+		HPWH &hpwh = fleet->tanks[firstTank + t];
+		for (int s = 0; s < numSteps; s++) {
+			const size_t i = (size_t)t * numSteps + s;
+			HPWH::DRMODES DRstatus = (inputs->DRstatus == NULL) ? HPWH::DR_ALLOW :
+				static_cast<HPWH::DRMODES>(inputs->DRstatus[(shared & HPWH_C_SHARED_DR) ? s : i]);
+			int result = hpwh.runOneStep(inputs->inletT_C[(shared & HPWH_C_SHARED_INLET) ? s : i],
+				inputs->drawVolume_L[(shared & HPWH_C_SHARED_DRAW) ? s : i],
+				inputs->tankAmbientT_C[(shared & HPWH_C_SHARED_AMBIENT) ? s : i],
+				inputs->heatSourceAmbientT_C[(shared & HPWH_C_SHARED_EVAPORATOR) ? s : i], DRstatus);
+			if (result != 0) {
+				return fail(fleet, "Tank %d failed on step %d", firstTank + t, s);
+			}
+			if (outputs == NULL) {
+				continue;
+			}
+
+			// one call for the whole step, rather than a getter per output
+			if (hpwh.getStepOutputs(step) != 0) {
+				return fail(fleet, "Tank %d has no outputs on step %d", firstTank + t, s);
+			}
+			if (outputs->outletTemp_C != NULL) outputs->outletTemp_C[i] = step.outletTemp_C;
+			if (outputs->standbyLosses_kWh != NULL) outputs->standbyLosses_kWh[i] = step.standbyLosses_kWh;
+			if (outputs->energyRemovedFromEnvironment_kWh != NULL) {
+				outputs->energyRemovedFromEnvironment_kWh[i] = step.energyRemovedFromEnvironment_kWh;
+			}
+			if (outputs->tankHeatContent_kJ != NULL) outputs->tankHeatContent_kJ[i] = step.tankHeatContent_kJ;
+			if (outputs->energyInput_kWh != NULL) {
+				double energyInput_kWh = 0.;
+				for (int j = 0; j < step.numHeatSources; j++) {
+					energyInput_kWh += step.heatSourceEnergyInput_kWh[j];
+				}
+				outputs->energyInput_kWh[i] = energyInput_kWh;
+			}
+			if (outputs->heatSourceEnergyInput_kWh != NULL) {
+				std::copy(step.heatSourceEnergyInput_kWh, step.heatSourceEnergyInput_kWh + HPWH_C_HEAT_SOURCES,
+					outputs->heatSourceEnergyInput_kWh + i * HPWH_C_HEAT_SOURCES);
+			}
+			if (outputs->heatSourceEnergyOutput_kWh != NULL) {
+				std::copy(step.heatSourceEnergyOutput_kWh, step.heatSourceEnergyOutput_kWh + HPWH_C_HEAT_SOURCES,
+					outputs->heatSourceEnergyOutput_kWh + i * HPWH_C_HEAT_SOURCES);
+			}
+			if (outputs->heatSourceRunTime_min != NULL) {
+				std::copy(step.heatSourceRunTime_min, step.heatSourceRunTime_min + HPWH_C_HEAT_SOURCES,
+					outputs->heatSourceRunTime_min + i * HPWH_C_HEAT_SOURCES);
+			}
+			if (outputs->simTcouples_C != NULL) {
+				std::copy(step.simTcouples_C, step.simTcouples_C + HPWH_C_TCOUPLES, outputs->simTcouples_C + i * HPWH_C_TCOUPLES);
+			}
+		}
+	}
+	return 0;
+}
+
+const char *hpwh_fleet_error(const HPWHFleet *fleet) {
+	if (fleet == NULL) {
+		return "There is no fleet";
+	}
+	return (lastError.fleet == fleet) ? lastError.message : "";
+}
@@ -0,0 +1,105 @@
+#ifndef HPWHCAPI_h
+#define HPWHCAPI_h
+
+/** A C interface to HPWHsim for hosts that are not C++: a fleet of tanks behind an opaque
+ *  handle, stepped many tanks and many steps at a time with caller owned arrays.
+ *
+ *  Time series are laid out tank by tank: value s of tank t, of a call on numTanks tanks from
+ *  firstTank for numSteps steps, is at t * numSteps + s, with t counted from firstTank.  The
+ *  heat source outputs hold HPWH_C_HEAT_SOURCES values per step whatever the model, 0 past its
+ *  last heat source, and the thermocouples HPWH_C_TCOUPLES, so step s of heat source j of tank
+ *  t is at (t * numSteps + s) * HPWH_C_HEAT_SOURCES + j.
+ *
+ *  hpwh_fleet_step neither allocates nor copies: it runs each tank through its steps straight
+ *  from the inputs and writes straight to the outputs.  Calls on different tanks of a fleet
+ *  may run at the same time from different threads; anything that adds tanks may not.
+ *
+ *  Every int function returns 0 for success or HPWH_C_ABORT, with the reason from
+ *  hpwh_fleet_error on the thread that made the call.  Like errno, each thread keeps its own,
+ *  so calls failing at the same time on different threads do not overwrite each other's.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HPWH_C_API_VERSION 2
+#define HPWH_C_ABORT (-274000)     /**< HPWH::HPWH_ABORT */
+#define HPWH_C_HEAT_SOURCES 4      /**< HPWH::STEP_HEATSOURCES */
+#define HPWH_C_TCOUPLES 6          /**< HPWH::STEP_TCOUPLES */
+
+/** the inputs that hpwh_fleet_step takes the same for every tank, as flags for shared  */
+#define HPWH_C_SHARED_INLET 1
+#define HPWH_C_SHARED_DRAW 2
+#define HPWH_C_SHARED_AMBIENT 4
+#define HPWH_C_SHARED_EVAPORATOR 8
+#define HPWH_C_SHARED_DR 16
+
+typedef struct HPWHFleet HPWHFleet;
+
+/** the inputs of runOneStep, numTanks * numSteps values each, or numSteps values for one
+    flagged in shared  */
+typedef struct {
+  const double *inletT_C;
+  const double *drawVolume_L;
+  const double *tankAmbientT_C;
+  const double *heatSourceAmbientT_C;
+  const int *DRstatus;                   /**< HPWH::DRMODES, NULL runs every step at DR_ALLOW */
+  unsigned shared;                       /**< HPWH_C_SHARED_ flags */
+} HPWHStepInputs;
+
+/** the outputs of every step, any may be NULL to skip it  */
+typedef struct {
+  double *outletTemp_C;                  /**< 0 when nothing was drawn */
+  double *standbyLosses_kWh;
+  double *energyRemovedFromEnvironment_kWh;
+  double *tankHeatContent_kJ;
+  double *energyInput_kWh;               /**< summed over the heat sources */
+  double *heatSourceEnergyInput_kWh;     /**< HPWH_C_HEAT_SOURCES per step */
+  double *heatSourceEnergyOutput_kWh;    /**< HPWH_C_HEAT_SOURCES per step */
+  double *heatSourceRunTime_min;         /**< HPWH_C_HEAT_SOURCES per step */
+  double *simTcouples_C;                 /**< HPWH_C_TCOUPLES per step, 0 at the bottom */
+} HPWHStepOutputs;
+
+int hpwh_c_api_version(void);
+/**< HPWH_C_API_VERSION of the library, to check against the header a host was built with  */
+const char *hpwh_version(void);
+/**< HPWH::getVersion  */
+
+HPWHFleet *hpwh_fleet_create(void);
+/**< an empty fleet, NULL if out of memory  */
+void hpwh_fleet_destroy(HPWHFleet *fleet);
+
+int hpwh_fleet_add_preset(HPWHFleet *fleet, const char *presetName, int count, int *firstTank);
+/**< adds count tanks of a preset, by a name HPWH::findPreset takes, and sets firstTank to the
+    number of the first.  They are copies of one tank, so adding many costs one setup  */
+int hpwh_fleet_add_file(HPWHFleet *fleet, const char *modelFile, int count, int *firstTank);
+/**< as hpwh_fleet_add_preset, from a model file as HPWH::HPWHinit_file reads it  */
+
+int hpwh_fleet_size(const HPWHFleet *fleet);
+int hpwh_fleet_num_nodes(const HPWHFleet *fleet, int tank);
+/**< the number of nodes of a tank, or HPWH_C_ABORT if there is no such tank  */
+int hpwh_fleet_num_heat_sources(const HPWHFleet *fleet, int tank);
+int hpwh_fleet_tank_temps(const HPWHFleet *fleet, int tank, double *tankTemps_C, int numNodes);
+/**< fills tankTemps_C with the numNodes node temperatures of a tank, 0 is the bottom node.
+    numNodes must be hpwh_fleet_num_nodes  */
+int hpwh_fleet_set_setpoint(HPWHFleet *fleet, int firstTank, int numTanks, double setpoint_C);
+int hpwh_fleet_reset_to_setpoint(HPWHFleet *fleet, int firstTank, int numTanks);
+/**< fills tanks firstTank to firstTank + numTanks - 1 with water at their setpoints  */
+
+int hpwh_fleet_step(HPWHFleet *fleet, int firstTank, int numTanks, int numSteps,
+                    const HPWHStepInputs *inputs, const HPWHStepOutputs *outputs);
+/**< runs numSteps one minute steps of tanks firstTank to firstTank + numTanks - 1, writing
+    every step's outputs.  outputs may be NULL; when it is not, every tank must have at most
+    HPWH_C_HEAT_SOURCES heat sources and at least HPWH_C_TCOUPLES nodes.  A tank that fails stops the call there, with
+    the tanks before it stepped and those after it not  */
+
+const char *hpwh_fleet_error(const HPWHFleet *fleet);
+/**< why the last call of this thread to fail failed, if it was on this fleet, "" otherwise.
+    The text stays valid until the thread's next failing call  */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
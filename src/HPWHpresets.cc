@@ -2,6 +2,143 @@
 File Containing all of the presets available in HPWHsim
 */
 #include <algorithm>
+#include <unordered_map>
+
+// every preset HPWHinit_presets builds, as PRESET(model, description) with model the MODELS
+// enum without MODELS_.  The registry is generated from this list, and HPWHinit_presets refuses
+// any model that is not on it, so a branch below can only be reached by a listed model
+#define HPWH_PRESETS(PRESET) \
+	PRESET(restankNoUA,            "a simple resistance tank, but with no tank losses") \
+	PRESET(restankHugeUA,          "a simple resistance tank, but with very large tank losses") \
+	PRESET(restankRealistic,       "a more-or-less realistic resistance tank") \
+	PRESET(basicIntegrated,        "a standard integrated HPWH") \
+	PRESET(externalTest,           "a single compressor tank, using \"external\" topology") \
+	PRESET(AOSmithPHPT60,          "Ecotope model of the 60 gallon AOSmith Voltex") \
+	PRESET(AOSmithPHPT80,          "80 gallon AOSmith Voltex") \
+	PRESET(AOSmithHPTU50,          "50 gallon AOSmith HPTU") \
+	PRESET(AOSmithHPTU66,          "66 gallon AOSmith HPTU") \
+	PRESET(AOSmithHPTU80,          "80 gallon AOSmith HPTU") \
+	PRESET(AOSmithHPTU80_DR,       "80 gallon AOSmith HPTU, DR settings") \
+	PRESET(AOSmithCAHP120,         "12 gallon AOSmith CAHP commercial grade") \
+	PRESET(GE2012,                 "The 2012 era GeoSpring") \
+	PRESET(GE2014STDMode,          "2014 GE model run in standard mode") \
+	PRESET(GE2014STDMode_80,       "2014 GE model run in standard mode, 80 gallon unit") \
+	PRESET(GE2014,                 "2014 GE model run in the efficiency mode") \
+	PRESET(GE2014_80,              "2014 GE model run in the efficiency mode, 80 gallon unit") \
+	PRESET(GE2014_80DR,            "2014 GE model run in the efficiency mode, 80 gallon unit, DR settings") \
+	PRESET(BWC2020_65,             "The 2020 Bradford White 65 gallon unit") \
+	PRESET(Sanden40,               "Sanden 40 gallon CO2 external heat pump") \
+	PRESET(Sanden80,               "Sanden 80 gallon CO2 external heat pump") \
+	PRESET(Sanden_GS3_45HPA_US_SP, "Sanden 80 gallon CO2 external heat pump used for MF") \
+	PRESET(Sanden120,              "Sanden 120 gallon CO2 external heat pump") \
+	PRESET(RheemHB50,              "Rheem 2014 (?) Model") \
+	PRESET(RheemHBDR2250,          "50 gallon, 2250 W resistance Rheem HB Duct Ready") \
+	PRESET(RheemHBDR4550,          "50 gallon, 4500 W resistance Rheem HB Duct Ready") \
+	PRESET(RheemHBDR2265,          "65 gallon, 2250 W resistance Rheem HB Duct Ready") \
+	PRESET(RheemHBDR4565,          "65 gallon, 4500 W resistance Rheem HB Duct Ready") \
+	PRESET(RheemHBDR2280,          "80 gallon, 2250 W resistance Rheem HB Duct Ready") \
+	PRESET(RheemHBDR4580,          "80 gallon, 4500 W resistance Rheem HB Duct Ready") \
+	PRESET(Rheem2020Prem40,        "40 gallon, Rheem 2020 Premium") \
+	PRESET(Rheem2020Prem50,        "50 gallon, Rheem 2020 Premium") \
+	PRESET(Rheem2020Prem65,        "65 gallon, Rheem 2020 Premium") \
+	PRESET(Rheem2020Prem80,        "80 gallon, Rheem 2020 Premium") \
+	PRESET(Rheem2020Build40,       "40 gallon, Rheem 2020 Builder") \
+	PRESET(Rheem2020Build50,       "50 gallon, Rheem 2020 Builder") \
+	PRESET(Rheem2020Build65,       "65 gallon, Rheem 2020 Builder") \
+	PRESET(Rheem2020Build80,       "80 gallon, Rheem 2020 Builder") \
+	PRESET(Stiebel220E,            "Stiebel Eltron (2014 model?)") \
+	PRESET(Generic1,               "Generic Tier 1") \
+	PRESET(Generic2,               "Generic Tier 2") \
+	PRESET(Generic3,               "Generic Tier 3") \
+	PRESET(UEF2generic,            "UEF 2.0, modified GE2014STDMode case") \
+	PRESET(AWHSTier3Generic40,     "Generic AWHS Tier 3 40 gallons") \
+	PRESET(AWHSTier3Generic50,     "Generic AWHS Tier 3 50 gallons") \
+	PRESET(AWHSTier3Generic65,     "Generic AWHS Tier 3 65 gallons") \
+	PRESET(AWHSTier3Generic80,     "Generic AWHS Tier 3 80 gallons") \
+	PRESET(StorageTank,            "Generic Tank without heaters") \
+	PRESET(TamScalable_SP,         "a poorly performing single pass model with scalable input capacity and COP") \
+	PRESET(ColmacCxV_5_SP,         "Colmac CxA_5 external heat pump in Single Pass Mode") \
+	PRESET(ColmacCxA_10_SP,        "Colmac CxA_10 external heat pump in Single Pass Mode") \
+	PRESET(ColmacCxA_15_SP,        "Colmac CxA_15 external heat pump in Single Pass Mode") \
+	PRESET(ColmacCxA_20_SP,        "Colmac CxA_20 external heat pump in Single Pass Mode") \
+	PRESET(ColmacCxA_25_SP,        "Colmac CxA_25 external heat pump in Single Pass Mode") \
+	PRESET(ColmacCxA_30_SP,        "Colmac CxA_30 external heat pump in Single Pass Mode") \
+	PRESET(NyleC25A_SP,            "Nyle C25A external heat pump in Single Pass Mode") \
+	PRESET(NyleC60A_SP,            "Nyle C60A external heat pump in Single Pass Mode") \
+	PRESET(NyleC90A_SP,            "Nyle C90A external heat pump in Single Pass Mode") \
+	PRESET(NyleC125A_SP,           "Nyle C125A external heat pump in Single Pass Mode") \
+	PRESET(NyleC185A_SP,           "Nyle C185A external heat pump in Single Pass Mode") \
+	PRESET(NyleC250A_SP,           "Nyle C250A external heat pump in Single Pass Mode") \
+	PRESET(NyleC60A_C_SP,          "Nyle C60A external heat pump in Single Pass Mode, cold weather") \
+	PRESET(NyleC90A_C_SP,          "Nyle C90A external heat pump in Single Pass Mode, cold weather") \
+	PRESET(NyleC125A_C_SP,         "Nyle C125A external heat pump in Single Pass Mode, cold weather") \
+	PRESET(NyleC185A_C_SP,         "Nyle C185A external heat pump in Single Pass Mode, cold weather") \
+	PRESET(NyleC250A_C_SP,         "Nyle C250A external heat pump in Single Pass Mode, cold weather")
+
+#define HPWH_PRESET_INFO(model, description) { HPWH::MODELS_##model, #model, description },
+static const HPWH::PresetInfo presetTable[] = {
+	HPWH_PRESETS(HPWH_PRESET_INFO)
+};
+#undef HPWH_PRESET_INFO
+
+// names used by the test tools and older inputs
+static const struct {
+	const char *name;
+	HPWH::MODELS model;
+} presetAliases[] = {
+	{ "Voltex60",        HPWH::MODELS_AOSmithPHPT60 },
+	{ "Voltex80",        HPWH::MODELS_AOSmithPHPT80 },
+	{ "AOSmith80",       HPWH::MODELS_AOSmithPHPT80 },
+	{ "GEred",           HPWH::MODELS_GE2012 },
+	{ "GE",              HPWH::MODELS_GE2012 },
+	{ "SandenGAU",       HPWH::MODELS_Sanden80 },
+	{ "SandenGen3",      HPWH::MODELS_Sanden80 },
+	{ "SandenGES",       HPWH::MODELS_Sanden40 },
+	{ "AOSmithHPTU80DR", HPWH::MODELS_AOSmithHPTU80_DR },
+	{ "GE502014STDMode", HPWH::MODELS_GE2014STDMode },
+	{ "GE502014",        HPWH::MODELS_GE2014 },
+	{ "GE802014",        HPWH::MODELS_GE2014_80DR },
+	{ "Stiebel220e",     HPWH::MODELS_Stiebel220E },
+};
+
+namespace {
+struct PresetIndex {
+	std::vector<HPWH::PresetInfo> presets;
+	std::unordered_map<int, size_t> byModel;
+	std::unordered_map<std::string, size_t> byName;
+
+	PresetIndex() : presets(std::begin(presetTable), std::end(presetTable)) {
+		for (size_t i = 0; i < presets.size(); i++) {
+			byModel[presets[i].model] = i;
+			byName[presets[i].name] = i;
+		}
+		for (auto &alias : presetAliases) {
+			byName[alias.name] = byModel.at(alias.model);
+		}
+	}
+};
+
+const PresetIndex &presetIndex() {
+	static const PresetIndex index;
+	return index;
+}
+}
+
+const std::vector<HPWH::PresetInfo> &HPWH::getPresets() {
+	return presetIndex().presets;
+}
+
+const HPWH::PresetInfo *HPWH::findPreset(MODELS presetNum) {
+	const PresetIndex &index = presetIndex();
+	auto found = index.byModel.find(presetNum);
+	return (found == index.byModel.end()) ? NULL : &index.presets[found->second];
+}
+
+const HPWH::PresetInfo *HPWH::findPreset(const std::string &name) {
+	const PresetIndex &index = presetIndex();
+	auto found = index.byName.find(name);
+	return (found == index.byName.end()) ? NULL : &index.presets[found->second];
+}
 
 int HPWH::HPWHinit_resTank() {
 	//a default resistance tank, nominal 50 gallons, 0.95 EF, standard double 4.5 kW elements
@@ -76,7 +213,7 @@ int HPWH::HPWHinit_resTank(double tankVol_L, double energyFactor, double upperPo
 		setOfSources[0] = resistiveElementTop;
 		setOfSources[1] = resistiveElementBottom;
 
-		setOfSources[0].followedByHeatSource = &setOfSources[1];
+		setOfSources[0].followedByIndex = 1;
 	}
 	else {
 		numHeatSources = 1;
@@ -149,7 +286,7 @@ int HPWH::HPWHinit_resSwingTank(double tankVol_L, double energyFactor, double up
 		setOfSources[i].addTurnOnLogic(HPWH::topThird(deadband_C)); // replace with swing tank logic 
 	}
 	if (upperPower_W > 0.) {
-		setOfSources[0].companionHeatSource = &setOfSources[1];
+		setOfSources[0].companionIndex = 1;
 	}
 	// Recheck the heater is still valid
 	// calculate oft-used derived values
@@ -319,11 +456,11 @@ int HPWH::HPWHinit_genericHPWH(double tankVol_L, double energyFactor, double res
 
 	//and you have to do this after putting them into setOfSources, otherwise
 	//you don't get the right pointers
-	setOfSources[2].backupHeatSource = &setOfSources[1];
-	setOfSources[1].backupHeatSource = &setOfSources[2];
+	setOfSources[2].backupIndex = 1;
+	setOfSources[1].backupIndex = 2;
 
-	setOfSources[0].followedByHeatSource = &setOfSources[1];
-	setOfSources[1].followedByHeatSource = &setOfSources[2];
+	setOfSources[0].followedByIndex = 1;
+	setOfSources[1].followedByIndex = 2;
 
 
 
@@ -365,6 +502,13 @@ int HPWH::HPWHinit_presets(MODELS presetNum) {
 	// sets simHasFailed = true; this gets cleared on successful completion of init
 	// return 0 on success, HPWH_ABORT for failure
 
+	if (findPreset(presetNum) == NULL) {
+		if (hpwhVerbosity >= VRB_reluctant) {
+			msg("You have tried to select a preset model which does not exist.  \n");
+		}
+		return HPWH_ABORT;
+	}
+
 	//resistive with no UA losses for testing
 	if (presetNum == MODELS_restankNoUA) {
 		numNodes = 12;
@@ -398,7 +542,7 @@ int HPWH::HPWHinit_presets(MODELS presetNum) {
 		setOfSources[0] = resistiveElementTop;
 		setOfSources[1] = resistiveElementBottom;
 
-		setOfSources[0].followedByHeatSource = &setOfSources[1];
+		setOfSources[0].followedByIndex = 1;
 	}
 
 	//resistive tank with massive UA loss for testing
@@ -437,7 +581,7 @@ int HPWH::HPWHinit_presets(MODELS presetNum) {
 		setOfSources[0] = resistiveElementTop;
 		setOfSources[1] = resistiveElementBottom;
 
-		setOfSources[0].followedByHeatSource = &setOfSources[1];
+		setOfSources[0].followedByIndex = 1;
 
 	}
 
@@ -473,7 +617,7 @@ int HPWH::HPWHinit_presets(MODELS presetNum) {
 		setOfSources[0] = resistiveElementTop;
 		setOfSources[1] = resistiveElementBottom;
 
-		setOfSources[0].followedByHeatSource = &setOfSources[1];
+		setOfSources[0].followedByIndex = 1;
 	}
 
 	else if (presetNum == MODELS_StorageTank) {
@@ -582,11 +726,11 @@ int HPWH::HPWHinit_presets(MODELS presetNum) {
 
 		//and you have to do this after putting them into setOfSources, otherwise
 		//you don't get the right pointers
-		setOfSources[2].backupHeatSource = &setOfSources[1];
-		setOfSources[1].backupHeatSource = &setOfSources[2];
+		setOfSources[2].backupIndex = 1;
+		setOfSources[1].backupIndex = 2;
 
-		setOfSources[0].followedByHeatSource = &setOfSources[1];
-		setOfSources[1].followedByHeatSource = &setOfSources[2];
+		setOfSources[0].followedByIndex = 1;
+		setOfSources[1].followedByIndex = 2;
 
 	}
 
@@ -719,11 +863,11 @@ int HPWH::HPWHinit_presets(MODELS presetNum) {
 
 		//and you have to do this after putting them into setOfSources, otherwise
 		//you don't get the right pointers
-		setOfSources[2].backupHeatSource = &setOfSources[1];
-		setOfSources[1].backupHeatSource = &setOfSources[2];
+		setOfSources[2].backupIndex = 1;
+		setOfSources[1].backupIndex = 2;
 
-		setOfSources[0].followedByHeatSource = &setOfSources[1];
-		setOfSources[1].followedByHeatSource = &setOfSources[2];
+		setOfSources[0].followedByIndex = 1;
+		setOfSources[1].followedByIndex = 2;
 
 	}
 	else if (presetNum == MODELS_AOSmithPHPT80) {
@@ -800,11 +944,11 @@ int HPWH::HPWHinit_presets(MODELS presetNum) {
 
 		//and you have to do this after putting them into setOfSources, otherwise
 		//you don't get the right pointers
-		setOfSources[2].backupHeatSource = &setOfSources[1];
-		setOfSources[1].backupHeatSource = &setOfSources[2];
+		setOfSources[2].backupIndex = 1;
+		setOfSources[1].backupIndex = 2;
 
-		setOfSources[0].followedByHeatSource = &setOfSources[1];
-		setOfSources[1].followedByHeatSource = &setOfSources[2];
+		setOfSources[0].followedByIndex = 1;
+		setOfSources[1].followedByIndex = 2;
 
 	}
 	else if (presetNum == MODELS_GE2012) {
@@ -886,11 +1030,11 @@ int HPWH::HPWHinit_presets(MODELS presetNum) {
 
 		//and you have to do this after putting them into setOfSources, otherwise
 		//you don't get the right pointers
-		setOfSources[2].backupHeatSource = &setOfSources[1];
-		setOfSources[1].backupHeatSource = &setOfSources[2];
+		setOfSources[2].backupIndex = 1;
+		setOfSources[1].backupIndex = 2;
 
-		setOfSources[0].followedByHeatSource = &setOfSources[1];
-		setOfSources[1].followedByHeatSource = &setOfSources[2];
+		setOfSources[0].followedByIndex = 1;
+		setOfSources[1].followedByIndex = 2;
 
 	}
 	// If a Colmac single pass preset cold weather or not
@@ -1244,7 +1388,7 @@ int HPWH::HPWHinit_presets(MODELS presetNum) {
 			// Adds a bonus standby logic so the external heater does not cycle, recommended for any external heater with standby
 			std::vector<NodeWeight> nodeWeightStandby;
 			nodeWeightStandby.emplace_back(0);
-			compressor.standbyLogic = new HPWH::HeatingLogic("bottom node absolute", nodeWeightStandby, F_TO_C(113), true, std::greater<double>());
+			compressor.standbyLogic = std::make_shared<HPWH::HeatingLogic>("bottom node absolute", nodeWeightStandby, F_TO_C(113), true, std::greater<double>());
 		}
 		//lowT cutoff
 		std::vector<NodeWeight> nodeWeights1;
@@ -1324,7 +1468,7 @@ int HPWH::HPWHinit_presets(MODELS presetNum) {
 		nodeWeightStandby.emplace_back(0);
 		compressor.addTurnOnLogic(HPWH::HeatingLogic("fourth node absolute", nodeWeights, F_TO_C(113), true));
 		compressor.addTurnOnLogic(HPWH::standby(dF_TO_dC(8.2639)));
-		compressor.standbyLogic = new HPWH::HeatingLogic("bottom node absolute", nodeWeightStandby, F_TO_C(113), true, std::greater<double>());
+		compressor.standbyLogic = std::make_shared<HPWH::HeatingLogic>("bottom node absolute", nodeWeightStandby, F_TO_C(113), true, std::greater<double>());
 
 		//lowT cutoff
 		std::vector<NodeWeight> nodeWeights1;
@@ -1427,13 +1571,13 @@ int HPWH::HPWHinit_presets(MODELS presetNum) {
 
 		//and you have to do this after putting them into setOfSources, otherwise
 		//you don't get the right pointers
-		setOfSources[2].backupHeatSource = &setOfSources[1];
-		setOfSources[1].backupHeatSource = &setOfSources[2];
+		setOfSources[2].backupIndex = 1;
+		setOfSources[1].backupIndex = 2;
 
-		setOfSources[0].followedByHeatSource = &setOfSources[1];
-		setOfSources[1].followedByHeatSource = &setOfSources[2];
+		setOfSources[0].followedByIndex = 1;
+		setOfSources[1].followedByIndex = 2;
 
-		setOfSources[0].companionHeatSource = &setOfSources[2];
+		setOfSources[0].companionIndex = 2;
 
 
 	}
@@ -1534,13 +1678,13 @@ int HPWH::HPWHinit_presets(MODELS presetNum) {
 
 		//and you have to do this after putting them into setOfSources, otherwise
 		//you don't get the right pointers
-		setOfSources[2].backupHeatSource = &setOfSources[1];
-		setOfSources[1].backupHeatSource = &setOfSources[2];
+		setOfSources[2].backupIndex = 1;
+		setOfSources[1].backupIndex = 2;
 
-		setOfSources[0].followedByHeatSource = &setOfSources[1];
-		setOfSources[1].followedByHeatSource = &setOfSources[2];
+		setOfSources[0].followedByIndex = 1;
+		setOfSources[1].followedByIndex = 2;
 
-		setOfSources[0].companionHeatSource = &setOfSources[2];
+		setOfSources[0].companionIndex = 2;
 
 	}
 	else if (presetNum == MODELS_AOSmithHPTU80 || presetNum == MODELS_RheemHBDR2280 || presetNum == MODELS_RheemHBDR4580) {
@@ -1635,13 +1779,13 @@ int HPWH::HPWHinit_presets(MODELS presetNum) {
 
 		//and you have to do this after putting them into setOfSources, otherwise
 		//you don't get the right pointers
-		setOfSources[2].backupHeatSource = &setOfSources[1];
-		setOfSources[1].backupHeatSource = &setOfSources[2];
+		setOfSources[2].backupIndex = 1;
+		setOfSources[1].backupIndex = 2;
 
-		setOfSources[0].followedByHeatSource = &setOfSources[1];
-		setOfSources[1].followedByHeatSource = &setOfSources[2];
+		setOfSources[0].followedByIndex = 1;
+		setOfSources[1].followedByIndex = 2;
 
-		setOfSources[0].companionHeatSource = &setOfSources[2];
+		setOfSources[0].companionIndex = 2;
 
 	}
 	else if (presetNum == MODELS_AOSmithHPTU80_DR) {
@@ -1718,11 +1862,11 @@ int HPWH::HPWHinit_presets(MODELS presetNum) {
 
 		//and you have to do this after putting them into setOfSources, otherwise
 		//you don't get the right pointers
-		setOfSources[2].backupHeatSource = &setOfSources[1];
-		setOfSources[1].backupHeatSource = &setOfSources[2];
+		setOfSources[2].backupIndex = 1;
+		setOfSources[1].backupIndex = 2;
 
-		setOfSources[0].followedByHeatSource = &setOfSources[1];
-		setOfSources[1].followedByHeatSource = &setOfSources[2];
+		setOfSources[0].followedByIndex = 1;
+		setOfSources[1].followedByIndex = 2;
 
 	}
 	else if (presetNum == MODELS_AOSmithCAHP120) {
@@ -1807,15 +1951,15 @@ int HPWH::HPWHinit_presets(MODELS presetNum) {
 
 	//and you have to do this after putting them into setOfSources, otherwise
 	//you don't get the right pointers
-	setOfSources[2].backupHeatSource = &setOfSources[1];
-	setOfSources[1].backupHeatSource = &setOfSources[2];
+	setOfSources[2].backupIndex = 1;
+	setOfSources[1].backupIndex = 2;
 
-	setOfSources[0].followedByHeatSource = &setOfSources[1];
-	setOfSources[1].followedByHeatSource = &setOfSources[2];
-	//setOfSources[2].followedByHeatSource = &setOfSources[1];;
+	setOfSources[0].followedByIndex = 1;
+	setOfSources[1].followedByIndex = 2;
+	//setOfSources[2].followedByIndex = 1;;
 
-	setOfSources[0].companionHeatSource = &setOfSources[1];
-	setOfSources[1].companionHeatSource = &setOfSources[2];
+	setOfSources[0].companionIndex = 1;
+	setOfSources[1].companionIndex = 2;
 
 	}
 		else if (presetNum == MODELS_GE2014STDMode) {
@@ -1889,11 +2033,11 @@ int HPWH::HPWHinit_presets(MODELS presetNum) {
 
 			//and you have to do this after putting them into setOfSources, otherwise
 			//you don't get the right pointers
-			setOfSources[2].backupHeatSource = &setOfSources[1];
-			setOfSources[1].backupHeatSource = &setOfSources[2];
+			setOfSources[2].backupIndex = 1;
+			setOfSources[1].backupIndex = 2;
 
-			setOfSources[0].followedByHeatSource = &setOfSources[1];
-			setOfSources[1].followedByHeatSource = &setOfSources[2];
+			setOfSources[0].followedByIndex = 1;
+			setOfSources[1].followedByIndex = 2;
 
 	}
 	else if (presetNum == MODELS_GE2014STDMode_80) {
@@ -1963,11 +2107,11 @@ int HPWH::HPWHinit_presets(MODELS presetNum) {
 
 		//and you have to do this after putting them into setOfSources, otherwise
 		//you don't get the right pointers
-		setOfSources[2].backupHeatSource = &setOfSources[1];
-		setOfSources[1].backupHeatSource = &setOfSources[2];
+		setOfSources[2].backupIndex = 1;
+		setOfSources[1].backupIndex = 2;
 
-		setOfSources[0].followedByHeatSource = &setOfSources[1];
-		setOfSources[1].followedByHeatSource = &setOfSources[2];
+		setOfSources[0].followedByIndex = 1;
+		setOfSources[1].followedByIndex = 2;
 
 	}
 	else if (presetNum == MODELS_GE2014) {
@@ -2045,11 +2189,11 @@ int HPWH::HPWHinit_presets(MODELS presetNum) {
 
 		//and you have to do this after putting them into setOfSources, otherwise
 		//you don't get the right pointers
-		setOfSources[2].backupHeatSource = &setOfSources[1];
-		setOfSources[1].backupHeatSource = &setOfSources[2];
+		setOfSources[2].backupIndex = 1;
+		setOfSources[1].backupIndex = 2;
 
-		setOfSources[0].followedByHeatSource = &setOfSources[1];
-		setOfSources[1].followedByHeatSource = &setOfSources[2];
+		setOfSources[0].followedByIndex = 1;
+		setOfSources[1].followedByIndex = 2;
 
 	}
 	else if (presetNum == MODELS_GE2014_80) {
@@ -2127,11 +2271,11 @@ int HPWH::HPWHinit_presets(MODELS presetNum) {
 
 		//and you have to do this after putting them into setOfSources, otherwise
 		//you don't get the right pointers
-		setOfSources[2].backupHeatSource = &setOfSources[1];
-		setOfSources[1].backupHeatSource = &setOfSources[2];
+		setOfSources[2].backupIndex = 1;
+		setOfSources[1].backupIndex = 2;
 
-		setOfSources[0].followedByHeatSource = &setOfSources[1];
-		setOfSources[1].followedByHeatSource = &setOfSources[2];
+		setOfSources[0].followedByIndex = 1;
+		setOfSources[1].followedByIndex = 2;
 
 	}
 	else if (presetNum == MODELS_GE2014_80DR) {
@@ -2210,11 +2354,11 @@ int HPWH::HPWHinit_presets(MODELS presetNum) {
 
 		//and you have to do this after putting them into setOfSources, otherwise
 		//you don't get the right pointers
-		setOfSources[2].backupHeatSource = &setOfSources[1];
-		setOfSources[1].backupHeatSource = &setOfSources[2];
+		setOfSources[2].backupIndex = 1;
+		setOfSources[1].backupIndex = 2;
 
-		setOfSources[0].followedByHeatSource = &setOfSources[1];
-		setOfSources[1].followedByHeatSource = &setOfSources[2];
+		setOfSources[0].followedByIndex = 1;
+		setOfSources[1].followedByIndex = 2;
 
 	}
 	// PRESET USING GE2014 DATA 
@@ -2293,8 +2437,8 @@ int HPWH::HPWHinit_presets(MODELS presetNum) {
 
 		//and you have to do this after putting them into setOfSources, otherwise
 		//you don't get the right pointers
-		setOfSources[2].backupHeatSource = &setOfSources[1];
-		setOfSources[1].backupHeatSource = &setOfSources[2];
+		setOfSources[2].backupIndex = 1;
+		setOfSources[1].backupIndex = 2;
 
 	}
 	// If Rheem Premium
@@ -2381,13 +2525,13 @@ int HPWH::HPWHinit_presets(MODELS presetNum) {
 
 		//and you have to do this after putting them into setOfSources, otherwise
 		//you don't get the right pointers
-		setOfSources[1].backupHeatSource = &setOfSources[2];
-		setOfSources[2].backupHeatSource = &setOfSources[1];
+		setOfSources[1].backupIndex = 2;
+		setOfSources[2].backupIndex = 1;
 
-		setOfSources[0].followedByHeatSource = &setOfSources[2];
-		setOfSources[1].followedByHeatSource = &setOfSources[2];
+		setOfSources[0].followedByIndex = 2;
+		setOfSources[1].followedByIndex = 2;
 
-		setOfSources[0].companionHeatSource = &setOfSources[2];
+		setOfSources[0].companionIndex = 2;
 	}
 
 	// If Rheem Build
@@ -2475,13 +2619,13 @@ int HPWH::HPWHinit_presets(MODELS presetNum) {
 
 		//and you have to do this after putting them into setOfSources, otherwise
 		//you don't get the right pointers
-		setOfSources[1].backupHeatSource = &setOfSources[2];
-		setOfSources[2].backupHeatSource = &setOfSources[1];
+		setOfSources[1].backupIndex = 2;
+		setOfSources[2].backupIndex = 1;
 
-		setOfSources[0].followedByHeatSource = &setOfSources[2];
-		setOfSources[1].followedByHeatSource = &setOfSources[2];
+		setOfSources[0].followedByIndex = 2;
+		setOfSources[1].followedByIndex = 2;
 
-		setOfSources[0].companionHeatSource = &setOfSources[2];
+		setOfSources[0].companionIndex = 2;
 	}
 
 	else if (presetNum == MODELS_RheemHB50) {
@@ -2558,11 +2702,11 @@ int HPWH::HPWHinit_presets(MODELS presetNum) {
 
 		//and you have to do this after putting them into setOfSources, otherwise
 		//you don't get the right pointers
-		setOfSources[2].backupHeatSource = &setOfSources[1];
-		setOfSources[1].backupHeatSource = &setOfSources[2];
+		setOfSources[2].backupIndex = 1;
+		setOfSources[1].backupIndex = 2;
 
-		setOfSources[0].followedByHeatSource = &setOfSources[1];
-		setOfSources[1].followedByHeatSource = &setOfSources[2];
+		setOfSources[0].followedByIndex = 1;
+		setOfSources[1].followedByIndex = 2;
 
 	}
 	else if (presetNum == MODELS_Stiebel220E) {
@@ -2623,7 +2767,7 @@ int HPWH::HPWHinit_presets(MODELS presetNum) {
 
 		//and you have to do this after putting them into setOfSources, otherwise
 		//you don't get the right pointers
-		setOfSources[0].backupHeatSource = &setOfSources[1];
+		setOfSources[0].backupIndex = 1;
 
 	}
 	else if (presetNum == MODELS_Generic1) {
@@ -2692,11 +2836,11 @@ int HPWH::HPWHinit_presets(MODELS presetNum) {
 		setOfSources[1] = resistiveElementBottom;
 		setOfSources[2] = compressor;
 
-		setOfSources[2].backupHeatSource = &setOfSources[1];
-		setOfSources[1].backupHeatSource = &setOfSources[2];
+		setOfSources[2].backupIndex = 1;
+		setOfSources[1].backupIndex = 2;
 
-		setOfSources[0].followedByHeatSource = &setOfSources[1];
-		setOfSources[1].followedByHeatSource = &setOfSources[2];
+		setOfSources[0].followedByIndex = 1;
+		setOfSources[1].followedByIndex = 2;
 
 	}
 	else if (presetNum == MODELS_Generic2) {
@@ -2769,11 +2913,11 @@ int HPWH::HPWHinit_presets(MODELS presetNum) {
 
 		//and you have to do this after putting them into setOfSources, otherwise
 		//you don't get the right pointers
-		setOfSources[2].backupHeatSource = &setOfSources[1];
-		setOfSources[1].backupHeatSource = &setOfSources[2];
+		setOfSources[2].backupIndex = 1;
+		setOfSources[1].backupIndex = 2;
 
-		setOfSources[0].followedByHeatSource = &setOfSources[1];
-		setOfSources[1].followedByHeatSource = &setOfSources[2];
+		setOfSources[0].followedByIndex = 1;
+		setOfSources[1].followedByIndex = 2;
 
 	}
 	else if (presetNum == MODELS_Generic3) {
@@ -2848,11 +2992,11 @@ int HPWH::HPWHinit_presets(MODELS presetNum) {
 
 		//and you have to do this after putting them into setOfSources, otherwise
 		//you don't get the right pointers
-		setOfSources[2].backupHeatSource = &setOfSources[1];
-		setOfSources[1].backupHeatSource = &setOfSources[2];
+		setOfSources[2].backupIndex = 1;
+		setOfSources[1].backupIndex = 2;
 
-		setOfSources[0].followedByHeatSource = &setOfSources[1];
-		setOfSources[1].followedByHeatSource = &setOfSources[2];
+		setOfSources[0].followedByIndex = 1;
+		setOfSources[1].followedByIndex = 2;
 
 	}
 	else if (presetNum == MODELS_UEF2generic) {
@@ -2925,11 +3069,11 @@ int HPWH::HPWHinit_presets(MODELS presetNum) {
 
 		//and you have to do this after putting them into setOfSources, otherwise
 		//you don't get the right pointers
-		setOfSources[2].backupHeatSource = &setOfSources[1];
-		setOfSources[1].backupHeatSource = &setOfSources[2];
+		setOfSources[2].backupIndex = 1;
+		setOfSources[1].backupIndex = 2;
 
-		setOfSources[0].followedByHeatSource = &setOfSources[1];
-		setOfSources[1].followedByHeatSource = &setOfSources[2];
+		setOfSources[0].followedByIndex = 1;
+		setOfSources[1].followedByIndex = 2;
 
 	}
 	else if (MODELS_AWHSTier3Generic40 <= presetNum && presetNum <= MODELS_AWHSTier3Generic80) {
@@ -3025,11 +3169,11 @@ int HPWH::HPWHinit_presets(MODELS presetNum) {
 
 		//and you have to do this after putting them into setOfSources, otherwise
 		//you don't get the right pointers
-		setOfSources[2].backupHeatSource = &setOfSources[1];
-		setOfSources[1].backupHeatSource = &setOfSources[2];
+		setOfSources[2].backupIndex = 1;
+		setOfSources[1].backupIndex = 2;
 
-		setOfSources[0].followedByHeatSource = &setOfSources[1];
-		setOfSources[1].followedByHeatSource = &setOfSources[2];
+		setOfSources[0].followedByIndex = 1;
+		setOfSources[1].followedByIndex = 2;
 	}
 	// If a the model is the TamOMatic, HotTam, Generic... This model is scalable. 
 	else if (presetNum == MODELS_TamScalable_SP) {
@@ -3103,13 +3247,13 @@ int HPWH::HPWHinit_presets(MODELS presetNum) {
 
 		//and you have to do this after putting them into setOfSources, otherwise
 		//you don't get the right pointers
-		setOfSources[2].backupHeatSource = &setOfSources[1];
-		setOfSources[1].backupHeatSource = &setOfSources[2];
+		setOfSources[2].backupIndex = 1;
+		setOfSources[1].backupIndex = 2;
 
-		setOfSources[0].followedByHeatSource = &setOfSources[1];
-		setOfSources[1].followedByHeatSource = &setOfSources[2];
+		setOfSources[0].followedByIndex = 1;
+		setOfSources[1].followedByIndex = 2;
 
-		setOfSources[0].companionHeatSource = &setOfSources[2];
+		setOfSources[0].companionIndex = 2;
 	}
 
 	else {
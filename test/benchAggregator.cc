@@ -0,0 +1,105 @@
+/*Benchmark for the fleet aggregator: a fleet of the test models with shifted draws runs a few days
+ * with fleet totals every minute, once per thread count, and once stepped tank by tank through
+ * the whole run without totals, for what aggregating every minute costs.  Reports the wall time,
+ * the time spent adding block sums, and a checksum of the totals in hex, which must be the same
+ * for every thread count.
+ *
+ * Usage: benchAggregator [tanks (optional)] [days (optional)] [thread counts (optional)]
+ */
+#include "HPWH.hh"
+#include "HPWHAggregator.hh"
+#include "testUtilityFcts.cc"
+
+#include <thread>
+
+using std::cout;
+using std::string;
+
+const std::vector<string> modelNames = { "AOSmithHPTU80", "Rheem2020Prem50", "GE502014", "restankRealistic" };
+
+int main(int argc, char *argv[])
+{
+	int numTanks = (argc > 1) ? atoi(argv[1]) : 4096;
+	int days = (argc > 2) ? atoi(argv[2]) : 1;
+	std::vector<int> threadCounts;
+	for (int a = 3; a < argc; a++) {
+		threadCounts.push_back(atoi(argv[a]));
+	}
+	if (threadCounts.empty()) {
+		threadCounts = { 1, 2, std::max(1, (int)std::thread::hardware_concurrency()) };
+	}
+	const long steps = days * 1440L;
+
+	std::vector<schedule> allSchedules;
+	long minutesToRun;
+	double newSetpoint;
+	if (readTestSchedules("testDOE_24hr50", allSchedules, minutesToRun, newSetpoint) != 0) {
+		cout << "Could not read testDOE_24hr50\n";
+		exit(1);
+	}
+	std::vector<double> inletT_C(steps), ambientT_C(steps), evaporatorT_C(steps);
+	std::vector<std::vector<double> > drawVolume_L(numTanks, std::vector<double>(steps));
+	for (long s = 0; s < steps; s++) {
+		inletT_C[s] = allSchedules[0][s % minutesToRun];
+		ambientT_C[s] = allSchedules[2][s % minutesToRun];
+		evaporatorT_C[s] = allSchedules[3][s % minutesToRun];
+		for (int t = 0; t < numTanks; t++) {
+			drawVolume_L[t][s] = GAL_TO_L(allSchedules[1][(s + 37 * t) % minutesToRun]);
+		}
+	}
+	std::vector<HPWH> prototypes(modelNames.size());
+	for (size_t m = 0; m < modelNames.size(); m++) {
+		getHPWHObject(prototypes[m], modelNames[m]);
+	}
+	auto makeFleet = [&](std::vector<HPWH> &hpwhs, std::vector<HPWHAggregator::Tank> &tanks) {
+		hpwhs.resize(numTanks);
+		tanks.resize(numTanks);
+		for (int t = 0; t < numTanks; t++) {
+			hpwhs[t] = prototypes[t % prototypes.size()];
+			tanks[t].hpwh = &hpwhs[t];
+			tanks[t].inputs.inletT_C = inletT_C.data();
+			tanks[t].inputs.drawVolume_L = drawVolume_L[t].data();
+			tanks[t].inputs.tankAmbientT_C = ambientT_C.data();
+			tanks[t].inputs.heatSourceAmbientT_C = evaporatorT_C.data();
+		}
+	};
+
+	printf("method,tanks,steps,threads,seconds,tankStepsPerSecond,reduceSeconds,checksum\n");
+	{
+		std::vector<HPWH> hpwhs;
+		std::vector<HPWHAggregator::Tank> tanks;
+		makeFleet(hpwhs, tanks);
+		benchClock::time_point start = benchClock::now();
+		for (HPWHAggregator::Tank &tank : tanks) {
+			tank.hpwh->runNSteps((int)steps, tank.inputs);
+		}
+		double seconds = secondsSince(start);
+		printf("noTotals,%d,%ld,1,%.3f,%.0f,0,\n", numTanks, steps, seconds, numTanks * steps / seconds);
+	}
+
+	for (int threads : threadCounts) {
+		std::vector<HPWH> hpwhs;
+		std::vector<HPWHAggregator::Tank> tanks;
+		makeFleet(hpwhs, tanks);
+		HPWHAggregator aggregator;
+		aggregator.setNumThreads(threads);
+		double checksum = 0.;
+		long heating = 0;
+		benchClock::time_point start = benchClock::now();
+		if (aggregator.run(tanks, steps, [&](long, const HPWHAggregator::Totals &totals) {
+			for (int type = 0; type < HPWHAggregator::NUM_TYPES; type++) {
+				checksum += totals.energyInput_kWh[type] + totals.energyOutput_kWh[type];
+			}
+			checksum += totals.standbyLosses_kWh;
+			heating += totals.tanksHeating;
+			return 0;
+		}) != 0) {
+			cout << "Tank " << aggregator.getFailedTank() << " failed\n";
+			exit(1);
+		}
+		double seconds = secondsSince(start);
+		printf("minuteTotals,%d,%ld,%d,%.3f,%.0f,%.4f,%a/%ld\n", numTanks, steps, threads, seconds,
+			numTanks * steps / seconds, aggregator.getReduceSeconds(), checksum, heating);
+	}
+	return 0;
+}
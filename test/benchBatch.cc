@@ -0,0 +1,158 @@
+/*Benchmark for the work stealing batch runner on the yearly tests, yearTests by yearTestsModels.
+ * Each thread count runs the batch twice, statically partitioned with the jobs dealt out in turn
+ * to plain threads, and with HPWHBatch, and reports the wall time and the utilization of each
+ * worker.
+ *
+ * Usage: benchBatch [thread counts (optional)]
+ */
+#include "HPWH.hh"
+#include "HPWHBatch.hh"
+#include "testUtilityFcts.cc"
+
+#include <thread>
+
+using std::cout;
+using std::string;
+
+struct YearInputs {
+	string testName;
+	std::vector<schedule> schedules;   // inletT, draw (L), ambientT, evaporatorT
+	std::vector<HPWH::DRMODES> DRstatus;
+	HPWH::StepInputs stepInputs() {
+		HPWH::StepInputs in;
+		in.inletT_C = schedules[0].data();
+		in.drawVolume_L = schedules[1].data();
+		in.tankAmbientT_C = schedules[2].data();
+		in.heatSourceAmbientT_C = schedules[3].data();
+		in.DRstatus = DRstatus.data();
+		return in;
+	}
+};
+
+int readYear(YearInputs &year, long minutes) {
+	const char *names[] = { "inletT", "draw", "ambientT", "evaporatorT", "DR" };
+	year.schedules.assign(5, schedule());
+	for (int i = 0; i < 5; i++) {
+		if (readSchedule(year.schedules[i], year.testName + "/" + names[i] + "schedule.csv", minutes) != 0) {
+			return 1;
+		}
+	}
+	for (double &draw : year.schedules[1]) {
+		draw = GAL_TO_L(draw);
+	}
+	for (double DR : year.schedules[4]) {
+		year.DRstatus.push_back(static_cast<HPWH::DRMODES>(int(DR)));
+	}
+	return 0;
+}
+
+void printUtilization(const char *label, int threads, double seconds, const std::vector<double> &busySeconds) {
+	double total = 0.;
+	printf("%s,%d,%.3f", label, threads, seconds);
+	for (double busy : busySeconds) {
+		total += busy;
+	}
+	printf(",%.3f,", total / (threads * seconds));
+	for (size_t w = 0; w < busySeconds.size(); w++) {
+		printf("%s%.2f", (w > 0) ? " " : "", busySeconds[w] / seconds);
+	}
+	printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+	const long minutes = 525600;
+	std::vector<string> yearTests = { "testCA_3BR_CTZ15", "testCA_3BR_CTZ16" };
+	std::vector<string> yearModels = { "AOSmithHPTU80", "Sanden80", "GE502014", "Rheem2020Prem40", "Rheem2020Prem50",
+		"Rheem2020Build50", "AOSmithCAHP120", "AWHSTier3Generic80" };
+
+	std::vector<int> threadCounts;
+	for (int a = 1; a < argc; a++) {
+		threadCounts.push_back(atoi(argv[a]));
+	}
+	if (threadCounts.empty()) {
+		threadCounts.push_back(1);
+		threadCounts.push_back(std::max(1, (int)std::thread::hardware_concurrency()));
+	}
+
+	// the schedules of each test, read once
+	std::vector<std::pair<string, string> > matrix;
+	std::vector<YearInputs> years(yearTests.size());
+	for (size_t t = 0; t < yearTests.size(); t++) {
+		years[t].testName = yearTests[t];
+		if (readYear(years[t], minutes) != 0) {
+			cout << "Could not read " << yearTests[t] << "\n";
+			exit(1);
+		}
+		for (const string &model : yearModels) {
+			matrix.push_back(std::make_pair(yearTests[t], model));
+		}
+	}
+	auto inputsFor = [&](const string &test) -> YearInputs & {
+		for (YearInputs &year : years) {
+			if (year.testName == test) return year;
+		}
+		return years[0];
+	};
+
+	printf("scheduler,threads,seconds,utilization,workerUtilization\n");
+	for (int threads : threadCounts) {
+		std::vector<HPWH> tanks(matrix.size());
+		for (size_t j = 0; j < matrix.size(); j++) {
+			if (getHPWHObject(tanks[j], matrix[j].second) != 0) {
+				cout << "Could not set up " << matrix[j].second << "\n";
+				exit(1);
+			}
+		}
+
+		// static partition, each thread runs its share of the jobs start to finish
+		std::vector<HPWH> staticTanks(tanks);
+		std::vector<double> busySeconds(threads, 0.);
+		benchClock::time_point start = benchClock::now();
+		std::vector<std::thread> pool;
+		for (int t = 0; t < threads; t++) {
+			pool.push_back(std::thread([&, t]() {
+				benchClock::time_point workerStart = benchClock::now();
+				for (size_t j = t; j < matrix.size(); j += threads) {
+					staticTanks[j].runNSteps(minutes, inputsFor(matrix[j].first).stepInputs());
+				}
+				busySeconds[t] = secondsSince(workerStart);
+			}));
+		}
+		for (auto &thread : pool) {
+			thread.join();
+		}
+		printUtilization("static", threads, secondsSince(start), busySeconds);
+
+		// work stealing
+		std::vector<HPWHBatch::Job> jobs(matrix.size());
+		for (size_t j = 0; j < matrix.size(); j++) {
+			jobs[j].hpwh = &tanks[j];
+			jobs[j].steps = minutes;
+			jobs[j].runChunk = HPWHBatch::runNStepsChunks(inputsFor(matrix[j].first).stepInputs());
+		}
+		HPWHBatch batch;
+		batch.setNumThreads(threads);
+		if (batch.run(jobs) != 0) {
+			cout << "A batch job failed\n";
+			exit(1);
+		}
+		busySeconds.clear();
+		long steals = 0;
+		for (const HPWHBatch::WorkerStats &stats : batch.getWorkerStats()) {
+			busySeconds.push_back(stats.busySeconds);
+			steals += stats.steals;
+		}
+		printUtilization("stealing", threads, batch.getWallSeconds(), busySeconds);
+
+		// both ran the same years
+		for (size_t j = 0; j < matrix.size(); j++) {
+			if (tanks[j].getTankNodeTemp(0) != staticTanks[j].getTankNodeTemp(0)) {
+				cout << "The runs differ for " << matrix[j].first << " " << matrix[j].second << "\n";
+				exit(1);
+			}
+		}
+		cout << steals << " steals\n";
+	}
+	return 0;
+}
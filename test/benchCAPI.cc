@@ -0,0 +1,124 @@
+/*Benchmark for the C interface: a fleet of tanks for some days, stepped the chatty way, one
+ * runOneStep and a getter per output for each tank and minute as a host marshalling every step
+ * would, and in one hpwh_fleet_step call writing every output to arrays.  Reports tank steps
+ * per second and the heap allocations made inside each.
+ *
+ * Usage: benchCAPI [tanks (optional)] [days (optional)]
+ */
+#include "HPWH.hh"
+#include "HPWHcapi.h"
+#include "testUtilityFcts.cc"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+using std::cout;
+using std::string;
+
+// every allocation of the process, to count those made while stepping
+static std::atomic<long> allocations(0);
+
+void *operator new(size_t size) {
+	allocations++;
+	void *p = malloc(size == 0 ? 1 : size);
+	if (p == NULL) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void operator delete(void *p) noexcept {
+	free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+	free(p);
+}
+
+int main(int argc, char *argv[])
+{
+	int tanks = (argc > 1) ? atoi(argv[1]) : 200;
+	int days = (argc > 2) ? atoi(argv[2]) : 7;
+	const int numSteps = days * 1440;
+
+	std::vector<schedule> allSchedules;
+	long minutesToRun;
+	double newSetpoint;
+	if (readTestSchedules("testDOE_24hr50", allSchedules, minutesToRun, newSetpoint) != 0) {
+		cout << "Could not read testDOE_24hr50\n";
+		exit(1);
+	}
+	std::vector<double> inletT_C(numSteps), ambientT_C(numSteps), evaporatorT_C(numSteps);
+	std::vector<double> drawVolume_L((size_t)tanks * numSteps);
+	for (int s = 0; s < numSteps; s++) {
+		inletT_C[s] = allSchedules[0][s % minutesToRun];
+		ambientT_C[s] = allSchedules[2][s % minutesToRun];
+		evaporatorT_C[s] = allSchedules[3][s % minutesToRun];
+		for (int t = 0; t < tanks; t++) {
+			drawVolume_L[(size_t)t * numSteps + s] = GAL_TO_L(allSchedules[1][(s + 37 * t) % minutesToRun]);
+		}
+	}
+	size_t values = (size_t)tanks * numSteps;
+	std::vector<double> outletT_C(values), standby_kWh(values), environment_kWh(values), heatContent_kJ(values),
+		energyInput_kWh(values), heatIn_kWh(values * HPWH_C_HEAT_SOURCES), heatOut_kWh(values * HPWH_C_HEAT_SOURCES),
+		runTime_min(values * HPWH_C_HEAT_SOURCES), tcouples_C(values * HPWH_C_TCOUPLES);
+
+	printf("method,tanks,steps,seconds,tankStepsPerSecond,allocations\n");
+
+	// the class, a call per step and per output
+	{
+		std::vector<HPWH> hpwhs(tanks);
+		for (HPWH &hpwh : hpwhs) {
+			getHPWHObject(hpwh, "AOSmithHPTU80");
+		}
+		long before = allocations;
+		benchClock::time_point start = benchClock::now();
+		for (int t = 0; t < tanks; t++) {
+			HPWH &hpwh = hpwhs[t];
+			for (int s = 0; s < numSteps; s++) {
+				size_t i = (size_t)t * numSteps + s;
+				hpwh.runOneStep(inletT_C[s], drawVolume_L[i], ambientT_C[s], evaporatorT_C[s], HPWH::DR_ALLOW);
+				outletT_C[i] = hpwh.getOutletTemp();
+				standby_kWh[i] = hpwh.getStandbyLosses();
+				environment_kWh[i] = hpwh.getEnergyRemovedFromEnvironment();
+				heatContent_kJ[i] = hpwh.getTankHeatContent_kJ();
+				energyInput_kWh[i] = 0.;
+				for (int j = 0; j < hpwh.getNumHeatSources(); j++) {
+					heatIn_kWh[i * HPWH_C_HEAT_SOURCES + j] = hpwh.getNthHeatSourceEnergyInput(j);
+					heatOut_kWh[i * HPWH_C_HEAT_SOURCES + j] = hpwh.getNthHeatSourceEnergyOutput(j);
+					runTime_min[i * HPWH_C_HEAT_SOURCES + j] = hpwh.getNthHeatSourceRunTime(j);
+					energyInput_kWh[i] += heatIn_kWh[i * HPWH_C_HEAT_SOURCES + j];
+				}
+				for (int k = 0; k < HPWH_C_TCOUPLES; k++) {
+					tcouples_C[i * HPWH_C_TCOUPLES + k] = hpwh.getNthSimTcouple(k + 1, HPWH_C_TCOUPLES);
+				}
+			}
+		}
+		double seconds = secondsSince(start);
+		printf("perStep,%d,%d,%.3f,%.0f,%ld\n", tanks, numSteps, seconds, values / seconds, allocations - before);
+	}
+
+	// the fleet, one call
+	{
+		HPWHFleet *fleet = hpwh_fleet_create();
+		if (hpwh_fleet_add_preset(fleet, "AOSmithHPTU80", tanks, NULL) != 0) {
+			cout << hpwh_fleet_error(fleet) << "\n";
+			exit(1);
+		}
+		HPWHStepInputs inputs = { inletT_C.data(), drawVolume_L.data(), ambientT_C.data(), evaporatorT_C.data(), NULL,
+			HPWH_C_SHARED_INLET | HPWH_C_SHARED_AMBIENT | HPWH_C_SHARED_EVAPORATOR };
+		HPWHStepOutputs outputs = { outletT_C.data(), standby_kWh.data(), environment_kWh.data(), heatContent_kJ.data(),
+			energyInput_kWh.data(), heatIn_kWh.data(), heatOut_kWh.data(), runTime_min.data(), tcouples_C.data() };
+		long before = allocations;
+		benchClock::time_point start = benchClock::now();
+		if (hpwh_fleet_step(fleet, 0, tanks, numSteps, &inputs, &outputs) != 0) {
+			cout << hpwh_fleet_error(fleet) << "\n";
+			exit(1);
+		}
+		double seconds = secondsSince(start);
+		printf("fleetStep,%d,%d,%.3f,%.0f,%ld\n", tanks, numSteps, seconds, values / seconds, allocations - before);
+		hpwh_fleet_destroy(fleet);
+	}
+	return 0;
+}
@@ -0,0 +1,70 @@
+/*Benchmark for cloning warmed up HPWHs: copy construction, assignment into a HPWH of the
+ * same model, and restoring a HPWH::SimState, in clones per second.
+ *
+ * Usage: benchCopyHPWH [model presets (optional)]
+ */
+#include "HPWH.hh"
+#include "testUtilityFcts.cc"
+
+using std::cout;
+using std::string;
+
+int main(int argc, char *argv[])
+{
+	std::vector<string> modelNames = { "AOSmithHPTU80", "Sanden80", "GE502014", "Rheem2020Prem50", "ColmacCxA_20_SP" };
+	if (argc > 1) {
+		modelNames.assign(argv + 1, argv + argc);
+	}
+	const long clones = 200000;
+
+	printf("model,copyConstructPerSecond,assignPerSecond,simStatePerSecond,stepsPerSecond\n");
+	for (string &modelName : modelNames) {
+		HPWH hpwh;
+		if (getHPWHObject(hpwh, modelName) != 0) {
+			cout << "Could not set up " << modelName << "\n";
+			exit(1);
+		}
+		// warm up with a draw so the tank is stratified and heating
+		for (int i = 0; i < 60; i++) {
+			hpwh.runOneStep(10., (i < 10) ? 10. : 0., 20., 20., HPWH::DR_ALLOW);
+		}
+
+		double check = 0.;
+		benchClock::time_point start = benchClock::now();
+		for (long i = 0; i < clones; i++) {
+			HPWH clone(hpwh);
+			check += clone.getTankNodeTemp(0);
+		}
+		double copyRate = clones / secondsSince(start);
+
+		HPWH target(hpwh);
+		start = benchClock::now();
+		for (long i = 0; i < clones; i++) {
+			target = hpwh;
+			check += target.getTankNodeTemp(0);
+		}
+		double assignRate = clones / secondsSince(start);
+
+		HPWH::SimState state;
+		start = benchClock::now();
+		for (long i = 0; i < clones; i++) {
+			hpwh.getSimState(state);
+			target.setSimState(state);
+			check += target.getTankNodeTemp(0);
+		}
+		double stateRate = clones / secondsSince(start);
+
+		// a step of the tank, for scale
+		start = benchClock::now();
+		for (long i = 0; i < clones; i++) {
+			target.runOneStep(10., (i % 60 < 5) ? 5. : 0., 20., 20., HPWH::DR_ALLOW);
+		}
+		double stepRate = clones / secondsSince(start);
+
+		printf("%s,%.3e,%.3e,%.3e,%.3e\n", modelName.c_str(), copyRate, assignRate, stateRate, stepRate);
+		if (check == 0.) {
+			cout << "\n";
+		}
+	}
+	return 0;
+}
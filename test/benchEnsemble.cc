@@ -0,0 +1,80 @@
+/*Benchmark for the draw schedule ensemble: a year of testCA_3BR_CTZ15 with its draws resampled,
+ * for N and then 2N realizations at each thread count.  Reports realizations per second and the
+ * peak resident memory, which should not grow with the realizations.
+ *
+ * Usage: benchEnsemble [model (optional)] [N (optional)] [thread counts (optional)]
+ */
+#include "HPWH.hh"
+#include "HPWHEnsemble.hh"
+#include "testUtilityFcts.cc"
+
+#include <thread>
+#include <sys/resource.h>
+
+using std::cout;
+using std::string;
+
+long maxResident_kB() {
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+int main(int argc, char *argv[])
+{
+	const string testName = "testCA_3BR_CTZ15";
+	const long minutes = 525600;
+	string modelName = (argc > 1) ? argv[1] : "AOSmithHPTU80";
+	long N = (argc > 2) ? atol(argv[2]) : 16;
+	std::vector<int> threadCounts;
+	for (int a = 3; a < argc; a++) {
+		threadCounts.push_back(atoi(argv[a]));
+	}
+	if (threadCounts.empty()) {
+		threadCounts.push_back(1);
+		threadCounts.push_back(std::max(1, (int)std::thread::hardware_concurrency()));
+	}
+
+	const char *names[] = { "inletT", "draw", "ambientT", "evaporatorT", "DR" };
+	std::vector<schedule> schedules(5);
+	for (int i = 0; i < 5; i++) {
+		if (readSchedule(schedules[i], testName + "/" + names[i] + "schedule.csv", minutes) != 0) {
+			cout << "Could not read " << testName << "\n";
+			exit(1);
+		}
+	}
+	std::vector<double> baseDraws_L;
+	for (double draw : schedules[1]) {
+		baseDraws_L.push_back(GAL_TO_L(draw));
+	}
+	std::vector<HPWH::DRMODES> DRstatus;
+	for (double DR : schedules[4]) {
+		DRstatus.push_back(static_cast<HPWH::DRMODES>(int(DR)));
+	}
+	HPWH::StepInputs inputs;
+	inputs.inletT_C = schedules[0].data();
+	inputs.tankAmbientT_C = schedules[2].data();
+	inputs.heatSourceAmbientT_C = schedules[3].data();
+	inputs.DRstatus = DRstatus.data();
+
+	HPWHEnsemble ensemble([modelName](HPWH &hpwh) { return getHPWHObject(hpwh, modelName); });
+	HPWHEnsemble::DrawGenerator draws = HPWHEnsemble::resampledDays(baseDraws_L, 2023);
+
+	printf("threads,realizations,seconds,realizationsPerSecond,maxResident_kB,"
+		"energyMean_kWh,energyP95_kWh,belowComfortMean_min,peakDemandP95_kW\n");
+	for (int threads : threadCounts) {
+		ensemble.setNumThreads(threads);
+		for (long realizations : { N, 2 * N }) {
+			benchClock::time_point start = benchClock::now();
+			if (ensemble.run(realizations, minutes, inputs, draws) != 0) {
+				cout << "The ensemble failed\n";
+				exit(1);
+			}
+			double seconds = secondsSince(start);
+			printf("%d,%ld,%.3f,%.2f,%ld,%.1f,%.1f,%.1f,%.3f\n", threads, realizations, seconds, realizations / seconds,
+				maxResident_kB(), ensemble.getEnergyInput().getMean(), ensemble.getEnergyInput().getQuantile(2),
+				ensemble.getMinutesBelowComfort().getMean(), ensemble.getPeakDemand().getQuantile(2));
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,42 @@
+/*Benchmark for the HPWHinit_file parser: loads every model file in turn, many times over, and
+ * reports loads per second for each file and for the set.
+ *
+ * Usage: benchFileParser [rounds (optional)] [model files (optional)]
+ */
+#include "HPWH.hh"
+#include "testUtilityFcts.cc"
+
+using std::cout;
+using std::string;
+
+int main(int argc, char *argv[])
+{
+	long rounds = (argc > 1) ? atol(argv[1]) : 10000;
+	std::vector<string> modelFiles = { "AOSmithHPTU80.txt", "AOSmithPHPT60.txt", "GE502014.txt", "Rheem2020Build50.txt",
+		"Rheem2020Prem40.txt", "Rheem2020Prem50.txt", "RheemHB50.txt", "Sanden80.txt", "Stiebel220e.txt" };
+	if (argc > 2) {
+		modelFiles.assign(argv + 2, argv + argc);
+	}
+	std::vector<double> seconds(modelFiles.size(), 0.);
+
+	HPWH hpwh;
+	benchClock::time_point allStart = benchClock::now();
+	for (long r = 0; r < rounds; r++) {
+		for (size_t f = 0; f < modelFiles.size(); f++) {
+			benchClock::time_point start = benchClock::now();
+			if (hpwh.HPWHinit_file(modelFiles[f]) != 0) {
+				cout << "Could not load " << modelFiles[f] << "\n";
+				exit(1);
+			}
+			seconds[f] += secondsSince(start);
+		}
+	}
+	double allSeconds = secondsSince(allStart);
+
+	printf("model,loadsPerSecond\n");
+	for (size_t f = 0; f < modelFiles.size(); f++) {
+		printf("%s,%.3e\n", modelFiles[f].c_str(), rounds / seconds[f]);
+	}
+	printf("all,%.3e\n", rounds * modelFiles.size() / allSeconds);
+	return 0;
+}
@@ -0,0 +1,123 @@
+/*Benchmark for the flyweight HPWHModel and HPWHState: the memory of one tank of each preset
+ * as a full HPWH and as a HPWHState, and the time to step a fleet both ways.
+ *
+ * Usage: benchFlyweight [fleet size (optional)]
+ */
+#include "HPWH.hh"
+#include "HPWHModel.hh"
+#include "testUtilityFcts.cc"
+
+#include <cstdlib>
+#include <new>
+
+using std::cout;
+using std::string;
+
+// count the heap in use, by keeping each allocation's size in front of it
+static long long heapBytes = 0;
+static const size_t HEADER = 16;
+
+void *operator new(size_t size) {
+	char *p = static_cast<char *>(malloc(size + HEADER));
+	if (p == NULL) {
+		throw std::bad_alloc();
+	}
+	*reinterpret_cast<size_t *>(p) = size;
+	heapBytes += size;
+	return p + HEADER;
+}
+
+void operator delete(void *ptr) noexcept {
+	if (ptr != NULL) {
+		char *p = static_cast<char *>(ptr) - HEADER;
+		heapBytes -= *reinterpret_cast<size_t *>(p);
+		free(p);
+	}
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete[](void *ptr) noexcept { operator delete(ptr); }
+void operator delete(void *ptr, size_t) noexcept { operator delete(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { operator delete(ptr); }
+
+int main(int argc, char *argv[])
+{
+	int fleetSize = (argc > 1) ? std::stoi(argv[1]) : 1000;
+
+	printf("preset,nodes,heatSources,bytesFullHPWH,bytesHPWHState,ratio\n");
+	for (int preset = 1; preset < 1000; preset++) {
+		long long before = heapBytes;
+		HPWH *hpwh = new HPWH;
+		if (hpwh->HPWHinit_presets(static_cast<HPWH::MODELS>(preset)) != 0) {
+			delete hpwh;
+			continue;
+		}
+		long long fullBytes = heapBytes - before;
+		int nodes = hpwh->getNumNodes(), sources = hpwh->getNumHeatSources();
+		delete hpwh;
+
+		std::shared_ptr<HPWHModel> model = std::make_shared<HPWHModel>();
+		model->init([preset](HPWH &h) { return h.HPWHinit_presets(static_cast<HPWH::MODELS>(preset)); });
+		before = heapBytes;
+		HPWHState *state = new HPWHState(model);
+		long long stateBytes = heapBytes - before;
+		delete state;
+
+		printf("%d,%d,%d,%lld,%lld,%.1f\n", preset, nodes, sources, fullBytes, stateBytes, (double)fullBytes / stateBytes);
+	}
+
+	// a fleet stepped through a day of the DOE test, as separate HPWHs and as states in one workspace
+	std::vector<schedule> allSchedules;
+	long minutesToRun;
+	double newSetpoint;
+	if (readTestSchedules("testDOE_24hr50", allSchedules, minutesToRun, newSetpoint) != 0) {
+		exit(1);
+	}
+	const string modelName = "AOSmithHPTU80";
+	printf("model,fleetSize,secondsFull,secondsFlyweight,heapBytesFull,heapBytesFlyweight,energyInputFull_kWh,energyInputFlyweight_kWh\n");
+
+	long long before = heapBytes;
+	std::vector<HPWH> tanks(fleetSize);
+	for (HPWH &tank : tanks) {
+		getHPWHObject(tank, modelName);
+	}
+	long long fullHeap = heapBytes - before;
+	double fullEnergy = 0.;
+	benchClock::time_point start = benchClock::now();
+	for (long i = 0; i < minutesToRun; i++) {
+		for (int t = 0; t < fleetSize; t++) {
+			long j = (i + 13 * t) % minutesToRun;
+			tanks[t].runOneStep(allSchedules[0][j], GAL_TO_L(allSchedules[1][j]), allSchedules[2][j], allSchedules[3][j],
+				static_cast<HPWH::DRMODES>(int(allSchedules[4][j])));
+			for (int s = 0; s < tanks[t].getNumHeatSources(); s++) {
+				fullEnergy += tanks[t].getNthHeatSourceEnergyInput(s);
+			}
+		}
+	}
+	double fullSeconds = secondsSince(start);
+	tanks.clear();
+	tanks.shrink_to_fit();
+
+	before = heapBytes;
+	std::shared_ptr<HPWHModel> model = std::make_shared<HPWHModel>();
+	model->init([&modelName](HPWH &h) { return getHPWHObject(h, modelName); });
+	HPWH workspace;
+	model->initWorkspace(workspace);
+	std::vector<HPWHState> states(fleetSize, HPWHState(model));
+	long long flyweightHeap = heapBytes - before;
+	double flyweightEnergy = 0.;
+	start = benchClock::now();
+	for (long i = 0; i < minutesToRun; i++) {
+		for (int t = 0; t < fleetSize; t++) {
+			long j = (i + 13 * t) % minutesToRun;
+			states[t].runOneStep(workspace, allSchedules[0][j], GAL_TO_L(allSchedules[1][j]), allSchedules[2][j], allSchedules[3][j],
+				static_cast<HPWH::DRMODES>(int(allSchedules[4][j])));
+			flyweightEnergy += states[t].getEnergyInput();
+		}
+	}
+	double flyweightSeconds = secondsSince(start);
+
+	printf("%s,%d,%.3f,%.3f,%lld,%lld,%.4f,%.4f\n", modelName.c_str(), fleetSize, fullSeconds, flyweightSeconds,
+		fullHeap, flyweightHeap, fullEnergy, flyweightEnergy);
+	return 0;
+}
@@ -0,0 +1,147 @@
+/*Load generator for hpwhd, the local simulation service: starts it with a pool of tanks and,
+ * for each number of clients, has every client step its share of the tanks as fast as it can,
+ * one request a step.  Reports requests per second, tank steps per second, the median and 99th
+ * percentile latency, and how many requests the service coalesced into each fleet step, with
+ * the outputs through the socket and through a file in /dev/shm that the service maps.
+ *
+ * Usage: benchHpwhd [hpwhd path] [tanks (optional)] [seconds (optional)] [client counts (optional)]
+ */
+#include "HPWH.hh"
+#include "hpwhdProtocol.hh"
+#include "testUtilityFcts.cc"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+using std::cout;
+using std::string;
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2) {
+		cout << "Usage: benchHpwhd [hpwhd path] [tanks (optional)] [seconds (optional)] [client counts (optional)]\n";
+		exit(1);
+	}
+	uint32_t tanks = (argc > 2) ? atoi(argv[2]) : 256;
+	double seconds = (argc > 3) ? atof(argv[3]) : 2.;
+	std::vector<int> clientCounts;
+	for (int a = 4; a < argc; a++) {
+		clientCounts.push_back(atoi(argv[a]));
+	}
+	if (clientCounts.empty()) {
+		clientCounts = { 1, 4, 16, 64 };
+	}
+
+	std::vector<schedule> allSchedules;
+	long minutesToRun;
+	double newSetpoint;
+	if (readTestSchedules("testDOE_24hr50", allSchedules, minutesToRun, newSetpoint) != 0) {
+		cout << "Could not read testDOE_24hr50\n";
+		exit(1);
+	}
+
+	string socketPath = "/tmp/benchHpwhd." + std::to_string(getpid()) + ".sock";
+	pid_t service = fork();
+	if (service == 0) {
+		execl(argv[1], argv[1], socketPath.c_str(), (char *)NULL);
+		_exit(127);
+	}
+	HpwhdClient control;
+	for (int tries = 0; !control.connectTo(socketPath); tries++) {
+		if (tries == 500 || waitpid(service, NULL, WNOHANG) != 0) {
+			cout << "hpwhd did not start\n";
+			exit(1);
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	uint32_t firstTank;
+	if (control.create("AOSmithHPTU80", tanks, firstTank) != 0) {
+		cout << control.getError() << "\n";
+		exit(1);
+	}
+
+	printf("clients,shared,requests,seconds,requestsPerSecond,tankStepsPerSecond,p50_us,p99_us,requestsPerFleetStep\n");
+	for (int clients : clientCounts) {
+		for (bool shared : { false, true }) {
+			HpwhdStats before, after;
+			control.stats(before);
+			std::vector<std::vector<double>> latencies_us(clients);
+			std::vector<long> tankSteps(clients, 0);
+			std::vector<int> failures(clients, 0);
+			std::vector<std::thread> threads;
+			benchClock::time_point start = benchClock::now();
+			for (int c = 0; c < clients; c++) {
+				threads.emplace_back([&, c]() {
+					HpwhdClient client;
+					string mapPath = "/dev/shm/benchHpwhd." + std::to_string(getpid()) + "." + std::to_string(c);
+					uint32_t begin = c * tanks / clients, end = (c + 1) * tanks / clients;
+					size_t mapSize = std::max((uint32_t)1, end - begin) * sizeof(HPWH::StepOutputs);
+					int fd = -1;
+					if (!client.connectTo(socketPath)) {
+						failures[c]++;
+						return;
+					}
+					if (shared) {
+						fd = open(mapPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+						if (fd < 0 || ftruncate(fd, mapSize) != 0 || client.mapShared(mapPath, mapSize) != 0) {
+							failures[c]++;
+							return;
+						}
+					}
+					std::vector<HpwhdStep> steps(end - begin);
+					std::vector<HPWH::StepOutputs> outputs;
+					for (long minute = 0; benchClock::now() - start < std::chrono::duration<double>(seconds); minute++) {
+						long i = minute % minutesToRun;
+						for (uint32_t t = begin; t < end; t++) {
+							steps[t - begin] = { t, int(allSchedules[4][i]), allSchedules[0][i],
+								GAL_TO_L(allSchedules[1][i]), allSchedules[2][i], allSchedules[3][i] };
+						}
+						benchClock::time_point sent = benchClock::now();
+						if (client.step(steps, outputs, shared) != 0) {
+							failures[c]++;
+							break;
+						}
+						latencies_us[c].push_back(std::chrono::duration<double, std::micro>(benchClock::now() - sent).count());
+						tankSteps[c] += steps.size();
+					}
+					if (fd >= 0) {
+						close(fd);
+						unlink(mapPath.c_str());
+					}
+				});
+			}
+			for (std::thread &thread : threads) {
+				thread.join();
+			}
+			double elapsed = secondsSince(start);
+			control.stats(after);
+
+			std::vector<double> all;
+			long totalTankSteps = 0;
+			for (int c = 0; c < clients; c++) {
+				if (failures[c] != 0) {
+					cout << "Client " << c << " failed\n";
+					exit(1);
+				}
+				all.insert(all.end(), latencies_us[c].begin(), latencies_us[c].end());
+				totalTankSteps += tankSteps[c];
+			}
+			std::sort(all.begin(), all.end());
+			double fleetSteps = std::max((double)(after.fleetSteps - before.fleetSteps), 1.);
+			printf("%d,%d,%ld,%.3f,%.0f,%.0f,%.1f,%.1f,%.2f\n", clients, shared ? 1 : 0, (long)all.size(), elapsed,
+				all.size() / elapsed, totalTankSteps / elapsed, all[all.size() / 2], all[(size_t)(0.99 * (all.size() - 1))],
+				(after.stepRequests - before.stepRequests) / fleetSteps);
+		}
+	}
+
+	control.shutdown();
+	waitpid(service, NULL, 0);
+	return 0;
+}
@@ -0,0 +1,55 @@
+/*Benchmark for compiled model images: loads per second of each model file as text with
+ * HPWHinit_file, as a compiled image file with HPWHinit_imageFile, and as an image already in
+ * memory with HPWHinit_image.
+ *
+ * Usage: benchModelImage [image file to write (optional)] [model files (optional)]
+ */
+#include "HPWH.hh"
+#include "testUtilityFcts.cc"
+
+using std::cout;
+using std::string;
+
+int main(int argc, char *argv[])
+{
+	string imageFile = (argc > 1) ? argv[1] : "benchModelImage.hpwm";
+	std::vector<string> modelFiles = { "AOSmithHPTU80.txt", "AOSmithPHPT60.txt", "GE502014.txt", "Rheem2020Build50.txt",
+		"Rheem2020Prem40.txt", "Rheem2020Prem50.txt", "RheemHB50.txt", "Sanden80.txt", "Stiebel220e.txt" };
+	if (argc > 2) {
+		modelFiles.assign(argv + 2, argv + argc);
+	}
+	const int loads = 2000;
+
+	printf("model,imageBytes,textLoadsPerSecond,imageFileLoadsPerSecond,imageMemoryLoadsPerSecond,fileSpeedup\n");
+	for (string &modelFile : modelFiles) {
+		HPWH hpwh;
+		std::vector<unsigned char> image;
+		if (hpwh.HPWHinit_file(modelFile) != 0 || hpwh.compileModel(image) != 0 || hpwh.compileModelFile(imageFile) != 0) {
+			cout << "Could not compile " << modelFile << "\n";
+			exit(1);
+		}
+
+		benchClock::time_point start = benchClock::now();
+		for (int i = 0; i < loads; i++) {
+			hpwh.HPWHinit_file(modelFile);
+		}
+		double textTime = secondsSince(start);
+
+		start = benchClock::now();
+		for (int i = 0; i < loads; i++) {
+			hpwh.HPWHinit_imageFile(imageFile);
+		}
+		double fileTime = secondsSince(start);
+
+		start = benchClock::now();
+		for (int i = 0; i < loads; i++) {
+			hpwh.HPWHinit_image(image);
+		}
+		double memoryTime = secondsSince(start);
+
+		printf("%s,%zu,%.3e,%.3e,%.3e,%.1f\n", modelFile.c_str(), image.size(), loads / textTime, loads / fileTime,
+			loads / memoryTime, textTime / fileTime);
+	}
+	remove(imageFile.c_str());
+	return 0;
+}
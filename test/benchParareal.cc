@@ -0,0 +1,91 @@
+/*Benchmark for the Parareal driver: wall-clock speed-up of a long run versus the
+ * number of threads, compared to the sequential runOneStep loop.
+ *
+ * Usage: benchParareal [model preset] [test directory] [slices (optional)] [tolerance C (optional)]
+ * e.g.   benchParareal ColmacCxA_20_SP testCA_36Unit_CTZ12 32 0.01
+ */
+#include "HPWH.hh"
+#include "HPWHParareal.hh"
+#include "testUtilityFcts.cc"
+
+#include <thread>
+
+using std::cout;
+using std::string;
+
+int main(int argc, char *argv[])
+{
+	if (argc < 3) {
+		cout << "Usage: benchParareal [model preset] [test directory] [slices (optional)] [tolerance C (optional)]\n";
+		exit(1);
+	}
+	string modelName = argv[1];
+	string testDirectory = argv[2];
+	int slices = (argc > 3) ? std::stoi(argv[3]) : 32;
+	double tolerance = (argc > 4) ? std::stod(argv[4]) : 0.01;
+
+	std::vector<schedule> allSchedules;
+	long minutesToRun;
+	double newSetpoint;
+	if (readTestSchedules(testDirectory, allSchedules, minutesToRun, newSetpoint) != 0) {
+		exit(1);
+	}
+	std::vector<double> drawVolume_L(minutesToRun);
+	std::vector<HPWH::DRMODES> DRstatus(minutesToRun);
+	for (long i = 0; i < minutesToRun; i++) {
+		drawVolume_L[i] = GAL_TO_L(allSchedules[1][i]);
+		DRstatus[i] = static_cast<HPWH::DRMODES>(int(allSchedules[4][i]));
+	}
+
+	HPWHParareal::InitFunc initFunc = [&](HPWH &hpwh) {
+		if (getHPWHObject(hpwh, modelName) != 0) {
+			return (int)HPWH::HPWH_ABORT;
+		}
+		if (newSetpoint > 0 && !hpwh.isSetpointFixed()) {
+			hpwh.setSetpoint(newSetpoint);
+			hpwh.resetTankToSetpoint();
+		}
+		return 0;
+	};
+
+	// the sequential reference
+	HPWH hpwh;
+	initFunc(hpwh);
+	double serialIn_kWh = 0.;
+	benchClock::time_point start = benchClock::now();
+	for (long i = 0; i < minutesToRun; i++) {
+		hpwh.runOneStep(allSchedules[0][i], drawVolume_L[i], allSchedules[2][i], allSchedules[3][i], DRstatus[i]);
+		for (int j = 0; j < hpwh.getNumHeatSources(); j++) {
+			serialIn_kWh += hpwh.getNthHeatSourceEnergyInput(j);
+		}
+	}
+	double serialTime = secondsSince(start);
+	printf("%s, %s, %ld minutes, %d slices, tolerance %g C\n", modelName.c_str(), testDirectory.c_str(), minutesToRun, slices, tolerance);
+	printf("sequential: %.3f s, energy input %.3f kWh\n", serialTime, serialIn_kWh);
+	printf("threads,iterations,converged,seconds,speedup,energyInput_kWh,relativeError\n");
+
+	int maxThreads = std::max(1, (int)std::thread::hardware_concurrency());
+	for (int threads = 1; threads <= maxThreads; threads *= 2) {
+		HPWHParareal parareal(initFunc);
+		parareal.setNumSlices(slices);
+		parareal.setNumThreads(threads);
+		parareal.setTolerance(tolerance);
+		HPWHParareal::Results results;
+
+		start = benchClock::now();
+		if (parareal.run(minutesToRun, &allSchedules[0][0], &drawVolume_L[0], &allSchedules[2][0],
+			&allSchedules[3][0], &DRstatus[0], results) != 0) {
+			cout << "Parareal run failed\n";
+			exit(1);
+		}
+		double time = secondsSince(start);
+
+		double energyIn_kWh = 0.;
+		for (double e : results.energyInput_kWh) {
+			energyIn_kWh += e;
+		}
+		printf("%d,%d,%d,%.3f,%.2f,%.3f,%.2e\n", threads, results.iterations, results.converged ? 1 : 0, time,
+			serialTime / time, energyIn_kWh, fabs(energyIn_kWh - serialIn_kWh) / std::max(serialIn_kWh, 1e-9));
+	}
+	return 0;
+}
@@ -0,0 +1,162 @@
+/*Benchmark for the central plant engine: a year of a Colmac single pass primary and a swing tank
+ * with recirculation on the testCA_36Unit_CTZ12 schedules.  The draws are the test's own when it
+ * has a draw schedule, otherwise 36 copies of the testCA_3BR_CTZ15 draws shifted by a week and
+ * some minutes from unit to unit.  Runs the two tanks stepped together by hand, the plant, and a
+ * number of plants through HPWHBatch once per thread count.  Reports the wall time, the plant
+ * steps per second and the year's energy input, which must be the same for every method.
+ *
+ * Usage: benchPlant [plants (optional)] [thread counts (optional)]
+ */
+#include "HPWH.hh"
+#include "HPWHPlant.hh"
+#include "testUtilityFcts.cc"
+
+#include <thread>
+
+using std::cout;
+using std::string;
+
+const int numUnits = 36;
+const double recircFlow_Lpermin = GAL_TO_L(3.);
+const double loopLoss_W = 100. * numUnits;
+
+void makeTanks(HPWH &primary, HPWH &swing, double setpoint_C) {
+	getHPWHObject(primary, "ColmacCxA_20_SP");
+	primary.setSetpoint(setpoint_C);
+	primary.resetTankToSetpoint();
+	swing.HPWHinit_resSwingTank(GAL_TO_L(80.), 0.95, 0., 4500., F_TO_C(120.));
+}
+
+void makePlant(HPWHPlant &plant, double setpoint_C) {
+	HPWH primary, swing;
+	makeTanks(primary, swing, setpoint_C);
+	plant.addStage(primary);
+	plant.addStage(swing);
+	plant.setRecirculation(recircFlow_Lpermin, loopLoss_W);
+}
+
+int main(int argc, char *argv[])
+{
+	int numPlants = (argc > 1) ? atoi(argv[1]) : 4;
+	std::vector<int> threadCounts;
+	for (int a = 2; a < argc; a++) {
+		threadCounts.push_back(atoi(argv[a]));
+	}
+	if (threadCounts.empty()) {
+		threadCounts = { 1, 2, std::max(1, (int)std::thread::hardware_concurrency()) };
+	}
+
+	// a year, at the test's setpoint.  The test has no draw schedule of its own, so readTestSchedules
+	// would refuse it
+	const long steps = 525600;
+	const double setpoint_C = 60.;
+	const char *scheduleNames[4] = { "inletT", "ambientT", "evaporatorT", "DR" };
+	std::vector<schedule> allSchedules(4);
+	for (int k = 0; k < 4; k++) {
+		if (readSchedule(allSchedules[k], string("testCA_36Unit_CTZ12/") + scheduleNames[k] + "schedule.csv", steps) != 0) {
+			cout << "Could not read testCA_36Unit_CTZ12\n";
+			exit(1);
+		}
+	}
+	schedule unitDraws;
+	bool buildingDraws = readSchedule(unitDraws, "testCA_36Unit_CTZ12/drawschedule.csv", steps) == 0;
+	if (!buildingDraws && readSchedule(unitDraws, "testCA_3BR_CTZ15/drawschedule.csv", steps) != 0) {
+		cout << "Could not read the draws\n";
+		exit(1);
+	}
+
+	std::vector<double> inletT_C(steps), drawVolume_L(steps, 0.), ambientT_C(steps), evaporatorT_C(steps);
+	std::vector<HPWH::DRMODES> DRstatus(steps);
+	for (long i = 0; i < steps; i++) {
+		inletT_C[i] = allSchedules[0][i];
+		ambientT_C[i] = allSchedules[1][i];
+		evaporatorT_C[i] = allSchedules[2][i];
+		DRstatus[i] = static_cast<HPWH::DRMODES>(int(allSchedules[3][i]));
+		if (buildingDraws) {
+			drawVolume_L[i] = GAL_TO_L(unitDraws[i]);
+			continue;
+		}
+		for (int u = 0; u < numUnits; u++) {
+			drawVolume_L[i] += GAL_TO_L(unitDraws[(i + (7 * 1440 + 37) * u) % steps]);
+		}
+	}
+	HPWHPlant::Inputs inputs;
+	inputs.inletT_C = inletT_C.data();
+	inputs.drawVolume_L = drawVolume_L.data();
+	inputs.tankAmbientT_C = ambientT_C.data();
+	inputs.heatSourceAmbientT_C = evaporatorT_C.data();
+	inputs.DRstatus = DRstatus.data();
+
+	printf("method,plants,steps,threads,seconds,plantStepsPerSecond,energyInput_kWh\n");
+	{
+		// what callers glue together today: the primary's outlet copied to the swing tank's inlet
+		HPWH primary, swing;
+		makeTanks(primary, swing, setpoint_C);
+		const double loopDrop_C = loopLoss_W * 60. / 1000. / (recircFlow_Lpermin * HPWH::DENSITYWATER_kgperL * HPWH::CPWATER_kJperkgC);
+		double energyInput_kWh = 0.;
+		benchClock::time_point start = benchClock::now();
+		for (long i = 0; i < steps; i++) {
+			double returnT_C = swing.getTankNodeTemp(swing.getNumNodes() - 1) - loopDrop_C;
+			primary.runOneStep(inletT_C[i], drawVolume_L[i], ambientT_C[i], evaporatorT_C[i], DRstatus[i]);
+			double primaryOutletT_C = (drawVolume_L[i] > 0.) ? primary.getOutletTemp() : 0.;
+			swing.runOneStep(primaryOutletT_C, drawVolume_L[i] + recircFlow_Lpermin, ambientT_C[i], evaporatorT_C[i],
+				DRstatus[i], recircFlow_Lpermin, returnT_C);
+			double stepEnergy_kWh = 0.;
+			for (int j = 0; j < primary.getNumHeatSources(); j++) {
+				stepEnergy_kWh += primary.getNthHeatSourceEnergyInput(j);
+			}
+			double swingEnergy_kWh = 0.;
+			for (int j = 0; j < swing.getNumHeatSources(); j++) {
+				swingEnergy_kWh += swing.getNthHeatSourceEnergyInput(j);
+			}
+			energyInput_kWh += stepEnergy_kWh + swingEnergy_kWh;
+		}
+		double seconds = secondsSince(start);
+		printf("glued,1,%ld,1,%.3f,%.0f,%.6f\n", steps, seconds, steps / seconds, energyInput_kWh);
+	}
+	{
+		HPWHPlant plant;
+		makePlant(plant, setpoint_C);
+		std::vector<double> energyInput_kWh(steps);
+		HPWHPlant::OutputArrays outputs;
+		outputs.energyInput_kWh = energyInput_kWh.data();
+		benchClock::time_point start = benchClock::now();
+		if (plant.runNSteps(steps, inputs, &outputs) != 0) {
+			cout << "The plant failed\n";
+			exit(1);
+		}
+		double seconds = secondsSince(start);
+		double total_kWh = 0.;
+		for (double e : energyInput_kWh) {
+			total_kWh += e;
+		}
+		printf("plant,1,%ld,1,%.3f,%.0f,%.6f\n", steps, seconds, steps / seconds, total_kWh);
+	}
+
+	for (int threads : threadCounts) {
+		std::vector<HPWHPlant> plants(numPlants);
+		std::vector<std::vector<double> > energyInput_kWh(numPlants, std::vector<double>(steps));
+		std::vector<HPWHBatch::Job> jobs;
+		for (int p = 0; p < numPlants; p++) {
+			makePlant(plants[p], setpoint_C);
+			HPWHPlant::OutputArrays outputs;
+			outputs.energyInput_kWh = energyInput_kWh[p].data();
+			jobs.push_back(plants[p].batchJob(steps, inputs, &outputs));
+		}
+		HPWHBatch batch;
+		batch.setNumThreads(threads);
+		benchClock::time_point start = benchClock::now();
+		if (batch.run(jobs) != 0) {
+			cout << "A plant failed\n";
+			exit(1);
+		}
+		double seconds = secondsSince(start);
+		// every plant runs the same year, so each must match the plant above
+		double total_kWh = 0.;
+		for (double e : energyInput_kWh[numPlants - 1]) {
+			total_kWh += e;
+		}
+		printf("batch,%d,%ld,%d,%.3f,%.0f,%.6f\n", numPlants, steps, threads, seconds, numPlants * steps / seconds, total_kWh);
+	}
+	return 0;
+}
@@ -0,0 +1,54 @@
+/*Benchmark for preset lookup and initialization: name lookups per second through the registry,
+ * and the latency of initializing each registered preset with HPWHinit_presets and with a warm
+ * HPWHinit_presetsCached.
+ *
+ * Usage: benchPresetRegistry
+ */
+#include "HPWH.hh"
+#include "testUtilityFcts.cc"
+
+using std::cout;
+using std::string;
+
+int main(int argc, char *argv[])
+{
+	const std::vector<HPWH::PresetInfo> &presets = HPWH::getPresets();
+	const int repeats = 200;
+
+	std::vector<string> names;
+	for (const HPWH::PresetInfo &preset : presets) {
+		names.push_back(preset.name);
+	}
+	const long lookups = 2000000;
+	long found = 0;
+	benchClock::time_point start = benchClock::now();
+	for (long i = 0; i < lookups; i++) {
+		found += (HPWH::findPreset(names[i % names.size()]) != NULL) ? 1 : 0;
+	}
+	double lookupTime = secondsSince(start);
+	printf("%zu presets, %.3e name lookups per second (%ld found)\n", presets.size(), lookups / lookupTime, found);
+
+	printf("preset,initMicroseconds,cachedMicroseconds,speedup\n");
+	double initTotal = 0., cachedTotal = 0.;
+	for (const HPWH::PresetInfo &preset : presets) {
+		HPWH hpwh;
+		start = benchClock::now();
+		for (int r = 0; r < repeats; r++) {
+			hpwh.HPWHinit_presets(preset.model);
+		}
+		double initTime = secondsSince(start) / repeats;
+
+		hpwh.HPWHinit_presetsCached(preset.model);
+		start = benchClock::now();
+		for (int r = 0; r < repeats; r++) {
+			hpwh.HPWHinit_presetsCached(preset.model);
+		}
+		double cachedTime = secondsSince(start) / repeats;
+		initTotal += initTime;
+		cachedTotal += cachedTime;
+		printf("%s,%.2f,%.2f,%.1f\n", preset.name, 1e6 * initTime, 1e6 * cachedTime, initTime / cachedTime);
+	}
+	printf("average,%.2f,%.2f,%.1f\n", 1e6 * initTotal / presets.size(), 1e6 * cachedTotal / presets.size(),
+		initTotal / cachedTotal);
+	return 0;
+}
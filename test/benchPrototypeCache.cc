@@ -0,0 +1,67 @@
+/*Benchmark for the prototype cache: HPWHs initialized per second with HPWHinit_presets, with
+ * HPWHinit_presetsCached on an empty cache (cold), and with HPWHinit_presetsCached once every
+ * prototype is cached (warm), for a fleet spread over a set of presets.
+ *
+ * Usage: benchPrototypeCache [number of tanks (optional)] [model presets (optional)]
+ */
+#include "HPWH.hh"
+#include "testUtilityFcts.cc"
+
+using std::cout;
+using std::string;
+
+int main(int argc, char *argv[])
+{
+	long nTanks = (argc > 1) ? std::stol(argv[1]) : 50000;
+	std::vector<string> modelNames = { "Voltex60", "Voltex80", "GEred", "SandenGAU", "Sanden80", "Sanden120",
+		"AOSmithHPTU50", "AOSmithHPTU66", "AOSmithHPTU80", "AOSmithHPTU80DR", "GE502014", "GE802014", "RheemHB50",
+		"Stiebel220e", "Rheem2020Prem40", "Rheem2020Prem50", "Rheem2020Build50", "Rheem2020Build80", "BWC2020_65",
+		"ColmacCxA_20_SP" };
+	if (argc > 2) {
+		modelNames.assign(argv + 2, argv + argc);
+	}
+	std::vector<HPWH::MODELS> presets;
+	for (string &modelName : modelNames) {
+		presets.push_back(mapStringToPreset(modelName));
+	}
+	size_t nPresets = presets.size();
+
+	std::vector<HPWH> fleet(nTanks);
+	benchClock::time_point start = benchClock::now();
+	for (long i = 0; i < nTanks; i++) {
+		if (fleet[i].HPWHinit_presets(presets[i % nPresets]) != 0) {
+			cout << "Could not set up " << modelNames[i % nPresets] << "\n";
+			exit(1);
+		}
+	}
+	double initTime = secondsSince(start);
+
+	fleet.assign(nTanks, HPWH());
+	HPWH::clearPrototypeCache();
+	start = benchClock::now();
+	for (long i = 0; i < nTanks; i++) {
+		fleet[i].HPWHinit_presetsCached(presets[i % nPresets]);
+	}
+	double coldTime = secondsSince(start);
+
+	fleet.assign(nTanks, HPWH());
+	start = benchClock::now();
+	for (long i = 0; i < nTanks; i++) {
+		fleet[i].HPWHinit_presetsCached(presets[i % nPresets]);
+	}
+	double warmTime = secondsSince(start);
+
+	// the first tank of each preset, where the cold cache pays for the initialization
+	HPWH::clearPrototypeCache();
+	HPWH first;
+	start = benchClock::now();
+	for (size_t p = 0; p < nPresets; p++) {
+		first.HPWHinit_presetsCached(presets[p]);
+	}
+	double firstTime = secondsSince(start);
+
+	printf("tanks,presets,initPerSecond,cachedColdPerSecond,cachedWarmPerSecond,firstOfPresetSeconds,warmSpeedup\n");
+	printf("%ld,%zu,%.3e,%.3e,%.3e,%.2e,%.1f\n", nTanks, nPresets, nTanks / initTime, nTanks / coldTime,
+		nTanks / warmTime, firstTime / nPresets, initTime / warmTime);
+	return 0;
+}
@@ -0,0 +1,90 @@
+/*Benchmark for batch stepping: a day of steps as a runOneStep loop that gathers each step's
+ * results through the getters, against one runNSteps call writing them to output arrays, in
+ * steps per second.
+ *
+ * Usage: benchRunNSteps [model presets (optional)]
+ */
+#include "HPWH.hh"
+#include "testUtilityFcts.cc"
+
+using std::cout;
+using std::string;
+
+int main(int argc, char *argv[])
+{
+	std::vector<string> modelNames = { "AOSmithHPTU80", "Sanden80", "Rheem2020Prem50" };
+	if (argc > 1) {
+		modelNames.assign(argv + 1, argv + argc);
+	}
+	std::vector<schedule> allSchedules;
+	long minutesToRun;
+	double newSetpoint;
+	if (readTestSchedules("testDOE_24hr50", allSchedules, minutesToRun, newSetpoint) != 0) {
+		cout << "Could not read the schedules\n";
+		exit(1);
+	}
+	std::vector<double> inletT_C(allSchedules[0].begin(), allSchedules[0].begin() + minutesToRun);
+	std::vector<double> drawVolume_L(minutesToRun);
+	std::vector<double> tankAmbientT_C(allSchedules[2].begin(), allSchedules[2].begin() + minutesToRun);
+	std::vector<double> heatSourceAmbientT_C(allSchedules[3].begin(), allSchedules[3].begin() + minutesToRun);
+	std::vector<HPWH::DRMODES> DRstatus(minutesToRun);
+	for (long i = 0; i < minutesToRun; i++) {
+		drawVolume_L[i] = GAL_TO_L(allSchedules[1][i]);
+		DRstatus[i] = static_cast<HPWH::DRMODES>(int(allSchedules[4][i]));
+	}
+	const int days = 200;
+
+	printf("model,runOneStepStepsPerSecond,runNStepsStepsPerSecond,speedup\n");
+	for (string &modelName : modelNames) {
+		HPWH prototype;
+		if (getHPWHObject(prototype, modelName) != 0) {
+			cout << "Could not set up " << modelName << "\n";
+			exit(1);
+		}
+		int numHeatSources = prototype.getNumHeatSources();
+		std::vector<double> outletTemp_C(minutesToRun), energyInput_kWh(minutesToRun * numHeatSources),
+			simTcouples_C(minutesToRun * HPWH::STEP_TCOUPLES);
+
+		double check = 0.;
+		benchClock::time_point start = benchClock::now();
+		for (int d = 0; d < days; d++) {
+			HPWH hpwh(prototype);
+			for (long i = 0; i < minutesToRun; i++) {
+				hpwh.runOneStep(inletT_C[i], drawVolume_L[i], tankAmbientT_C[i], heatSourceAmbientT_C[i], DRstatus[i]);
+				outletTemp_C[i] = hpwh.getOutletTemp();
+				for (int s = 0; s < numHeatSources; s++) {
+					energyInput_kWh[i * numHeatSources + s] = hpwh.getNthHeatSourceEnergyInput(s);
+				}
+				for (int t = 0; t < HPWH::STEP_TCOUPLES; t++) {
+					simTcouples_C[i * HPWH::STEP_TCOUPLES + t] = hpwh.getNthSimTcouple(t + 1, HPWH::STEP_TCOUPLES);
+				}
+			}
+			check += simTcouples_C.back();
+		}
+		double loopRate = days * minutesToRun / secondsSince(start);
+
+		HPWH::StepInputs inputs;
+		inputs.inletT_C = inletT_C.data();
+		inputs.drawVolume_L = drawVolume_L.data();
+		inputs.tankAmbientT_C = tankAmbientT_C.data();
+		inputs.heatSourceAmbientT_C = heatSourceAmbientT_C.data();
+		inputs.DRstatus = DRstatus.data();
+		HPWH::StepOutputArrays outputs;
+		outputs.outletTemp_C = outletTemp_C.data();
+		outputs.heatSourceEnergyInput_kWh = energyInput_kWh.data();
+		outputs.simTcouples_C = simTcouples_C.data();
+		start = benchClock::now();
+		for (int d = 0; d < days; d++) {
+			HPWH hpwh(prototype);
+			hpwh.runNSteps(minutesToRun, inputs, &outputs);
+			check += simTcouples_C.back();
+		}
+		double batchRate = days * minutesToRun / secondsSince(start);
+
+		printf("%s,%.3e,%.3e,%.2f\n", modelName.c_str(), loopRate, batchRate, batchRate / loopRate);
+		if (check == 0.) {
+			cout << "\n";
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,53 @@
+/*Benchmark for binary state snapshots: the size of a snapshot and the number of saveState
+ * and loadState calls per second for warmed up tanks.
+ *
+ * Usage: benchSaveState [model presets (optional)]
+ */
+#include "HPWH.hh"
+#include "testUtilityFcts.cc"
+
+using std::cout;
+using std::string;
+
+int main(int argc, char *argv[])
+{
+	std::vector<string> modelNames = { "AOSmithHPTU80", "Sanden80", "GE502014", "Rheem2020Prem50", "ColmacCxA_20_SP" };
+	if (argc > 1) {
+		modelNames.assign(argv + 1, argv + argc);
+	}
+	const long snapshots = 500000;
+
+	printf("model,nodes,bytes,savesPerSecond,loadsPerSecond,MBPerSecondSave,MBPerSecondLoad\n");
+	for (string &modelName : modelNames) {
+		HPWH hpwh;
+		if (getHPWHObject(hpwh, modelName) != 0) {
+			cout << "Could not set up " << modelName << "\n";
+			exit(1);
+		}
+		for (int i = 0; i < 60; i++) {
+			hpwh.runOneStep(10., (i < 10) ? 10. : 0., 20., 20., HPWH::DR_ALLOW);
+		}
+
+		std::vector<unsigned char> buffer;
+		benchClock::time_point start = benchClock::now();
+		for (long i = 0; i < snapshots; i++) {
+			hpwh.saveState(buffer);
+		}
+		double saveRate = snapshots / secondsSince(start);
+
+		HPWH target;
+		getHPWHObject(target, modelName);
+		start = benchClock::now();
+		for (long i = 0; i < snapshots; i++) {
+			if (target.loadState(buffer) != 0) {
+				cout << "Could not load the snapshot of " << modelName << "\n";
+				exit(1);
+			}
+		}
+		double loadRate = snapshots / secondsSince(start);
+
+		printf("%s,%d,%zu,%.3e,%.3e,%.0f,%.0f\n", modelName.c_str(), hpwh.getNumNodes(), buffer.size(),
+			saveRate, loadRate, saveRate * buffer.size() / 1e6, loadRate * buffer.size() / 1e6);
+	}
+	return 0;
+}
@@ -0,0 +1,67 @@
+/*Benchmark for simulateAhead: rollouts per second of three hour DR candidates for a warmed up
+ * tank, by number of threads.
+ *
+ * Usage: benchSimulateAhead [number of candidates (optional)] [model presets (optional)]
+ */
+#include "HPWH.hh"
+#include "testUtilityFcts.cc"
+
+#include <thread>
+
+using std::cout;
+using std::string;
+
+int main(int argc, char *argv[])
+{
+	int nCandidates = (argc > 1) ? std::stoi(argv[1]) : 24;
+	std::vector<string> modelNames = { "AOSmithHPTU80", "Sanden80", "ColmacCxA_20_SP" };
+	if (argc > 2) {
+		modelNames.assign(argv + 2, argv + argc);
+	}
+	const int horizon = 180;
+	const int repeats = 20;
+
+	HPWH::AheadInputs inputs;
+	for (int i = 0; i < horizon; i++) {
+		inputs.inletT_C.push_back(12.);
+		inputs.drawVolume_L.push_back((i % 60 < 5) ? 6. : 0.);
+		inputs.tankAmbientT_C.push_back(20.);
+		inputs.heatSourceAmbientT_C.push_back(15.);
+	}
+	// lock outs of every length, from none to the whole horizon
+	std::vector<HPWH::AheadCandidate> candidates(nCandidates);
+	for (int c = 0; c < nCandidates; c++) {
+		candidates[c].DRstatus.assign(horizon, HPWH::DR_ALLOW);
+		for (int i = 0; i < horizon * c / nCandidates; i++) {
+			candidates[c].DRstatus[i] = HPWH::DR_LOC;
+		}
+	}
+
+	int maxThreads = std::max(1, (int)std::thread::hardware_concurrency());
+	printf("hardware threads %d, horizon %d minutes, %d candidates\n", maxThreads, horizon, nCandidates);
+	printf("model,threads,rolloutsPerSecond,stepsPerSecond,secondsPerDecision\n");
+	for (string &modelName : modelNames) {
+		HPWH hpwh;
+		if (getHPWHObject(hpwh, modelName) != 0) {
+			cout << "Could not set up " << modelName << "\n";
+			exit(1);
+		}
+		for (int i = 0; i < 90; i++) {
+			hpwh.runOneStep(12., (i < 20) ? 6. : 0., 20., 15., HPWH::DR_ALLOW);
+		}
+		for (int threads = 1; threads <= maxThreads; threads *= 2) {
+			std::vector<HPWH::AheadOutputs> outputs;
+			benchClock::time_point start = benchClock::now();
+			for (int r = 0; r < repeats; r++) {
+				if (hpwh.simulateAhead(horizon, inputs, candidates, outputs, threads) != 0) {
+					cout << "simulateAhead failed for " << modelName << "\n";
+					exit(1);
+				}
+			}
+			double seconds = secondsSince(start);
+			printf("%s,%d,%.3e,%.3e,%.2e\n", modelName.c_str(), threads, repeats * nCandidates / seconds,
+				(double)repeats * nCandidates * horizon / seconds, seconds / repeats);
+		}
+	}
+	return 0;
+}
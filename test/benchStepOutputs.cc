@@ -0,0 +1,67 @@
+/*Benchmark for gathering the outputs of a step: the single getters called for every heat
+ * source and thermocouple, against one getStepOutputs call, in gathers per second.
+ *
+ * Usage: benchStepOutputs [model presets (optional)]
+ */
+#include "HPWH.hh"
+#include "testUtilityFcts.cc"
+
+using std::cout;
+using std::string;
+
+int main(int argc, char *argv[])
+{
+	std::vector<string> modelNames = { "AOSmithHPTU80", "Sanden80", "Rheem2020Prem50" };
+	if (argc > 1) {
+		modelNames.assign(argv + 1, argv + argc);
+	}
+	const long gathers = 2000000;
+
+	printf("model,gettersPerSecond,stepOutputsPerSecond,speedup\n");
+	for (string &modelName : modelNames) {
+		HPWH hpwh;
+		if (getHPWHObject(hpwh, modelName) != 0) {
+			cout << "Could not set up " << modelName << "\n";
+			exit(1);
+		}
+		for (int i = 0; i < 60; i++) {
+			hpwh.runOneStep(10., (i < 10) ? 10. : 0., 20., 20., HPWH::DR_ALLOW);
+		}
+
+		// the buffer a fleet would gather into
+		std::vector<double> buffer(3 * HPWH::STEP_HEATSOURCES + 4 + HPWH::STEP_TCOUPLES);
+		double check = 0.;
+		benchClock::time_point start = benchClock::now();
+		for (long g = 0; g < gathers; g++) {
+			double *out = buffer.data();
+			for (int s = 0; s < hpwh.getNumHeatSources(); s++) {
+				*out++ = hpwh.getNthHeatSourceEnergyInput(s);
+				*out++ = hpwh.getNthHeatSourceEnergyOutput(s);
+				*out++ = hpwh.getNthHeatSourceRunTime(s);
+			}
+			*out++ = hpwh.getOutletTemp();
+			*out++ = hpwh.getStandbyLosses();
+			*out++ = hpwh.getEnergyRemovedFromEnvironment();
+			*out++ = hpwh.getTankHeatContent_kJ();
+			for (int t = 1; t <= HPWH::STEP_TCOUPLES; t++) {
+				*out++ = hpwh.getNthSimTcouple(t, HPWH::STEP_TCOUPLES);
+			}
+			check += buffer.back();
+		}
+		double getterRate = gathers / secondsSince(start);
+
+		std::vector<HPWH::StepOutputs> outputs(1);
+		start = benchClock::now();
+		for (long g = 0; g < gathers; g++) {
+			hpwh.getStepOutputs(outputs[0]);
+			check += outputs[0].simTcouples_C[HPWH::STEP_TCOUPLES - 1];
+		}
+		double stepOutputsRate = gathers / secondsSince(start);
+
+		printf("%s,%.3e,%.3e,%.2f\n", modelName.c_str(), getterRate, stepOutputsRate, stepOutputsRate / getterRate);
+		if (check == 0.) {
+			cout << "\n";
+		}
+	}
+	return 0;
+}
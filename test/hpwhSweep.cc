@@ -0,0 +1,678 @@
+/*Runs a sweep of model tests in one process: every combination of the models, tests and
+ * options in a sweep file, on a pool of threads.  Each test's schedules are read once and
+ * shared by its runs.  A run writes the same csv testTool does, named as testTool names it
+ * plus the options that were overridden, and yearly runs add their row to DHW_YRLY.csv.  Both
+ * and a summary of every run are written in the order of the sweep file, whatever the threads.
+ *
+ * Usage: hpwhSweep [sweep file] [output directory] [threads (optional)]
+ *                  [--shard i/n] [--results file] [--resume]
+ *
+ * The results of every run can also go to a table of fixed width records in a file, mapped
+ * into memory, so several processes can share a sweep.  --shard i/n runs only runs i, i + n,
+ * i + 2n, ... of the sweep, each writing its own records in place, with no locks.  A shard
+ * writes its runs' csvs and messages but not the summary or DHW_YRLY.csv; those come from the
+ * table, once a process covering the whole sweep finds every record complete.  --resume skips
+ * the runs already complete in the table, so after the shards, or after a crash, running the
+ * whole sweep with --resume runs only what is missing and writes the summary.  The table is
+ * sweepResults.bin in the output directory unless --results names another.
+ *
+ * The sweep file has one entry per line, # starts a comment:
+ *   model Preset AOSmithHPTU80          a model, Preset or File, as testTool takes them
+ *   test test50                         a test directory
+ *   airtemp testLockout GE502014 40     testTool's air temperature override for a test and
+ *                                       model, F.  A test with any of these only runs those models
+ *   tanksize 50 80                      values to sweep, 0 runs the test's own.  tanksize is
+ *   setpoint 50 55                      in gal, setpoint in C, replacing the setpoint schedule,
+ *   tot_limit 60                        and tot_limit in minutes
+ *   reference ref                       compare each run's csv to the one of the same name here
+ */
+#include "HPWH.hh"
+#include "testUtilityFcts.cc"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using std::cout;
+using std::string;
+
+// a test directory, read once
+struct TestInputs {
+	string name;
+	bool ok = false;
+	long minutesToRun = 0;
+	double newSetpoint = 0., inletH = 0., newTankSize = 0., tot_limit = 0.;
+	int doInvMix = 1, doCondu = 1;
+	std::vector<schedule> allSchedules;
+	std::map<string, double> airTemps;  // testTool's air temperature override by model, F
+};
+
+struct ModelSpec {
+	string source;  // Preset or File
+	string name;
+};
+
+// the results of a run, a fixed width record of the result table
+enum RECORDSTATUS : uint32_t {
+	RECORD_EMPTY = 0,
+	RECORD_DONE = 1,
+	RECORD_FAILED = 2
+};
+
+struct SweepRecord {
+	uint32_t status;     // RECORDSTATUS, written last so a record is complete once it is set
+	uint32_t warnings;
+	uint64_t run;        // the index of the run in the sweep
+	uint32_t yearly;
+	uint32_t unused;
+	double energyIn_kWh, energyOut_kWh;
+	double heatIn_Wh[3], heatOut_Wh[3];  // yearly runs, by heat source
+};
+static_assert(sizeof(SweepRecord) == 88, "SweepRecord is written to the result table as it is");
+
+struct Run {
+	const ModelSpec *model;
+	const TestInputs *test;
+	double tankSize, setpoint, tot_limit;  // 0 for the test's own
+	string outputName;
+	string messages;
+	SweepRecord *record;  // in the result table, or held in memory without one
+};
+
+// the result table: a header, then one record per run of the sweep, at offsets fixed by the
+// run, so processes sharing it never write the same bytes
+struct TableHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t recordSize;
+	uint64_t runs;
+	uint64_t sweepHash;  // of the runs' names, so a table is only reused for the same sweep
+	uint8_t unused[32];
+};
+static_assert(sizeof(TableHeader) == 64, "TableHeader is written to the result table as it is");
+
+const char TABLE_MAGIC[8] = { 'H', 'P', 'W', 'H', 'S', 'W', 'P', '\0' };
+const uint32_t TABLE_VERSION = 1;
+
+class ResultTable {
+public:
+	~ResultTable() {
+#ifndef _WIN32
+		if (map != NULL) {
+			msync(map, size, MS_SYNC);
+			munmap(map, size);
+		}
+		if (fd >= 0) {
+			close(fd);
+		}
+#endif
+	}
+
+	// opens or creates the table for a sweep, returns an error message or ""
+	string open(const string &path, uint64_t runs, uint64_t sweepHash) {
+#ifdef _WIN32
+		return "The result table is not supported on Windows";
+#else
+		TableHeader header = {};
+		std::copy(TABLE_MAGIC, TABLE_MAGIC + 8, header.magic);
+		header.version = TABLE_VERSION;
+		header.recordSize = sizeof(SweepRecord);
+		header.runs = runs;
+		header.sweepHash = sweepHash;
+		size = sizeof(TableHeader) + runs * sizeof(SweepRecord);
+
+		fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+		struct stat fileStat;
+		if (fd < 0 || fstat(fd, &fileStat) != 0) {
+			return "Could not open the result table " + path;
+		}
+		// a new table, or one other shards are creating at the same time, is all zeros.  Each
+		// writes the same size and header, so the order does not matter
+		if (fileStat.st_size != 0 && (size_t)fileStat.st_size != size) {
+			return "The result table " + path + " is for another sweep";
+		}
+		if ((size_t)fileStat.st_size != size && ftruncate(fd, size) != 0) {
+			return "Could not size the result table " + path;
+		}
+		map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (map == MAP_FAILED) {
+			map = NULL;
+			return "Could not map the result table " + path;
+		}
+		TableHeader *mapped = static_cast<TableHeader *>(map);
+		TableHeader zero = {};
+		if (std::equal((char *)mapped, (char *)(mapped + 1), (char *)&zero)) {
+			*mapped = header;
+		}
+		else if (!std::equal((char *)mapped, (char *)(mapped + 1), (char *)&header)) {
+			return "The result table " + path + " is for another sweep";
+		}
+		return "";
+#endif
+	}
+
+	SweepRecord *records() {
+		return reinterpret_cast<SweepRecord *>(static_cast<char *>(map) + sizeof(TableHeader));
+	}
+
+private:
+	int fd = -1;
+	void *map = NULL;
+	size_t size = 0;
+};
+
+uint64_t hashRuns(const std::vector<Run> &runs) {
+	uint64_t hash = 14695981039346656037ull;
+	for (const Run &run : runs) {
+		for (char c : run.outputName + "\n") {
+			hash = (hash ^ (unsigned char)c) * 1099511628211ull;
+		}
+	}
+	return hash;
+}
+
+bool readTestInputs(TestInputs &test) {
+	std::ifstream controlFile((test.name + "/testInfo.txt").c_str());
+	if (!controlFile.is_open()) {
+		cout << "Could not open control file " << test.name << "/testInfo.txt\n";
+		return false;
+	}
+	string var1;
+	double testVal;
+	while (controlFile >> var1 >> testVal) {
+		if (var1 == "setpoint") test.newSetpoint = testVal;
+		else if (var1 == "length_of_test") test.minutesToRun = (int)testVal;
+		else if (var1 == "doInversionMixing") test.doInvMix = (testVal > 0.0) ? 1 : 0;
+		else if (var1 == "doConduction") test.doCondu = (testVal > 0.0) ? 1 : 0;
+		else if (var1 == "inletH") test.inletH = testVal;
+		else if (var1 == "tanksize") test.newTankSize = testVal;
+		else if (var1 == "tot_limit") test.tot_limit = testVal;
+		else cout << var1 << " in testInfo.txt is an unrecogized key.\n";
+	}
+	if (test.minutesToRun == 0) {
+		cout << "Error, must record length_of_test in " << test.name << "/testInfo.txt file\n";
+		return false;
+	}
+
+	const char *scheduleNames[] = { "inletT", "draw", "ambientT", "evaporatorT", "DR", "setpoint" };
+	test.allSchedules.assign(6, schedule());
+	for (int i = 0; i < 6; i++) {
+		string fileToOpen = test.name + "/" + scheduleNames[i] + "schedule.csv";
+		if (readSchedule(test.allSchedules[i], fileToOpen, test.minutesToRun) != 0) {
+			if (i != 5) {
+				cout << "readSchedule returns an error on " << scheduleNames[i] << " schedule!\n";
+				return false;
+			}
+			// the setpoint schedule is optional
+			test.allSchedules[i].clear();
+		}
+	}
+	return true;
+}
+
+// what testTool does for one model and test, messages kept to print in order later.  Returns
+// false if the run failed
+bool simulate(Run &run, SweepRecord &result, const string &outputDirectory) {
+	const int nTestTCouples = 6;
+	const double EBALTHRESHOLD = 0.005;
+	const TestInputs &test = *run.test;
+	const std::vector<schedule> &allSchedules = test.allSchedules;
+	std::ostringstream messages;
+
+	HPWH hpwh;
+	if (run.model->source == "Preset") {
+		if (getHPWHObject(hpwh, run.model->name) == HPWH::HPWH_ABORT) {
+			run.messages = "Error, preset model did not initialize.\n";
+			return false;
+		}
+	}
+	else if (hpwh.HPWHinit_file(run.model->name + ".txt") != 0) {
+		run.messages = "Error, model file did not initialize.\n";
+		return false;
+	}
+
+	auto airTemp = test.airTemps.find(run.model->name);
+	bool HPWH_doTempDepress = airTemp != test.airTemps.end();
+	hpwh.setMaxTempDepression(4);
+	hpwh.setDoTempDepression(HPWH_doTempDepress);
+
+	int outputCode = 0;
+	if (test.doInvMix == 0) {
+		outputCode += hpwh.setDoInversionMixing(false);
+	}
+	if (test.doCondu == 0) {
+		outputCode += hpwh.setDoConduction(false);
+	}
+	bool setpointSchedule = !allSchedules[5].empty() && run.setpoint == 0.;
+	if (run.setpoint > 0.) {
+		outputCode += hpwh.setSetpoint(run.setpoint);
+		hpwh.resetTankToSetpoint();
+	}
+	else if (test.newSetpoint > 0) {
+		if (setpointSchedule) {
+			hpwh.setSetpoint(allSchedules[5][0]); //expect this to fail sometimes
+		}
+		else {
+			hpwh.setSetpoint(test.newSetpoint);
+		}
+		hpwh.resetTankToSetpoint();
+	}
+	if (test.inletH > 0) {
+		outputCode += hpwh.setInletByFraction(test.inletH);
+	}
+	double newTankSize = (run.tankSize > 0.) ? run.tankSize : test.newTankSize;
+	if (newTankSize > 0) {
+		hpwh.setTankSize(newTankSize, HPWH::UNITS_GAL);
+	}
+	double tot_limit = (run.tot_limit > 0.) ? run.tot_limit : test.tot_limit;
+	if (tot_limit > 0) {
+		outputCode += hpwh.setTimerLimitTOT(tot_limit);
+	}
+	if (outputCode != 0) {
+		run.messages = "The test or sweep has unsettable specifics in it.\n";
+		return false;
+	}
+
+	long minutesToRun = test.minutesToRun;
+	result.yearly = minutesToRun > 500000.;
+	FILE *outputFile = NULL;
+	if (!result.yearly) {
+		string fileToOpen = outputDirectory + "/" + run.outputName + ".csv";
+		outputFile = fopen(fileToOpen.c_str(), "w+");
+		if (outputFile == NULL) {
+			run.messages = "Could not open output file " + fileToOpen + "\n";
+			return false;
+		}
+		hpwh.WriteCSVHeading(outputFile, "minutes,Ta,Tsetpoint,inletT,draw,", nTestTCouples, 0);
+	}
+
+	// the yearly mix down changes the draws, so only those runs need their own copy
+	bool mixDown = hpwh.getHPWHModel() >= 210 && result.yearly;
+	schedule mixedDraws;
+	if (mixDown) {
+		mixedDraws = allSchedules[1];
+	}
+	const schedule &draws = mixDown ? mixedDraws : allSchedules[1];
+
+	double *cumHeatIn = result.heatIn_Wh;
+	double *cumHeatOut = result.heatOut_Wh;
+	for (long i = 0; i < minutesToRun; i++) {
+		double airTemp2 = HPWH_doTempDepress ? F_TO_C(airTemp->second) : allSchedules[2][i];
+		double tankHCStart = hpwh.getTankHeatContent_kJ();
+		HPWH::DRMODES drStatus = static_cast<HPWH::DRMODES>(int(allSchedules[4][i]));
+
+		// Change setpoint if there is a setpoint schedule.
+		if (setpointSchedule && !hpwh.isSetpointFixed()) {
+			hpwh.setSetpoint(allSchedules[5][i]); //expect this to fail sometimes
+		}
+
+		// Mix down for yearly tests with large compressors
+		if (mixDown && hpwh.getSetpoint() <= 125.) {
+			mixedDraws[i] *= (125. - allSchedules[0][i]) / (hpwh.getTankNodeTemp(hpwh.getNumNodes() - 1, HPWH::UNITS_F) - allSchedules[0][i]);
+		}
+
+		hpwh.runOneStep(allSchedules[0][i], GAL_TO_L(draws[i]), airTemp2, allSchedules[3][i], drStatus,
+			1. * GAL_TO_L(draws[i]), allSchedules[0][i], NULL);
+
+		// Check energy balance accounting.
+		double hpwhElect = 0;
+		for (int iHS = 0; iHS < hpwh.getNumHeatSources(); iHS++) {
+			hpwhElect += hpwh.getNthHeatSourceEnergyInput(iHS, HPWH::UNITS_KJ);
+		}
+		double hpwhqHW = GAL_TO_L(draws[i]) * (hpwh.getOutletTemp() - allSchedules[0][i])
+			* HPWH::DENSITYWATER_kgperL * HPWH::CPWATER_kJperkgC;
+		double qBal = hpwh.getEnergyRemovedFromEnvironment(HPWH::UNITS_KJ) - hpwh.getStandbyLosses(HPWH::UNITS_KJ)
+			+ hpwhElect - hpwhqHW - (hpwh.getTankHeatContent_kJ() - tankHCStart);
+		double fBal = fabs(qBal) / std::max(tankHCStart, 1.);
+		if (fBal > EBALTHRESHOLD) {
+			messages << "WARNING: On minute " << i << " HPWH has an energy balance error " << qBal << "kJ, " << 100 * fBal << "%" << "\n";
+			result.warnings++;
+		}
+		for (int iHS = 0; iHS < hpwh.getNumHeatSources(); iHS++) {
+			if (hpwh.getNthHeatSourceRunTime(iHS) > 1) {
+				messages << "WARNING: On minute " << i << " heat source " << iHS << " ran for " << hpwh.getNthHeatSourceRunTime(iHS) << "minutes" << "\n";
+				result.warnings++;
+			}
+			result.energyIn_kWh += hpwh.getNthHeatSourceEnergyInput(iHS);
+			result.energyOut_kWh += hpwh.getNthHeatSourceEnergyOutput(iHS);
+		}
+
+		// Recording
+		if (!result.yearly) {
+			if (HPWH_doTempDepress) {
+				airTemp2 = hpwh.getLocationTemp_C();
+			}
+			string strPreamble = std::to_string(i) + ", " + std::to_string(airTemp2) + ", " + std::to_string(hpwh.getSetpoint()) + ", " +
+				std::to_string(allSchedules[0][i]) + ", " + std::to_string(draws[i]) + ", ";
+			hpwh.WriteCSVRow(outputFile, strPreamble.c_str(), nTestTCouples, 0);
+		}
+		else {
+			for (int iHS = 0; iHS < hpwh.getNumHeatSources(); iHS++) {
+				cumHeatIn[iHS] += hpwh.getNthHeatSourceEnergyInput(iHS, HPWH::UNITS_KWH)*1000.;
+				cumHeatOut[iHS] += hpwh.getNthHeatSourceEnergyOutput(iHS, HPWH::UNITS_KWH)*1000.;
+			}
+		}
+	}
+
+	if (!result.yearly) {
+		fclose(outputFile);
+	}
+	run.messages = messages.str();
+	return true;
+}
+
+// the DHW_YRLY.csv row of a yearly run
+string yearRow(const Run &run) {
+	const SweepRecord &result = *run.record;
+	char buffer[64];
+	string row = run.test->name + "," + run.model->source + "," + run.model->name;
+	double totalIn = 0, totalOut = 0;
+	for (int iHS = 0; iHS < 3; iHS++) {
+		snprintf(buffer, sizeof(buffer), ",%0.0f,%0.0f", result.heatIn_Wh[iHS], result.heatOut_Wh[iHS]);
+		row += buffer;
+		totalIn += result.heatIn_Wh[iHS];
+		totalOut += result.heatOut_Wh[iHS];
+	}
+	snprintf(buffer, sizeof(buffer), ",%0.0f,%0.0f", totalIn, totalOut);
+	row += buffer;
+	for (int iHS = 0; iHS < 3; iHS++) {
+		snprintf(buffer, sizeof(buffer), ",%0.2f", result.heatOut_Wh[iHS] / result.heatIn_Wh[iHS]);
+		row += buffer;
+	}
+	snprintf(buffer, sizeof(buffer), ",%0.2f\n", totalOut / totalIn);
+	row += buffer;
+	return row;
+}
+
+// runs a run and writes its record, the status last, so a record that says it is complete is
+void runOne(Run &run, uint64_t index, const string &outputDirectory) {
+	SweepRecord result = {};
+	result.run = index;
+	bool ok = simulate(run, result, outputDirectory);
+	SweepRecord &record = *run.record;
+	record.warnings = result.warnings;
+	record.run = result.run;
+	record.yearly = result.yearly;
+	record.energyIn_kWh = result.energyIn_kWh;
+	record.energyOut_kWh = result.energyOut_kWh;
+	std::copy(result.heatIn_Wh, result.heatIn_Wh + 3, record.heatIn_Wh);
+	std::copy(result.heatOut_Wh, result.heatOut_Wh + 3, record.heatOut_Wh);
+	std::atomic_thread_fence(std::memory_order_release);
+	record.status = ok ? RECORD_DONE : RECORD_FAILED;
+}
+
+bool sameFile(const string &a, const string &b) {
+	std::ifstream fileA(a.c_str(), std::ios::binary), fileB(b.c_str(), std::ios::binary);
+	if (!fileA.is_open() || !fileB.is_open()) {
+		return false;
+	}
+	return std::equal(std::istreambuf_iterator<char>(fileA), std::istreambuf_iterator<char>(),
+		std::istreambuf_iterator<char>(fileB)) && fileB.peek() == EOF;
+}
+
+string optionName(const char *name, double value) {
+	std::ostringstream out;
+	out << "_" << name << value;
+	return out.str();
+}
+
+int main(int argc, char *argv[])
+{
+	std::vector<string> positional;
+	int shardIndex = 0, shardCount = 1;
+	bool useTable = false, resume = false;
+	string resultsPath;
+	for (int a = 1; a < argc; a++) {
+		string arg = argv[a];
+		if (arg == "--shard" && a + 1 < argc) {
+			char slash = 0;
+			std::istringstream shard(argv[++a]);
+			if (!(shard >> shardIndex >> slash >> shardCount) || slash != '/' || shardCount < 1 || shardIndex < 0 ||
+				shardIndex >= shardCount) {
+				cout << "A shard is i/n, with 0 <= i < n\n";
+				exit(1);
+			}
+			useTable = true;
+		}
+		else if (arg == "--results" && a + 1 < argc) {
+			resultsPath = argv[++a];
+			useTable = true;
+		}
+		else if (arg == "--resume") {
+			resume = true;
+			useTable = true;
+		}
+		else {
+			positional.push_back(arg);
+		}
+	}
+	if (positional.size() < 2 || positional.size() > 3) {
+		cout << "Standard usage: \"hpwhSweep [sweep file] [output directory] [threads (optional)] "
+			"[--shard i/n] [--results file] [--resume]\"\n";
+		exit(1);
+	}
+	string outputDirectory = positional[1];
+	int numThreads = (positional.size() > 2) ? atoi(positional[2].c_str()) : 0;
+	if (numThreads < 1) {
+		numThreads = std::max(1, (int)std::thread::hardware_concurrency());
+	}
+	if (resultsPath.empty()) {
+		resultsPath = outputDirectory + "/sweepResults.bin";
+	}
+
+	// ------------------------------------- Read the Sweep --------------------------------------- //
+	std::ifstream sweepFile(positional[0].c_str());
+	if (!sweepFile.is_open()) {
+		cout << "Could not open sweep file " << positional[0] << "\n";
+		exit(1);
+	}
+	std::vector<ModelSpec> models;
+	std::vector<TestInputs> tests;
+	std::vector<double> tankSizes(1, 0.), setpoints(1, 0.), tot_limits(1, 0.);
+	std::map<string, std::map<string, double> > airTemps;
+	string referenceDirectory, line, keyword;
+	while (std::getline(sweepFile, line)) {
+		std::istringstream words(line);
+		if (!(words >> keyword) || keyword[0] == '#') {
+			continue;
+		}
+		if (keyword == "model") {
+			ModelSpec model;
+			words >> model.source >> model.name;
+			if (model.source != "Preset" && model.source != "File") {
+				cout << "A model must be a Preset or File: " << line << "\n";
+				exit(1);
+			}
+			models.push_back(model);
+		}
+		else if (keyword == "test") {
+			tests.push_back(TestInputs());
+			words >> tests.back().name;
+		}
+		else if (keyword == "airtemp") {
+			string testName, modelName;
+			double airTemp;
+			if (!(words >> testName >> modelName >> airTemp)) {
+				cout << "An airtemp needs a test, a model and a temperature: " << line << "\n";
+				exit(1);
+			}
+			airTemps[testName][modelName] = airTemp;
+		}
+		else if (keyword == "tanksize" || keyword == "setpoint" || keyword == "tot_limit") {
+			std::vector<double> &values = (keyword == "tanksize") ? tankSizes : (keyword == "setpoint") ? setpoints : tot_limits;
+			values.clear();
+			for (double value; words >> value;) {
+				values.push_back(value);
+			}
+			if (values.empty()) {
+				cout << keyword << " needs at least one value\n";
+				exit(1);
+			}
+		}
+		else if (keyword == "reference") {
+			words >> referenceDirectory;
+		}
+		else {
+			cout << keyword << " in the sweep file is an unrecogized key.\n";
+			exit(1);
+		}
+	}
+
+	benchClock::time_point start = benchClock::now();
+	bool failed = false;
+	for (TestInputs &test : tests) {
+		test.ok = readTestInputs(test);
+		failed = failed || !test.ok;
+		if (airTemps.count(test.name)) {
+			test.airTemps = airTemps[test.name];
+		}
+	}
+
+	// every combination, in the order of the sweep file
+	std::vector<Run> runs;
+	for (const TestInputs &test : tests) {
+		for (const ModelSpec &model : models) {
+			if (!test.ok || (!test.airTemps.empty() && test.airTemps.count(model.name) == 0)) {
+				continue;
+			}
+			for (double tankSize : tankSizes) {
+				for (double setpoint : setpoints) {
+					for (double tot_limit : tot_limits) {
+						Run run;
+						run.model = &model;
+						run.test = &test;
+						run.tankSize = tankSize;
+						run.setpoint = setpoint;
+						run.tot_limit = tot_limit;
+						run.outputName = test.name + "_" + model.source + "_" + model.name +
+							((tankSize > 0.) ? optionName("tanksize", tankSize) : "") +
+							((setpoint > 0.) ? optionName("setpoint", setpoint) : "") +
+							((tot_limit > 0.) ? optionName("tot_limit", tot_limit) : "");
+						runs.push_back(run);
+					}
+				}
+			}
+		}
+	}
+	double readSeconds = secondsSince(start);
+
+	// the records, in the table or in memory
+	ResultTable table;
+	std::vector<SweepRecord> memoryRecords;
+	if (useTable) {
+		string error = table.open(resultsPath, runs.size(), hashRuns(runs));
+		if (!error.empty()) {
+			cout << error << "\n";
+			exit(1);
+		}
+	}
+	else {
+		memoryRecords.assign(runs.size(), SweepRecord());
+	}
+	SweepRecord *records = useTable ? table.records() : memoryRecords.data();
+
+	// this shard's runs, less those already done if resuming
+	std::vector<size_t> shardRuns, toRun;
+	for (size_t r = 0; r < runs.size(); r++) {
+		runs[r].record = &records[r];
+		if ((long)(r % shardCount) != shardIndex) {
+			continue;
+		}
+		shardRuns.push_back(r);
+		if (resume && records[r].status == RECORD_DONE && records[r].run == r) {
+			continue;
+		}
+		records[r] = SweepRecord();
+		toRun.push_back(r);
+	}
+
+	// ------------------------------------- Simulate --------------------------------------- //
+	cout << "Running " << toRun.size() << " runs on " << numThreads << " threads";
+	if (shardCount > 1) {
+		cout << ", shard " << shardIndex << " of " << shardCount;
+	}
+	if (toRun.size() < shardRuns.size()) {
+		cout << ", " << shardRuns.size() - toRun.size() << " already done";
+	}
+	cout << "\n";
+	std::atomic<size_t> nextRun(0);
+	auto worker = [&]() {
+		for (size_t i = nextRun++; i < toRun.size(); i = nextRun++) {
+			runOne(runs[toRun[i]], toRun[i], outputDirectory);
+		}
+	};
+	std::vector<std::thread> threads;
+	for (int t = 0; t < numThreads; t++) {
+		threads.push_back(std::thread(worker));
+	}
+	for (auto &thread : threads) {
+		thread.join();
+	}
+	double seconds = secondsSince(start);
+
+	// ------------------------------------- Report, in order --------------------------------------- //
+	// the summary and yearly results cover the whole sweep, so only a process that has all of it
+	// writes them
+	bool wholeSweep = shardCount == 1;
+	FILE *summaryFile = wholeSweep ? fopen((outputDirectory + "/sweepSummary.csv").c_str(), "w") : NULL;
+	FILE *yearOutFile = NULL;
+	int mismatches = 0;
+	if (summaryFile != NULL) {
+		fprintf(summaryFile, "run,test,source,model,tanksize,setpoint,tot_limit,energyIn_kWh,energyOut_kWh,warnings,failed\n");
+	}
+	for (size_t r : shardRuns) {
+		Run &run = runs[r];
+		const SweepRecord &record = *run.record;
+		bool runFailed = record.status != RECORD_DONE;
+		cout << run.messages;
+		failed = failed || runFailed;
+		if (runFailed) {
+			cout << "Failed: " << run.outputName << "\n";
+		}
+		if (summaryFile != NULL) {
+			fprintf(summaryFile, "%d,%s,%s,%s,%g,%g,%g,%.6f,%.6f,%d,%d\n", (int)r, run.test->name.c_str(), run.model->source.c_str(),
+				run.model->name.c_str(), run.tankSize, run.setpoint, run.tot_limit, record.energyIn_kWh, record.energyOut_kWh,
+				(int)record.warnings, runFailed ? 1 : 0);
+		}
+		if (wholeSweep && record.yearly && !runFailed) {
+			if (yearOutFile == NULL) {
+				yearOutFile = fopen((outputDirectory + "/DHW_YRLY.csv").c_str(), "w");
+			}
+			if (yearOutFile != NULL) {
+				fprintf(yearOutFile, "%s", yearRow(run).c_str());
+			}
+		}
+		if (!referenceDirectory.empty() && !record.yearly && !runFailed &&
+			!sameFile(outputDirectory + "/" + run.outputName + ".csv", referenceDirectory + "/" + run.outputName + ".csv")) {
+			cout << "Differs from the reference: " << run.outputName << "\n";
+			mismatches++;
+		}
+	}
+	if (summaryFile != NULL) {
+		fclose(summaryFile);
+	}
+	if (yearOutFile != NULL) {
+		fclose(yearOutFile);
+	}
+
+	printf("%d runs, schedules read in %.3f s, %.3f s in all, %.2f runs per second\n", (int)toRun.size(), readSeconds, seconds,
+		toRun.size() / seconds);
+	if (!referenceDirectory.empty()) {
+		printf("%d of %d runs differ from %s\n", mismatches, (int)shardRuns.size(), referenceDirectory.c_str());
+	}
+	return (failed || mismatches > 0) ? 1 : 0;
+}
@@ -0,0 +1,519 @@
+/*hpwhd, a local simulation service: holds a pool of HPWH tanks in memory and steps them for
+ * clients on a Unix domain socket, so tools that drive the same tanks share one model setup.
+ * The requests are in hpwhdProtocol.hh, which also has a client.
+ *
+ * Each connection has a thread that reads its requests and writes the replies, and one
+ * simulation thread owns the tanks.  It takes every request waiting when it wakes, in the order
+ * they came, and runs the step requests among them in one fleet step over the worker threads,
+ * until one needs a tank already in the step or is not a step, which waits for the next.  So
+ * concurrent clients' steps run together, and each client still sees its own in order.
+ * Outputs can go to a file the client maps, rather than through the socket.
+ *
+ * Usage: hpwhd [socket path] [threads (optional)]
+ */
+#include "HPWH.hh"
+#include "hpwhdProtocol.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <csignal>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using std::cout;
+using std::string;
+
+static char socketPathForSignal[sizeof(sockaddr_un::sun_path)];
+
+static void stopOnSignal(int) {
+	unlink(socketPathForSignal);
+	_exit(0);
+}
+
+struct Tank {
+	HPWH hpwh;
+	HPWH::StepOutputs last;
+	uint64_t round = 0;  // the fleet step it is in, so a fleet step steps a tank once
+};
+
+struct Connection {
+	int fd = -1;
+	char *map = NULL;  // the region of HPWHD_MAP, only used by the simulation thread
+	size_t mapSize = 0;
+	std::thread thread;
+	std::atomic<bool> finished{ false };
+
+	~Connection() {
+		if (map != NULL) {
+			munmap(map, mapSize);
+		}
+		if (fd >= 0) {
+			close(fd);
+		}
+	}
+};
+
+struct Job {
+	Connection *connection;
+	HpwhdRequestHeader header;
+	std::vector<char> payload;
+	int status = 0;
+	std::vector<char> reply;
+	bool done = false;
+
+	void fail(const string &message) {
+		status = HPWH::HPWH_ABORT;
+		reply.assign(message.begin(), message.end());
+	}
+};
+
+// one tank's part of a fleet step
+struct FleetItem {
+	Tank *tank;
+	HpwhdStep step;
+	HPWH::StepOutputs *outputs;
+	int result;
+};
+
+class Service {
+public:
+	Service(int threads) : numThreads(threads) {}
+
+	int serve(const string &socketPath);
+
+private:
+	void readRequests(Connection *connection);
+	void simulate();
+	void handle(Job *job);
+	bool addToFleetStep(Job *job);
+	void runFleetStep();
+	HPWH::StepOutputs *outputsFor(Job *job, uint32_t n);
+	bool takeTank(Job *job, size_t &offset, Tank *&tank);
+
+	int numThreads;
+	int listenFd = -1;
+	std::atomic<bool> stopping{ false };
+	bool simulationDone = false;  // set once no connection can add a job
+
+	std::mutex mutex;
+	std::condition_variable jobsWaiting;
+	std::condition_variable jobsDone;
+	std::deque<Job *> jobs;
+
+	std::mutex connectionsMutex;
+	std::vector<std::unique_ptr<Connection>> connections;
+
+	// the simulation thread's own
+	std::vector<std::unique_ptr<Tank>> tanks;
+	std::vector<FleetItem> fleet;
+	std::vector<Job *> fleetJobs;
+	uint64_t round = 1;
+	HpwhdStats stats = {};
+};
+
+int Service::serve(const string &socketPath) {
+	sockaddr_un address = {};
+	address.sun_family = AF_UNIX;
+	if (socketPath.size() >= sizeof(address.sun_path)) {
+		cout << "The socket path is too long: " << socketPath << "\n";
+		return 1;
+	}
+	strcpy(address.sun_path, socketPath.c_str());
+	strcpy(socketPathForSignal, socketPath.c_str());
+	unlink(socketPath.c_str());
+	listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listenFd < 0 || bind(listenFd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+		listen(listenFd, 128) != 0) {
+		cout << "Could not listen on " << socketPath << "\n";
+		return 1;
+	}
+	signal(SIGINT, stopOnSignal);
+	signal(SIGTERM, stopOnSignal);
+	cout << "hpwhd listening on " << socketPath << " with " << numThreads << " threads\n";
+	cout.flush();
+
+	std::thread simulation(&Service::simulate, this);
+	while (!stopping) {
+		int fd = accept(listenFd, NULL, NULL);
+		if (fd < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+		std::lock_guard<std::mutex> lock(connectionsMutex);
+		for (size_t i = 0; i < connections.size();) {
+			if (connections[i]->finished) {
+				connections[i]->thread.join();
+				connections.erase(connections.begin() + i);
+			}
+			else {
+				i++;
+			}
+		}
+		connections.emplace_back(new Connection);
+		Connection *connection = connections.back().get();
+		connection->fd = fd;
+		connection->thread = std::thread(&Service::readRequests, this, connection);
+	}
+
+	// wake the connections still reading, then the simulation thread
+	{
+		std::lock_guard<std::mutex> lock(connectionsMutex);
+		for (std::unique_ptr<Connection> &connection : connections) {
+			::shutdown(connection->fd, SHUT_RDWR);
+		}
+	}
+	for (std::unique_ptr<Connection> &connection : connections) {
+		connection->thread.join();
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		simulationDone = true;
+		jobsWaiting.notify_all();
+	}
+	simulation.join();
+	close(listenFd);
+	unlink(socketPath.c_str());
+	return 0;
+}
+
+void Service::readRequests(Connection *connection) {
+	Job job;
+	job.connection = connection;
+	while (!stopping && hpwhdRead(connection->fd, &job.header, sizeof(job.header))) {
+		job.status = 0;
+		job.reply.clear();
+		job.done = false;
+		bool valid = job.header.magic == HPWHD_MAGIC && job.header.version == HPWHD_VERSION &&
+			job.header.payloadBytes <= HPWHD_MAX_PAYLOAD;
+		if (valid) {
+			job.payload.resize(job.header.payloadBytes);
+			if (!hpwhdRead(connection->fd, job.payload.data(), job.payload.size())) {
+				break;
+			}
+			std::unique_lock<std::mutex> lock(mutex);
+			jobs.push_back(&job);
+			jobsWaiting.notify_one();
+			jobsDone.wait(lock, [&job] { return job.done; });
+		}
+		else {
+			job.fail("The request is not of this version of hpwhd");
+		}
+		HpwhdResponseHeader response = { HPWHD_MAGIC, job.status, (uint32_t)job.reply.size(), 0 };
+		if (!hpwhdWrite(connection->fd, &response, sizeof(response)) ||
+			!hpwhdWrite(connection->fd, job.reply.data(), job.reply.size()) || !valid) {
+			break;
+		}
+		if (job.header.type == HPWHD_SHUTDOWN) {
+			stopping = true;
+			::shutdown(listenFd, SHUT_RDWR);
+			break;
+		}
+	}
+	::shutdown(connection->fd, SHUT_RDWR);
+	connection->finished = true;
+}
+
+void Service::simulate() {
+	std::deque<Job *> waiting;
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			jobsWaiting.wait(lock, [this] { return !jobs.empty() || simulationDone; });
+			if (jobs.empty()) {
+				return;
+			}
+			waiting.swap(jobs);
+		}
+
+		// step requests join the fleet step until one cannot, then it runs
+		std::vector<Job *> finished;
+		for (Job *job : waiting) {
+			stats.requests++;
+			if (job->header.type == HPWHD_STEP) {
+				stats.stepRequests++;
+				if (!addToFleetStep(job)) {
+					runFleetStep();
+					addToFleetStep(job);
+				}
+			}
+			else {
+				runFleetStep();
+				handle(job);
+			}
+			finished.push_back(job);
+		}
+		runFleetStep();
+		waiting.clear();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		for (Job *job : finished) {
+			job->done = true;
+		}
+		jobsDone.notify_all();
+	}
+}
+
+// where a job's n outputs go: its reply, or the connection's mapped region
+HPWH::StepOutputs *Service::outputsFor(Job *job, uint32_t n) {
+	size_t bytes = (size_t)n * sizeof(HPWH::StepOutputs);
+	if (job->header.flags & HPWHD_TO_SHARED) {
+		if (job->connection->map == NULL || bytes > job->connection->mapSize) {
+			job->fail("The outputs do not fit in the mapped region");
+			return NULL;
+		}
+		return reinterpret_cast<HPWH::StepOutputs *>(job->connection->map);
+	}
+	job->reply.resize(bytes);
+	return reinterpret_cast<HPWH::StepOutputs *>(job->reply.data());
+}
+
+bool Service::takeTank(Job *job, size_t &offset, Tank *&tank) {
+	uint32_t index;
+	if (!hpwhdTake(job->payload, offset, index)) {
+		job->fail("The request is too short");
+		return false;
+	}
+	if (index >= tanks.size()) {
+		job->fail("There is no tank " + std::to_string(index));
+		return false;
+	}
+	tank = tanks[index].get();
+	return true;
+}
+
+// adds a step request to the fleet step, false if one of its tanks is in it already.  A bad
+// request fails here and adds nothing
+bool Service::addToFleetStep(Job *job) {
+	size_t offset = 0;
+	uint32_t n;
+	if (!hpwhdTake(job->payload, offset, n) || job->payload.size() != offset + (size_t)n * sizeof(HpwhdStep)) {
+		job->fail("The step request is not the size of its steps");
+		return true;
+	}
+	std::vector<HpwhdStep> steps(n);
+	memcpy(steps.data(), job->payload.data() + offset, n * sizeof(HpwhdStep));
+	std::vector<uint32_t> stepped;
+	bool conflict = false;
+	for (const HpwhdStep &step : steps) {
+		if (step.tank >= tanks.size()) {
+			job->fail("There is no tank " + std::to_string(step.tank));
+			return true;
+		}
+		stepped.push_back(step.tank);
+		conflict = conflict || tanks[step.tank]->round == round;
+	}
+	std::sort(stepped.begin(), stepped.end());
+	std::vector<uint32_t>::iterator twice = std::adjacent_find(stepped.begin(), stepped.end());
+	if (twice != stepped.end()) {
+		job->fail("Tank " + std::to_string(*twice) + " is in the step request twice");
+		return true;
+	}
+	if (conflict) {
+		return false;
+	}
+
+	HPWH::StepOutputs *outputs = outputsFor(job, n);
+	if (outputs == NULL) {
+		return true;
+	}
+	for (uint32_t i = 0; i < n; i++) {
+		FleetItem item;
+		item.step = steps[i];
+		item.tank = tanks[item.step.tank].get();
+		item.tank->round = round;
+		item.outputs = outputs + i;
+		item.result = 0;
+		fleet.push_back(item);
+	}
+	fleetJobs.push_back(job);
+	return true;
+}
+
+void Service::runFleetStep() {
+	if (fleet.empty()) {
+		return;
+	}
+	auto stepItems = [this](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			FleetItem &item = fleet[i];
+			const HpwhdStep &step = item.step;
+			item.result = item.tank->hpwh.runOneStep(step.inletT_C, step.drawVolume_L, step.tankAmbientT_C,
+				step.heatSourceAmbientT_C, static_cast<HPWH::DRMODES>(step.DRstatus));
+			if (item.result == 0) {
+				item.result = item.tank->hpwh.getStepOutputs(item.tank->last);
+			}
+			*item.outputs = item.tank->last;
+		}
+	};
+
+	// a thread is only worth starting for a good number of tanks
+	const size_t minTanksPerThread = 64;
+	size_t threads = std::min((size_t)numThreads, std::max((size_t)1, fleet.size() / minTanksPerThread));
+	if (threads == 1) {
+		stepItems(0, fleet.size());
+	}
+	else {
+		std::vector<std::thread> workers;
+		for (size_t t = 1; t < threads; t++) {
+			workers.emplace_back(stepItems, t * fleet.size() / threads, (t + 1) * fleet.size() / threads);
+		}
+		stepItems(0, fleet.size() / threads);
+		for (std::thread &worker : workers) {
+			worker.join();
+		}
+	}
+
+	// the items are in job order, so each job's failures are together
+	size_t i = 0;
+	for (Job *job : fleetJobs) {
+		uint32_t n;
+		memcpy(&n, job->payload.data(), sizeof(n));
+		for (uint32_t j = 0; j < n; j++, i++) {
+			if (fleet[i].result != 0 && job->status == 0) {
+				job->fail("Tank " + std::to_string(fleet[i].step.tank) + " failed its step");
+			}
+		}
+	}
+	stats.fleetSteps++;
+	stats.tankSteps += fleet.size();
+	fleet.clear();
+	fleetJobs.clear();
+	round++;
+}
+
+void Service::handle(Job *job) {
+	size_t offset = 0;
+	switch (job->header.type) {
+	case HPWHD_CREATE: {
+		uint32_t count;
+		if (!hpwhdTake(job->payload, offset, count) || count == 0 || count > (1u << 20)) {
+			job->fail("Create from 1 to 1048576 tanks");
+			return;
+		}
+		string model(job->payload.begin() + offset, job->payload.end());
+		std::unique_ptr<Tank> first(new Tank);
+		int result = HPWH::HPWH_ABORT;
+		if (job->header.flags & HPWHD_FROM_FILE) {
+			result = first->hpwh.HPWHinit_fileCached(model);
+		}
+		else if (HPWH::findPreset(model) != NULL) {
+			result = first->hpwh.HPWHinit_presetsCached(HPWH::findPreset(model)->model);
+		}
+		if (result != 0 || first->hpwh.getStepOutputs(first->last) != 0) {
+			job->fail("Could not create the model " + model);
+			return;
+		}
+		uint32_t firstTank = (uint32_t)tanks.size();
+		for (uint32_t i = 1; i < count; i++) {
+			tanks.emplace_back(new Tank(*first));
+		}
+		tanks.emplace_back(std::move(first));
+		hpwhdAppend(job->reply, firstTank);
+		hpwhdAppend(job->reply, count);
+		stats.tanks = tanks.size();
+		return;
+	}
+	case HPWHD_QUERY: {
+		uint32_t n;
+		if (!hpwhdTake(job->payload, offset, n) || job->payload.size() != offset + (size_t)n * sizeof(uint32_t)) {
+			job->fail("The query is not the size of its tanks");
+			return;
+		}
+		std::vector<Tank *> queried(n);
+		for (Tank *&tank : queried) {
+			if (!takeTank(job, offset, tank)) {
+				return;
+			}
+		}
+		HPWH::StepOutputs *outputs = outputsFor(job, n);
+		for (uint32_t i = 0; outputs != NULL && i < n; i++) {
+			outputs[i] = queried[i]->last;
+		}
+		return;
+	}
+	case HPWHD_SNAPSHOT: {
+		Tank *tank;
+		HPWH::SimState state;
+		if (!takeTank(job, offset, tank)) {
+			return;
+		}
+		if (tank->hpwh.getSimState(state) != 0) {
+			job->fail("Could not take the snapshot");
+			return;
+		}
+		encodeSimState(state, job->reply);
+		return;
+	}
+	case HPWHD_RESTORE: {
+		Tank *tank;
+		HPWH::SimState state;
+		if (!takeTank(job, offset, tank)) {
+			return;
+		}
+		if (!decodeSimState(job->payload, offset, state) || tank->hpwh.setSimState(state) != 0) {
+			job->fail("The snapshot is not of a tank of this model");
+		}
+		return;
+	}
+	case HPWHD_MAP: {
+		Connection *connection = job->connection;
+		uint64_t size;
+		if (!hpwhdTake(job->payload, offset, size) || size == 0) {
+			job->fail("Map a region of at least one byte");
+			return;
+		}
+		string path(job->payload.begin() + offset, job->payload.end());
+		int fd = open(path.c_str(), O_RDWR);
+		struct stat status;
+		if (fd < 0 || fstat(fd, &status) != 0 || (uint64_t)status.st_size < size) {
+			job->fail("Could not open " + path + " with " + std::to_string(size) + " bytes");
+			if (fd >= 0) {
+				close(fd);
+			}
+			return;
+		}
+		void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		if (map == MAP_FAILED) {
+			job->fail("Could not map " + path);
+			return;
+		}
+		if (connection->map != NULL) {
+			munmap(connection->map, connection->mapSize);
+		}
+		connection->map = static_cast<char *>(map);
+		connection->mapSize = size;
+		return;
+	}
+	case HPWHD_STATS:
+		hpwhdAppend(job->reply, stats);
+		return;
+	case HPWHD_SHUTDOWN:
+		return;
+	default:
+		job->fail("Unknown request " + std::to_string(job->header.type));
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2 || argc > 3) {
+		cout << "Usage: hpwhd [socket path] [threads (optional)]\n";
+		exit(1);
+	}
+	int threads = (argc > 2) ? atoi(argv[2]) : (int)std::thread::hardware_concurrency();
+	Service service(std::max(1, threads));
+	return service.serve(argv[1]);
+}
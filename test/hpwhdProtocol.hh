@@ -0,0 +1,316 @@
+/*The request and response format of hpwhd, the local simulation service, and a small blocking
+ * client for it.
+ *
+ * Every message is a fixed header and a payload of header.payloadBytes.  Numbers are in the
+ * byte order of the machine, which the socket never leaves, and step outputs are HPWH::StepOutputs
+ * as they are in memory, so a client must be built with the same HPWH.hh; the protocol version
+ * includes sizeof(HPWH::StepOutputs) to catch one that is not.
+ *
+ *   HPWHD_CREATE    uint32 count, then a preset name, or a model file path with HPWHD_FROM_FILE.
+ *                   Replies uint32 first tank, uint32 count.  Tanks are numbered from 0 and
+ *                   never removed
+ *   HPWHD_STEP      uint32 n, then n HpwhdStep.  Runs one minute of each tank, all in one
+ *                   fleet step, and replies n HPWH::StepOutputs in the same order.  A tank may
+ *                   only appear once.  With HPWHD_TO_SHARED the outputs go to the start of the
+ *                   mapped region instead and the reply is empty
+ *   HPWHD_QUERY     uint32 n, then n uint32 tanks.  Replies the outputs of each tank's last
+ *                   step, as HPWHD_STEP does, HPWHD_TO_SHARED included
+ *   HPWHD_SNAPSHOT  uint32 tank.  Replies the tank's HPWH::SimState, see encodeSimState
+ *   HPWHD_RESTORE   uint32 tank, then a snapshot of a tank of the same model
+ *   HPWHD_MAP       uint64 size, then the path of a file of at least size bytes that the
+ *                   service maps for this connection, for HPWHD_TO_SHARED
+ *   HPWHD_STATS     replies HpwhdStats
+ *   HPWHD_SHUTDOWN  stops the service once it has replied
+ *
+ * A failed request replies HPWH::HPWH_ABORT and a message as the payload.
+ */
+#ifndef HPWHD_PROTOCOL_hh
+#define HPWHD_PROTOCOL_hh
+
+#include "HPWH.hh"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+const uint32_t HPWHD_MAGIC = 0x44575048;  // "HPWD"
+const uint32_t HPWHD_VERSION = (1u << 16) | (uint32_t)sizeof(HPWH::StepOutputs);
+const uint32_t HPWHD_MAX_PAYLOAD = 64u << 20;
+
+enum HPWHD_REQUEST : uint16_t {
+	HPWHD_CREATE = 1,
+	HPWHD_STEP = 2,
+	HPWHD_QUERY = 3,
+	HPWHD_SNAPSHOT = 4,
+	HPWHD_RESTORE = 5,
+	HPWHD_MAP = 6,
+	HPWHD_STATS = 7,
+	HPWHD_SHUTDOWN = 8
+};
+
+enum HPWHD_FLAGS : uint16_t {
+	HPWHD_FROM_FILE = 1,  // HPWHD_CREATE from a model file rather than a preset
+	HPWHD_TO_SHARED = 2   // HPWHD_STEP and HPWHD_QUERY outputs to the mapped region
+};
+
+struct HpwhdRequestHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint16_t type;
+	uint16_t flags;
+	uint32_t payloadBytes;
+};
+
+struct HpwhdResponseHeader {
+	uint32_t magic;
+	int32_t status;  // 0 or HPWH::HPWH_ABORT
+	uint32_t payloadBytes;
+	uint32_t unused;
+};
+
+// the inputs of one tank's step, as runOneStep takes them
+struct HpwhdStep {
+	uint32_t tank;
+	int32_t DRstatus;  // HPWH::DRMODES
+	double inletT_C;
+	double drawVolume_L;
+	double tankAmbientT_C;
+	double heatSourceAmbientT_C;
+};
+static_assert(sizeof(HpwhdStep) == 40, "HpwhdStep is sent as it is");
+
+struct HpwhdStats {
+	uint64_t tanks;
+	uint64_t requests;
+	uint64_t stepRequests;
+	uint64_t fleetSteps;  // each runs the step requests waiting when it started, together
+	uint64_t tankSteps;
+};
+
+// reads or writes all of size bytes, false if the connection closed or failed
+inline bool hpwhdRead(int fd, void *data, size_t size) {
+	char *bytes = static_cast<char *>(data);
+	while (size > 0) {
+		ssize_t n = read(fd, bytes, size);
+		if (n <= 0) {
+			return false;
+		}
+		bytes += n;
+		size -= n;
+	}
+	return true;
+}
+
+inline bool hpwhdWrite(int fd, const void *data, size_t size) {
+	const char *bytes = static_cast<const char *>(data);
+	while (size > 0) {
+		ssize_t n = send(fd, bytes, size, MSG_NOSIGNAL);
+		if (n <= 0) {
+			return false;
+		}
+		bytes += n;
+		size -= n;
+	}
+	return true;
+}
+
+template <typename T>
+void hpwhdAppend(std::vector<char> &buffer, const T &value) {
+	const char *bytes = reinterpret_cast<const char *>(&value);
+	buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+// takes a T from buffer at offset and moves offset past it, false if the buffer is too short
+template <typename T>
+bool hpwhdTake(const std::vector<char> &buffer, size_t &offset, T &value) {
+	if (offset + sizeof(T) > buffer.size()) {
+		return false;
+	}
+	memcpy(&value, buffer.data() + offset, sizeof(T));
+	offset += sizeof(T);
+	return true;
+}
+
+inline void encodeSimState(const HPWH::SimState &state, std::vector<char> &buffer) {
+	hpwhdAppend(buffer, (uint32_t)state.tankTemps_C.size());
+	hpwhdAppend(buffer, (uint32_t)state.heatSourcesOn.size());
+	for (double T : state.tankTemps_C) {
+		hpwhdAppend(buffer, T);
+	}
+	for (size_t i = 0; i < state.heatSourcesOn.size(); i++) {
+		hpwhdAppend(buffer, (uint8_t)state.heatSourcesOn[i]);
+		hpwhdAppend(buffer, (uint8_t)state.heatSourcesLockedOut[i]);
+	}
+	hpwhdAppend(buffer, (uint8_t)state.isHeating);
+	hpwhdAppend(buffer, (int32_t)state.prevDRstatus);
+	hpwhdAppend(buffer, state.setpoint_C);
+	hpwhdAppend(buffer, state.timerTOT);
+	hpwhdAppend(buffer, state.locationTemperature_C);
+}
+
+inline bool decodeSimState(const std::vector<char> &buffer, size_t offset, HPWH::SimState &state) {
+	uint32_t nodes, heatSources;
+	if (!hpwhdTake(buffer, offset, nodes) || !hpwhdTake(buffer, offset, heatSources) ||
+		nodes > (1u << 16) || heatSources > (1u << 8)) {
+		return false;
+	}
+	state.tankTemps_C.resize(nodes);
+	for (double &T : state.tankTemps_C) {
+		if (!hpwhdTake(buffer, offset, T)) {
+			return false;
+		}
+	}
+	state.heatSourcesOn.resize(heatSources);
+	state.heatSourcesLockedOut.resize(heatSources);
+	for (uint32_t i = 0; i < heatSources; i++) {
+		uint8_t on, lockedOut;
+		if (!hpwhdTake(buffer, offset, on) || !hpwhdTake(buffer, offset, lockedOut)) {
+			return false;
+		}
+		state.heatSourcesOn[i] = on != 0;
+		state.heatSourcesLockedOut[i] = lockedOut != 0;
+	}
+	uint8_t isHeating;
+	int32_t prevDRstatus;
+	if (!hpwhdTake(buffer, offset, isHeating) || !hpwhdTake(buffer, offset, prevDRstatus) ||
+		!hpwhdTake(buffer, offset, state.setpoint_C) || !hpwhdTake(buffer, offset, state.timerTOT) ||
+		!hpwhdTake(buffer, offset, state.locationTemperature_C)) {
+		return false;
+	}
+	state.isHeating = isHeating != 0;
+	state.prevDRstatus = static_cast<HPWH::DRMODES>(prevDRstatus);
+	return offset == buffer.size();
+}
+
+// a blocking client: one request at a time on one connection.  Use a client per thread
+class HpwhdClient {
+public:
+	~HpwhdClient() {
+		if (fd >= 0) {
+			close(fd);
+		}
+	}
+
+	bool connectTo(const std::string &socketPath) {
+		sockaddr_un address = {};
+		address.sun_family = AF_UNIX;
+		if (socketPath.size() >= sizeof(address.sun_path)) {
+			return false;
+		}
+		strcpy(address.sun_path, socketPath.c_str());
+		fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0) {
+			return true;
+		}
+		if (fd >= 0) {
+			close(fd);
+		}
+		fd = -1;
+		return false;
+	}
+
+	// sends a request and waits for its reply, returns its status or HPWH::HPWH_ABORT if the
+	// connection failed.  A failed request's message is in getError
+	int call(uint16_t type, uint16_t flags, const std::vector<char> &payload, std::vector<char> &reply) {
+		HpwhdRequestHeader header = { HPWHD_MAGIC, HPWHD_VERSION, type, flags, (uint32_t)payload.size() };
+		HpwhdResponseHeader response;
+		if (fd < 0 || !hpwhdWrite(fd, &header, sizeof(header)) || !hpwhdWrite(fd, payload.data(), payload.size()) ||
+			!hpwhdRead(fd, &response, sizeof(response)) || response.magic != HPWHD_MAGIC ||
+			response.payloadBytes > HPWHD_MAX_PAYLOAD) {
+			error = "the connection to hpwhd failed";
+			return HPWH::HPWH_ABORT;
+		}
+		reply.resize(response.payloadBytes);
+		if (!hpwhdRead(fd, reply.data(), reply.size())) {
+			error = "the connection to hpwhd failed";
+			return HPWH::HPWH_ABORT;
+		}
+		error = (response.status == 0) ? "" : std::string(reply.begin(), reply.end());
+		return response.status;
+	}
+
+	int create(const std::string &model, uint32_t count, uint32_t &firstTank, bool fromFile = false) {
+		std::vector<char> payload, reply;
+		hpwhdAppend(payload, count);
+		payload.insert(payload.end(), model.begin(), model.end());
+		int status = call(HPWHD_CREATE, fromFile ? HPWHD_FROM_FILE : 0, payload, reply);
+		size_t offset = 0;
+		return (status == 0 && hpwhdTake(reply, offset, firstTank)) ? 0 : HPWH::HPWH_ABORT;
+	}
+
+	// steps each tank of steps, outputs gets one entry per step, or nothing with toShared
+	int step(const std::vector<HpwhdStep> &steps, std::vector<HPWH::StepOutputs> &outputs, bool toShared = false) {
+		std::vector<char> payload, reply;
+		payload.reserve(sizeof(uint32_t) + steps.size() * sizeof(HpwhdStep));
+		hpwhdAppend(payload, (uint32_t)steps.size());
+		const char *bytes = reinterpret_cast<const char *>(steps.data());
+		payload.insert(payload.end(), bytes, bytes + steps.size() * sizeof(HpwhdStep));
+		return takeOutputs(call(HPWHD_STEP, toShared ? HPWHD_TO_SHARED : 0, payload, reply), reply, outputs);
+	}
+
+	int query(const std::vector<uint32_t> &tanks, std::vector<HPWH::StepOutputs> &outputs, bool toShared = false) {
+		std::vector<char> payload, reply;
+		hpwhdAppend(payload, (uint32_t)tanks.size());
+		for (uint32_t tank : tanks) {
+			hpwhdAppend(payload, tank);
+		}
+		return takeOutputs(call(HPWHD_QUERY, toShared ? HPWHD_TO_SHARED : 0, payload, reply), reply, outputs);
+	}
+
+	int snapshot(uint32_t tank, HPWH::SimState &state) {
+		std::vector<char> payload, reply;
+		hpwhdAppend(payload, tank);
+		if (call(HPWHD_SNAPSHOT, 0, payload, reply) != 0 || !decodeSimState(reply, 0, state)) {
+			return HPWH::HPWH_ABORT;
+		}
+		return 0;
+	}
+
+	int restore(uint32_t tank, const HPWH::SimState &state) {
+		std::vector<char> payload, reply;
+		hpwhdAppend(payload, tank);
+		encodeSimState(state, payload);
+		return call(HPWHD_RESTORE, 0, payload, reply);
+	}
+
+	// has the service map size bytes of the file at path, for the toShared outputs
+	int mapShared(const std::string &path, uint64_t size) {
+		std::vector<char> payload, reply;
+		hpwhdAppend(payload, size);
+		payload.insert(payload.end(), path.begin(), path.end());
+		return call(HPWHD_MAP, 0, payload, reply);
+	}
+
+	int stats(HpwhdStats &stats) {
+		std::vector<char> payload, reply;
+		size_t offset = 0;
+		return (call(HPWHD_STATS, 0, payload, reply) == 0 && hpwhdTake(reply, offset, stats)) ? 0 : HPWH::HPWH_ABORT;
+	}
+
+	int shutdown() {
+		std::vector<char> payload, reply;
+		return call(HPWHD_SHUTDOWN, 0, payload, reply);
+	}
+
+	const std::string &getError() const { return error; }
+
+private:
+	int takeOutputs(int status, const std::vector<char> &reply, std::vector<HPWH::StepOutputs> &outputs) {
+		if (status != 0 || reply.size() % sizeof(HPWH::StepOutputs) != 0) {
+			return HPWH::HPWH_ABORT;
+		}
+		outputs.resize(reply.size() / sizeof(HPWH::StepOutputs));
+		memcpy(outputs.data(), reply.data(), reply.size());
+		return 0;
+	}
+
+	int fd = -1;
+	std::string error;
+};
+
+#endif
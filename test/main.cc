@@ -24,10 +24,6 @@ using std::string;
 using std::ifstream;
 //using std::ofstream;
 
-typedef std::vector<double> schedule;
-
-int readSchedule(schedule &scheduleArray, string scheduleFileName, long minutesOfTest);
-
 int main(int argc, char *argv[])
 {
   HPWH hpwh;
@@ -378,68 +374,3 @@ int main(int argc, char *argv[])
   return 0;
 
 }
-
-
-
-// this function reads the named schedule into the provided array
-int readSchedule(schedule &scheduleArray, string scheduleFileName, long minutesOfTest) {
-  int minuteHrTmp;
-  bool hourInput;
-  string line, snippet, s, minORhr;
-  double valTmp;
-  ifstream inputFile(scheduleFileName.c_str());
-  //open the schedule file provided
-  cout << "Opening " << scheduleFileName << '\n';
-
-  if(!inputFile.is_open()) {
-    return 1;
-  }
-
-  inputFile >> snippet >> valTmp;
-  // cout << "snippet " << snippet << " valTmp"<< valTmp<<'\n';
-
-  if(snippet != "default") {
-    cout << "First line of " << scheduleFileName << " must specify default\n";
-    return 1;
-  }
-  // cout << valTmp << " minutes = " << minutesOfTest << "\n";
-
-  // Fill with the default value
-  scheduleArray.assign(minutesOfTest, valTmp);
-
-  // Burn the first two lines
-  std::getline(inputFile, line);
-  std::getline(inputFile, line);
-
-  std::stringstream ss(line); // Will parse with a stringstream
-  // Grab the first token, which is the minute or hour marker
-  ss >> minORhr;
-  if (minORhr.empty() ) { // If nothing left in the file
-	  return 0;
-  }
-  hourInput = tolower(minORhr.at(0)) == 'h';
-  char c; // to eat the commas nom nom
-  // Read all the exceptions to the default value
-  while (inputFile >> minuteHrTmp >> c >> valTmp) {
-
-		if (minuteHrTmp >= (int)scheduleArray.size()) {
-			cout << "In " << scheduleFileName << " the input file has more minutes than the test was defined with\n";
-			return 1;
-		}
-		// Update the value
-		if (!hourInput) {
-			scheduleArray[minuteHrTmp] = valTmp;
-		}
-		else if (hourInput) {
-			for (int j = minuteHrTmp * 60; j < (minuteHrTmp+1) * 60; j++) {
-				scheduleArray[j] = valTmp;
-				//cout << "minute " << j-(minuteHrTmp) * 60 << " of hour" << (minuteHrTmp)<<"\n";
-			}
-		}
-  }
-
-  inputFile.close();
-
-  return 0;
-
-}
\ No newline at end of file
@@ -0,0 +1,121 @@
+/*Fits a HPWHSurrogate to a preset, saves it, and reports its accuracy against the full
+ * model on held-out test schedules, none of which are used in the fit.
+ *
+ * Usage: makeSurrogate [model preset] [output file (optional)] [test directories (optional)]
+ * e.g.   makeSurrogate AOSmithHPTU80 AOSmithHPTU80.surrogate testCA_3BR_CTZ15 testDr_LO
+ */
+#include "HPWH.hh"
+#include "HPWHSurrogate.hh"
+#include "testUtilityFcts.cc"
+
+using std::cout;
+using std::string;
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2) {
+		cout << "Usage: makeSurrogate [model preset] [output file (optional)] [test directories (optional)]\n";
+		exit(1);
+	}
+	string modelName = argv[1];
+	string outputFile = (argc > 2) ? argv[2] : modelName + ".surrogate";
+	std::vector<string> testNames = { "testCA_3BR_CTZ15", "testCA_3BR_CTZ16", "testDOE_24hr50", "testDr_LO", "testDr_TOT" };
+	if (argc > 3) {
+		testNames.assign(argv + 3, argv + argc);
+	}
+
+	HPWHSurrogate::InitFunc init = [&](HPWH &hpwh) {
+		return getHPWHObject(hpwh, modelName) == 0 ? 0 : (int)HPWH::HPWH_ABORT;
+	};
+
+	std::shared_ptr<HPWHSurrogate::Model> model = std::make_shared<HPWHSurrogate::Model>();
+	benchClock::time_point start = benchClock::now();
+	if (model->fit(init) != 0 || model->writeFile(outputFile) != 0) {
+		cout << "Could not fit the surrogate for " << modelName << "\n";
+		exit(1);
+	}
+	printf("%s: fitted in %.2f s, saved to %s\n", modelName.c_str(), secondsSince(start), outputFile.c_str());
+	printf("test,minutes,energyInputFull_kWh,energyInputSurrogate_kWh,relativeError,hourlyCVRMSE,hourlyCorrelation,"
+		"heatingAgreement,outletMAE_C,secondsFull,secondsSurrogate,speedup\n");
+
+	for (string &testName : testNames) {
+		std::vector<schedule> allSchedules;
+		long minutesToRun;
+		double newSetpoint;
+		if (readTestSchedules(testName, allSchedules, minutesToRun, newSetpoint) != 0) {
+			exit(1);
+		}
+
+		HPWH hpwh;
+		init(hpwh);
+		HPWHSurrogate surrogate(model);
+		if (newSetpoint > 0 && !hpwh.isSetpointFixed()) {
+			hpwh.setSetpoint(newSetpoint);
+			hpwh.resetTankToSetpoint();
+			surrogate.setSetpoint(newSetpoint);
+			surrogate.resetTankToSetpoint();
+		}
+
+		// the full model, keeping hourly energy, the heating state and outlet temperature of each minute
+		std::vector<double> fullHourly_kWh((minutesToRun + 59) / 60, 0.), surrogateHourly_kWh(fullHourly_kWh.size(), 0.);
+		std::vector<bool> fullHeating(minutesToRun);
+		std::vector<double> fullOutletT_C(minutesToRun);
+		start = benchClock::now();
+		bool followSetpoint = !allSchedules[5].empty() && !hpwh.isSetpointFixed();
+		for (long i = 0; i < minutesToRun; i++) {
+			if (followSetpoint) {
+				hpwh.setSetpoint(allSchedules[5][i]);
+			}
+			hpwh.runOneStep(allSchedules[0][i], GAL_TO_L(allSchedules[1][i]), allSchedules[2][i], allSchedules[3][i],
+				static_cast<HPWH::DRMODES>(int(allSchedules[4][i])));
+			bool heating = false;
+			for (int j = 0; j < hpwh.getNumHeatSources(); j++) {
+				fullHourly_kWh[i / 60] += hpwh.getNthHeatSourceEnergyInput(j);
+				heating = heating || hpwh.isNthHeatSourceRunning(j) == 1;
+			}
+			fullHeating[i] = heating;
+			fullOutletT_C[i] = hpwh.getOutletTemp();
+		}
+		double fullTime = secondsSince(start);
+
+		start = benchClock::now();
+		long agree = 0;
+		double outletError = 0., drawn_L = 0.;
+		for (long i = 0; i < minutesToRun; i++) {
+			double draw_L = GAL_TO_L(allSchedules[1][i]);
+			if (followSetpoint) {
+				surrogate.setSetpoint(allSchedules[5][i]);
+			}
+			surrogate.runOneStep(allSchedules[0][i], draw_L, allSchedules[2][i], allSchedules[3][i],
+				static_cast<HPWH::DRMODES>(int(allSchedules[4][i])));
+			surrogateHourly_kWh[i / 60] += surrogate.getEnergyInput();
+			agree += (surrogate.isHeating() == fullHeating[i]) ? 1 : 0;
+			outletError += draw_L * fabs(surrogate.getOutletTemp() - fullOutletT_C[i]);
+			drawn_L += draw_L;
+		}
+		double surrogateTime = secondsSince(start);
+
+		double fullTotal = 0., surrogateTotal = 0., squaredError = 0., sxy = 0., sxx = 0., syy = 0.;
+		size_t nHours = fullHourly_kWh.size();
+		for (size_t h = 0; h < nHours; h++) {
+			fullTotal += fullHourly_kWh[h];
+			surrogateTotal += surrogateHourly_kWh[h];
+		}
+		double fullMean = fullTotal / nHours, surrogateMean = surrogateTotal / nHours;
+		for (size_t h = 0; h < nHours; h++) {
+			double dx = fullHourly_kWh[h] - fullMean, dy = surrogateHourly_kWh[h] - surrogateMean;
+			squaredError += (fullHourly_kWh[h] - surrogateHourly_kWh[h]) * (fullHourly_kWh[h] - surrogateHourly_kWh[h]);
+			sxy += dx * dy;
+			sxx += dx * dx;
+			syy += dy * dy;
+		}
+		double cvrmse = (fullMean > 0.) ? sqrt(squaredError / nHours) / fullMean : 0.;
+		double correlation = (sxx > 0. && syy > 0.) ? sxy / sqrt(sxx * syy) : 0.;
+
+		printf("%s,%ld,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.2f,%.3f,%.4f,%.0f\n", testName.c_str(), minutesToRun,
+			fullTotal, surrogateTotal, (surrogateTotal - fullTotal) / std::max(fullTotal, 1e-9), cvrmse, correlation,
+			(double)agree / minutesToRun, (drawn_L > 0.) ? outletError / drawn_L : 0., fullTime, surrogateTime,
+			fullTime / std::max(surrogateTime, 1e-9));
+	}
+	return 0;
+}
@@ -0,0 +1,24 @@
+# Runs modelTests.sweep as a shard and then resumes the whole sweep from the shard's result
+# table, which must run only the other shard's half and match the reference.
+#   cmake -DSWEEP=<hpwhSweep> -DOUTPUT=<output directory> -P sweepShards.cmake
+
+file(REMOVE_RECURSE "${OUTPUT}")
+file(MAKE_DIRECTORY "${OUTPUT}")
+
+execute_process(COMMAND "${SWEEP}" "modelTests.sweep" "${OUTPUT}" "--shard" "0/2"
+  RESULT_VARIABLE result OUTPUT_VARIABLE output)
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "Shard 0 of 2 failed:\n${output}")
+endif()
+
+execute_process(COMMAND "${SWEEP}" "modelTests.sweep" "${OUTPUT}" "--resume"
+  RESULT_VARIABLE result OUTPUT_VARIABLE output)
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "Resuming the sweep failed:\n${output}")
+endif()
+if(NOT output MATCHES "Running 95 runs on [0-9]+ threads, 95 already done")
+  message(FATAL_ERROR "Resuming did not skip the shard's runs:\n${output}")
+endif()
+if(NOT EXISTS "${OUTPUT}/sweepSummary.csv")
+  message(FATAL_ERROR "Resuming the whole sweep did not write the summary")
+endif()
@@ -0,0 +1,250 @@
+/*unit test for the fleet aggregator: the fleet totals of each interval are bit for bit the same
+ * whatever the threads, match the tanks run alone and summed to round off, and a failed tank
+ * or a bad run stops with HPWH_ABORT
+ *
+ *
+ */
+#include "HPWH.hh"
+#include "HPWHAggregator.hh"
+#include "testUtilityFcts.cc"
+
+#include <iostream>
+#include <string>
+
+
+using std::cout;
+using std::string;
+
+std::vector<schedule> allSchedules;
+long minutesToRun;
+
+// the test schedules with each tank's draws shifted, as runNSteps takes them
+struct FleetInputs {
+	long steps;
+	std::vector<double> inletT_C, ambientT_C, externalT_C;
+	std::vector<std::vector<double> > drawVolume_L;
+	FleetInputs(int tanks, long numSteps) : steps(numSteps), drawVolume_L(tanks) {
+		for (long i = 0; i < steps; i++) {
+			long j = i % minutesToRun;
+			inletT_C.push_back(allSchedules[0][j]);
+			ambientT_C.push_back(allSchedules[2][j]);
+			externalT_C.push_back(allSchedules[3][j]);
+			for (int t = 0; t < tanks; t++) {
+				drawVolume_L[t].push_back(GAL_TO_L(allSchedules[1][(i + 37 * t) % minutesToRun]));
+			}
+		}
+	}
+	HPWH::StepInputs stepInputs(int tank) {
+		HPWH::StepInputs in;
+		in.inletT_C = inletT_C.data();
+		in.drawVolume_L = drawVolume_L[tank].data();
+		in.tankAmbientT_C = ambientT_C.data();
+		in.heatSourceAmbientT_C = externalT_C.data();
+		return in;
+	}
+};
+
+const std::vector<string> modelNames = { "AOSmithHPTU80", "Sanden80", "ColmacCxA_20_SP", "RheemHB50", "Stiebel220E",
+	"GE502014", "restankRealistic", "Rheem2020Prem50" };
+
+void testSameForAnyThreads(int intervalSteps);
+void testSameAsAlone();
+void testFailedTank();
+void testBadRuns();
+
+int main(int argc, char *argv[])
+{
+	double newSetpoint;
+	ASSERTTRUE(readTestSchedules("testDOE_24hr50", allSchedules, minutesToRun, newSetpoint) == 0);
+
+	testSameForAnyThreads(1);
+	testSameForAnyThreads(15);
+	testSameAsAlone();
+	testFailedTank();
+	testBadRuns();
+
+	//Made it through the gauntlet
+	return 0;
+}
+
+// a fleet of the test models in turn
+void makeFleet(std::vector<HPWH> &hpwhs, FleetInputs &inputs, std::vector<HPWHAggregator::Tank> &tanks) {
+	std::vector<HPWH> prototypes(modelNames.size());
+	for (size_t m = 0; m < modelNames.size(); m++) {
+		ASSERTTRUE(getHPWHObject(prototypes[m], modelNames[m]) == 0);
+	}
+	tanks.resize(hpwhs.size());
+	for (size_t t = 0; t < hpwhs.size(); t++) {
+		hpwhs[t] = prototypes[t % prototypes.size()];
+		tanks[t].hpwh = &hpwhs[t];
+		tanks[t].inputs = inputs.stepInputs((int)t);
+	}
+}
+
+bool sameTotals(const HPWHAggregator::Totals &a, const HPWHAggregator::Totals &b) {
+	bool same = a.standbyLosses_kWh == b.standbyLosses_kWh && a.tanksHeating == b.tanksHeating;
+	for (int type = 0; type < HPWHAggregator::NUM_TYPES; type++) {
+		same = same && a.energyInput_kWh[type] == b.energyInput_kWh[type] &&
+			a.energyOutput_kWh[type] == b.energyOutput_kWh[type] && a.tanksHeatingByType[type] == b.tanksHeatingByType[type];
+	}
+	return same;
+}
+
+void testSameForAnyThreads(int intervalSteps) {
+	// enough tanks for several blocks, the last one part full
+	const int numTanks = 3 * HPWHAggregator::BLOCK_TANKS + 11;
+	const long steps = minutesToRun;
+	FleetInputs inputs(numTanks, steps);
+
+	std::vector<HPWHAggregator::Totals> first;
+	for (int threads : { 1, 2, 3, 8 }) {
+		std::vector<HPWH> hpwhs(numTanks);
+		std::vector<HPWHAggregator::Tank> tanks;
+		makeFleet(hpwhs, inputs, tanks);
+		std::vector<HPWHAggregator::Totals> totals;
+		HPWHAggregator aggregator;
+		ASSERTTRUE(aggregator.setNumThreads(threads) == 0);
+		ASSERTTRUE(aggregator.setIntervalSteps(intervalSteps) == 0);
+		ASSERTTRUE(aggregator.run(tanks, steps, [&](long interval, const HPWHAggregator::Totals &t) {
+			ASSERTTRUE(interval == (long)totals.size());
+			totals.push_back(t);
+			return 0;
+		}) == 0);
+		ASSERTTRUE((long)totals.size() == steps / intervalSteps);
+		ASSERTTRUE(aggregator.getFailedTank() == -1);
+		if (first.empty()) {
+			first = totals;
+			continue;
+		}
+		for (size_t k = 0; k < totals.size(); k++) {
+			ASSERTTRUE(sameTotals(totals[k], first[k]));
+		}
+	}
+}
+
+void testSameAsAlone() {
+	const int numTanks = 2 * HPWHAggregator::BLOCK_TANKS + 5;
+	const long steps = minutesToRun, intervalSteps = 60;
+	FleetInputs inputs(numTanks, steps);
+	std::vector<HPWH> hpwhs(numTanks);
+	std::vector<HPWHAggregator::Tank> tanks;
+	makeFleet(hpwhs, inputs, tanks);
+	std::vector<HPWHAggregator::Totals> totals;
+	HPWHAggregator aggregator;
+	aggregator.setNumThreads(2);
+	aggregator.setIntervalSteps(intervalSteps);
+	ASSERTTRUE(aggregator.run(tanks, steps, [&](long, const HPWHAggregator::Totals &t) {
+		totals.push_back(t);
+		return 0;
+	}) == 0);
+
+	// every tank alone, minute by minute
+	std::vector<HPWHAggregator::Totals> expected(steps / intervalSteps, HPWHAggregator::Totals());
+	for (int t = 0; t < numTanks; t++) {
+		HPWH alone;
+		ASSERTTRUE(getHPWHObject(alone, modelNames[t % modelNames.size()]) == 0);
+		for (long k = 0; k < steps / intervalSteps; k++) {
+			bool heating = false;
+			std::vector<bool> typeHeating(HPWHAggregator::NUM_TYPES, false);
+			for (long i = k * intervalSteps; i < (k + 1) * intervalSteps; i++) {
+				ASSERTTRUE(alone.runOneStep(inputs.inletT_C[i], inputs.drawVolume_L[t][i], inputs.ambientT_C[i],
+					inputs.externalT_C[i], HPWH::DR_ALLOW) == 0);
+				for (int j = 0; j < alone.getNumHeatSources(); j++) {
+					int type = alone.getNthHeatSourceType(j);
+					expected[k].energyInput_kWh[type] += alone.getNthHeatSourceEnergyInput(j);
+					expected[k].energyOutput_kWh[type] += alone.getNthHeatSourceEnergyOutput(j);
+					if (alone.getNthHeatSourceRunTime(j) > 0.) {
+						heating = true;
+						typeHeating[type] = true;
+					}
+				}
+				expected[k].standbyLosses_kWh += alone.getStandbyLosses();
+			}
+			expected[k].tanksHeating += heating ? 1 : 0;
+			for (int type = 0; type < HPWHAggregator::NUM_TYPES; type++) {
+				expected[k].tanksHeatingByType[type] += typeHeating[type] ? 1 : 0;
+			}
+		}
+		for (int n = 0; n < alone.getNumNodes(); n++) {
+			ASSERTTRUE(hpwhs[t].getTankNodeTemp(n) == alone.getTankNodeTemp(n));
+		}
+	}
+
+	// summed in another order, so only to round off
+	ASSERTTRUE(totals.size() == expected.size());
+	bool compressorsRan = false, resistanceRan = false;
+	for (size_t k = 0; k < totals.size(); k++) {
+		for (int type = 0; type < HPWHAggregator::NUM_TYPES; type++) {
+			ASSERTTRUE(cmpd(totals[k].energyInput_kWh[type], expected[k].energyInput_kWh[type], 1.e-9));
+			ASSERTTRUE(cmpd(totals[k].energyOutput_kWh[type], expected[k].energyOutput_kWh[type], 1.e-9));
+			ASSERTTRUE(totals[k].tanksHeatingByType[type] == expected[k].tanksHeatingByType[type]);
+		}
+		ASSERTTRUE(cmpd(totals[k].standbyLosses_kWh, expected[k].standbyLosses_kWh, 1.e-9));
+		ASSERTTRUE(totals[k].tanksHeating == expected[k].tanksHeating);
+		compressorsRan = compressorsRan || totals[k].tanksHeatingByType[HPWH::TYPE_compressor] > 0;
+		resistanceRan = resistanceRan || totals[k].tanksHeatingByType[HPWH::TYPE_resistance] > 0;
+	}
+	ASSERTTRUE(compressorsRan && resistanceRan);
+}
+
+void testFailedTank() {
+	// a setpoint the model cannot reach stops its tank in the interval it comes in
+	const int numTanks = HPWHAggregator::BLOCK_TANKS + 3;
+	const long steps = 240;
+	FleetInputs inputs(numTanks, steps);
+	std::vector<HPWH> hpwhs(numTanks);
+	std::vector<HPWHAggregator::Tank> tanks;
+	makeFleet(hpwhs, inputs, tanks);
+	std::vector<double> setpoint_C(steps, 50.);
+	setpoint_C[130] = 200.;
+	tanks[66].inputs.setpoint_C = setpoint_C.data();
+
+	HPWHAggregator aggregator;
+	aggregator.setNumThreads(2);
+	aggregator.setIntervalSteps(10);
+	long delivered = 0;
+	ASSERTTRUE(aggregator.run(tanks, steps, [&](long, const HPWHAggregator::Totals &) {
+		delivered++;
+		return 0;
+	}) == HPWH::HPWH_ABORT);
+	ASSERTTRUE(aggregator.getFailedTank() == 66);
+	ASSERTTRUE(delivered < 13);
+}
+
+void testBadRuns() {
+	HPWHAggregator aggregator;
+	ASSERTTRUE(aggregator.setNumThreads(0) == HPWH::HPWH_ABORT);
+	ASSERTTRUE(aggregator.setIntervalSteps(0) == HPWH::HPWH_ABORT);
+	HPWHAggregator::TotalsFunc keep = [](long, const HPWHAggregator::Totals &) { return 0; };
+
+	// a tank without a HPWH or inputs, or part of an interval, stops the run before it starts
+	FleetInputs inputs(1, 20);
+	HPWH hpwh;
+	ASSERTTRUE(getHPWHObject(hpwh, "AOSmithHPTU80") == 0);
+	std::vector<HPWHAggregator::Tank> tanks(1);
+	ASSERTTRUE(aggregator.run(tanks, 20, keep) == HPWH::HPWH_ABORT);
+	tanks[0].hpwh = &hpwh;
+	ASSERTTRUE(aggregator.run(tanks, 20, keep) == HPWH::HPWH_ABORT);
+	tanks[0].inputs = inputs.stepInputs(0);
+	ASSERTTRUE(aggregator.run(tanks, 20, HPWHAggregator::TotalsFunc()) == HPWH::HPWH_ABORT);
+	aggregator.setIntervalSteps(3);
+	ASSERTTRUE(aggregator.run(tanks, 20, keep) == HPWH::HPWH_ABORT);
+
+	// the totals function stops the run when it asks to
+	aggregator.setIntervalSteps(5);
+	long delivered = 0;
+	ASSERTTRUE(aggregator.run(tanks, 20, [&](long, const HPWHAggregator::Totals &) {
+		return (++delivered == 2) ? HPWH::HPWH_ABORT : 0;
+	}) == HPWH::HPWH_ABORT);
+	ASSERTTRUE(delivered == 2);
+	ASSERTTRUE(aggregator.getFailedTank() == -1);
+
+	// an empty fleet has nothing in every interval
+	std::vector<HPWHAggregator::Tank> none;
+	delivered = 0;
+	ASSERTTRUE(aggregator.run(none, 20, [&](long, const HPWHAggregator::Totals &t) {
+		delivered++;
+		return sameTotals(t, HPWHAggregator::Totals()) ? 0 : HPWH::HPWH_ABORT;
+	}) == 0);
+	ASSERTTRUE(delivered == 4);
+}
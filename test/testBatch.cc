@@ -0,0 +1,181 @@
+/*unit test for the work stealing batch runner: whatever the threads and chunk length, every
+ * job must end exactly as it does run alone, failures stay with their job, and the worker
+ * statistics add up
+ *
+ *
+ */
+#include "HPWH.hh"
+#include "HPWHBatch.hh"
+#include "testUtilityFcts.cc"
+
+#include <iostream>
+#include <string>
+
+
+using std::cout;
+using std::string;
+
+std::vector<schedule> allSchedules;
+long minutesToRun;
+
+// a few days of the test schedules, as runNSteps takes them
+struct TestInputs {
+	std::vector<double> inletT_C, drawVolume_L, ambientT_C, externalT_C;
+	std::vector<HPWH::DRMODES> DRstatus;
+	TestInputs(long steps) {
+		for (long i = 0; i < steps; i++) {
+			long j = i % minutesToRun;
+			inletT_C.push_back(allSchedules[0][j]);
+			drawVolume_L.push_back(GAL_TO_L(allSchedules[1][j]));
+			ambientT_C.push_back(allSchedules[2][j]);
+			externalT_C.push_back(allSchedules[3][j]);
+			DRstatus.push_back(static_cast<HPWH::DRMODES>(int(allSchedules[4][j])));
+		}
+	}
+	HPWH::StepInputs stepInputs() {
+		HPWH::StepInputs in;
+		in.inletT_C = inletT_C.data();
+		in.drawVolume_L = drawVolume_L.data();
+		in.tankAmbientT_C = ambientT_C.data();
+		in.heatSourceAmbientT_C = externalT_C.data();
+		in.DRstatus = DRstatus.data();
+		return in;
+	}
+};
+
+const std::vector<string> modelNames = { "AOSmithHPTU80", "Sanden80", "ColmacCxA_20_SP", "RheemHB50", "Stiebel220E",
+	"GE502014", "NyleC90A_SP", "Rheem2020Prem50" };
+
+void testSameAsAlone(int threads, long chunkSteps);
+void testFailedJob();
+void testBadJobs();
+
+int main(int argc, char *argv[])
+{
+	double newSetpoint;
+	ASSERTTRUE(readTestSchedules("testDOE_24hr50", allSchedules, minutesToRun, newSetpoint) == 0);
+
+	testSameAsAlone(1, 43200);
+	testSameAsAlone(4, 500);
+	testSameAsAlone(3, 1);
+	testFailedJob();
+	testBadJobs();
+
+	//Made it through the gauntlet
+	return 0;
+}
+
+void testSameAsAlone(int threads, long chunkSteps) {
+	const long steps = 3 * minutesToRun;
+	TestInputs inputs(steps);
+	size_t numJobs = modelNames.size();
+
+	// each job keeps its own running total of energy input, and writes its outlet temperatures
+	std::vector<HPWH> tanks(numJobs);
+	std::vector<double> energyInput_kWh(numJobs, 0.);
+	std::vector<std::vector<double> > outletTemp_C(numJobs, std::vector<double>(steps));
+	std::vector<HPWHBatch::Job> jobs(numJobs);
+	for (size_t j = 0; j < numJobs; j++) {
+		ASSERTTRUE(getHPWHObject(tanks[j], modelNames[j]) == 0);
+		HPWH::StepOutputArrays outputs;
+		outputs.outletTemp_C = outletTemp_C[j].data();
+		HPWHBatch::ChunkFunc runSteps = HPWHBatch::runNStepsChunks(inputs.stepInputs(), &outputs);
+		double *total = &energyInput_kWh[j];
+		jobs[j].hpwh = &tanks[j];
+		jobs[j].steps = steps;
+		jobs[j].runChunk = [runSteps, total](HPWH &hpwh, long begin, long end) {
+			int result = runSteps(hpwh, begin, end);
+			for (int s = 0; s < hpwh.getNumHeatSources(); s++) {
+				*total += hpwh.getNthHeatSourceEnergyInput(s);
+			}
+			return result;
+		};
+	}
+
+	HPWHBatch batch;
+	ASSERTTRUE(batch.setNumThreads(threads) == 0);
+	ASSERTTRUE(batch.setChunkSteps(chunkSteps) == 0);
+	ASSERTTRUE(batch.run(jobs) == 0);
+
+	for (size_t j = 0; j < numJobs; j++) {
+		ASSERTTRUE(jobs[j].status == 0);
+		HPWH alone;
+		ASSERTTRUE(getHPWHObject(alone, modelNames[j]) == 0);
+		double aloneEnergyInput_kWh = 0.;
+		for (long i = 0; i < steps; i++) {
+			ASSERTTRUE(alone.runOneStep(inputs.inletT_C[i], inputs.drawVolume_L[i], inputs.ambientT_C[i], inputs.externalT_C[i],
+				inputs.DRstatus[i]) == 0);
+			ASSERTTRUE(outletTemp_C[j][i] == alone.getOutletTemp());
+			for (int s = 0; s < alone.getNumHeatSources(); s++) {
+				aloneEnergyInput_kWh += alone.getNthHeatSourceEnergyInput(s);
+			}
+		}
+		// summed chunk by chunk, so only to round off
+		ASSERTTRUE(relcmpd(energyInput_kWh[j], aloneEnergyInput_kWh, 1.e-12));
+		for (int n = 0; n < alone.getNumNodes(); n++) {
+			ASSERTTRUE(tanks[j].getTankNodeTemp(n) == alone.getTankNodeTemp(n));
+		}
+	}
+
+	// the statistics account for every chunk and step
+	const std::vector<HPWHBatch::WorkerStats> &stats = batch.getWorkerStats();
+	ASSERTTRUE((int)stats.size() == threads);
+	long chunks = 0, stepsRun = 0, jobsFinished = 0;
+	for (const HPWHBatch::WorkerStats &worker : stats) {
+		chunks += worker.chunks;
+		stepsRun += worker.steps;
+		jobsFinished += worker.jobsFinished;
+		ASSERTTRUE(worker.utilization >= 0. && worker.utilization <= 1.);
+	}
+	ASSERTTRUE(chunks == (long)numJobs * ((steps + chunkSteps - 1) / chunkSteps));
+	ASSERTTRUE(stepsRun == (long)numJobs * steps);
+	ASSERTTRUE(jobsFinished == (long)numJobs);
+	ASSERTTRUE(batch.getWallSeconds() > 0.);
+}
+
+void testFailedJob() {
+	// one job fails part way, the others still finish
+	const long steps = minutesToRun;
+	TestInputs inputs(steps);
+	std::vector<HPWH> tanks(3);
+	std::vector<HPWHBatch::Job> jobs(3);
+	for (int j = 0; j < 3; j++) {
+		ASSERTTRUE(getHPWHObject(tanks[j], "AOSmithHPTU80") == 0);
+		jobs[j].hpwh = &tanks[j];
+		jobs[j].steps = steps;
+		jobs[j].runChunk = HPWHBatch::runNStepsChunks(inputs.stepInputs());
+	}
+	jobs[1].runChunk = [](HPWH &hpwh, long begin, long end) {
+		return (begin >= 600) ? HPWH::HPWH_ABORT : 0;
+	};
+	HPWHBatch batch;
+	batch.setNumThreads(2);
+	batch.setChunkSteps(100);
+	ASSERTTRUE(batch.run(jobs) == HPWH::HPWH_ABORT);
+	ASSERTTRUE(jobs[0].status == 0);
+	ASSERTTRUE(jobs[1].status == HPWH::HPWH_ABORT);
+	ASSERTTRUE(jobs[2].status == 0);
+	HPWH alone;
+	ASSERTTRUE(getHPWHObject(alone, "AOSmithHPTU80") == 0);
+	ASSERTTRUE(alone.runNSteps(steps, inputs.stepInputs()) == 0);
+	ASSERTTRUE(tanks[2].getTankNodeTemp(0) == alone.getTankNodeTemp(0));
+}
+
+void testBadJobs() {
+	HPWHBatch batch;
+	ASSERTTRUE(batch.setNumThreads(0) == HPWH::HPWH_ABORT);
+	ASSERTTRUE(batch.setChunkSteps(0) == HPWH::HPWH_ABORT);
+
+	// a job without a HPWH or a chunk function stops the batch before it starts
+	std::vector<HPWHBatch::Job> jobs(1);
+	ASSERTTRUE(batch.run(jobs) == HPWH::HPWH_ABORT);
+	HPWH hpwh;
+	jobs[0].hpwh = &hpwh;
+	ASSERTTRUE(batch.run(jobs) == HPWH::HPWH_ABORT);
+
+	// no jobs, or jobs of no steps, are done at once
+	std::vector<HPWHBatch::Job> none;
+	ASSERTTRUE(batch.run(none) == 0);
+	jobs[0].runChunk = [](HPWH &, long, long) { return HPWH::HPWH_ABORT; };
+	ASSERTTRUE(batch.run(jobs) == 0);
+}
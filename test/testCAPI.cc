@@ -0,0 +1,306 @@
+/*unit test for the C interface: a fleet stepped many tanks and steps at a time gives the same
+ * outputs as its tanks stepped one by one, with inputs per tank or shared, and a C host can use it
+ *
+ *
+ */
+#include "HPWH.hh"
+#include "HPWHcapi.h"
+#include "testUtilityFcts.cc"
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+
+extern "C" int stepFleetFromC(const char *presetName, int numTanks, int numSteps, const double *drawVolume_L,
+	const double *inletT_C, const double *ambientT_C, double *energyInput_kWh);
+
+using std::cout;
+using std::string;
+
+std::vector<schedule> allSchedules;
+long minutesToRun;
+
+const char *models[] = { "AOSmithHPTU80", "AOSmithHPTU80", "AOSmithHPTU80", "Sanden80", "Sanden80", "Rheem2020Prem50" };
+const int numTanks = 6;
+
+// a tank's inputs, one value per step, each tank's moved along the schedules
+struct TankInputs {
+	std::vector<double> inletT_C, drawVolume_L, ambientT_C, evaporatorT_C;
+	std::vector<int> DRstatus;
+};
+
+TankInputs tankInputs(int tank, long firstMinute, int numSteps) {
+	TankInputs inputs;
+	for (long m = firstMinute; m < firstMinute + numSteps; m++) {
+		long i = (m + 211 * tank) % minutesToRun;
+		inputs.inletT_C.push_back(allSchedules[0][i]);
+		inputs.drawVolume_L.push_back(GAL_TO_L(allSchedules[1][i]));
+		inputs.ambientT_C.push_back(allSchedules[2][i]);
+		inputs.evaporatorT_C.push_back(allSchedules[3][i]);
+		inputs.DRstatus.push_back(int(allSchedules[4][i]));
+	}
+	return inputs;
+}
+
+void testFleetSteps();
+void testSharedInputs();
+void testErrors();
+void testErrorsPerThread();
+void testFromC();
+
+int main(int argc, char *argv[])
+{
+	double newSetpoint;
+	ASSERTTRUE(readTestSchedules("testDOE_24hr50", allSchedules, minutesToRun, newSetpoint) == 0);
+
+	ASSERTTRUE(hpwh_c_api_version() == HPWH_C_API_VERSION);
+	ASSERTTRUE(string(hpwh_version()) == HPWH::getVersion());
+
+	testFleetSteps();
+	testSharedInputs();
+	testErrors();
+	testErrorsPerThread();
+	testFromC();
+
+	//Made it through the gauntlet
+	return 0;
+}
+
+void testFleetSteps() {
+	HPWHFleet *fleet = hpwh_fleet_create();
+	int firstTank;
+	ASSERTTRUE(hpwh_fleet_add_preset(fleet, "AOSmithHPTU80", 3, &firstTank) == 0 && firstTank == 0);
+	ASSERTTRUE(hpwh_fleet_add_preset(fleet, "Sanden80", 2, &firstTank) == 0 && firstTank == 3);
+	ASSERTTRUE(hpwh_fleet_add_preset(fleet, "Rheem2020Prem50", 1, &firstTank) == 0 && firstTank == 5);
+	ASSERTTRUE(hpwh_fleet_size(fleet) == numTanks);
+
+	std::vector<HPWH> hpwhs(numTanks);
+	for (int t = 0; t < numTanks; t++) {
+		ASSERTTRUE(getHPWHObject(hpwhs[t], models[t]) == 0);
+		ASSERTTRUE(hpwh_fleet_num_nodes(fleet, t) == hpwhs[t].getNumNodes());
+		ASSERTTRUE(hpwh_fleet_num_heat_sources(fleet, t) == hpwhs[t].getNumHeatSources());
+	}
+
+	// two days in calls of a day, the whole fleet, then tanks 3 and 4 for a day more
+	const int numSteps = 1440;
+	struct Call {
+		int firstTank, numTanks;
+		long firstMinute;
+	};
+	for (const Call &call : { Call{ 0, numTanks, 0 }, Call{ 0, numTanks, numSteps }, Call{ 3, 2, 2 * numSteps } }) {
+		std::vector<TankInputs> perTank;
+		HPWHStepInputs inputs = {};
+		std::vector<double> inletT_C, drawVolume_L, ambientT_C, evaporatorT_C;
+		std::vector<int> DRstatus;
+		for (int t = 0; t < call.numTanks; t++) {
+			perTank.push_back(tankInputs(call.firstTank + t, call.firstMinute, numSteps));
+			const TankInputs &tank = perTank.back();
+			inletT_C.insert(inletT_C.end(), tank.inletT_C.begin(), tank.inletT_C.end());
+			drawVolume_L.insert(drawVolume_L.end(), tank.drawVolume_L.begin(), tank.drawVolume_L.end());
+			ambientT_C.insert(ambientT_C.end(), tank.ambientT_C.begin(), tank.ambientT_C.end());
+			evaporatorT_C.insert(evaporatorT_C.end(), tank.evaporatorT_C.begin(), tank.evaporatorT_C.end());
+			DRstatus.insert(DRstatus.end(), tank.DRstatus.begin(), tank.DRstatus.end());
+		}
+		inputs.inletT_C = inletT_C.data();
+		inputs.drawVolume_L = drawVolume_L.data();
+		inputs.tankAmbientT_C = ambientT_C.data();
+		inputs.heatSourceAmbientT_C = evaporatorT_C.data();
+		inputs.DRstatus = DRstatus.data();
+
+		size_t values = (size_t)call.numTanks * numSteps;
+		std::vector<double> outletT_C(values), standby_kWh(values), environment_kWh(values), heatContent_kJ(values),
+			energyInput_kWh(values), heatIn_kWh(values * HPWH_C_HEAT_SOURCES), heatOut_kWh(values * HPWH_C_HEAT_SOURCES),
+			runTime_min(values * HPWH_C_HEAT_SOURCES), tcouples_C(values * HPWH_C_TCOUPLES);
+		HPWHStepOutputs outputs = { outletT_C.data(), standby_kWh.data(), environment_kWh.data(), heatContent_kJ.data(),
+			energyInput_kWh.data(), heatIn_kWh.data(), heatOut_kWh.data(), runTime_min.data(), tcouples_C.data() };
+		ASSERTTRUE(hpwh_fleet_step(fleet, call.firstTank, call.numTanks, numSteps, &inputs, &outputs) == 0);
+		ASSERTTRUE(string(hpwh_fleet_error(fleet)) == "");
+
+		for (int t = 0; t < call.numTanks; t++) {
+			HPWH &hpwh = hpwhs[call.firstTank + t];
+			const TankInputs &tank = perTank[t];
+			for (int s = 0; s < numSteps; s++) {
+				size_t i = (size_t)t * numSteps + s;
+				HPWH::StepOutputs expected;
+				ASSERTTRUE(hpwh.runOneStep(tank.inletT_C[s], tank.drawVolume_L[s], tank.ambientT_C[s], tank.evaporatorT_C[s],
+					static_cast<HPWH::DRMODES>(tank.DRstatus[s]), expected) == 0);
+				ASSERTTRUE(outletT_C[i] == expected.outletTemp_C);
+				ASSERTTRUE(standby_kWh[i] == expected.standbyLosses_kWh);
+				ASSERTTRUE(environment_kWh[i] == expected.energyRemovedFromEnvironment_kWh);
+				ASSERTTRUE(heatContent_kJ[i] == expected.tankHeatContent_kJ);
+				double total_kWh = 0.;
+				for (int j = 0; j < HPWH_C_HEAT_SOURCES; j++) {
+					total_kWh += (j < hpwh.getNumHeatSources()) ? expected.heatSourceEnergyInput_kWh[j] : 0.;
+					ASSERTTRUE(heatIn_kWh[i * HPWH_C_HEAT_SOURCES + j] == expected.heatSourceEnergyInput_kWh[j]);
+					ASSERTTRUE(heatOut_kWh[i * HPWH_C_HEAT_SOURCES + j] == expected.heatSourceEnergyOutput_kWh[j]);
+					ASSERTTRUE(runTime_min[i * HPWH_C_HEAT_SOURCES + j] == expected.heatSourceRunTime_min[j]);
+				}
+				ASSERTTRUE(energyInput_kWh[i] == total_kWh);
+				for (int k = 0; k < HPWH_C_TCOUPLES; k++) {
+					ASSERTTRUE(tcouples_C[i * HPWH_C_TCOUPLES + k] == expected.simTcouples_C[k]);
+				}
+			}
+		}
+	}
+
+	// the tanks not in the last call were not stepped
+	for (int t = 0; t < numTanks; t++) {
+		std::vector<double> tankTemps_C(hpwhs[t].getNumNodes());
+		ASSERTTRUE(hpwh_fleet_tank_temps(fleet, t, tankTemps_C.data(), (int)tankTemps_C.size()) == 0);
+		for (size_t n = 0; n < tankTemps_C.size(); n++) {
+			ASSERTTRUE(tankTemps_C[n] == hpwhs[t].getTankNodeTemp((int)n));
+		}
+	}
+	hpwh_fleet_destroy(fleet);
+}
+
+// one series for several inputs gives the same as it repeated for each tank, and no outputs is fine
+void testSharedInputs() {
+	HPWHFleet *shared = hpwh_fleet_create(), *repeated = hpwh_fleet_create();
+	ASSERTTRUE(hpwh_fleet_add_preset(shared, "AOSmithHPTU80", 4, NULL) == 0);
+	ASSERTTRUE(hpwh_fleet_add_preset(repeated, "AOSmithHPTU80", 4, NULL) == 0);
+	const int numSteps = 720;
+	TankInputs common = tankInputs(0, 300, numSteps);
+	TankInputs all;
+	std::vector<double> draws;
+	for (int t = 0; t < 4; t++) {
+		TankInputs tank = tankInputs(t, 300, numSteps);
+		draws.insert(draws.end(), tank.drawVolume_L.begin(), tank.drawVolume_L.end());
+		all.inletT_C.insert(all.inletT_C.end(), common.inletT_C.begin(), common.inletT_C.end());
+		all.ambientT_C.insert(all.ambientT_C.end(), common.ambientT_C.begin(), common.ambientT_C.end());
+		all.evaporatorT_C.insert(all.evaporatorT_C.end(), common.evaporatorT_C.begin(), common.evaporatorT_C.end());
+		all.DRstatus.insert(all.DRstatus.end(), common.DRstatus.begin(), common.DRstatus.end());
+	}
+
+	HPWHStepInputs sharedInputs = { common.inletT_C.data(), draws.data(), common.ambientT_C.data(),
+		common.evaporatorT_C.data(), common.DRstatus.data(),
+		HPWH_C_SHARED_INLET | HPWH_C_SHARED_AMBIENT | HPWH_C_SHARED_EVAPORATOR | HPWH_C_SHARED_DR };
+	HPWHStepInputs repeatedInputs = { all.inletT_C.data(), draws.data(), all.ambientT_C.data(),
+		all.evaporatorT_C.data(), all.DRstatus.data(), 0 };
+	ASSERTTRUE(hpwh_fleet_step(shared, 0, 4, numSteps, &sharedInputs, NULL) == 0);
+	ASSERTTRUE(hpwh_fleet_step(repeated, 0, 4, numSteps, &repeatedInputs, NULL) == 0);
+	for (int t = 0; t < 4; t++) {
+		int numNodes = hpwh_fleet_num_nodes(shared, t);
+		std::vector<double> sharedTemps_C(numNodes), repeatedTemps_C(numNodes);
+		ASSERTTRUE(hpwh_fleet_tank_temps(shared, t, sharedTemps_C.data(), numNodes) == 0);
+		ASSERTTRUE(hpwh_fleet_tank_temps(repeated, t, repeatedTemps_C.data(), numNodes) == 0);
+		ASSERTTRUE(sharedTemps_C == repeatedTemps_C);
+	}
+
+	// with every input shared, every tank is stepped alike
+	HPWHFleet *alike = hpwh_fleet_create();
+	ASSERTTRUE(hpwh_fleet_add_preset(alike, "Sanden80", 2, NULL) == 0);
+	HPWHStepInputs allShared = sharedInputs;
+	allShared.drawVolume_L = common.drawVolume_L.data();
+	allShared.shared |= HPWH_C_SHARED_DRAW;
+	ASSERTTRUE(hpwh_fleet_step(alike, 0, 2, numSteps, &allShared, NULL) == 0);
+	std::vector<double> first_C(hpwh_fleet_num_nodes(alike, 0)), second_C(first_C.size());
+	ASSERTTRUE(hpwh_fleet_tank_temps(alike, 0, first_C.data(), (int)first_C.size()) == 0);
+	ASSERTTRUE(hpwh_fleet_tank_temps(alike, 1, second_C.data(), (int)second_C.size()) == 0);
+	ASSERTTRUE(first_C == second_C);
+	hpwh_fleet_destroy(alike);
+
+	hpwh_fleet_destroy(shared);
+	hpwh_fleet_destroy(repeated);
+}
+
+void testErrors() {
+	HPWHFleet *fleet = hpwh_fleet_create();
+	int firstTank = -1;
+	ASSERTTRUE(hpwh_fleet_add_preset(fleet, "NoSuchModel", 1, &firstTank) == HPWH_C_ABORT);
+	ASSERTTRUE(string(hpwh_fleet_error(fleet)).find("NoSuchModel") != string::npos);
+	ASSERTTRUE(hpwh_fleet_add_preset(fleet, "AOSmithHPTU80", 0, &firstTank) == HPWH_C_ABORT);
+	ASSERTTRUE(hpwh_fleet_add_file(fleet, "noSuchModelFile.txt", 1, &firstTank) == HPWH_C_ABORT);
+	ASSERTTRUE(hpwh_fleet_size(fleet) == 0);
+	ASSERTTRUE(hpwh_fleet_add_preset(fleet, "AOSmithHPTU80", 2, &firstTank) == 0);
+
+	double value = 20.;
+	HPWHStepInputs inputs = { &value, &value, &value, &value, NULL,
+		HPWH_C_SHARED_INLET | HPWH_C_SHARED_DRAW | HPWH_C_SHARED_AMBIENT | HPWH_C_SHARED_EVAPORATOR };
+	ASSERTTRUE(hpwh_fleet_step(fleet, 1, 2, 1, &inputs, NULL) == HPWH_C_ABORT);
+	ASSERTTRUE(hpwh_fleet_step(fleet, -1, 1, 1, &inputs, NULL) == HPWH_C_ABORT);
+	ASSERTTRUE(hpwh_fleet_step(fleet, 0, 2, 1, NULL, NULL) == HPWH_C_ABORT);
+	HPWHStepInputs noDraws = inputs;
+	noDraws.drawVolume_L = NULL;
+	ASSERTTRUE(hpwh_fleet_step(fleet, 0, 2, 1, &noDraws, NULL) == HPWH_C_ABORT);
+	ASSERTTRUE(hpwh_fleet_step(fleet, 0, 2, 1, &inputs, NULL) == 0);
+	ASSERTTRUE(hpwh_fleet_step(fleet, 0, 0, 1, &inputs, NULL) == 0);
+
+	double temps[200];
+	ASSERTTRUE(hpwh_fleet_tank_temps(fleet, 0, temps, hpwh_fleet_num_nodes(fleet, 0) + 1) == HPWH_C_ABORT);
+	ASSERTTRUE(hpwh_fleet_num_nodes(fleet, 2) == HPWH_C_ABORT);
+	ASSERTTRUE(hpwh_fleet_set_setpoint(fleet, 0, 3, 50.) == HPWH_C_ABORT);
+	ASSERTTRUE(hpwh_fleet_set_setpoint(fleet, 0, 2, 200.) == HPWH_C_ABORT);
+	ASSERTTRUE(hpwh_fleet_set_setpoint(fleet, 0, 2, 50.) == 0);
+	ASSERTTRUE(hpwh_fleet_reset_to_setpoint(fleet, 1, 2) == HPWH_C_ABORT);
+	ASSERTTRUE(hpwh_fleet_reset_to_setpoint(fleet, 0, 2) == 0);
+	ASSERTTRUE(hpwh_fleet_tank_temps(fleet, 1, temps, hpwh_fleet_num_nodes(fleet, 1)) == 0);
+	ASSERTTRUE(cmpd(temps[0], 50.) && cmpd(temps[hpwh_fleet_num_nodes(fleet, 1) - 1], 50.));
+	hpwh_fleet_destroy(fleet);
+
+	ASSERTTRUE(hpwh_fleet_size(NULL) == 0);
+	ASSERTTRUE(hpwh_fleet_step(NULL, 0, 0, 1, &inputs, NULL) == HPWH_C_ABORT);
+}
+
+void testErrorsPerThread() {
+	// calls failing on different threads at the same time each see their own reason
+	HPWHFleet *fleet = hpwh_fleet_create();
+	ASSERTTRUE(hpwh_fleet_add_preset(fleet, "AOSmithHPTU80", 1, NULL) == 0);
+	const int numThreads = 4;
+	std::vector<int> mismatches(numThreads, 0);
+	std::vector<std::thread> threads;
+	for (int k = 0; k < numThreads; k++) {
+		threads.push_back(std::thread([fleet, k, &mismatches]() {
+			const string expected = "There is no tank " + std::to_string(100 + k);
+			for (int i = 0; i < 2000; i++) {
+				if (hpwh_fleet_num_nodes(fleet, 100 + k) != HPWH_C_ABORT || string(hpwh_fleet_error(fleet)) != expected) {
+					mismatches[k]++;
+				}
+			}
+		}));
+	}
+	for (std::thread &thread : threads) {
+		thread.join();
+	}
+	for (int k = 0; k < numThreads; k++) {
+		ASSERTTRUE(mismatches[k] == 0);
+	}
+
+	// none of them failed on this thread, nor on another fleet
+	ASSERTTRUE(string(hpwh_fleet_error(fleet)) == "");
+	HPWHFleet *other = hpwh_fleet_create();
+	ASSERTTRUE(hpwh_fleet_num_nodes(other, 0) == HPWH_C_ABORT);
+	ASSERTTRUE(string(hpwh_fleet_error(other)) == "There is no tank 0");
+	ASSERTTRUE(string(hpwh_fleet_error(fleet)) == "");
+	hpwh_fleet_destroy(other);
+	hpwh_fleet_destroy(fleet);
+}
+
+void testFromC() {
+	const int cTanks = 3, numSteps = 1440;
+	std::vector<double> draws_L, energyInput_kWh(cTanks);
+	TankInputs common = tankInputs(0, 0, numSteps);
+	for (int t = 0; t < cTanks; t++) {
+		TankInputs tank = tankInputs(t, 0, numSteps);
+		draws_L.insert(draws_L.end(), tank.drawVolume_L.begin(), tank.drawVolume_L.end());
+	}
+	ASSERTTRUE(stepFleetFromC("Sanden80", cTanks, numSteps, draws_L.data(), common.inletT_C.data(),
+		common.ambientT_C.data(), energyInput_kWh.data()) == 0);
+	for (int t = 0; t < cTanks; t++) {
+		HPWH hpwh;
+		ASSERTTRUE(getHPWHObject(hpwh, "Sanden80") == 0);
+		double expected_kWh = 0.;
+		for (int s = 0; s < numSteps; s++) {
+			ASSERTTRUE(hpwh.runOneStep(common.inletT_C[s], draws_L[t * numSteps + s], common.ambientT_C[s],
+				common.ambientT_C[s], HPWH::DR_ALLOW) == 0);
+			for (int j = 0; j < hpwh.getNumHeatSources(); j++) {
+				expected_kWh += hpwh.getNthHeatSourceEnergyInput(j);
+			}
+		}
+		ASSERTTRUE(relcmpd(energyInput_kWh[t], expected_kWh, 1.e-12));
+		ASSERTTRUE(expected_kWh > 0.);
+	}
+	ASSERTTRUE(stepFleetFromC("NoSuchModel", 1, 1, draws_L.data(), common.inletT_C.data(), common.ambientT_C.data(),
+		energyInput_kWh.data()) == HPWH_C_ABORT);
+}
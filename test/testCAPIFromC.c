@@ -0,0 +1,41 @@
+/*The C half of testCAPI: built as C, so the C interface is checked to be C, and steps a fleet
+ * the way a C host would
+ */
+#include "HPWHcapi.h"
+
+#include <stdlib.h>
+
+/* adds numTanks tanks of presetName to a new fleet and steps them numSteps minutes with their
+ * own draws, one inlet and ambient temperature for all, and the total energy input of each
+ * tank's steps in energyInput_kWh.  Returns 0 or HPWH_C_ABORT */
+int stepFleetFromC(const char *presetName, int numTanks, int numSteps, const double *drawVolume_L,
+                   const double *inletT_C, const double *ambientT_C, double *energyInput_kWh) {
+	HPWHFleet *fleet = hpwh_fleet_create();
+	double *stepEnergy_kWh = (double *)malloc(sizeof(double) * numTanks * numSteps);
+	HPWHStepInputs inputs = { 0 };
+	HPWHStepOutputs outputs = { 0 };
+	int firstTank, result, t, s;
+
+	result = (fleet == NULL || stepEnergy_kWh == NULL) ? HPWH_C_ABORT : 0;
+	if (result == 0) {
+		result = hpwh_fleet_add_preset(fleet, presetName, numTanks, &firstTank);
+	}
+	if (result == 0) {
+		inputs.inletT_C = inletT_C;
+		inputs.drawVolume_L = drawVolume_L;
+		inputs.tankAmbientT_C = ambientT_C;
+		inputs.heatSourceAmbientT_C = ambientT_C;
+		inputs.shared = HPWH_C_SHARED_INLET | HPWH_C_SHARED_AMBIENT | HPWH_C_SHARED_EVAPORATOR;
+		outputs.energyInput_kWh = stepEnergy_kWh;
+		result = hpwh_fleet_step(fleet, firstTank, numTanks, numSteps, &inputs, &outputs);
+	}
+	for (t = 0; result == 0 && t < numTanks; t++) {
+		energyInput_kWh[t] = 0.;
+		for (s = 0; s < numSteps; s++) {
+			energyInput_kWh[t] += stepEnergy_kWh[t * numSteps + s];
+		}
+	}
+	free(stepEnergy_kWh);
+	hpwh_fleet_destroy(fleet);
+	return result;
+}
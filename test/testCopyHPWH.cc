@@ -0,0 +1,151 @@
+/*unit test for copying and moving HPWHs, including heat sources with backups, companions
+ * and followers
+ *
+ *
+ */
+#include "HPWH.hh"
+#include "testUtilityFcts.cc"
+
+#include <iostream>
+#include <string>
+#include <utility>
+
+
+using std::cout;
+using std::string;
+
+std::vector<schedule> allSchedules;
+long minutesToRun;
+
+void testCloneMidRun(string modelName);
+void testCloneIsIndependent();
+void testAssignAcrossModels();
+void testMove();
+void testCopyFromFile();
+
+int main(int argc, char *argv[])
+{
+	double newSetpoint;
+	ASSERTTRUE(readTestSchedules("testDOE_24hr50", allSchedules, minutesToRun, newSetpoint) == 0);
+
+	testCloneMidRun("AOSmithHPTU80");   // lower and upper elements back each other up
+	testCloneMidRun("Stiebel220E");     // a companion
+	testCloneMidRun("GE502014");
+	testCloneMidRun("Sanden80");        // standby logic
+	testCloneMidRun("ColmacCxA_20_SP");
+	testCloneIsIndependent();
+	testAssignAcrossModels();
+	testMove();
+	testCopyFromFile();
+
+	//Made it through the gauntlet
+	return 0;
+}
+
+int runStep(HPWH &hpwh, long i) {
+	long j = i % minutesToRun;
+	return hpwh.runOneStep(allSchedules[0][j], GAL_TO_L(allSchedules[1][j]), allSchedules[2][j], allSchedules[3][j],
+		static_cast<HPWH::DRMODES>(int(allSchedules[4][j])));
+}
+
+// runs both for a day and checks every output matches
+void checkSameRun(HPWH &a, HPWH &b) {
+	for (long i = 0; i < 1440; i++) {
+		ASSERTTRUE(runStep(a, i) == 0);
+		ASSERTTRUE(runStep(b, i) == 0);
+		ASSERTTRUE(a.getNumHeatSources() == b.getNumHeatSources());
+		for (int s = 0; s < a.getNumHeatSources(); s++) {
+			ASSERTTRUE(a.getNthHeatSourceEnergyInput(s) == b.getNthHeatSourceEnergyInput(s));
+			ASSERTTRUE(a.getNthHeatSourceRunTime(s) == b.getNthHeatSourceRunTime(s));
+			ASSERTTRUE(a.isNthHeatSourceRunning(s) == b.isNthHeatSourceRunning(s));
+		}
+		ASSERTTRUE(a.getOutletTemp() == b.getOutletTemp());
+	}
+	for (int n = 0; n < a.getNumNodes(); n++) {
+		ASSERTTRUE(a.getTankNodeTemp(n) == b.getTankNodeTemp(n));
+	}
+}
+
+void testCloneMidRun(string modelName) {
+	HPWH hpwh;
+	ASSERTTRUE(getHPWHObject(hpwh, modelName) == 0);
+	for (long i = 0; i < 600; i++) {
+		ASSERTTRUE(runStep(hpwh, i) == 0);
+	}
+
+	HPWH clone(hpwh);
+	ASSERTTRUE(clone.getHPWHModel() == hpwh.getHPWHModel());
+	ASSERTTRUE(clone.getCompressorCapacity() == hpwh.getCompressorCapacity());
+	ASSERTTRUE(clone.isSetpointFixed() == hpwh.isSetpointFixed());
+	checkSameRun(hpwh, clone);
+}
+
+void testCloneIsIndependent() {
+	HPWH hpwh;
+	getHPWHObject(hpwh, "AOSmithHPTU80");
+	HPWH clone = hpwh;
+	ASSERTTRUE(clone.setSetpoint(40.) == 0);
+	ASSERTTRUE(hpwh.getSetpoint() != 40.);
+
+	// a draw from the clone leaves the original full
+	ASSERTTRUE(clone.runOneStep(10., 100., 20., 20., HPWH::DR_LOC) == 0);
+	ASSERTTRUE(hpwh.getTankNodeTemp(0) != clone.getTankNodeTemp(0));
+
+	// the clone's heat sources belong to the clone: destroying the original does not matter
+	HPWH *original = new HPWH;
+	getHPWHObject(*original, "AOSmithHPTU80");
+	HPWH survivor(*original);
+	delete original;
+	HPWH fresh;
+	getHPWHObject(fresh, "AOSmithHPTU80");
+	checkSameRun(survivor, fresh);
+}
+
+void testAssignAcrossModels() {
+	HPWH sanden, aosmith, reference;
+	getHPWHObject(sanden, "Sanden80");
+	getHPWHObject(aosmith, "AOSmithHPTU80");
+	getHPWHObject(reference, "AOSmithHPTU80");
+
+	// different numbers of nodes and heat sources
+	sanden = aosmith;
+	ASSERTTRUE(sanden.getNumNodes() == aosmith.getNumNodes());
+	checkSameRun(sanden, reference);
+
+	// and into a default HPWH
+	HPWH empty;
+	empty = reference;
+	checkSameRun(empty, reference);
+}
+
+void testMove() {
+	HPWH hpwh, reference;
+	getHPWHObject(hpwh, "AOSmithHPTU80");
+	getHPWHObject(reference, "AOSmithHPTU80");
+
+	HPWH moved(std::move(hpwh));
+	ASSERTTRUE(hpwh.runOneStep(10., 0., 20., 20., HPWH::DR_ALLOW) == HPWH::HPWH_ABORT);
+	checkSameRun(moved, reference);
+
+	HPWH assigned;
+	assigned = std::move(moved);
+	checkSameRun(assigned, reference);
+
+	// growing a vector moves its HPWHs
+	std::vector<HPWH> fleet;
+	for (int i = 0; i < 5; i++) {
+		fleet.push_back(reference);
+	}
+	for (HPWH &tank : fleet) {
+		HPWH check(reference);
+		checkSameRun(tank, check);
+	}
+}
+
+void testCopyFromFile() {
+	HPWH hpwh, reference;
+	ASSERTTRUE(hpwh.HPWHinit_file("AOSmithHPTU80.txt") == 0);
+	ASSERTTRUE(reference.HPWHinit_file("AOSmithHPTU80.txt") == 0);
+	HPWH clone(hpwh);
+	checkSameRun(clone, reference);
+}
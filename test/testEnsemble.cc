@@ -0,0 +1,231 @@
+/*unit test for the draw schedule ensemble: the streaming statistics match the realizations run
+ * one by one, do not depend on the number of threads, and the quantile sketch is close
+ *
+ *
+ */
+#include "HPWH.hh"
+#include "HPWHEnsemble.hh"
+#include "testUtilityFcts.cc"
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+
+using std::cout;
+using std::string;
+
+std::vector<schedule> allSchedules;
+long minutesToRun;
+
+void testStatistic();
+void testResampledDays();
+void testEnsemble(const string &modelName);
+void testBadSettings();
+
+int main(int argc, char *argv[])
+{
+	double newSetpoint;
+	ASSERTTRUE(readTestSchedules("testDOE_24hr50", allSchedules, minutesToRun, newSetpoint) == 0);
+
+	testStatistic();
+	testResampledDays();
+	testEnsemble("AOSmithHPTU80");
+	testEnsemble("Sanden80");
+	testBadSettings();
+
+	//Made it through the gauntlet
+	return 0;
+}
+
+void testStatistic() {
+	// 1 to 1001, in a scrambled order
+	const long n = 1001;
+	HPWHEnsemble::Statistic stat({ 0.05, 0.5, 0.95 });
+	for (long i = 0; i < n; i++) {
+		stat.add((double)((i * 389) % n + 1));
+	}
+	ASSERTTRUE(stat.getCount() == n);
+	ASSERTTRUE(cmpd(stat.getMean(), 501.));
+	ASSERTTRUE(cmpd(stat.getVariance(), n * (n + 1) / 12.));
+	ASSERTTRUE(stat.getMin() == 1.);
+	ASSERTTRUE(stat.getMax() == n);
+	ASSERTTRUE(fabs(stat.getQuantile(0) - 51.) < 10.);
+	ASSERTTRUE(fabs(stat.getQuantile(1) - 501.) < 10.);
+	ASSERTTRUE(fabs(stat.getQuantile(2) - 951.) < 10.);
+	ASSERTTRUE(stat.getQuantile(3) == 0.);
+
+	// up to EXACT_VALUES values are exact
+	HPWHEnsemble::Statistic exact({ 0.25 });
+	for (int i = HPWHEnsemble::Statistic::EXACT_VALUES; i > 0; i--) {
+		exact.add(i);
+	}
+	ASSERTTRUE(exact.getQuantile(0) == 1. + 0.25 * (HPWHEnsemble::Statistic::EXACT_VALUES - 1));
+	HPWHEnsemble::Statistic few({ 0.5, 0.75 });
+	ASSERTTRUE(few.getQuantile(0) == 0. && few.getVariance() == 0.);
+	few.add(4.);
+	few.add(1.);
+	few.add(3.);
+	ASSERTTRUE(few.getQuantile(0) == 3.);
+	ASSERTTRUE(few.getQuantile(1) == 3.5);
+}
+
+void testResampledDays() {
+	std::vector<double> baseDraws_L;
+	for (long i = 0; i < minutesToRun; i++) {
+		baseDraws_L.push_back(GAL_TO_L(allSchedules[1][i]));
+	}
+	double baseVolume_L = 0.;
+	for (double draw : baseDraws_L) {
+		baseVolume_L += draw;
+	}
+
+	HPWHEnsemble::DrawGenerator draws = HPWHEnsemble::resampledDays(baseDraws_L, 7, 30, 0.2);
+	std::vector<double> first(3 * 1440), again(3 * 1440), other(3 * 1440);
+	ASSERTTRUE(draws(5, first) == 0);
+	ASSERTTRUE(draws(5, again) == 0);
+	ASSERTTRUE(draws(6, other) == 0);
+	ASSERTTRUE(first == again);
+	ASSERTTRUE(first != other);
+
+	// each day is the one base day, moved about and scaled by at most 20%
+	for (int day = 0; day < 3; day++) {
+		double volume_L = 0.;
+		for (long m = 0; m < 1440; m++) {
+			volume_L += first[day * 1440 + m];
+		}
+		ASSERTTRUE(volume_L >= 0.8 * baseVolume_L - 1.e-9 && volume_L <= 1.2 * baseVolume_L + 1.e-9);
+	}
+
+	// a base shorter than a day cannot be resampled
+	std::vector<double> shortBase(100, 1.);
+	ASSERTTRUE(HPWHEnsemble::resampledDays(shortBase, 7)(0, first) == HPWH::HPWH_ABORT);
+}
+
+void testEnsemble(const string &modelName) {
+	const long steps = 2 * minutesToRun;
+	const long realizations = 12;
+	std::vector<double> inletT_C, ambientT_C, externalT_C, baseDraws_L;
+	std::vector<HPWH::DRMODES> DRstatus;
+	for (long i = 0; i < steps; i++) {
+		long j = i % minutesToRun;
+		inletT_C.push_back(allSchedules[0][j]);
+		baseDraws_L.push_back(GAL_TO_L(allSchedules[1][j]));
+		ambientT_C.push_back(allSchedules[2][j]);
+		externalT_C.push_back(allSchedules[3][j]);
+		DRstatus.push_back(static_cast<HPWH::DRMODES>(int(allSchedules[4][j])));
+	}
+	HPWH::StepInputs inputs;
+	inputs.inletT_C = inletT_C.data();
+	inputs.tankAmbientT_C = ambientT_C.data();
+	inputs.heatSourceAmbientT_C = externalT_C.data();
+	inputs.DRstatus = DRstatus.data();
+	HPWHEnsemble::DrawGenerator draws = HPWHEnsemble::resampledDays(baseDraws_L, 11);
+	HPWHEnsemble::InitFunc init = [modelName](HPWH &hpwh) { return getHPWHObject(hpwh, modelName); };
+
+	// the realizations one by one, a step at a time
+	const double comfortTemp_C = 48.;
+	const int peakWindow_min = 30;
+	std::vector<double> energy_kWh, below_min, peak_kW;
+	for (long r = 0; r < realizations; r++) {
+		HPWH hpwh;
+		ASSERTTRUE(init(hpwh) == 0);
+		std::vector<double> drawVolume_L(steps);
+		ASSERTTRUE(draws(r, drawVolume_L) == 0);
+		std::vector<double> step_kWh(steps, 0.);
+		double below = 0.;
+		for (long i = 0; i < steps; i++) {
+			ASSERTTRUE(hpwh.runOneStep(inletT_C[i], drawVolume_L[i], ambientT_C[i], externalT_C[i], DRstatus[i]) == 0);
+			for (int h = 0; h < hpwh.getNumHeatSources(); h++) {
+				step_kWh[i] += hpwh.getNthHeatSourceEnergyInput(h);
+			}
+			below += (drawVolume_L[i] > 0. && hpwh.getOutletTemp() < comfortTemp_C) ? 1. : 0.;
+		}
+		double total_kWh = 0., peak = 0.;
+		for (long i = 0; i < steps; i++) {
+			total_kWh += step_kWh[i];
+			if (i + 1 >= peakWindow_min) {
+				double window_kWh = 0.;
+				for (long w = i + 1 - peakWindow_min; w <= i; w++) {
+					window_kWh += step_kWh[w];
+				}
+				peak = std::max(peak, window_kWh * 60. / peakWindow_min);
+			}
+		}
+		energy_kWh.push_back(total_kWh);
+		below_min.push_back(below);
+		peak_kW.push_back(peak);
+	}
+
+	// the same in the ensemble, with one thread and with several
+	HPWHEnsemble one(init), several(init);
+	for (HPWHEnsemble *ensemble : { &one, &several }) {
+		ASSERTTRUE(ensemble->setComfortTemp(comfortTemp_C) == 0);
+		ASSERTTRUE(ensemble->setPeakWindow(peakWindow_min) == 0);
+	}
+	ASSERTTRUE(one.setNumThreads(1) == 0);
+	ASSERTTRUE(several.setNumThreads(3) == 0);
+	ASSERTTRUE(one.run(realizations, steps, inputs, draws) == 0);
+	ASSERTTRUE(several.run(realizations, steps, inputs, draws) == 0);
+	ASSERTTRUE(one.getRealizations() == realizations);
+
+	struct Check {
+		const HPWHEnsemble::Statistic &oneStat, &severalStat;
+		const std::vector<double> &values;
+	};
+	Check checks[] = { { one.getEnergyInput(), several.getEnergyInput(), energy_kWh },
+		{ one.getMinutesBelowComfort(), several.getMinutesBelowComfort(), below_min },
+		{ one.getPeakDemand(), several.getPeakDemand(), peak_kW } };
+	for (const Check &check : checks) {
+		double sum = 0.;
+		for (double value : check.values) {
+			sum += value;
+		}
+		ASSERTTRUE(check.oneStat.getCount() == realizations);
+		ASSERTTRUE(cmpd(check.oneStat.getMean(), sum / realizations, 1.e-9));
+		ASSERTTRUE(cmpd(check.oneStat.getMin(), *std::min_element(check.values.begin(), check.values.end()), 1.e-9));
+		ASSERTTRUE(cmpd(check.oneStat.getMax(), *std::max_element(check.values.begin(), check.values.end()), 1.e-9));
+
+		// added in the same order whatever the threads, so exactly the same
+		ASSERTTRUE(check.severalStat.getMean() == check.oneStat.getMean());
+		ASSERTTRUE(check.severalStat.getVariance() == check.oneStat.getVariance());
+		for (int q = 0; q < 3; q++) {
+			ASSERTTRUE(check.severalStat.getQuantile(q) == check.oneStat.getQuantile(q));
+			ASSERTTRUE(check.oneStat.getQuantile(q) >= check.oneStat.getMin());
+			ASSERTTRUE(check.oneStat.getQuantile(q) <= check.oneStat.getMax());
+		}
+	}
+}
+
+void testBadSettings() {
+	HPWHEnsemble::InitFunc init = [](HPWH &hpwh) { return getHPWHObject(hpwh, "AOSmithHPTU80"); };
+	HPWHEnsemble ensemble(init);
+	ASSERTTRUE(ensemble.setNumThreads(0) == HPWH::HPWH_ABORT);
+	ASSERTTRUE(ensemble.setQuantiles({ 0.5, 1. }) == HPWH::HPWH_ABORT);
+	ASSERTTRUE(ensemble.setQuantiles({ 0. }) == HPWH::HPWH_ABORT);
+	ASSERTTRUE(ensemble.setComfortTemp(105., HPWH::UNITS_KW) == HPWH::HPWH_ABORT);
+	ASSERTTRUE(ensemble.setPeakWindow(0) == HPWH::HPWH_ABORT);
+	ASSERTTRUE(ensemble.setNumThreads(2) == 0);
+
+	// a failing realization or model fails the run
+	std::vector<double> inletT_C(60, 10.), ambientT_C(60, 20.);
+	HPWH::StepInputs inputs;
+	inputs.inletT_C = inletT_C.data();
+	inputs.tankAmbientT_C = ambientT_C.data();
+	inputs.heatSourceAmbientT_C = ambientT_C.data();
+	HPWHEnsemble::DrawGenerator failAtThree = [](long realization, std::vector<double> &drawVolume_L) {
+		return (realization == 3) ? HPWH::HPWH_ABORT : 0;
+	};
+	ASSERTTRUE(ensemble.run(10, 60, inputs, failAtThree) == HPWH::HPWH_ABORT);
+	HPWHEnsemble badModel([](HPWH &hpwh) { return HPWH::HPWH_ABORT; });
+	badModel.setNumThreads(2);
+	ASSERTTRUE(badModel.run(10, 60, inputs, failAtThree) == HPWH::HPWH_ABORT);
+
+	// no draws at all, and no realizations
+	HPWHEnsemble::DrawGenerator noDraws = [](long, std::vector<double> &) { return 0; };
+	ASSERTTRUE(ensemble.run(4, 60, inputs, noDraws) == 0);
+	ASSERTTRUE(ensemble.getMinutesBelowComfort().getMax() == 0.);
+	ASSERTTRUE(ensemble.run(0, 60, inputs, noDraws) == 0);
+	ASSERTTRUE(ensemble.getRealizations() == 0);
+	ASSERTTRUE(ensemble.run(4, 0, inputs, noDraws) == HPWH::HPWH_ABORT);
+}
@@ -0,0 +1,114 @@
+/*unit test for the HPWHinit_file parser: every model file must compile to the same image the
+ * regex parser made, kept in fileImages/, and a malformed file must say which line is wrong
+ *
+ *
+ */
+#include "HPWH.hh"
+#include "testUtilityFcts.cc"
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+
+using std::cout;
+using std::string;
+
+const std::vector<string> modelNames = { "AOSmithHPTU80", "AOSmithPHPT60", "GE502014", "Rheem2020Build50",
+	"Rheem2020Prem40", "Rheem2020Prem50", "RheemHB50", "Sanden80", "Stiebel220e" };
+
+string scratchFile;
+
+void testSameAsRegexParser();
+void testFormats();
+void testErrorLines();
+
+int main(int argc, char *argv[])
+{
+	ASSERTTRUE(argc > 1);
+	scratchFile = argv[1];
+
+	testSameAsRegexParser();
+	testFormats();
+	testErrorLines();
+
+	//Made it through the gauntlet
+	return 0;
+}
+
+std::vector<unsigned char> readImage(const string &fileName) {
+	std::ifstream imageFILE(fileName.c_str(), std::ios::binary);
+	return std::vector<unsigned char>(std::istreambuf_iterator<char>(imageFILE), std::istreambuf_iterator<char>());
+}
+
+void writeScratch(const string &contents) {
+	std::ofstream scratch(scratchFile.c_str(), std::ios::binary);
+	scratch << contents;
+}
+
+void testSameAsRegexParser() {
+	for (const string &modelName : modelNames) {
+		HPWH hpwh;
+		std::vector<unsigned char> image;
+		ASSERTTRUE(hpwh.HPWHinit_file(modelName + ".txt") == 0);
+		ASSERTTRUE(hpwh.compileModel(image) == 0);
+		std::vector<unsigned char> reference = readImage("fileImages/" + modelName + ".hpwm");
+		ASSERTTRUE(!reference.empty());
+		ASSERTTRUE(image == reference);
+	}
+}
+
+void testFormats() {
+	// line endings, no final newline, tabs and comments all read as the plain file does
+	std::ifstream textFILE("Sanden80.txt", std::ios::binary);
+	string text((std::istreambuf_iterator<char>(textFILE)), std::istreambuf_iterator<char>());
+	string crlf, tabbed;
+	for (char c : text) {
+		if (c == '\n') crlf += '\r';
+		crlf += c;
+		tabbed += (c == ' ') ? '\t' : c;
+	}
+	std::vector<unsigned char> reference = readImage("fileImages/Sanden80.hpwm");
+	for (const string &variant : { crlf, tabbed, "# a comment\n\n" + text.substr(0, text.find_last_not_of("\n") + 1) }) {
+		HPWH hpwh;
+		std::vector<unsigned char> image;
+		writeScratch(variant);
+		ASSERTTRUE(hpwh.HPWHinit_file(scratchFile) == 0);
+		ASSERTTRUE(hpwh.compileModel(image) == 0);
+		ASSERTTRUE(image == reference);
+	}
+}
+
+void keepMessage(const string message, void *pContext) {
+	*static_cast<string *>(pContext) += message;
+}
+
+// the file fails to load and the message names the line
+void checkErrorLine(const string &contents, const string &lineText) {
+	HPWH hpwh;
+	string messages;
+	hpwh.setMessageCallback(keepMessage, &messages);
+	writeScratch(contents);
+	ASSERTTRUE(hpwh.HPWHinit_file(scratchFile) == HPWH::HPWH_ABORT);
+	if (messages.find(lineText) == string::npos) {
+		cout << "Expected \"" << lineText << "\" in: " << messages << "\n";
+		ASSERTTRUE(false);
+	}
+}
+
+void testErrorLines() {
+	const string head = "verbosity reluctant\nnumNodes 12\nvolume 50 gal\nnumHeatSources 1\n";
+	checkErrorLine(head + "UA 10 BTUperHr\n", "line 5, UA");
+	checkErrorLine(head + "volume fifty gal\n", "line 5, volume");
+	checkErrorLine(head + "\n# comment\nnotAKeyword 1\n", "line 7, notAKeyword");
+	checkErrorLine(head + "heatsource 0 type resistor\nheatsource 0 condensity 1 0 0\n", "line 6, heatsource 0 condensity");
+	checkErrorLine(head + "heatsource 1 type resistor\n", "line 5, heatsource");
+	checkErrorLine(head + "heatsource 0 onlogic nodes 1 2 weights 0.5 absolute > 100 F\n", "line 5, heatsource 0 onlogic");
+	checkErrorLine(head + "heatsource 0 T1 50 F\n", "line 5, heatsource 0 T1");
+	checkErrorLine(head + "heatsource 0 nTemps 2\nheatsource 0 T3 50 F\n", "line 6, heatsource 0 T3");
+
+	// a file that is not there
+	HPWH hpwh;
+	ASSERTTRUE(hpwh.HPWHinit_file("noSuchModel.txt") == HPWH::HPWH_ABORT);
+}
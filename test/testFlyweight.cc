@@ -0,0 +1,135 @@
+/*unit test for the flyweight HPWHModel and HPWHState
+ *
+ *
+ *
+ */
+#include "HPWH.hh"
+#include "HPWHModel.hh"
+#include "testUtilityFcts.cc"
+
+#include <iostream>
+#include <string>
+
+
+using std::cout;
+using std::string;
+
+void testMatchesSeparateTanks(string modelName);
+void testSetpoint();
+void testMismatchedState();
+void testFailedStepResetsWorkspace();
+
+int main(int argc, char *argv[])
+{
+	testMatchesSeparateTanks("AOSmithHPTU80");
+	testMatchesSeparateTanks("Sanden80");
+	testMatchesSeparateTanks("ColmacCxA_20_SP");
+	testSetpoint();
+	testMismatchedState();
+	testFailedStepResetsWorkspace();
+
+	//Made it through the gauntlet
+	return 0;
+}
+
+std::shared_ptr<const HPWHModel> makeModel(string modelName) {
+	std::shared_ptr<HPWHModel> model = std::make_shared<HPWHModel>();
+	ASSERTTRUE(model->init([modelName](HPWH &hpwh) { return getHPWHObject(hpwh, modelName); }) == 0);
+	return model;
+}
+
+void testMatchesSeparateTanks(string modelName) {
+	std::vector<schedule> allSchedules;
+	long minutesToRun;
+	double newSetpoint;
+	ASSERTTRUE(readTestSchedules("testDOE_24hr50", allSchedules, minutesToRun, newSetpoint) == 0);
+
+	// tanks whose draws are offset in time, stepped one minute at a time in turn through one workspace
+	const int nTanks = 4;
+	std::shared_ptr<const HPWHModel> model = makeModel(modelName);
+	HPWH workspace;
+	ASSERTTRUE(model->initWorkspace(workspace) == 0);
+	std::vector<HPWHState> states(nTanks, HPWHState(model));
+	std::vector<HPWH> tanks(nTanks);
+	for (int t = 0; t < nTanks; t++) {
+		getHPWHObject(tanks[t], modelName);
+	}
+
+	for (long i = 0; i < minutesToRun; i++) {
+		for (int t = 0; t < nTanks; t++) {
+			long j = (i + 97 * t) % minutesToRun;
+			HPWH::DRMODES DRstatus = static_cast<HPWH::DRMODES>(int(allSchedules[4][j]));
+			double draw_L = GAL_TO_L(allSchedules[1][j]);
+			ASSERTTRUE(tanks[t].runOneStep(allSchedules[0][j], draw_L, allSchedules[2][j], allSchedules[3][j], DRstatus) == 0);
+			ASSERTTRUE(states[t].runOneStep(workspace, allSchedules[0][j], draw_L, allSchedules[2][j], allSchedules[3][j], DRstatus) == 0);
+
+			for (int s = 0; s < tanks[t].getNumHeatSources(); s++) {
+				ASSERTTRUE(states[t].getNthHeatSourceEnergyInput(s) == tanks[t].getNthHeatSourceEnergyInput(s));
+				ASSERTTRUE(states[t].getNthHeatSourceEnergyOutput(s) == tanks[t].getNthHeatSourceEnergyOutput(s));
+			}
+			ASSERTTRUE(states[t].getOutletTemp() == tanks[t].getOutletTemp());
+			ASSERTTRUE(states[t].getStandbyLosses() == tanks[t].getStandbyLosses());
+		}
+	}
+	for (int t = 0; t < nTanks; t++) {
+		HPWH::SimState state;
+		tanks[t].getSimState(state);
+		ASSERTTRUE(state.tankTemps_C == states[t].getSimState().tankTemps_C);
+		ASSERTTRUE(state.heatSourcesOn == states[t].getSimState().heatSourcesOn);
+	}
+}
+
+void testSetpoint() {
+	std::shared_ptr<const HPWHModel> model = makeModel("AOSmithHPTU80");
+	HPWHState state(model);
+	ASSERTTRUE(state.getSetpoint() == model->getPrototype().getSetpoint());
+	ASSERTTRUE(state.setSetpoint(50.) == 0);
+	ASSERTTRUE(state.getSetpoint() == 50.);
+	ASSERTTRUE(state.setSetpoint(150.) == HPWH::HPWH_ABORT);
+	ASSERTTRUE(state.getSetpoint() == 50.);
+
+	std::shared_ptr<const HPWHModel> sanden = makeModel("Sanden80");
+	HPWHState fixed(sanden);
+	ASSERTTRUE(fixed.setSetpoint(50.) == HPWH::HPWH_ABORT);
+}
+
+void testMismatchedState() {
+	std::shared_ptr<const HPWHModel> model = makeModel("AOSmithHPTU80");
+	std::shared_ptr<const HPWHModel> other = makeModel("Sanden80");
+	HPWHState state(model);
+	ASSERTTRUE(state.setSimState(other->getInitialState()) == HPWH::HPWH_ABORT);
+	ASSERTTRUE(state.setSimState(model->getInitialState()) == 0);
+
+	// a workspace of another model is caught by the node and heat source counts
+	HPWH workspace;
+	ASSERTTRUE(other->initWorkspace(workspace) == 0);
+	ASSERTTRUE(state.runOneStep(workspace, 10., 0., 20., 20., HPWH::DR_ALLOW) == HPWH::HPWH_ABORT);
+}
+
+void testFailedStepResetsWorkspace() {
+	std::shared_ptr<const HPWHModel> model = makeModel("AOSmithHPTU80");
+	HPWHState failing(model), good(model), alone(model);
+	ASSERTTRUE(good.setSetpoint(45.) == 0);
+	ASSERTTRUE(alone.setSetpoint(45.) == 0);
+
+	// a step that fails in the shared workspace must not fail the states stepped after it
+	HPWH workspace;
+	ASSERTTRUE(model->initWorkspace(workspace) == 0);
+	workspace.setMinutesPerStep(2.);
+	ASSERTTRUE(workspace.setDoTempDepression(true) == 0);
+	HPWH::SimState before = failing.getSimState();
+	ASSERTTRUE(failing.runOneStep(workspace, 10., 30., 20., 20., HPWH::DR_ALLOW) == HPWH::HPWH_ABORT);
+	ASSERTTRUE(failing.getSimState().tankTemps_C == before.tankTemps_C);
+	for (int i = 0; i < 30; i++) {
+		ASSERTTRUE(good.runOneStep(workspace, 10., 5., 20., 20., HPWH::DR_ALLOW) == 0);
+	}
+
+	// and they step as they would in a workspace of their own
+	HPWH own;
+	ASSERTTRUE(model->initWorkspace(own) == 0);
+	for (int i = 0; i < 30; i++) {
+		ASSERTTRUE(alone.runOneStep(own, 10., 5., 20., 20., HPWH::DR_ALLOW) == 0);
+	}
+	ASSERTTRUE(good.getSimState().tankTemps_C == alone.getSimState().tankTemps_C);
+	ASSERTTRUE(good.getEnergyInput() == alone.getEnergyInput());
+}
@@ -0,0 +1,298 @@
+/*unit test for hpwhd, the local simulation service: starts it, and checks that tanks stepped
+ * through it, alone, together and from concurrent clients, give the same outputs as the same
+ * tanks stepped here, and that snapshots, queries and the shared outputs do too
+ *
+ * Usage: testHpwhd [hpwhd path]
+ */
+#include "HPWH.hh"
+#include "hpwhdProtocol.hh"
+#include "testUtilityFcts.cc"
+
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+using std::cout;
+using std::string;
+
+std::vector<schedule> allSchedules;
+long minutesToRun;
+string socketPath;
+pid_t service = 0;
+
+// a failed assertion exits, and should not leave the service running
+void stopService() {
+	if (service > 0) {
+		kill(service, SIGTERM);
+		waitpid(service, NULL, 0);
+	}
+}
+
+const char *models[] = { "AOSmithHPTU80", "AOSmithHPTU80", "Sanden80", "Rheem2020Prem50" };
+const uint32_t numTanks = 4;
+
+// the inputs of a tank's step: the test schedules, with each tank's draws moved along
+HpwhdStep stepInputs(uint32_t tank, long minute) {
+	long i = (minute + 97 * tank) % minutesToRun;
+	HpwhdStep step;
+	step.tank = tank;
+	step.DRstatus = int(allSchedules[4][i]);
+	step.inletT_C = allSchedules[0][i];
+	step.drawVolume_L = GAL_TO_L(allSchedules[1][i]);
+	step.tankAmbientT_C = allSchedules[2][i];
+	step.heatSourceAmbientT_C = allSchedules[3][i];
+	return step;
+}
+
+// every field exactly the same; memcmp would also compare the padding
+bool sameOutputs(const HPWH::StepOutputs &a, const HPWH::StepOutputs &b) {
+	bool same = a.numHeatSources == b.numHeatSources && a.outletTemp_C == b.outletTemp_C &&
+		a.standbyLosses_kWh == b.standbyLosses_kWh &&
+		a.energyRemovedFromEnvironment_kWh == b.energyRemovedFromEnvironment_kWh &&
+		a.tankHeatContent_kJ == b.tankHeatContent_kJ;
+	for (int i = 0; i < HPWH::STEP_HEATSOURCES; i++) {
+		same = same && a.heatSourceEnergyInput_kWh[i] == b.heatSourceEnergyInput_kWh[i] &&
+			a.heatSourceEnergyOutput_kWh[i] == b.heatSourceEnergyOutput_kWh[i] &&
+			a.heatSourceRunTime_min[i] == b.heatSourceRunTime_min[i];
+	}
+	for (int i = 0; i < HPWH::STEP_TCOUPLES; i++) {
+		same = same && a.simTcouples_C[i] == b.simTcouples_C[i];
+	}
+	return same;
+}
+
+// the same tanks, stepped here
+struct LocalTanks {
+	std::vector<HPWH> hpwhs;
+	LocalTanks() : hpwhs(numTanks) {
+		for (uint32_t t = 0; t < numTanks; t++) {
+			ASSERTTRUE(getHPWHObject(hpwhs[t], models[t]) == 0);
+		}
+	}
+	HPWH::StepOutputs step(const HpwhdStep &step) {
+		HPWH::StepOutputs outputs;
+		ASSERTTRUE(hpwhs[step.tank].runOneStep(step.inletT_C, step.drawVolume_L, step.tankAmbientT_C,
+			step.heatSourceAmbientT_C, static_cast<HPWH::DRMODES>(step.DRstatus)) == 0);
+		ASSERTTRUE(hpwhs[step.tank].getStepOutputs(outputs) == 0);
+		return outputs;
+	}
+};
+
+void testCreate(HpwhdClient &client);
+void testFleetSteps(HpwhdClient &client, LocalTanks &local, long &minute);
+void testConcurrentClients(LocalTanks &local, long &minute);
+void testSnapshot(HpwhdClient &client, LocalTanks &local, long &minute);
+void testShared(HpwhdClient &client, LocalTanks &local, long &minute);
+void testBadRequests(HpwhdClient &client);
+
+int main(int argc, char *argv[])
+{
+	if (argc != 2) {
+		cout << "Usage: testHpwhd [hpwhd path]\n";
+		exit(1);
+	}
+	double newSetpoint;
+	ASSERTTRUE(readTestSchedules("testDOE_24hr50", allSchedules, minutesToRun, newSetpoint) == 0);
+
+	socketPath = "/tmp/testHpwhd." + std::to_string(getpid()) + ".sock";
+	service = fork();
+	if (service == 0) {
+		execl(argv[1], argv[1], socketPath.c_str(), "2", (char *)NULL);
+		_exit(127);
+	}
+	atexit(stopService);
+	HpwhdClient client;
+	for (int tries = 0; !client.connectTo(socketPath); tries++) {
+		if (tries == 500 || waitpid(service, NULL, WNOHANG) != 0) {
+			cout << "hpwhd did not start\n";
+			exit(1);
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+
+	LocalTanks local;
+	long minute = 0;
+	testCreate(client);
+	testFleetSteps(client, local, minute);
+	testConcurrentClients(local, minute);
+	testSnapshot(client, local, minute);
+	testShared(client, local, minute);
+	testBadRequests(client);
+
+	HpwhdStats stats;
+	ASSERTTRUE(client.stats(stats) == 0);
+	ASSERTTRUE(stats.tanks == numTanks);
+	ASSERTTRUE(stats.fleetSteps <= stats.stepRequests);
+	ASSERTTRUE(client.shutdown() == 0);
+	int exitStatus;
+	ASSERTTRUE(waitpid(service, &exitStatus, 0) == service);
+	ASSERTTRUE(WIFEXITED(exitStatus) && WEXITSTATUS(exitStatus) == 0);
+	service = 0;
+
+	//Made it through the gauntlet
+	return 0;
+}
+
+void testCreate(HpwhdClient &client) {
+	uint32_t firstTank;
+	ASSERTTRUE(client.create("AOSmithHPTU80", 2, firstTank) == 0);
+	ASSERTTRUE(firstTank == 0);
+	ASSERTTRUE(client.create("Sanden80", 1, firstTank) == 0);
+	ASSERTTRUE(firstTank == 2);
+	ASSERTTRUE(client.create("Rheem2020Prem50", 1, firstTank) == 0);
+	ASSERTTRUE(firstTank == 3);
+
+	// before a step, the outputs are of the new tank
+	LocalTanks fresh;
+	std::vector<HPWH::StepOutputs> outputs;
+	ASSERTTRUE(client.query({ 3, 0 }, outputs) == 0);
+	HPWH::StepOutputs expected;
+	ASSERTTRUE(fresh.hpwhs[3].getStepOutputs(expected) == 0);
+	ASSERTTRUE(outputs.size() == 2 && sameOutputs(outputs[0], expected));
+}
+
+void testFleetSteps(HpwhdClient &client, LocalTanks &local, long &minute) {
+	std::vector<HPWH::StepOutputs> outputs;
+	for (; minute < 180; minute++) {
+		// every tank in one request, in any order, or one tank alone
+		std::vector<HpwhdStep> steps;
+		if (minute % 3 == 2) {
+			steps.push_back(stepInputs(minute % numTanks, minute));
+		}
+		else {
+			for (uint32_t t = numTanks; t-- > 0;) {
+				steps.push_back(stepInputs(t, minute));
+			}
+		}
+		ASSERTTRUE(client.step(steps, outputs) == 0);
+		ASSERTTRUE(outputs.size() == steps.size());
+		for (size_t i = 0; i < steps.size(); i++) {
+			ASSERTTRUE(sameOutputs(outputs[i], local.step(steps[i])));
+		}
+	}
+	ASSERTTRUE(client.query({ 2 }, outputs) == 0);
+	HPWH::StepOutputs expected;
+	ASSERTTRUE(local.hpwhs[2].getStepOutputs(expected) == 0);
+	ASSERTTRUE(sameOutputs(outputs[0], expected));
+}
+
+// a client per tank, each stepping its own tank, so their steps can be coalesced
+void testConcurrentClients(LocalTanks &local, long &minute) {
+	const long steps = 300;
+	std::vector<std::vector<HPWH::StepOutputs>> results(numTanks);
+	std::vector<int> failures(numTanks, 0);
+	std::vector<std::thread> clients;
+	for (uint32_t t = 0; t < numTanks; t++) {
+		clients.emplace_back([&, t]() {
+			HpwhdClient client;
+			if (!client.connectTo(socketPath)) {
+				failures[t]++;
+				return;
+			}
+			std::vector<HPWH::StepOutputs> outputs;
+			for (long m = minute; m < minute + steps; m++) {
+				if (client.step({ stepInputs(t, m) }, outputs) != 0 || outputs.size() != 1) {
+					failures[t]++;
+					return;
+				}
+				results[t].push_back(outputs[0]);
+			}
+		});
+	}
+	for (std::thread &client : clients) {
+		client.join();
+	}
+	for (uint32_t t = 0; t < numTanks; t++) {
+		ASSERTTRUE(failures[t] == 0);
+		for (long m = 0; m < steps; m++) {
+			ASSERTTRUE(sameOutputs(results[t][m], local.step(stepInputs(t, minute + m))));
+		}
+	}
+	minute += steps;
+}
+
+void testSnapshot(HpwhdClient &client, LocalTanks &local, long &minute) {
+	HPWH::SimState state, localState;
+	ASSERTTRUE(client.snapshot(2, state) == 0);
+	ASSERTTRUE(local.hpwhs[2].getSimState(localState) == 0);
+	ASSERTTRUE(state.tankTemps_C == localState.tankTemps_C);
+	ASSERTTRUE(state.heatSourcesOn == localState.heatSourcesOn);
+	ASSERTTRUE(state.setpoint_C == localState.setpoint_C && state.timerTOT == localState.timerTOT);
+
+	// step on, go back, and the same steps give the same outputs
+	std::vector<HPWH::StepOutputs> first, again;
+	for (long m = minute; m < minute + 30; m++) {
+		ASSERTTRUE(client.step({ stepInputs(2, m) }, first) == 0);
+	}
+	ASSERTTRUE(client.restore(2, state) == 0);
+	for (long m = minute; m < minute + 30; m++) {
+		ASSERTTRUE(client.step({ stepInputs(2, m) }, again) == 0);
+		ASSERTTRUE(sameOutputs(again[0], local.step(stepInputs(2, m))));
+	}
+	ASSERTTRUE(sameOutputs(first[0], again[0]));
+	minute += 30;
+
+	// a Sanden80 snapshot does not fit an AOSmithHPTU80
+	ASSERTTRUE(client.restore(0, state) == HPWH::HPWH_ABORT);
+}
+
+void testShared(HpwhdClient &client, LocalTanks &local, long &minute) {
+	string path = "/tmp/testHpwhd." + std::to_string(getpid()) + ".out";
+	size_t size = numTanks * sizeof(HPWH::StepOutputs);
+	int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+	ASSERTTRUE(fd >= 0 && ftruncate(fd, size) == 0);
+	void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	ASSERTTRUE(map != MAP_FAILED);
+	const HPWH::StepOutputs *shared = static_cast<const HPWH::StepOutputs *>(map);
+
+	std::vector<HPWH::StepOutputs> outputs;
+	ASSERTTRUE(client.step({ stepInputs(0, minute) }, outputs, true) == HPWH::HPWH_ABORT);
+	ASSERTTRUE(client.mapShared(path, size) == 0);
+	for (long m = minute; m < minute + 20; m++) {
+		std::vector<HpwhdStep> steps;
+		for (uint32_t t = 0; t < numTanks; t++) {
+			steps.push_back(stepInputs(t, m));
+		}
+		ASSERTTRUE(client.step(steps, outputs, true) == 0);
+		ASSERTTRUE(outputs.empty());
+		for (uint32_t t = 0; t < numTanks; t++) {
+			ASSERTTRUE(sameOutputs(shared[t], local.step(steps[t])));
+		}
+	}
+	minute += 20;
+	ASSERTTRUE(client.query({ 1 }, outputs, true) == 0);
+	ASSERTTRUE(sameOutputs(shared[0], shared[1]));
+
+	// more outputs than the region holds
+	std::vector<uint32_t> tooMany(numTanks + 1, 0);
+	ASSERTTRUE(client.query(tooMany, outputs, true) == HPWH::HPWH_ABORT);
+	munmap(map, size);
+	close(fd);
+	unlink(path.c_str());
+}
+
+void testBadRequests(HpwhdClient &client) {
+	uint32_t firstTank;
+	std::vector<HPWH::StepOutputs> outputs;
+	ASSERTTRUE(client.create("NoSuchModel", 1, firstTank) == HPWH::HPWH_ABORT);
+	ASSERTTRUE(client.getError().find("NoSuchModel") != string::npos);
+	ASSERTTRUE(client.create("AOSmithHPTU80", 0, firstTank) == HPWH::HPWH_ABORT);
+	ASSERTTRUE(client.step({ stepInputs(0, 0), stepInputs(0, 1) }, outputs) == HPWH::HPWH_ABORT);
+	HpwhdStep noTank = stepInputs(0, 0);
+	noTank.tank = numTanks;
+	ASSERTTRUE(client.step({ noTank }, outputs) == HPWH::HPWH_ABORT);
+	ASSERTTRUE(client.query({ numTanks }, outputs) == HPWH::HPWH_ABORT);
+	HPWH::SimState state;
+	ASSERTTRUE(client.snapshot(numTanks, state) == HPWH::HPWH_ABORT);
+	ASSERTTRUE(client.mapShared("/nonexistent/hpwhd.out", 64) == HPWH::HPWH_ABORT);
+	std::vector<char> reply;
+	ASSERTTRUE(client.call(99, 0, std::vector<char>(), reply) == HPWH::HPWH_ABORT);
+
+	// the connection still works after them
+	ASSERTTRUE(client.query({ 0 }, outputs) == 0);
+}
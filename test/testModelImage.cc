@@ -0,0 +1,235 @@
+/*unit test for compiled model images: every model file and preset, compiled and loaded back,
+ * must simulate bit for bit as the text or preset path
+ *
+ *
+ */
+#include "HPWH.hh"
+#include "testUtilityFcts.cc"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+
+using std::cout;
+using std::string;
+
+std::vector<schedule> allSchedules;
+long minutesToRun;
+
+const std::vector<string> modelFiles = { "AOSmithHPTU80.txt", "AOSmithPHPT60.txt", "GE502014.txt", "Rheem2020Build50.txt",
+	"Rheem2020Prem40.txt", "Rheem2020Prem50.txt", "RheemHB50.txt", "Sanden80.txt", "Stiebel220e.txt" };
+
+void testModelFiles(const string &imageFile);
+void testPresets();
+void testMidRun();
+void testDamagedImage(const string &imageFile);
+
+int main(int argc, char *argv[])
+{
+	double newSetpoint;
+	ASSERTTRUE(argc > 1);
+	ASSERTTRUE(readTestSchedules("testDOE_24hr50", allSchedules, minutesToRun, newSetpoint) == 0);
+
+	testModelFiles(argv[1]);
+	testPresets();
+	testMidRun();
+	testDamagedImage(argv[1]);
+
+	//Made it through the gauntlet
+	return 0;
+}
+
+// runs both for a day and checks every output matches
+void checkSameRun(HPWH &a, HPWH &b) {
+	ASSERTTRUE(a.getHPWHModel() == b.getHPWHModel());
+	ASSERTTRUE(a.getNumNodes() == b.getNumNodes());
+	ASSERTTRUE(a.getNumHeatSources() == b.getNumHeatSources());
+	for (long i = 0; i < 1440; i++) {
+		ASSERTTRUE(a.runOneStep(allSchedules[0][i], GAL_TO_L(allSchedules[1][i]), allSchedules[2][i], allSchedules[3][i],
+			static_cast<HPWH::DRMODES>(int(allSchedules[4][i]))) == 0);
+		ASSERTTRUE(b.runOneStep(allSchedules[0][i], GAL_TO_L(allSchedules[1][i]), allSchedules[2][i], allSchedules[3][i],
+			static_cast<HPWH::DRMODES>(int(allSchedules[4][i]))) == 0);
+		for (int s = 0; s < a.getNumHeatSources(); s++) {
+			ASSERTTRUE(a.getNthHeatSourceEnergyInput(s) == b.getNthHeatSourceEnergyInput(s));
+			ASSERTTRUE(a.getNthHeatSourceEnergyOutput(s) == b.getNthHeatSourceEnergyOutput(s));
+			ASSERTTRUE(a.getNthHeatSourceRunTime(s) == b.getNthHeatSourceRunTime(s));
+		}
+		ASSERTTRUE(a.getOutletTemp() == b.getOutletTemp());
+	}
+	for (int n = 0; n < a.getNumNodes(); n++) {
+		ASSERTTRUE(a.getTankNodeTemp(n) == b.getTankNodeTemp(n));
+	}
+}
+
+void testModelFiles(const string &imageFile) {
+	for (const string &modelFile : modelFiles) {
+		HPWH text, fromMemory, fromFile;
+		ASSERTTRUE(text.HPWHinit_file(modelFile) == 0);
+		std::vector<unsigned char> image, recompiled;
+		ASSERTTRUE(text.compileModel(image) == 0);
+		ASSERTTRUE(fromMemory.HPWHinit_image(image) == 0);
+		ASSERTTRUE(text.compileModelFile(imageFile) == 0);
+		ASSERTTRUE(fromFile.HPWHinit_imageFile(imageFile) == 0);
+
+		// loading loses nothing, so compiling again gives the same bytes
+		ASSERTTRUE(fromFile.compileModel(recompiled) == 0);
+		ASSERTTRUE(recompiled == image);
+
+		HPWH reference;
+		ASSERTTRUE(reference.HPWHinit_file(modelFile) == 0);
+		checkSameRun(text, fromMemory);
+		checkSameRun(reference, fromFile);
+	}
+}
+
+void testPresets() {
+	for (const HPWH::PresetInfo &preset : HPWH::getPresets()) {
+		HPWH reference, loaded;
+		ASSERTTRUE(reference.HPWHinit_presets(preset.model) == 0);
+		std::vector<unsigned char> image;
+		ASSERTTRUE(reference.compileModel(image) == 0);
+		ASSERTTRUE(loaded.HPWHinit_image(image) == 0);
+		checkSameRun(reference, loaded);
+	}
+}
+
+// a compiled image carries the tank state too, so a run can continue from it
+void testMidRun() {
+	HPWH hpwh;
+	ASSERTTRUE(getHPWHObject(hpwh, "AOSmithHPTU80") == 0);
+	hpwh.setDoConduction(false);
+	for (long i = 0; i < 500; i++) {
+		hpwh.runOneStep(allSchedules[0][i], GAL_TO_L(allSchedules[1][i]), allSchedules[2][i], allSchedules[3][i],
+			static_cast<HPWH::DRMODES>(int(allSchedules[4][i])));
+	}
+	std::vector<unsigned char> image;
+	ASSERTTRUE(hpwh.compileModel(image) == 0);
+	HPWH loaded;
+	ASSERTTRUE(getHPWHObject(loaded, "Sanden80") == 0);   // replaced by the image
+	ASSERTTRUE(loaded.HPWHinit_image(image) == 0);
+	checkSameRun(hpwh, loaded);
+}
+
+uint32_t crc32(const std::vector<unsigned char> &data, size_t size) {
+	uint32_t crc = 0xFFFFFFFFu;
+	for (size_t i = 0; i < size; i++) {
+		crc ^= data[i];
+		for (int k = 0; k < 8; k++) {
+			crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320u : 0u);
+		}
+	}
+	return crc ^ 0xFFFFFFFFu;
+}
+
+// makes the checksum of a changed image good again
+void resign(std::vector<unsigned char> &image) {
+	uint32_t crc = crc32(image, image.size() - 4);
+	for (int i = 0; i < 4; i++) {
+		image[image.size() - 4 + i] = (unsigned char)(crc >> (8 * i));
+	}
+}
+
+// the image with the int at offset at set to value, and its checksum made good again
+std::vector<unsigned char> withInt(const std::vector<unsigned char> &image, size_t at, int value) {
+	std::vector<unsigned char> changed(image);
+	for (int i = 0; i < 4; i++) {
+		changed[at + i] = (unsigned char)((uint32_t)value >> (8 * i));
+	}
+	resign(changed);
+	return changed;
+}
+
+void testDamagedImage(const string &imageFile) {
+	HPWH source, target;
+	ASSERTTRUE(source.HPWHinit_presets(HPWH::MODELS_Rheem2020Prem50) == 0);
+	ASSERTTRUE(target.HPWHinit_presets(HPWH::MODELS_GE2014) == 0);
+	std::vector<unsigned char> image, before, after;
+	ASSERTTRUE(source.compileModel(image) == 0);
+	ASSERTTRUE(target.compileModel(before) == 0);
+
+	std::vector<unsigned char> damaged(image);
+	damaged[damaged.size() / 2] ^= 0x10;
+	ASSERTTRUE(target.HPWHinit_image(damaged) == HPWH::HPWH_ABORT);
+	damaged.assign(image.begin(), image.end() - 8);
+	ASSERTTRUE(target.HPWHinit_image(damaged) == HPWH::HPWH_ABORT);
+	damaged = image;
+	damaged[0] = 'X';
+	ASSERTTRUE(target.HPWHinit_image(damaged) == HPWH::HPWH_ABORT);
+	std::vector<unsigned char> state;
+	source.saveState(state);   // a state snapshot is not a model image
+	ASSERTTRUE(target.HPWHinit_image(state) == HPWH::HPWH_ABORT);
+	ASSERTTRUE(target.HPWHinit_imageFile("noSuchFile.hpwm") == HPWH::HPWH_ABORT);
+
+	// well formed images, checksum and all, with nodes outside the tank
+	const size_t nodeDensityAt = 33, inletHeightAt = 37, inlet2HeightAt = 41, lastLowestNodeAt = image.size() - 12;
+	for (size_t at : { nodeDensityAt, inletHeightAt, inlet2HeightAt, lastLowestNodeAt }) {
+		for (int node : { -1, source.getNumNodes(), 1000000 }) {
+			ASSERTTRUE(target.HPWHinit_image(withInt(image, at, node)) == HPWH::HPWH_ABORT);
+		}
+	}
+	ASSERTTRUE(target.HPWHinit_image(withInt(image, inletHeightAt, source.getNumNodes() - 1)) == 0);
+
+	// a tank without its node temperatures, the bytes and the flag both gone
+	const size_t nodesAt = 206, hasTankTempsAt = 210, hasNextTankTempsAt = 211, tankTempsAt = 212;
+	const size_t tempsSize = 8 * source.getNumNodes();
+	for (size_t flagAt : { hasTankTempsAt, hasNextTankTempsAt }) {
+		damaged = image;
+		size_t from = tankTempsAt + ((flagAt == hasTankTempsAt) ? 0 : tempsSize);
+		damaged.erase(damaged.begin() + from, damaged.begin() + from + tempsSize);
+		damaged[flagAt] = 0;
+		resign(damaged);
+		ASSERTTRUE(target.HPWHinit_image(damaged) == HPWH::HPWH_ABORT);
+	}
+	// and node temperatures without a tank
+	damaged = withInt(image, nodesAt, 0);
+	damaged.erase(damaged.begin() + tankTempsAt, damaged.begin() + tankTempsAt + 2 * tempsSize);
+	resign(damaged);
+	ASSERTTRUE(target.HPWHinit_image(damaged) == HPWH::HPWH_ABORT);
+
+	// enums that are none of their values
+	const size_t hpwhModelAt = 13, prevDRstatusAt = 109;
+	const size_t lastConfigurationAt = image.size() - 20, lastTypeAt = image.size() - 16, lastExtrapolationAt = image.size() - 8;
+	for (int model : { -1, 0, 999, (int)HPWH::MODELS_ColmacCxA_20_MP }) {
+		ASSERTTRUE(target.HPWHinit_image(withInt(image, hpwhModelAt, model)) == HPWH::HPWH_ABORT);
+	}
+	ASSERTTRUE(target.HPWHinit_image(withInt(image, hpwhModelAt, HPWH::MODELS_CustomFile)) == 0);
+	for (int status : { -1, 16 }) {
+		ASSERTTRUE(target.HPWHinit_image(withInt(image, prevDRstatusAt, status)) == HPWH::HPWH_ABORT);
+	}
+	ASSERTTRUE(target.HPWHinit_image(withInt(image, prevDRstatusAt, HPWH::DR_LOC | HPWH::DR_TOT)) == 0);
+	for (int configuration : { -1, 3 }) {
+		ASSERTTRUE(target.HPWHinit_image(withInt(image, lastConfigurationAt, configuration)) == HPWH::HPWH_ABORT);
+	}
+	for (int type : { -1, 4 }) {
+		ASSERTTRUE(target.HPWHinit_image(withInt(image, lastTypeAt, type)) == HPWH::HPWH_ABORT);
+	}
+	for (int method : { -1, 2 }) {
+		ASSERTTRUE(target.HPWHinit_image(withInt(image, lastExtrapolationAt, method)) == HPWH::HPWH_ABORT);
+	}
+
+	// a performance map missing the terms getCapacity reads: the file parser takes a short
+	// list, so the model compiles, but its image does not load
+	std::ifstream in("AOSmithHPTU80.txt");
+	ASSERTTRUE(in.good());
+	const string shortModelFile = imageFile + ".txt";
+	std::ofstream out(shortModelFile);
+	string line;
+	while (std::getline(in, line)) {
+		if (line.find("heatsource 2 copT1quad") != 0) {
+			out << line << "\n";
+		}
+	}
+	out.close();
+	HPWH shortMap;
+	ASSERTTRUE(shortMap.HPWHinit_file(shortModelFile) == 0);
+	ASSERTTRUE(shortMap.compileModel(damaged) == 0);
+	ASSERTTRUE(target.HPWHinit_image(damaged) == HPWH::HPWH_ABORT);
+	std::remove(shortModelFile.c_str());
+
+	ASSERTTRUE(target.HPWHinit_image(before) == 0);
+
+	ASSERTTRUE(target.compileModel(after) == 0);
+	ASSERTTRUE(before == after);
+}
@@ -0,0 +1,125 @@
+/*unit test for the Parareal parallel-in-time driver
+ *
+ *
+ *
+ */
+#include "HPWH.hh"
+#include "HPWHParareal.hh"
+#include "testUtilityFcts.cc"
+
+#include <iostream>
+#include <string>
+
+
+using std::cout;
+using std::string;
+
+struct TestSchedules {
+	std::vector<double> inletT_C, drawVolume_L, ambientT_C, externalT_C;
+	std::vector<HPWH::DRMODES> DRstatus;
+};
+
+void makeSchedules(TestSchedules &sched, int nMinutes, double drawScale_L);
+void testMatchesSerialRun(string modelName, double drawScale_L);
+void testThreadCountIndependent(string modelName, double drawScale_L);
+void runSerial(HPWH &hpwh, const TestSchedules &sched, double &energyIn_kWh, double &energyOut_kWh);
+
+const int nTestMinutes = 3 * 1440;
+
+int main(int argc, char *argv[])
+{
+	testMatchesSerialRun("AOSmithHPTU80", 1.);
+	testMatchesSerialRun("ColmacCxA_20_SP", 10.);
+	testThreadCountIndependent("AOSmithHPTU80", 1.);
+	testThreadCountIndependent("ColmacCxA_20_SP", 10.);
+
+	//Made it through the gauntlet
+	return 0;
+}
+
+void makeSchedules(TestSchedules &sched, int nMinutes, double drawScale_L) {
+	for (int i = 0; i < nMinutes; i++) {
+		int minuteOfDay = i % 1440;
+		double draw_L = 0.;
+		// morning and evening draw periods
+		if ((minuteOfDay >= 420 && minuteOfDay < 480 && minuteOfDay % 7 < 3) ||
+			(minuteOfDay >= 1140 && minuteOfDay < 1230 && minuteOfDay % 5 < 2)) {
+			draw_L = 8. * drawScale_L;
+		}
+		sched.inletT_C.push_back(10. + 2. * sin(i / 1440. * 2. * 3.14159));
+		sched.drawVolume_L.push_back(draw_L);
+		sched.ambientT_C.push_back(19.);
+		sched.externalT_C.push_back(12. + 8. * sin((minuteOfDay - 480) / 1440. * 2. * 3.14159));
+		sched.DRstatus.push_back(HPWH::DR_ALLOW);
+	}
+}
+
+void runSerial(HPWH &hpwh, const TestSchedules &sched, double &energyIn_kWh, double &energyOut_kWh) {
+	energyIn_kWh = 0.;
+	energyOut_kWh = 0.;
+	for (size_t i = 0; i < sched.drawVolume_L.size(); i++) {
+		ASSERTTRUE(hpwh.runOneStep(sched.inletT_C[i], sched.drawVolume_L[i], sched.ambientT_C[i],
+			sched.externalT_C[i], sched.DRstatus[i]) == 0);
+		for (int j = 0; j < hpwh.getNumHeatSources(); j++) {
+			energyIn_kWh += hpwh.getNthHeatSourceEnergyInput(j);
+			energyOut_kWh += hpwh.getNthHeatSourceEnergyOutput(j);
+		}
+	}
+}
+
+double sum(const std::vector<double> &values) {
+	double total = 0.;
+	for (double value : values) {
+		total += value;
+	}
+	return total;
+}
+
+void testMatchesSerialRun(string modelName, double drawScale_L) {
+	TestSchedules sched;
+	makeSchedules(sched, nTestMinutes, drawScale_L);
+
+	HPWH hpwh;
+	getHPWHObject(hpwh, modelName);
+	double energyIn_kWh, energyOut_kWh;
+	runSerial(hpwh, sched, energyIn_kWh, energyOut_kWh);
+	HPWH::SimState serialState;
+	hpwh.getSimState(serialState);
+
+	// with no tolerance the iteration continues until the slice start states are exact
+	HPWHParareal parareal([&](HPWH &h) { return getHPWHObject(h, modelName); });
+	parareal.setNumSlices(8);
+	parareal.setNumThreads(4);
+	HPWHParareal::Results results;
+	ASSERTTRUE(parareal.run(nTestMinutes, &sched.inletT_C[0], &sched.drawVolume_L[0], &sched.ambientT_C[0],
+		&sched.externalT_C[0], &sched.DRstatus[0], results) == 0);
+
+	ASSERTTRUE(results.converged);
+	ASSERTTRUE(results.iterations <= 9);
+	ASSERTTRUE(results.finalState.tankTemps_C == serialState.tankTemps_C);
+	ASSERTTRUE(results.finalState.heatSourcesOn == serialState.heatSourcesOn);
+	ASSERTTRUE(relcmpd(sum(results.energyInput_kWh), energyIn_kWh));
+	ASSERTTRUE(relcmpd(sum(results.energyOutput_kWh), energyOut_kWh));
+}
+
+void testThreadCountIndependent(string modelName, double drawScale_L) {
+	TestSchedules sched;
+	makeSchedules(sched, nTestMinutes, drawScale_L);
+
+	HPWHParareal::Results results[2];
+	int threads[2] = { 1, 3 };
+	for (int i = 0; i < 2; i++) {
+		HPWHParareal parareal([&](HPWH &h) { return getHPWHObject(h, modelName); });
+		parareal.setNumSlices(6);
+		parareal.setNumThreads(threads[i]);
+		parareal.setTolerance(0.05);
+		ASSERTTRUE(parareal.run(nTestMinutes, &sched.inletT_C[0], &sched.drawVolume_L[0], &sched.ambientT_C[0],
+			&sched.externalT_C[0], &sched.DRstatus[0], results[i]) == 0);
+	}
+
+	// the same start states are refined in the same order, so the results are identical
+	ASSERTTRUE(results[0].iterations == results[1].iterations);
+	ASSERTTRUE(results[0].finalState.tankTemps_C == results[1].finalState.tankTemps_C);
+	ASSERTTRUE(results[0].energyInput_kWh == results[1].energyInput_kWh);
+	ASSERTTRUE(results[0].energyOutput_kWh == results[1].energyOutput_kWh);
+}
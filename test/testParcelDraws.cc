@@ -0,0 +1,119 @@
+/*unit test for the parcel (plug flow) draw model
+ *
+ *
+ *
+ */
+#include "HPWH.hh"
+#include "testUtilityFcts.cc"
+
+#include <iostream>
+#include <string>
+
+
+using std::cout;
+using std::string;
+
+const HPWH::DRMODES lockOutAll = static_cast<HPWH::DRMODES>(HPWH::DR_LOC | HPWH::DR_LOR);
+
+void setUpTank(HPWH &hpwh, bool doParcels);
+void testWholeNodeDrawMatchesNodeModel();
+void testDrawLargerThanTank();
+void testTwoInletEnergyBalance();
+void testPlugFlowKeepsThermocline();
+void testBadTolerance();
+
+int main(int argc, char *argv[])
+{
+	testWholeNodeDrawMatchesNodeModel();
+	testDrawLargerThanTank();
+	testTwoInletEnergyBalance();
+	testPlugFlowKeepsThermocline();
+	testBadTolerance();
+
+	//Made it through the gauntlet
+	return 0;
+}
+
+// a Sanden80 with no losses or conduction, and the tank stratified from 15 C at the bottom to 60 C at the top
+void setUpTank(HPWH &hpwh, bool doParcels) {
+	getHPWHObject(hpwh, "Sanden80");
+	hpwh.setUA(0.);
+	hpwh.setDoConduction(false);
+	hpwh.setDoParcelDraws(doParcels);
+
+	HPWH::SimState state;
+	hpwh.getSimState(state);
+	int n = hpwh.getNumNodes();
+	for (int i = 0; i < n; i++) {
+		state.tankTemps_C[i] = 15. + 45. * i / (n - 1);
+	}
+	hpwh.setSimState(state);
+}
+
+void testWholeNodeDrawMatchesNodeModel() {
+	HPWH nodes, parcels;
+	setUpTank(nodes, false);
+	setUpTank(parcels, true);
+	double draw_L = 5 * nodes.getTankSize() / nodes.getNumNodes();
+
+	ASSERTTRUE(nodes.runOneStep(10., draw_L, 20., 20., lockOutAll) == 0);
+	ASSERTTRUE(parcels.runOneStep(10., draw_L, 20., 20., lockOutAll) == 0);
+	for (int i = 0; i < nodes.getNumNodes(); i++) {
+		ASSERTTRUE(cmpd(nodes.getTankNodeTemp(i), parcels.getTankNodeTemp(i)));
+	}
+	ASSERTTRUE(cmpd(nodes.getOutletTemp(), parcels.getOutletTemp()));
+}
+
+void testDrawLargerThanTank() {
+	HPWH hpwh;
+	setUpTank(hpwh, true);
+	double tankAverage_C = 0.;
+	for (int i = 0; i < hpwh.getNumNodes(); i++) {
+		tankAverage_C += hpwh.getTankNodeTemp(i) / hpwh.getNumNodes();
+	}
+	double draw_L = 2. * hpwh.getTankSize();
+
+	ASSERTTRUE(hpwh.runOneStep(10., draw_L, 20., 20., lockOutAll) == 0);
+	for (int i = 0; i < hpwh.getNumNodes(); i++) {
+		ASSERTTRUE(cmpd(hpwh.getTankNodeTemp(i), 10.));
+	}
+	// the whole tank comes out, then as much inlet water
+	ASSERTTRUE(cmpd(hpwh.getOutletTemp(), (tankAverage_C + 10.) / 2.));
+}
+
+void testTwoInletEnergyBalance() {
+	HPWH hpwh;
+	setUpTank(hpwh, true);
+	hpwh.setInlet2ByFraction(0.5);
+	double heatContent_kJ = hpwh.getTankHeatContent_kJ();
+	double draw_L = 37.3, inlet2_L = 12.1;
+
+	ASSERTTRUE(hpwh.runOneStep(10., draw_L, 20., 20., lockOutAll, inlet2_L, 45.) == 0);
+	double heatIn_kJ = HPWH::DENSITYWATER_kgperL * HPWH::CPWATER_kJperkgC *
+		(10. * (draw_L - inlet2_L) + 45. * inlet2_L - hpwh.getOutletTemp() * draw_L);
+	ASSERTTRUE(relcmpd(heatContent_kJ + heatIn_kJ, hpwh.getTankHeatContent_kJ()));
+}
+
+void testPlugFlowKeepsThermocline() {
+	// many small draws of a hot tank move the thermocline up without smearing it
+	HPWH hpwh;
+	getHPWHObject(hpwh, "Sanden80");
+	hpwh.setUA(0.);
+	hpwh.setDoConduction(false);
+	hpwh.setDoParcelDraws(true);
+	int n = hpwh.getNumNodes();
+	double nodeVolume_L = hpwh.getTankSize() / n;
+
+	for (int i = 0; i < n / 2; i++) {
+		ASSERTTRUE(hpwh.runOneStep(10., nodeVolume_L, 20., 20., lockOutAll) == 0);
+	}
+	for (int i = 0; i < n; i++) {
+		ASSERTTRUE(cmpd(hpwh.getTankNodeTemp(i), (i < n / 2) ? 10. : hpwh.getSetpoint()));
+	}
+}
+
+void testBadTolerance() {
+	HPWH hpwh;
+	getHPWHObject(hpwh, "Sanden80");
+	ASSERTTRUE(hpwh.setDoParcelDraws(true, -1.) == HPWH::HPWH_ABORT);
+}
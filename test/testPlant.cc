@@ -0,0 +1,261 @@
+/*unit test for the central plant engine: a primary and swing tank with recirculation run as a
+ * plant end exactly as the two tanks stepped together by hand, tanks in parallel split the flow
+ * by their fractions, plants run by HPWHBatch in chunks end as run alone, and bad plants and
+ * runs are refused
+ *
+ *
+ */
+#include "HPWH.hh"
+#include "HPWHPlant.hh"
+#include "testUtilityFcts.cc"
+
+#include <iostream>
+#include <string>
+
+
+using std::cout;
+using std::string;
+
+std::vector<schedule> allSchedules;
+long minutesToRun;
+
+// a few days of the test schedules, with the draws of a building
+struct PlantInputs {
+	std::vector<double> inletT_C, drawVolume_L, ambientT_C, externalT_C;
+	std::vector<HPWH::DRMODES> DRstatus;
+	PlantInputs(long steps, double drawScale) {
+		for (long i = 0; i < steps; i++) {
+			long j = i % minutesToRun;
+			inletT_C.push_back(allSchedules[0][j]);
+			drawVolume_L.push_back(drawScale * GAL_TO_L(allSchedules[1][j]));
+			ambientT_C.push_back(allSchedules[2][j]);
+			externalT_C.push_back(allSchedules[3][j]);
+			DRstatus.push_back(static_cast<HPWH::DRMODES>(int(allSchedules[4][j])));
+		}
+	}
+	HPWHPlant::Inputs plantInputs() {
+		HPWHPlant::Inputs in;
+		in.inletT_C = inletT_C.data();
+		in.drawVolume_L = drawVolume_L.data();
+		in.tankAmbientT_C = ambientT_C.data();
+		in.heatSourceAmbientT_C = externalT_C.data();
+		in.DRstatus = DRstatus.data();
+		return in;
+	}
+};
+
+const double recircFlow_Lpermin = GAL_TO_L(3.);
+const double loopLoss_W = 3600.;
+
+void testSameAsGlued();
+void testParallelTanks();
+void testBatchSameAsAlone(int threads, long chunkSteps);
+void testBadPlants();
+
+int main(int argc, char *argv[])
+{
+	double newSetpoint;
+	ASSERTTRUE(readTestSchedules("testDOE_24hr50", allSchedules, minutesToRun, newSetpoint) == 0);
+
+	testSameAsGlued();
+	testParallelTanks();
+	testBatchSameAsAlone(1, 43200);
+	testBatchSameAsAlone(3, 500);
+	testBadPlants();
+
+	//Made it through the gauntlet
+	return 0;
+}
+
+void makeTanks(HPWH &primary, HPWH &swing) {
+	ASSERTTRUE(getHPWHObject(primary, "ColmacCxA_20_SP") == 0);
+	ASSERTTRUE(primary.setSetpoint(60.) == 0);
+	primary.resetTankToSetpoint();
+	ASSERTTRUE(swing.HPWHinit_resSwingTank(GAL_TO_L(80.), 0.95, 0., 4500., F_TO_C(120.)) == 0);
+}
+
+void makePlant(HPWHPlant &plant) {
+	HPWH primary, swing;
+	makeTanks(primary, swing);
+	ASSERTTRUE(plant.addStage(primary) == 0);
+	ASSERTTRUE(plant.addStage(swing) == 0);
+	ASSERTTRUE(plant.setRecirculation(recircFlow_Lpermin, loopLoss_W) == 0);
+}
+
+void testSameAsGlued() {
+	const long steps = 3 * minutesToRun;
+	PlantInputs inputs(steps, 12.);
+	HPWHPlant plant;
+	makePlant(plant);
+	std::vector<double> supplyT_C(steps), returnT_C(steps), energyInput_kWh(steps), stageEnergyInput_kWh(2 * steps);
+	HPWHPlant::OutputArrays outputs;
+	outputs.supplyT_C = supplyT_C.data();
+	outputs.returnT_C = returnT_C.data();
+	outputs.energyInput_kWh = energyInput_kWh.data();
+	outputs.stageEnergyInput_kWh = stageEnergyInput_kWh.data();
+	ASSERTTRUE(plant.runNSteps(steps, inputs.plantInputs(), &outputs) == 0);
+
+	// the two tanks stepped together by hand, the primary's outlet feeding the swing tank
+	HPWH primary, swing;
+	makeTanks(primary, swing);
+	const double loopDrop_C = loopLoss_W * 60. / 1000. / (recircFlow_Lpermin * HPWH::DENSITYWATER_kgperL * HPWH::CPWATER_kJperkgC);
+	bool swingHeated = false;
+	for (long i = 0; i < steps; i++) {
+		double returnT = swing.getTankNodeTemp(swing.getNumNodes() - 1) - loopDrop_C;
+		double draw_L = inputs.drawVolume_L[i] + recircFlow_Lpermin;
+		ASSERTTRUE(primary.runOneStep(inputs.inletT_C[i], inputs.drawVolume_L[i], inputs.ambientT_C[i],
+			inputs.externalT_C[i], inputs.DRstatus[i]) == 0);
+		double primaryOutletT_C = (inputs.drawVolume_L[i] > 0.) ? primary.getOutletTemp() : 0.;
+		ASSERTTRUE(swing.runOneStep(primaryOutletT_C, draw_L, inputs.ambientT_C[i], inputs.externalT_C[i],
+			inputs.DRstatus[i], recircFlow_Lpermin, returnT) == 0);
+		double primaryEnergy_kWh = 0., swingEnergy_kWh = 0.;
+		for (int j = 0; j < primary.getNumHeatSources(); j++) {
+			primaryEnergy_kWh += primary.getNthHeatSourceEnergyInput(j);
+		}
+		for (int j = 0; j < swing.getNumHeatSources(); j++) {
+			swingEnergy_kWh += swing.getNthHeatSourceEnergyInput(j);
+		}
+		swingHeated = swingHeated || swingEnergy_kWh > 0.;
+
+		ASSERTTRUE(supplyT_C[i] == swing.getOutletTemp());
+		ASSERTTRUE(returnT_C[i] == returnT);
+		ASSERTTRUE(stageEnergyInput_kWh[2 * i] == primaryEnergy_kWh);
+		ASSERTTRUE(stageEnergyInput_kWh[2 * i + 1] == swingEnergy_kWh);
+		ASSERTTRUE(energyInput_kWh[i] == primaryEnergy_kWh + swingEnergy_kWh);
+	}
+	ASSERTTRUE(swingHeated);
+	for (int n = 0; n < primary.getNumNodes(); n++) {
+		ASSERTTRUE(plant.getTank(0, 0)->getTankNodeTemp(n) == primary.getTankNodeTemp(n));
+	}
+	for (int n = 0; n < swing.getNumNodes(); n++) {
+		ASSERTTRUE(plant.getTank(1, 0)->getTankNodeTemp(n) == swing.getTankNodeTemp(n));
+	}
+}
+
+void testParallelTanks() {
+	// each tank of a stage runs as it would alone on its share of the flow
+	const long steps = 2 * minutesToRun;
+	PlantInputs inputs(steps, 4.);
+	HPWH prototype;
+	ASSERTTRUE(getHPWHObject(prototype, "AOSmithHPTU80") == 0);
+	const std::vector<double> fractions = { 0.25, 0.75 };
+	HPWHPlant plant;
+	ASSERTTRUE(plant.addStage(std::vector<HPWH>(2, prototype), fractions) == 0);
+	ASSERTTRUE(plant.getNumStages() == 1 && plant.getNumTanks(0) == 2);
+	std::vector<double> supplyT_C(steps);
+	HPWHPlant::OutputArrays outputs;
+	outputs.supplyT_C = supplyT_C.data();
+	ASSERTTRUE(plant.runNSteps(steps, inputs.plantInputs(), &outputs) == 0);
+
+	std::vector<HPWH> alone(2, prototype);
+	for (long i = 0; i < steps; i++) {
+		double mixedT_C = 0.;
+		for (int k = 0; k < 2; k++) {
+			ASSERTTRUE(alone[k].runOneStep(inputs.inletT_C[i], inputs.drawVolume_L[i] * fractions[k], inputs.ambientT_C[i],
+				inputs.externalT_C[i], inputs.DRstatus[i]) == 0);
+			mixedT_C += alone[k].getOutletTemp() * fractions[k];
+		}
+		ASSERTTRUE(supplyT_C[i] == ((inputs.drawVolume_L[i] > 0.) ? mixedT_C : 0.));
+	}
+	for (int k = 0; k < 2; k++) {
+		for (int n = 0; n < prototype.getNumNodes(); n++) {
+			ASSERTTRUE(plant.getTank(0, k)->getTankNodeTemp(n) == alone[k].getTankNodeTemp(n));
+		}
+	}
+
+	// equal shares of identical tanks stay identical
+	HPWHPlant equal;
+	ASSERTTRUE(equal.addStage(prototype, 3) == 0);
+	ASSERTTRUE(equal.runNSteps(steps, inputs.plantInputs()) == 0);
+	for (int n = 0; n < prototype.getNumNodes(); n++) {
+		ASSERTTRUE(equal.getTank(0, 0)->getTankNodeTemp(n) == equal.getTank(0, 2)->getTankNodeTemp(n));
+	}
+}
+
+void testBatchSameAsAlone(int threads, long chunkSteps) {
+	const long steps = 3 * minutesToRun;
+	const int numPlants = 5;
+	std::vector<PlantInputs> inputs;
+	for (int p = 0; p < numPlants; p++) {
+		inputs.push_back(PlantInputs(steps, 6. + 3. * p));
+	}
+
+	std::vector<HPWHPlant> plants(numPlants);
+	std::vector<std::vector<double> > supplyT_C(numPlants, std::vector<double>(steps));
+	std::vector<std::vector<double> > stageEnergyInput_kWh(numPlants, std::vector<double>(2 * steps));
+	std::vector<HPWHBatch::Job> jobs;
+	for (int p = 0; p < numPlants; p++) {
+		makePlant(plants[p]);
+		HPWHPlant::OutputArrays outputs;
+		outputs.supplyT_C = supplyT_C[p].data();
+		outputs.stageEnergyInput_kWh = stageEnergyInput_kWh[p].data();
+		jobs.push_back(plants[p].batchJob(steps, inputs[p].plantInputs(), &outputs));
+		ASSERTTRUE(jobs.back().hpwh == plants[p].getTank(0, 0));
+	}
+	HPWHBatch batch;
+	ASSERTTRUE(batch.setNumThreads(threads) == 0);
+	ASSERTTRUE(batch.setChunkSteps(chunkSteps) == 0);
+	ASSERTTRUE(batch.run(jobs) == 0);
+
+	for (int p = 0; p < numPlants; p++) {
+		HPWHPlant alone;
+		makePlant(alone);
+		std::vector<double> aloneSupplyT_C(steps), aloneStageEnergyInput_kWh(2 * steps);
+		HPWHPlant::OutputArrays outputs;
+		outputs.supplyT_C = aloneSupplyT_C.data();
+		outputs.stageEnergyInput_kWh = aloneStageEnergyInput_kWh.data();
+		ASSERTTRUE(alone.runNSteps(steps, inputs[p].plantInputs(), &outputs) == 0);
+		ASSERTTRUE(supplyT_C[p] == aloneSupplyT_C);
+		ASSERTTRUE(stageEnergyInput_kWh[p] == aloneStageEnergyInput_kWh);
+		for (int s = 0; s < 2; s++) {
+			for (int n = 0; n < alone.getTank(s, 0)->getNumNodes(); n++) {
+				ASSERTTRUE(plants[p].getTank(s, 0)->getTankNodeTemp(n) == alone.getTank(s, 0)->getTankNodeTemp(n));
+			}
+		}
+	}
+}
+
+void testBadPlants() {
+	PlantInputs inputs(10, 1.);
+	HPWH tank;
+	ASSERTTRUE(getHPWHObject(tank, "AOSmithHPTU80") == 0);
+	HPWHPlant plant;
+
+	// no stages, nothing to run
+	ASSERTTRUE(plant.runNSteps(10, inputs.plantInputs()) == HPWH::HPWH_ABORT);
+	ASSERTTRUE(plant.batchJob(10, inputs.plantInputs()).hpwh == NULL);
+	ASSERTTRUE(plant.getTank(0, 0) == NULL && plant.getNumTanks(0) == 0);
+
+	// stages need tanks, and positive fractions of the flow adding up to 1
+	ASSERTTRUE(plant.addStage(tank, 0) == HPWH::HPWH_ABORT);
+	ASSERTTRUE(plant.addStage(std::vector<HPWH>(), std::vector<double>()) == HPWH::HPWH_ABORT);
+	ASSERTTRUE(plant.addStage(std::vector<HPWH>(2, tank), { 1. }) == HPWH::HPWH_ABORT);
+	ASSERTTRUE(plant.addStage(std::vector<HPWH>(2, tank), { 0.5, 0.6 }) == HPWH::HPWH_ABORT);
+	ASSERTTRUE(plant.addStage(std::vector<HPWH>(2, tank), { 1.5, -0.5 }) == HPWH::HPWH_ABORT);
+	ASSERTTRUE(plant.getNumStages() == 0);
+
+	// recirculation needs a return stage that is there when it runs
+	ASSERTTRUE(plant.setRecirculation(-1., 0.) == HPWH::HPWH_ABORT);
+	ASSERTTRUE(plant.setRecirculation(1., -1.) == HPWH::HPWH_ABORT);
+	ASSERTTRUE(plant.setRecirculation(1., 100., -2) == HPWH::HPWH_ABORT);
+	ASSERTTRUE(plant.addStage(tank) == 0);
+	ASSERTTRUE(plant.setRecirculation(1., 100., 1) == 0);
+	ASSERTTRUE(plant.runNSteps(10, inputs.plantInputs()) == HPWH::HPWH_ABORT);
+	ASSERTTRUE(plant.addStage(tank) == 0);
+	ASSERTTRUE(plant.runNSteps(10, inputs.plantInputs()) == 0);
+	ASSERTTRUE(plant.getTank(1, 1) == NULL && plant.getTank(2, 0) == NULL);
+
+	// the inputs other than DR are required
+	HPWHPlant::Inputs missing = inputs.plantInputs();
+	missing.heatSourceAmbientT_C = NULL;
+	ASSERTTRUE(plant.runNSteps(10, missing) == HPWH::HPWH_ABORT);
+	missing = inputs.plantInputs();
+	missing.DRstatus = NULL;
+	ASSERTTRUE(plant.runNSteps(10, missing) == 0);
+	ASSERTTRUE(plant.runNSteps(-1, missing) == HPWH::HPWH_ABORT);
+
+	// a failed tank stops the plant
+	plant.getTank(0, 0)->setMinutesPerStep(2.);
+	ASSERTTRUE(plant.getTank(0, 0)->setDoTempDepression(true) == 0);
+	ASSERTTRUE(plant.runNSteps(10, missing) == HPWH::HPWH_ABORT);
+}
@@ -0,0 +1,108 @@
+/*unit test for the preset registry behind HPWH::getPresets and HPWH::findPreset
+ *
+ *
+ *
+ */
+#include "HPWH.hh"
+#include "testUtilityFcts.cc"
+
+#include <iostream>
+#include <set>
+#include <string>
+
+
+using std::cout;
+using std::string;
+
+void testLookups();
+void testMatchesInit();
+void testToolNames();
+
+int main(int argc, char *argv[])
+{
+	testLookups();
+	testMatchesInit();
+	testToolNames();
+
+	//Made it through the gauntlet
+	return 0;
+}
+
+void testLookups() {
+	const std::vector<HPWH::PresetInfo> &presets = HPWH::getPresets();
+	ASSERTTRUE(presets.size() > 60);
+	std::set<string> names;
+	for (const HPWH::PresetInfo &preset : presets) {
+		ASSERTTRUE(names.insert(preset.name).second);
+		ASSERTTRUE(HPWH::findPreset(preset.model) == &preset);
+		ASSERTTRUE(HPWH::findPreset(string(preset.name)) == &preset);
+		ASSERTTRUE(string(preset.description).size() > 0);
+	}
+	ASSERTTRUE(HPWH::findPreset("noSuchModel") == NULL);
+	ASSERTTRUE(HPWH::findPreset(HPWH::MODELS_CustomFile) == NULL);
+	ASSERTTRUE(HPWH::findPreset(HPWH::MODELS_ColmacCxA_20_MP) == NULL);
+}
+
+// every registered model initializes, and the declared models that are not registered do not
+void testMatchesInit() {
+	for (const HPWH::PresetInfo &preset : HPWH::getPresets()) {
+		HPWH hpwh;
+		ASSERTTRUE(hpwh.HPWHinit_presets(preset.model) == 0);
+		ASSERTTRUE(hpwh.getHPWHModel() == preset.model);
+	}
+	const HPWH::MODELS unregistered[] = {
+		HPWH::MODELS_genericCustomUEF, HPWH::MODELS_CustomFile, HPWH::MODELS_CustomResTank,
+		HPWH::MODELS_CustomResTankSwing, HPWH::MODELS_ColmacCxV_5_MP, HPWH::MODELS_ColmacCxA_10_MP,
+		HPWH::MODELS_ColmacCxA_15_MP, HPWH::MODELS_ColmacCxA_20_MP, HPWH::MODELS_ColmacCxA_25_MP,
+		HPWH::MODELS_ColmacCxA_30_MP, HPWH::MODELS_NyleC25A_MP, HPWH::MODELS_NyleC60A_MP,
+		HPWH::MODELS_NyleC90A_MP, HPWH::MODELS_NyleC125A_MP, HPWH::MODELS_NyleC185A_MP,
+		HPWH::MODELS_NyleC250A_MP };
+	for (HPWH::MODELS model : unregistered) {
+		HPWH hpwh;
+		ASSERTTRUE(HPWH::findPreset(model) == NULL);
+		ASSERTTRUE(hpwh.HPWHinit_presets(model) == HPWH::HPWH_ABORT);
+	}
+}
+
+// every name the test tools have used still finds the same model
+void testToolNames() {
+	const struct {
+		const char *name;
+		HPWH::MODELS model;
+	} toolNames[] = {
+		{ "Voltex60", HPWH::MODELS_AOSmithPHPT60 }, { "AOSmithPHPT60", HPWH::MODELS_AOSmithPHPT60 },
+		{ "Voltex80", HPWH::MODELS_AOSmithPHPT80 }, { "AOSmith80", HPWH::MODELS_AOSmithPHPT80 },
+		{ "GEred", HPWH::MODELS_GE2012 }, { "GE", HPWH::MODELS_GE2012 },
+		{ "SandenGAU", HPWH::MODELS_Sanden80 }, { "Sanden80", HPWH::MODELS_Sanden80 },
+		{ "SandenGen3", HPWH::MODELS_Sanden80 }, { "Sanden120", HPWH::MODELS_Sanden120 },
+		{ "SandenGES", HPWH::MODELS_Sanden40 }, { "Sanden40", HPWH::MODELS_Sanden40 },
+		{ "AOSmithHPTU50", HPWH::MODELS_AOSmithHPTU50 }, { "AOSmithHPTU66", HPWH::MODELS_AOSmithHPTU66 },
+		{ "AOSmithHPTU80", HPWH::MODELS_AOSmithHPTU80 }, { "AOSmithHPTU80DR", HPWH::MODELS_AOSmithHPTU80_DR },
+		{ "GE502014STDMode", HPWH::MODELS_GE2014STDMode }, { "GE2014STDMode", HPWH::MODELS_GE2014STDMode },
+		{ "GE502014", HPWH::MODELS_GE2014 }, { "GE2014", HPWH::MODELS_GE2014 },
+		{ "GE802014", HPWH::MODELS_GE2014_80DR }, { "RheemHB50", HPWH::MODELS_RheemHB50 },
+		{ "Stiebel220e", HPWH::MODELS_Stiebel220E }, { "Stiebel220E", HPWH::MODELS_Stiebel220E },
+		{ "Generic1", HPWH::MODELS_Generic1 }, { "Generic2", HPWH::MODELS_Generic2 },
+		{ "Generic3", HPWH::MODELS_Generic3 }, { "custom", HPWH::MODELS_CustomFile },
+		{ "restankRealistic", HPWH::MODELS_restankRealistic }, { "StorageTank", HPWH::MODELS_StorageTank },
+		{ "BWC2020_65", HPWH::MODELS_BWC2020_65 },
+		{ "Rheem2020Prem40", HPWH::MODELS_Rheem2020Prem40 }, { "Rheem2020Prem50", HPWH::MODELS_Rheem2020Prem50 },
+		{ "Rheem2020Prem65", HPWH::MODELS_Rheem2020Prem65 }, { "Rheem2020Prem80", HPWH::MODELS_Rheem2020Prem80 },
+		{ "Rheem2020Build40", HPWH::MODELS_Rheem2020Build40 }, { "Rheem2020Build50", HPWH::MODELS_Rheem2020Build50 },
+		{ "Rheem2020Build65", HPWH::MODELS_Rheem2020Build65 }, { "Rheem2020Build80", HPWH::MODELS_Rheem2020Build80 },
+		{ "AOSmithCAHP120", HPWH::MODELS_AOSmithCAHP120 }, { "ColmacCxV_5_SP", HPWH::MODELS_ColmacCxV_5_SP },
+		{ "ColmacCxA_10_SP", HPWH::MODELS_ColmacCxA_10_SP }, { "ColmacCxA_15_SP", HPWH::MODELS_ColmacCxA_15_SP },
+		{ "ColmacCxA_20_SP", HPWH::MODELS_ColmacCxA_20_SP }, { "ColmacCxA_25_SP", HPWH::MODELS_ColmacCxA_25_SP },
+		{ "ColmacCxA_30_SP", HPWH::MODELS_ColmacCxA_30_SP }, { "NyleC25A_SP", HPWH::MODELS_NyleC25A_SP },
+		{ "NyleC90A_SP", HPWH::MODELS_NyleC90A_SP }, { "NyleC185A_SP", HPWH::MODELS_NyleC185A_SP },
+		{ "NyleC250A_SP", HPWH::MODELS_NyleC250A_SP }, { "NyleC90A_C_SP", HPWH::MODELS_NyleC90A_C_SP },
+		{ "NyleC185A_C_SP", HPWH::MODELS_NyleC185A_C_SP }, { "NyleC250A_C_SP", HPWH::MODELS_NyleC250A_C_SP },
+		{ "TamScalable_SP", HPWH::MODELS_TamScalable_SP }, { "TamScalable_SP_2X", HPWH::MODELS_TamScalable_SP },
+		{ "TamScalable_SP_Half", HPWH::MODELS_TamScalable_SP },
+		{ "AWHSTier3Generic40", HPWH::MODELS_AWHSTier3Generic40 }, { "AWHSTier3Generic50", HPWH::MODELS_AWHSTier3Generic50 },
+		{ "AWHSTier3Generic65", HPWH::MODELS_AWHSTier3Generic65 }, { "AWHSTier3Generic80", HPWH::MODELS_AWHSTier3Generic80 },
+	};
+	for (auto &toolName : toolNames) {
+		ASSERTTRUE(mapStringToPreset(toolName.name) == toolName.model);
+	}
+}
@@ -0,0 +1,134 @@
+/*unit test for the prototype cache behind HPWHinit_presetsCached and HPWHinit_fileCached
+ *
+ *
+ *
+ */
+#include "HPWH.hh"
+#include "testUtilityFcts.cc"
+
+#include <iostream>
+#include <string>
+#include <thread>
+
+
+using std::cout;
+using std::string;
+
+std::vector<schedule> allSchedules;
+long minutesToRun;
+
+void testCachedPreset(string modelName);
+void testCachedFile();
+void testKeepsVerbosity();
+void testFailureNotCached();
+void testThreads();
+
+int main(int argc, char *argv[])
+{
+	double newSetpoint;
+	ASSERTTRUE(readTestSchedules("testDOE_24hr50", allSchedules, minutesToRun, newSetpoint) == 0);
+
+	testCachedPreset("AOSmithHPTU80");   // backups
+	testCachedPreset("Stiebel220E");     // a companion
+	testCachedPreset("Sanden80");        // standby logic
+	testCachedPreset("ColmacCxA_20_SP");
+	testCachedFile();
+	testKeepsVerbosity();
+	testFailureNotCached();
+	testThreads();
+
+	//Made it through the gauntlet
+	return 0;
+}
+
+// runs both for a day and checks every output matches
+void checkSameRun(HPWH &a, HPWH &b) {
+	ASSERTTRUE(a.getHPWHModel() == b.getHPWHModel());
+	ASSERTTRUE(a.getNumNodes() == b.getNumNodes());
+	ASSERTTRUE(a.getNumHeatSources() == b.getNumHeatSources());
+	for (long i = 0; i < 1440; i++) {
+		ASSERTTRUE(a.runOneStep(allSchedules[0][i], GAL_TO_L(allSchedules[1][i]), allSchedules[2][i], allSchedules[3][i],
+			static_cast<HPWH::DRMODES>(int(allSchedules[4][i]))) == 0);
+		ASSERTTRUE(b.runOneStep(allSchedules[0][i], GAL_TO_L(allSchedules[1][i]), allSchedules[2][i], allSchedules[3][i],
+			static_cast<HPWH::DRMODES>(int(allSchedules[4][i]))) == 0);
+		for (int s = 0; s < a.getNumHeatSources(); s++) {
+			ASSERTTRUE(a.getNthHeatSourceEnergyInput(s) == b.getNthHeatSourceEnergyInput(s));
+			ASSERTTRUE(a.getNthHeatSourceRunTime(s) == b.getNthHeatSourceRunTime(s));
+		}
+		ASSERTTRUE(a.getOutletTemp() == b.getOutletTemp());
+	}
+	for (int n = 0; n < a.getNumNodes(); n++) {
+		ASSERTTRUE(a.getTankNodeTemp(n) == b.getTankNodeTemp(n));
+	}
+}
+
+void testCachedPreset(string modelName) {
+	HPWH::MODELS preset = mapStringToPreset(modelName);
+	HPWH reference, first, second;
+	ASSERTTRUE(first.HPWHinit_presetsCached(preset) == 0);   // may fill the cache
+	ASSERTTRUE(second.HPWHinit_presetsCached(preset) == 0);  // copies the prototype
+	ASSERTTRUE(reference.HPWHinit_presets(preset) == 0);
+	checkSameRun(reference, first);
+	ASSERTTRUE(reference.HPWHinit_presets(preset) == 0);
+	checkSameRun(reference, second);
+
+	// a cached init re-initializes a HPWH that has already run
+	ASSERTTRUE(first.HPWHinit_presetsCached(preset) == 0);
+	ASSERTTRUE(reference.HPWHinit_presets(preset) == 0);
+	checkSameRun(reference, first);
+}
+
+void testCachedFile() {
+	HPWH reference, cached;
+	ASSERTTRUE(reference.HPWHinit_file("AOSmithHPTU80.txt") == 0);
+	ASSERTTRUE(cached.HPWHinit_fileCached("AOSmithHPTU80.txt") == 0);
+	ASSERTTRUE(cached.HPWHinit_fileCached("AOSmithHPTU80.txt") == 0);
+	checkSameRun(reference, cached);
+}
+
+int nMessages = 0;
+void countMessages(const std::string message, void* contextPtr) {
+	(*static_cast<int *>(contextPtr))++;
+}
+
+void testKeepsVerbosity() {
+	HPWH hpwh;
+	hpwh.setMessageCallback(countMessages, &nMessages);
+	hpwh.setVerbosity(HPWH::VRB_reluctant);
+	ASSERTTRUE(hpwh.HPWHinit_presetsCached(HPWH::MODELS_Sanden80) == 0);
+	ASSERTTRUE(hpwh.HPWHinit_presetsCached(HPWH::MODELS_Sanden80) == 0);
+	// the Sanden's setpoint is fixed, so this complains through the kept callback
+	ASSERTTRUE(hpwh.setSetpoint(40.) == HPWH::HPWH_ABORT);
+	ASSERTTRUE(nMessages > 0);
+}
+
+void testFailureNotCached() {
+	HPWH hpwh;
+	ASSERTTRUE(hpwh.HPWHinit_presetsCached(static_cast<HPWH::MODELS>(-1)) == HPWH::HPWH_ABORT);
+	ASSERTTRUE(hpwh.HPWHinit_presetsCached(static_cast<HPWH::MODELS>(-1)) == HPWH::HPWH_ABORT);
+	ASSERTTRUE(hpwh.HPWHinit_fileCached("noSuchFile.txt") == HPWH::HPWH_ABORT);
+	ASSERTTRUE(hpwh.HPWHinit_fileCached("noSuchFile.txt") == HPWH::HPWH_ABORT);
+}
+
+void testThreads() {
+	HPWH::clearPrototypeCache();
+	const int nThreads = 8;
+	std::vector<HPWH> tanks(nThreads);
+	std::vector<int> results(nThreads, -1);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < nThreads; t++) {
+		threads.push_back(std::thread([&tanks, &results, t]() {
+			results[t] = tanks[t].HPWHinit_presetsCached(HPWH::MODELS_AOSmithHPTU80);
+		}));
+	}
+	for (auto &thread : threads) {
+		thread.join();
+	}
+	HPWH reference;
+	ASSERTTRUE(reference.HPWHinit_presets(HPWH::MODELS_AOSmithHPTU80) == 0);
+	for (int t = 0; t < nThreads; t++) {
+		ASSERTTRUE(results[t] == 0);
+		HPWH check(reference);
+		checkSameRun(check, tanks[t]);
+	}
+}
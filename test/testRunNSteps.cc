@@ -0,0 +1,241 @@
+/*unit test for runNSteps: the StepInputs form must run exactly as the same runOneStep calls,
+ * with the second inlet, extra node power and setpoint changes, write each step's results,
+ * and leave the same sums as the original runNSteps
+ *
+ *
+ */
+#include "HPWH.hh"
+#include "testUtilityFcts.cc"
+
+#include <cmath>
+#include <iostream>
+#include <string>
+
+
+using std::cout;
+using std::string;
+
+std::vector<schedule> allSchedules;
+long minutesToRun;
+
+void testMatchesRunOneStep(string modelName);
+void testExtraNodePower();
+void testOriginalForm(string modelName);
+void testNoDraw();
+void testBadInputs();
+
+int main(int argc, char *argv[])
+{
+	double newSetpoint;
+	ASSERTTRUE(readTestSchedules("testDOE_24hr50", allSchedules, minutesToRun, newSetpoint) == 0);
+
+	testMatchesRunOneStep("AOSmithHPTU80");
+	testMatchesRunOneStep("Sanden80");
+	testMatchesRunOneStep("ColmacCxA_20_SP");
+	testExtraNodePower();
+	testOriginalForm("AOSmithHPTU80");
+	testOriginalForm("Stiebel220E");
+	testNoDraw();
+	testBadInputs();
+
+	//Made it through the gauntlet
+	return 0;
+}
+
+// the schedules as the arrays runNSteps takes
+struct Schedules {
+	std::vector<double> inletT_C, drawVolume_L, tankAmbientT_C, heatSourceAmbientT_C, inletVol2_L, inletT2_C, setpoint_C;
+	std::vector<HPWH::DRMODES> DRstatus;
+	Schedules(const HPWH &hpwh) {
+		double baseSetpoint_C = hpwh.getSetpoint();
+		double setback_dC = hpwh.isSetpointFixed() ? 0. : 5.;
+		for (long i = 0; i < minutesToRun; i++) {
+			inletT_C.push_back(allSchedules[0][i]);
+			drawVolume_L.push_back(GAL_TO_L(allSchedules[1][i]));
+			tankAmbientT_C.push_back(allSchedules[2][i]);
+			heatSourceAmbientT_C.push_back(allSchedules[3][i]);
+			DRstatus.push_back(static_cast<HPWH::DRMODES>(int(allSchedules[4][i])));
+			// a second inlet for half of some draws and an afternoon setback
+			inletVol2_L.push_back((i % 7 == 0) ? drawVolume_L.back() / 2. : 0.);
+			inletT2_C.push_back(45.);
+			setpoint_C.push_back((i >= 720 && i < 900) ? baseSetpoint_C - setback_dC : baseSetpoint_C);
+		}
+	}
+	HPWH::StepInputs inputs() {
+		HPWH::StepInputs in;
+		in.inletT_C = inletT_C.data();
+		in.drawVolume_L = drawVolume_L.data();
+		in.tankAmbientT_C = tankAmbientT_C.data();
+		in.heatSourceAmbientT_C = heatSourceAmbientT_C.data();
+		in.DRstatus = DRstatus.data();
+		in.inletVol2_L = inletVol2_L.data();
+		in.inletT2_C = inletT2_C.data();
+		in.setpoint_C = setpoint_C.data();
+		return in;
+	}
+};
+
+// per step results, sized for hpwh
+struct Results {
+	std::vector<double> outletTemp_C, standbyLosses_kWh, energyRemovedFromEnvironment_kWh, tankHeatContent_kJ,
+		energyInput_kWh, energyOutput_kWh, runTime_min, simTcouples_C;
+	Results(const HPWH &hpwh, long steps) : outletTemp_C(steps), standbyLosses_kWh(steps),
+		energyRemovedFromEnvironment_kWh(steps), tankHeatContent_kJ(steps), energyInput_kWh(steps * hpwh.getNumHeatSources()),
+		energyOutput_kWh(steps * hpwh.getNumHeatSources()), runTime_min(steps * hpwh.getNumHeatSources()),
+		simTcouples_C(steps * HPWH::STEP_TCOUPLES) {}
+	HPWH::StepOutputArrays arrays() {
+		HPWH::StepOutputArrays out;
+		out.outletTemp_C = outletTemp_C.data();
+		out.standbyLosses_kWh = standbyLosses_kWh.data();
+		out.energyRemovedFromEnvironment_kWh = energyRemovedFromEnvironment_kWh.data();
+		out.tankHeatContent_kJ = tankHeatContent_kJ.data();
+		out.heatSourceEnergyInput_kWh = energyInput_kWh.data();
+		out.heatSourceEnergyOutput_kWh = energyOutput_kWh.data();
+		out.heatSourceRunTime_min = runTime_min.data();
+		out.simTcouples_C = simTcouples_C.data();
+		return out;
+	}
+	// step i against what the getters of hpwh say now
+	void check(HPWH &hpwh, long i) {
+		int n = hpwh.getNumHeatSources();
+		ASSERTTRUE(outletTemp_C[i] == hpwh.getOutletTemp());
+		ASSERTTRUE(standbyLosses_kWh[i] == hpwh.getStandbyLosses());
+		ASSERTTRUE(energyRemovedFromEnvironment_kWh[i] == hpwh.getEnergyRemovedFromEnvironment());
+		ASSERTTRUE(tankHeatContent_kJ[i] == hpwh.getTankHeatContent_kJ());
+		for (int s = 0; s < n; s++) {
+			ASSERTTRUE(energyInput_kWh[i * n + s] == hpwh.getNthHeatSourceEnergyInput(s));
+			ASSERTTRUE(energyOutput_kWh[i * n + s] == hpwh.getNthHeatSourceEnergyOutput(s));
+			ASSERTTRUE(runTime_min[i * n + s] == hpwh.getNthHeatSourceRunTime(s));
+		}
+		for (int t = 0; t < HPWH::STEP_TCOUPLES; t++) {
+			ASSERTTRUE(simTcouples_C[i * HPWH::STEP_TCOUPLES + t] == hpwh.getNthSimTcouple(t + 1, HPWH::STEP_TCOUPLES));
+		}
+	}
+};
+
+void checkSameTank(HPWH &a, HPWH &b) {
+	ASSERTTRUE(a.getSetpoint() == b.getSetpoint());
+	for (int n = 0; n < a.getNumNodes(); n++) {
+		ASSERTTRUE(a.getTankNodeTemp(n) == b.getTankNodeTemp(n));
+	}
+}
+
+void testMatchesRunOneStep(string modelName) {
+	HPWH hpwh, reference;
+	ASSERTTRUE(getHPWHObject(hpwh, modelName) == 0);
+	ASSERTTRUE(getHPWHObject(reference, modelName) == 0);
+	Schedules schedules(hpwh);
+	Results results(hpwh, minutesToRun);
+	HPWH::StepOutputArrays arrays = results.arrays();
+	ASSERTTRUE(hpwh.runNSteps(minutesToRun, schedules.inputs(), &arrays) == 0);
+
+	double energyInput_kWh = 0., drawVolume_L = 0., outletTV = 0.;
+	for (long i = 0; i < minutesToRun; i++) {
+		if (schedules.setpoint_C[i] != reference.getSetpoint()) {
+			ASSERTTRUE(reference.setSetpoint(schedules.setpoint_C[i]) == 0);
+		}
+		ASSERTTRUE(reference.runOneStep(schedules.inletT_C[i], schedules.drawVolume_L[i], schedules.tankAmbientT_C[i],
+			schedules.heatSourceAmbientT_C[i], schedules.DRstatus[i], schedules.inletVol2_L[i], schedules.inletT2_C[i]) == 0);
+		results.check(reference, i);
+		energyInput_kWh += reference.getNthHeatSourceEnergyInput(0);
+		outletTV += reference.getOutletTemp() * schedules.drawVolume_L[i];
+		drawVolume_L += schedules.drawVolume_L[i];
+	}
+	checkSameTank(hpwh, reference);
+
+	// the sums left behind
+	ASSERTTRUE(hpwh.getNthHeatSourceEnergyInput(0) == energyInput_kWh);
+	ASSERTTRUE(hpwh.getOutletTemp() == outletTV / drawVolume_L);
+}
+
+void testExtraNodePower() {
+	HPWH hpwh, reference;
+	ASSERTTRUE(getHPWHObject(hpwh, "StorageTank") == 0);
+	ASSERTTRUE(getHPWHObject(reference, "StorageTank") == 0);
+	Schedules schedules(hpwh);
+	schedules.setpoint_C.assign(minutesToRun, hpwh.getSetpoint());
+	// a solar loop heating the bottom third in the middle of the day
+	std::vector<std::vector<double> > nodePowerExtra_W(minutesToRun);
+	for (long i = 600; i < 960; i++) {
+		nodePowerExtra_W[i] = { 1000., 1000., 1000., 1000. };
+	}
+	HPWH::StepInputs inputs = schedules.inputs();
+	inputs.nodePowerExtra_W = nodePowerExtra_W.data();
+	Results results(hpwh, minutesToRun);
+	HPWH::StepOutputArrays arrays = results.arrays();
+	ASSERTTRUE(hpwh.runNSteps(minutesToRun, inputs, &arrays) == 0);
+
+	for (long i = 0; i < minutesToRun; i++) {
+		ASSERTTRUE(reference.runOneStep(schedules.inletT_C[i], schedules.drawVolume_L[i], schedules.tankAmbientT_C[i],
+			schedules.heatSourceAmbientT_C[i], schedules.DRstatus[i], schedules.inletVol2_L[i], schedules.inletT2_C[i],
+			&nodePowerExtra_W[i]) == 0);
+		results.check(reference, i);
+	}
+	checkSameTank(hpwh, reference);
+
+	// and the power did something
+	HPWH unheated;
+	ASSERTTRUE(getHPWHObject(unheated, "StorageTank") == 0);
+	inputs.nodePowerExtra_W = NULL;
+	ASSERTTRUE(unheated.runNSteps(minutesToRun, inputs) == 0);
+	ASSERTTRUE(unheated.getTankHeatContent_kJ() < hpwh.getTankHeatContent_kJ());
+}
+
+void testOriginalForm(string modelName) {
+	HPWH hpwh, reference;
+	ASSERTTRUE(getHPWHObject(hpwh, modelName) == 0);
+	ASSERTTRUE(getHPWHObject(reference, modelName) == 0);
+	Schedules schedules(hpwh);
+	ASSERTTRUE(hpwh.runNSteps(minutesToRun, schedules.inletT_C.data(), schedules.drawVolume_L.data(),
+		schedules.tankAmbientT_C.data(), schedules.heatSourceAmbientT_C.data(), schedules.DRstatus.data()) == 0);
+
+	std::vector<double> energyInput_kWh(reference.getNumHeatSources()), runTime_min(reference.getNumHeatSources());
+	double standbyLosses_kWh = 0.;
+	for (long i = 0; i < minutesToRun; i++) {
+		ASSERTTRUE(reference.runOneStep(schedules.inletT_C[i], schedules.drawVolume_L[i], schedules.tankAmbientT_C[i],
+			schedules.heatSourceAmbientT_C[i], schedules.DRstatus[i]) == 0);
+		for (int s = 0; s < reference.getNumHeatSources(); s++) {
+			energyInput_kWh[s] += reference.getNthHeatSourceEnergyInput(s);
+			runTime_min[s] += reference.getNthHeatSourceRunTime(s);
+		}
+		standbyLosses_kWh += reference.getStandbyLosses();
+	}
+	checkSameTank(hpwh, reference);
+	for (int s = 0; s < reference.getNumHeatSources(); s++) {
+		ASSERTTRUE(hpwh.getNthHeatSourceEnergyInput(s) == energyInput_kWh[s]);
+		ASSERTTRUE(hpwh.getNthHeatSourceRunTime(s) == runTime_min[s]);
+	}
+	ASSERTTRUE(hpwh.getStandbyLosses() == standbyLosses_kWh);
+}
+
+void testNoDraw() {
+	// an hour without a draw leaves an outlet temperature of 0, as runOneStep does, not NaN
+	HPWH hpwh;
+	ASSERTTRUE(getHPWHObject(hpwh, "AOSmithHPTU80") == 0);
+	std::vector<double> inletT_C(60, 10.), drawVolume_L(60, 0.), ambientT_C(60, 20.);
+	std::vector<HPWH::DRMODES> DRstatus(60, HPWH::DR_ALLOW);
+	ASSERTTRUE(hpwh.runNSteps(60, inletT_C.data(), drawVolume_L.data(), ambientT_C.data(), ambientT_C.data(),
+		DRstatus.data()) == 0);
+	ASSERTTRUE(hpwh.getOutletTemp() == 0.);
+}
+
+void testBadInputs() {
+	HPWH hpwh;
+	ASSERTTRUE(getHPWHObject(hpwh, "AOSmithHPTU80") == 0);
+	double topTemp_C = hpwh.getTankNodeTemp(hpwh.getNumNodes() - 1);
+	Schedules schedules(hpwh);
+
+	HPWH::StepInputs inputs = schedules.inputs();
+	inputs.drawVolume_L = NULL;
+	ASSERTTRUE(hpwh.runNSteps(minutesToRun, inputs) == HPWH::HPWH_ABORT);
+
+	inputs = schedules.inputs();
+	inputs.inletT2_C = NULL;
+	ASSERTTRUE(hpwh.runNSteps(minutesToRun, inputs) == HPWH::HPWH_ABORT);
+
+	// a setpoint the model cannot reach, late in the run, stops it before the first step
+	inputs = schedules.inputs();
+	schedules.setpoint_C[minutesToRun - 1] = 200.;
+	ASSERTTRUE(hpwh.runNSteps(minutesToRun, inputs) == HPWH::HPWH_ABORT);
+	ASSERTTRUE(hpwh.getTankNodeTemp(hpwh.getNumNodes() - 1) == topTemp_C);
+}
@@ -0,0 +1,135 @@
+/*unit test for binary state snapshots with saveState and loadState
+ *
+ *
+ *
+ */
+#include "HPWH.hh"
+#include "testUtilityFcts.cc"
+
+#include <iostream>
+#include <string>
+
+
+using std::cout;
+using std::string;
+
+std::vector<schedule> allSchedules;
+long minutesToRun;
+
+void testContinuation(string modelName);
+void testOutputsRestored();
+void testDamagedSnapshots();
+void testOtherModel();
+
+int main(int argc, char *argv[])
+{
+	double newSetpoint;
+	ASSERTTRUE(readTestSchedules("testDOE_24hr50", allSchedules, minutesToRun, newSetpoint) == 0);
+
+	testContinuation("AOSmithHPTU80");
+	testContinuation("Sanden80");
+	testContinuation("Stiebel220E");
+	testContinuation("ColmacCxA_20_SP");
+	testOutputsRestored();
+	testDamagedSnapshots();
+	testOtherModel();
+
+	//Made it through the gauntlet
+	return 0;
+}
+
+int runStep(HPWH &hpwh, long i) {
+	long j = i % minutesToRun;
+	return hpwh.runOneStep(allSchedules[0][j], GAL_TO_L(allSchedules[1][j]), allSchedules[2][j], allSchedules[3][j],
+		static_cast<HPWH::DRMODES>(int(allSchedules[4][j])));
+}
+
+void testContinuation(string modelName) {
+	HPWH hpwh;
+	getHPWHObject(hpwh, modelName);
+	hpwh.setDoTempDepression(true);
+	for (long i = 0; i < 700; i++) {
+		ASSERTTRUE(runStep(hpwh, i) == 0);
+	}
+	std::vector<unsigned char> snapshot;
+	ASSERTTRUE(hpwh.saveState(snapshot) == 0);
+
+	// restored onto a freshly initialized tank, the run goes on bit for bit
+	HPWH restored;
+	getHPWHObject(restored, modelName);
+	restored.setDoTempDepression(true);
+	ASSERTTRUE(restored.loadState(snapshot) == 0);
+	for (long i = 700; i < 700 + 1440; i++) {
+		ASSERTTRUE(runStep(hpwh, i) == 0);
+		ASSERTTRUE(runStep(restored, i) == 0);
+		for (int s = 0; s < hpwh.getNumHeatSources(); s++) {
+			ASSERTTRUE(hpwh.getNthHeatSourceEnergyInput(s) == restored.getNthHeatSourceEnergyInput(s));
+		}
+		ASSERTTRUE(hpwh.getOutletTemp() == restored.getOutletTemp());
+		ASSERTTRUE(hpwh.getLocationTemp_C() == restored.getLocationTemp_C());
+	}
+	for (int n = 0; n < hpwh.getNumNodes(); n++) {
+		ASSERTTRUE(hpwh.getTankNodeTemp(n) == restored.getTankNodeTemp(n));
+	}
+
+	// and the snapshot is compact: a header, the node temperatures and a few outputs
+	ASSERTTRUE(snapshot.size() < 8 * (size_t)(hpwh.getNumNodes() + 3 * hpwh.getNumHeatSources()) + 100);
+}
+
+void testOutputsRestored() {
+	HPWH hpwh, restored;
+	getHPWHObject(hpwh, "AOSmithHPTU80");
+	getHPWHObject(restored, "AOSmithHPTU80");
+	ASSERTTRUE(hpwh.runOneStep(10., 100., 20., 20., HPWH::DR_ALLOW) == 0);
+
+	std::vector<unsigned char> snapshot;
+	hpwh.saveState(snapshot);
+	ASSERTTRUE(restored.loadState(snapshot) == 0);
+	ASSERTTRUE(restored.getOutletTemp() == hpwh.getOutletTemp());
+	ASSERTTRUE(restored.getStandbyLosses() == hpwh.getStandbyLosses());
+	ASSERTTRUE(restored.getEnergyRemovedFromEnvironment() == hpwh.getEnergyRemovedFromEnvironment());
+	for (int s = 0; s < hpwh.getNumHeatSources(); s++) {
+		ASSERTTRUE(restored.getNthHeatSourceEnergyInput(s) == hpwh.getNthHeatSourceEnergyInput(s));
+		ASSERTTRUE(restored.getNthHeatSourceEnergyOutput(s) == hpwh.getNthHeatSourceEnergyOutput(s));
+		ASSERTTRUE(restored.getNthHeatSourceRunTime(s) == hpwh.getNthHeatSourceRunTime(s));
+		ASSERTTRUE(restored.isNthHeatSourceRunning(s) == hpwh.isNthHeatSourceRunning(s));
+	}
+}
+
+void testDamagedSnapshots() {
+	HPWH hpwh, target;
+	getHPWHObject(hpwh, "AOSmithHPTU80");
+	getHPWHObject(target, "AOSmithHPTU80");
+	ASSERTTRUE(hpwh.runOneStep(10., 100., 20., 20., HPWH::DR_ALLOW) == 0);
+	std::vector<unsigned char> snapshot;
+	hpwh.saveState(snapshot);
+	double bottomT_C = target.getTankNodeTemp(0);
+
+	// every single flipped bit is caught, and the target is left alone
+	for (size_t i = 0; i < snapshot.size(); i++) {
+		std::vector<unsigned char> damaged = snapshot;
+		damaged[i] ^= 0x10;
+		ASSERTTRUE(target.loadState(damaged) == HPWH::HPWH_ABORT);
+	}
+	ASSERTTRUE(target.getTankNodeTemp(0) == bottomT_C);
+
+	std::vector<unsigned char> truncated(snapshot.begin(), snapshot.end() - 9);
+	ASSERTTRUE(target.loadState(truncated) == HPWH::HPWH_ABORT);
+	ASSERTTRUE(target.loadState(NULL, 0) == HPWH::HPWH_ABORT);
+	std::vector<unsigned char> empty;
+	ASSERTTRUE(target.loadState(empty) == HPWH::HPWH_ABORT);
+	ASSERTTRUE(target.getTankNodeTemp(0) == bottomT_C);
+}
+
+void testOtherModel() {
+	HPWH ge, rheem, sanden;
+	getHPWHObject(ge, "GE502014");
+	getHPWHObject(rheem, "Rheem2020Prem50");   // the same number of nodes and heat sources
+	getHPWHObject(sanden, "Sanden80");
+	ASSERTTRUE(ge.getNumNodes() == rheem.getNumNodes());
+	ASSERTTRUE(ge.getNumHeatSources() == rheem.getNumHeatSources());
+	std::vector<unsigned char> snapshot;
+	ge.saveState(snapshot);
+	ASSERTTRUE(rheem.loadState(snapshot) == HPWH::HPWH_ABORT);
+	ASSERTTRUE(sanden.loadState(snapshot) == HPWH::HPWH_ABORT);
+}
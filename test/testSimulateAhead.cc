@@ -0,0 +1,178 @@
+/*unit test for speculative rollouts with simulateAhead
+ *
+ *
+ *
+ */
+#include "HPWH.hh"
+#include "testUtilityFcts.cc"
+
+#include <iostream>
+#include <string>
+
+
+using std::cout;
+using std::string;
+
+void testLiveTankUnchanged();
+void testMatchesCopy();
+void testThreadsAgree();
+void testLockOutUsesNoEnergy();
+void testSetpointTrajectory();
+void testBadInputs();
+
+int main(int argc, char *argv[])
+{
+	testLiveTankUnchanged();
+	testMatchesCopy();
+	testThreadsAgree();
+	testLockOutUsesNoEnergy();
+	testSetpointTrajectory();
+	testBadInputs();
+
+	//Made it through the gauntlet
+	return 0;
+}
+
+const int horizon = 180;
+
+// three hours with a shower at the start and a tap draw later
+HPWH::AheadInputs makeInputs() {
+	HPWH::AheadInputs inputs;
+	for (int i = 0; i < horizon; i++) {
+		inputs.inletT_C.push_back(12.);
+		inputs.drawVolume_L.push_back((i < 10) ? 8. : (i >= 120 && i < 125) ? 3. : 0.);
+		inputs.tankAmbientT_C.push_back(20.);
+		inputs.heatSourceAmbientT_C.push_back(15.);
+	}
+	return inputs;
+}
+
+// a warmed up tank with a backup element
+void makeTank(HPWH &hpwh) {
+	getHPWHObject(hpwh, "AOSmithHPTU80");
+	for (int i = 0; i < 90; i++) {
+		hpwh.runOneStep(12., (i < 20) ? 6. : 0., 20., 15., HPWH::DR_ALLOW);
+	}
+}
+
+std::vector<HPWH::AheadCandidate> makeCandidates() {
+	std::vector<HPWH::AheadCandidate> candidates(5);
+	candidates[1].DRstatus.assign(horizon, static_cast<HPWH::DRMODES>(HPWH::DR_LOC | HPWH::DR_LOR));
+	candidates[2].DRstatus.assign(horizon, HPWH::DR_ALLOW);
+	candidates[2].DRstatus[0] = HPWH::DR_TOO;
+	candidates[3].DRstatus.assign(horizon, HPWH::DR_LOR);
+	candidates[4].DRstatus.assign(horizon, HPWH::DR_ALLOW);
+	for (int i = 60; i < horizon; i++) {
+		candidates[4].DRstatus[i] = HPWH::DR_LOC;
+	}
+	return candidates;
+}
+
+void testLiveTankUnchanged() {
+	HPWH hpwh;
+	makeTank(hpwh);
+	std::vector<unsigned char> before, after;
+	hpwh.saveState(before);
+
+	std::vector<HPWH::AheadOutputs> outputs;
+	ASSERTTRUE(hpwh.simulateAhead(horizon, makeInputs(), makeCandidates(), outputs) == 0);
+	ASSERTTRUE(outputs.size() == 5);
+	hpwh.saveState(after);
+	ASSERTTRUE(before == after);
+}
+
+void testMatchesCopy() {
+	HPWH hpwh;
+	makeTank(hpwh);
+	HPWH::AheadInputs inputs = makeInputs();
+	std::vector<HPWH::AheadCandidate> candidates = makeCandidates();
+	std::vector<HPWH::AheadOutputs> outputs;
+	ASSERTTRUE(hpwh.simulateAhead(horizon, inputs, candidates, outputs) == 0);
+
+	for (size_t c = 0; c < candidates.size(); c++) {
+		HPWH copy(hpwh);
+		double energy_kWh = 0.;
+		for (int i = 0; i < horizon; i++) {
+			HPWH::DRMODES DRstatus = candidates[c].DRstatus.empty() ? HPWH::DR_ALLOW : candidates[c].DRstatus[i];
+			ASSERTTRUE(copy.runOneStep(inputs.inletT_C[i], inputs.drawVolume_L[i], inputs.tankAmbientT_C[i],
+				inputs.heatSourceAmbientT_C[i], DRstatus) == 0);
+			double stepEnergy_kWh = 0.;
+			for (int s = 0; s < copy.getNumHeatSources(); s++) {
+				stepEnergy_kWh += copy.getNthHeatSourceEnergyInput(s);
+			}
+			ASSERTTRUE(stepEnergy_kWh == outputs[c].stepEnergyInput_kWh[i]);
+			energy_kWh += stepEnergy_kWh;
+		}
+		ASSERTTRUE(energy_kWh == outputs[c].energyInput_kWh);
+		ASSERTTRUE(copy.getTankHeatContent_kJ() == outputs[c].finalTankHeatContent_kJ);
+	}
+	// locking out all heating saves energy now and leave a colder tank
+	ASSERTTRUE(outputs[1].energyInput_kWh < outputs[0].energyInput_kWh);
+	ASSERTTRUE(outputs[1].finalTankHeatContent_kJ < outputs[0].finalTankHeatContent_kJ);
+	ASSERTTRUE(outputs[0].drawVolume_L > 0.);
+	ASSERTTRUE(outputs[0].minOutletTemp_C <= outputs[0].outletTemp_C);
+}
+
+void testThreadsAgree() {
+	HPWH hpwh;
+	makeTank(hpwh);
+	std::vector<HPWH::AheadOutputs> one, four;
+	ASSERTTRUE(hpwh.simulateAhead(horizon, makeInputs(), makeCandidates(), one, 1) == 0);
+	ASSERTTRUE(hpwh.simulateAhead(horizon, makeInputs(), makeCandidates(), four, 4) == 0);
+	for (size_t c = 0; c < one.size(); c++) {
+		ASSERTTRUE(one[c].stepEnergyInput_kWh == four[c].stepEnergyInput_kWh);
+		ASSERTTRUE(one[c].stepOutletTemp_C == four[c].stepOutletTemp_C);
+		ASSERTTRUE(one[c].finalTankHeatContent_kJ == four[c].finalTankHeatContent_kJ);
+	}
+}
+
+void testLockOutUsesNoEnergy() {
+	HPWH hpwh;
+	makeTank(hpwh);
+	std::vector<HPWH::AheadCandidate> candidates(1);
+	candidates[0].DRstatus.assign(horizon, static_cast<HPWH::DRMODES>(HPWH::DR_LOC | HPWH::DR_LOR));
+	std::vector<HPWH::AheadOutputs> outputs;
+	ASSERTTRUE(hpwh.simulateAhead(horizon, makeInputs(), candidates, outputs) == 0);
+	ASSERTTRUE(outputs[0].energyInput_kWh == 0.);
+}
+
+void testSetpointTrajectory() {
+	HPWH hpwh;
+	makeTank(hpwh);
+	double setpoint_C = hpwh.getSetpoint();
+	HPWH::AheadInputs inputs = makeInputs();
+	std::vector<HPWH::AheadCandidate> candidates(1);
+	candidates[0].setpoint_C.assign(horizon, setpoint_C);
+	for (int i = 30; i < horizon; i++) {
+		candidates[0].setpoint_C[i] = setpoint_C - 10.;
+	}
+	std::vector<HPWH::AheadOutputs> outputs;
+	ASSERTTRUE(hpwh.simulateAhead(horizon, inputs, candidates, outputs) == 0);
+	ASSERTTRUE(hpwh.getSetpoint() == setpoint_C);
+
+	HPWH copy(hpwh);
+	for (int i = 0; i < horizon; i++) {
+		if (i == 30) {
+			ASSERTTRUE(copy.setSetpoint(setpoint_C - 10.) == 0);
+		}
+		copy.runOneStep(inputs.inletT_C[i], inputs.drawVolume_L[i], inputs.tankAmbientT_C[i],
+			inputs.heatSourceAmbientT_C[i], HPWH::DR_ALLOW);
+	}
+	ASSERTTRUE(copy.getTankHeatContent_kJ() == outputs[0].finalTankHeatContent_kJ);
+}
+
+void testBadInputs() {
+	HPWH hpwh;
+	makeTank(hpwh);
+	std::vector<HPWH::AheadOutputs> outputs;
+	std::vector<HPWH::AheadCandidate> candidates = makeCandidates();
+	ASSERTTRUE(hpwh.simulateAhead(0, makeInputs(), candidates, outputs) == HPWH::HPWH_ABORT);
+	ASSERTTRUE(hpwh.simulateAhead(horizon + 1, makeInputs(), candidates, outputs) == HPWH::HPWH_ABORT);
+
+	candidates[1].DRstatus.resize(horizon - 1);
+	ASSERTTRUE(hpwh.simulateAhead(horizon, makeInputs(), candidates, outputs) == HPWH::HPWH_ABORT);
+
+	candidates = makeCandidates();
+	candidates[0].setpoint_C.assign(horizon, 200.);
+	ASSERTTRUE(hpwh.simulateAhead(horizon, makeInputs(), candidates, outputs) == HPWH::HPWH_ABORT);
+}
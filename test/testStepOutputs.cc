@@ -0,0 +1,93 @@
+/*unit test for getStepOutputs: every field must be exactly what the single getters return,
+ * and the runOneStep overload that fills StepOutputs must run the same as plain runOneStep
+ *
+ *
+ */
+#include "HPWH.hh"
+#include "testUtilityFcts.cc"
+
+#include <iostream>
+#include <string>
+
+
+using std::cout;
+using std::string;
+
+std::vector<schedule> allSchedules;
+long minutesToRun;
+
+void testSameAsGetters(string modelName);
+void testRunOneStepOverload(string modelName);
+void testNotReady();
+
+int main(int argc, char *argv[])
+{
+	double newSetpoint;
+	ASSERTTRUE(readTestSchedules("testDOE_24hr50", allSchedules, minutesToRun, newSetpoint) == 0);
+
+	testSameAsGetters("AOSmithHPTU80");     // three heat sources
+	testSameAsGetters("Sanden80");          // one
+	testSameAsGetters("Stiebel220E");       // a compressor and a resistor
+	testSameAsGetters("ColmacCxA_20_SP");
+	testRunOneStepOverload("AOSmithHPTU80");
+	testRunOneStepOverload("RheemHB50");
+	testNotReady();
+
+	//Made it through the gauntlet
+	return 0;
+}
+
+int runStep(HPWH &hpwh, long i) {
+	return hpwh.runOneStep(allSchedules[0][i], GAL_TO_L(allSchedules[1][i]), allSchedules[2][i], allSchedules[3][i],
+		static_cast<HPWH::DRMODES>(int(allSchedules[4][i])));
+}
+
+void checkSameAsGetters(HPWH &hpwh, const HPWH::StepOutputs &outputs) {
+	ASSERTTRUE(outputs.numHeatSources == hpwh.getNumHeatSources());
+	for (int s = 0; s < HPWH::STEP_HEATSOURCES; s++) {
+		bool exists = s < hpwh.getNumHeatSources();
+		ASSERTTRUE(outputs.heatSourceEnergyInput_kWh[s] == (exists ? hpwh.getNthHeatSourceEnergyInput(s) : 0.));
+		ASSERTTRUE(outputs.heatSourceEnergyOutput_kWh[s] == (exists ? hpwh.getNthHeatSourceEnergyOutput(s) : 0.));
+		ASSERTTRUE(outputs.heatSourceRunTime_min[s] == (exists ? hpwh.getNthHeatSourceRunTime(s) : 0.));
+	}
+	ASSERTTRUE(outputs.outletTemp_C == hpwh.getOutletTemp());
+	ASSERTTRUE(outputs.standbyLosses_kWh == hpwh.getStandbyLosses());
+	ASSERTTRUE(outputs.energyRemovedFromEnvironment_kWh == hpwh.getEnergyRemovedFromEnvironment());
+	ASSERTTRUE(outputs.tankHeatContent_kJ == hpwh.getTankHeatContent_kJ());
+	for (int t = 0; t < HPWH::STEP_TCOUPLES; t++) {
+		ASSERTTRUE(outputs.simTcouples_C[t] == hpwh.getNthSimTcouple(t + 1, HPWH::STEP_TCOUPLES));
+	}
+}
+
+void testSameAsGetters(string modelName) {
+	HPWH hpwh;
+	HPWH::StepOutputs outputs;
+	ASSERTTRUE(getHPWHObject(hpwh, modelName) == 0);
+	ASSERTTRUE(hpwh.getStepOutputs(outputs) == 0);
+	checkSameAsGetters(hpwh, outputs);
+	for (long i = 0; i < minutesToRun; i++) {
+		ASSERTTRUE(runStep(hpwh, i) == 0);
+		ASSERTTRUE(hpwh.getStepOutputs(outputs) == 0);
+		checkSameAsGetters(hpwh, outputs);
+	}
+}
+
+void testRunOneStepOverload(string modelName) {
+	HPWH hpwh, reference;
+	HPWH::StepOutputs outputs;
+	ASSERTTRUE(getHPWHObject(hpwh, modelName) == 0);
+	ASSERTTRUE(getHPWHObject(reference, modelName) == 0);
+	for (long i = 0; i < minutesToRun; i++) {
+		ASSERTTRUE(hpwh.runOneStep(allSchedules[0][i], GAL_TO_L(allSchedules[1][i]), allSchedules[2][i], allSchedules[3][i],
+			static_cast<HPWH::DRMODES>(int(allSchedules[4][i])), outputs) == 0);
+		ASSERTTRUE(runStep(reference, i) == 0);
+		checkSameAsGetters(reference, outputs);
+	}
+}
+
+void testNotReady() {
+	// nothing to report before a model is set up
+	HPWH hpwh;
+	HPWH::StepOutputs outputs;
+	ASSERTTRUE(hpwh.getStepOutputs(outputs) == HPWH::HPWH_ABORT);
+}
@@ -0,0 +1,116 @@
+/*unit test for the HPWHSurrogate reduced order model
+ *
+ *
+ *
+ */
+#include "HPWH.hh"
+#include "HPWHSurrogate.hh"
+#include "testUtilityFcts.cc"
+
+#include <iostream>
+#include <string>
+
+
+using std::cout;
+using std::string;
+
+const string modelName = "AOSmithHPTU80";
+
+void testReadWriteRoundTrip(std::shared_ptr<const HPWHSurrogate::Model> model, const string &fileName);
+void testEnergyBalance(std::shared_ptr<const HPWHSurrogate::Model> model);
+void testLockedOut(std::shared_ptr<const HPWHSurrogate::Model> model);
+void testAccuracy(std::shared_ptr<const HPWHSurrogate::Model> model);
+
+int main(int argc, char *argv[])
+{
+	std::shared_ptr<HPWHSurrogate::Model> model = std::make_shared<HPWHSurrogate::Model>();
+	ASSERTTRUE(model->fit([](HPWH &hpwh) { return getHPWHObject(hpwh, modelName); }) == 0);
+	ASSERTTRUE(model->getNumHeatSources() == 3);
+
+	// the saved model goes to the build directory when it is given
+	testReadWriteRoundTrip(model, (argc > 1) ? argv[1] : "testSurrogate.surrogate");
+	testEnergyBalance(model);
+	testLockedOut(model);
+	testAccuracy(model);
+
+	//Made it through the gauntlet
+	return 0;
+}
+
+// a day of draws: a shower in the morning, dishes, and a bath at night
+double drawAt(int minute) {
+	if (minute >= 420 && minute < 430) return 8.;
+	if (minute >= 1140 && minute < 1145) return 6.;
+	if (minute >= 1260 && minute < 1275) return 10.;
+	return 0.;
+}
+
+void testReadWriteRoundTrip(std::shared_ptr<const HPWHSurrogate::Model> model, const string &fileName) {
+	ASSERTTRUE(model->writeFile(fileName) == 0);
+	std::shared_ptr<HPWHSurrogate::Model> read = std::make_shared<HPWHSurrogate::Model>();
+	ASSERTTRUE(read->readFile(fileName) == 0);
+	ASSERTTRUE(read->readFile("noSuchDirectory/noSuchFile.surrogate") == HPWH::HPWH_ABORT);
+
+	HPWHSurrogate a(model), b(read);
+	for (int i = 0; i < 2 * 1440; i++) {
+		a.runOneStep(15., drawAt(i % 1440), 20., 20., HPWH::DR_ALLOW);
+		b.runOneStep(15., drawAt(i % 1440), 20., 20., HPWH::DR_ALLOW);
+		ASSERTTRUE(a.getEnergyInput() == b.getEnergyInput());
+		ASSERTTRUE(a.getAverageTankTemp() == b.getAverageTankTemp());
+	}
+}
+
+void testEnergyBalance(std::shared_ptr<const HPWHSurrogate::Model> model) {
+	HPWH hpwh;
+	getHPWHObject(hpwh, modelName);
+	HPWHSurrogate surrogate(model);
+	const double capacity_kJperC = hpwh.getTankSize(HPWH::UNITS_L) * HPWH::DENSITYWATER_kgperL * HPWH::CPWATER_kJperkgC;
+	double startT_C = surrogate.getAverageTankTemp();
+	double balance_kJ = 0.;
+	for (int i = 0; i < 1440; i++) {
+		double draw_L = drawAt(i);
+		ASSERTTRUE(surrogate.runOneStep(15., draw_L, 20., 20., HPWH::DR_ALLOW) == 0);
+		for (int s = 0; s < model->getNumHeatSources(); s++) {
+			balance_kJ += KWH_TO_KJ(surrogate.getNthHeatSourceEnergyOutput(s));
+		}
+		balance_kJ -= KWH_TO_KJ(surrogate.getStandbyLosses());
+		if (draw_L > 0.) {
+			balance_kJ -= draw_L * HPWH::DENSITYWATER_kgperL * HPWH::CPWATER_kJperkgC * (surrogate.getOutletTemp() - 15.);
+		}
+	}
+	ASSERTTRUE(cmpd(startT_C + balance_kJ / capacity_kJperC, surrogate.getAverageTankTemp()));
+}
+
+void testLockedOut(std::shared_ptr<const HPWHSurrogate::Model> model) {
+	HPWHSurrogate surrogate(model);
+	const HPWH::DRMODES lockOutAll = static_cast<HPWH::DRMODES>(HPWH::DR_LOC | HPWH::DR_LOR);
+	for (int i = 0; i < 1440; i++) {
+		ASSERTTRUE(surrogate.runOneStep(15., drawAt(i), 20., 20., lockOutAll) == 0);
+		ASSERTTRUE(surrogate.getEnergyInput() == 0.);
+	}
+	ASSERTTRUE(surrogate.getAverageTankTemp() < surrogate.getSetpoint() - 10.);
+}
+
+void testAccuracy(std::shared_ptr<const HPWHSurrogate::Model> model) {
+	// the 24 hour DOE test was not used in the fit
+	std::vector<schedule> allSchedules;
+	long minutesToRun;
+	double newSetpoint;
+	ASSERTTRUE(readTestSchedules("testDOE_24hr50", allSchedules, minutesToRun, newSetpoint) == 0);
+
+	HPWH hpwh;
+	getHPWHObject(hpwh, modelName);
+	HPWHSurrogate surrogate(model);
+	double full_kWh = 0., reduced_kWh = 0.;
+	for (long i = 0; i < minutesToRun; i++) {
+		HPWH::DRMODES DRstatus = static_cast<HPWH::DRMODES>(int(allSchedules[4][i]));
+		double draw_L = GAL_TO_L(allSchedules[1][i]);
+		hpwh.runOneStep(allSchedules[0][i], draw_L, allSchedules[2][i], allSchedules[3][i], DRstatus);
+		surrogate.runOneStep(allSchedules[0][i], draw_L, allSchedules[2][i], allSchedules[3][i], DRstatus);
+		for (int s = 0; s < hpwh.getNumHeatSources(); s++) {
+			full_kWh += hpwh.getNthHeatSourceEnergyInput(s);
+		}
+		reduced_kWh += surrogate.getEnergyInput();
+	}
+	ASSERTTRUE(fabs(reduced_kWh - full_kWh) < 0.1 * full_kWh);
+}
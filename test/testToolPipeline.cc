@@ -0,0 +1,521 @@
+/*The test tool as a three stage pipeline: a reader thread turns the schedules into the inputs
+ * of each minute, a simulation thread runs them, and a writer thread formats the csv rows.  The
+ * stages are joined by bounded single producer, single consumer ring buffers, so formatting
+ * overlaps the simulation instead of following each step.  The arguments and output are the
+ * same as testTool's, and each stage's throughput and the time it stalled on its neighbours
+ * are reported at the end.
+ *
+ * A schedule is read as its default and its entries, which are sorted by minute, later
+ * entries winning as in readSchedule, and expanded a minute at a time.  Schedules are not
+ * always in order of minute, so a file is read whole before its first minute is known, but the
+ * schedules are never held a value per minute.
+ */
+#include "HPWH.hh"
+#include "testUtilityFcts.cc"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+using std::cout;
+using std::string;
+using std::ifstream;
+
+// a bounded lock free queue for one producer thread and one consumer thread.  Each side keeps
+// its own index on its own cache line and a copy of the other's, refreshed only when the
+// queue looks full or empty
+template <typename T>
+class SpscRing {
+public:
+	explicit SpscRing(size_t capacityPow2) : slots(capacityPow2), mask(capacityPow2 - 1) {}
+
+	bool tryPush(const T &item) {
+		size_t tail = tailIndex.load(std::memory_order_relaxed);
+		if (tail - cachedHead == slots.size()) {
+			cachedHead = headIndex.load(std::memory_order_acquire);
+			if (tail - cachedHead == slots.size()) {
+				return false;
+			}
+		}
+		slots[tail & mask] = item;
+		tailIndex.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool tryPop(T &item) {
+		size_t head = headIndex.load(std::memory_order_relaxed);
+		if (head == cachedTail) {
+			cachedTail = tailIndex.load(std::memory_order_acquire);
+			if (head == cachedTail) {
+				return false;
+			}
+		}
+		item = slots[head & mask];
+		headIndex.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	std::vector<T> slots;
+	size_t mask;
+	alignas(64) std::atomic<size_t> headIndex{ 0 };  // the consumer's
+	size_t cachedTail = 0;
+	alignas(64) std::atomic<size_t> tailIndex{ 0 };  // the producer's
+	size_t cachedHead = 0;
+};
+
+struct StageStats {
+	const char *name;
+	long items = 0;
+	double seconds = 0.;
+	double stallSeconds = 0.;  // waiting for input, or for room for output
+};
+
+// push or pop, waiting while the ring is full or empty.  False if another stage failed meanwhile
+template <typename T>
+bool pushWait(SpscRing<T> &ring, const T &item, StageStats &stats, const std::atomic<bool> &failed) {
+	if (ring.tryPush(item)) {
+		return true;
+	}
+	benchClock::time_point start = benchClock::now();
+	while (!ring.tryPush(item)) {
+		if (failed) {
+			return false;
+		}
+		std::this_thread::yield();
+	}
+	stats.stallSeconds += secondsSince(start);
+	return true;
+}
+
+template <typename T>
+bool popWait(SpscRing<T> &ring, T &item, StageStats &stats, const std::atomic<bool> &failed) {
+	if (ring.tryPop(item)) {
+		return true;
+	}
+	benchClock::time_point start = benchClock::now();
+	while (!ring.tryPop(item)) {
+		if (failed) {
+			return false;
+		}
+		std::this_thread::yield();
+	}
+	stats.stallSeconds += secondsSince(start);
+	return true;
+}
+
+// one schedule file, read as readSchedule reads it but kept as its default and entries
+class ScheduleStream {
+public:
+	bool exists = false;
+
+	bool open(const string &fileName) {
+		name = fileName;
+		file.open(fileName.c_str());
+		cout << "Opening " << fileName << '\n';
+		exists = file.is_open();
+		return exists;
+	}
+
+	// reads the file, returns false with a message if it is not a schedule
+	bool read(long minutesOfTest, string &error) {
+		string snippet, line, minORhr;
+		file >> snippet >> defaultValue;
+		if (snippet != "default") {
+			error = "First line of " + name + " must specify default\n";
+			return false;
+		}
+		std::getline(file, line);
+		std::getline(file, line);
+		std::stringstream ss(line);
+		ss >> minORhr;
+		if (minORhr.empty()) {
+			return true;
+		}
+		minutesPerEntry = (tolower(minORhr.at(0)) == 'h') ? 60 : 1;
+
+		int index;
+		char c;
+		double value;
+		while (file >> index >> c >> value) {
+			if (index >= minutesOfTest) {
+				error = "In " + name + " the input file has more minutes than the test was defined with\n";
+				return false;
+			}
+			entries.push_back(std::make_pair((long)index, value));
+		}
+		// in order of minute, the last of any repeats winning
+		std::stable_sort(entries.begin(), entries.end(),
+			[](const std::pair<long, double> &a, const std::pair<long, double> &b) { return a.first < b.first; });
+		return true;
+	}
+
+	// the value of each minute in turn
+	double next() {
+		long entry = minute / minutesPerEntry;
+		while (nextEntry < entries.size() && entries[nextEntry].first <= entry) {
+			if (entries[nextEntry].first == entry) {
+				current = entries[nextEntry].second;
+				currentEntry = entry;
+			}
+			nextEntry++;
+		}
+		minute++;
+		return (currentEntry == entry) ? current : defaultValue;
+	}
+
+private:
+	string name;
+	ifstream file;
+	double defaultValue = 0.;
+	int minutesPerEntry = 1;
+	std::vector<std::pair<long, double> > entries;
+	size_t nextEntry = 0;
+	long minute = 0;
+	long currentEntry = -1;
+	double current = 0.;
+};
+
+// what the reader hands the simulation
+struct StepInput {
+	double inletT, draw, ambientT, evaporatorT, DR, setpoint;
+};
+
+// what the simulation hands the writer, the values of a testTool csv row
+struct StepRow {
+	int minute;
+	int DRstatus;
+	double airTemp, setpoint, inletT, draw;
+	HPWH::StepOutputs outputs;
+};
+
+int main(int argc, char *argv[])
+{
+	HPWH hpwh;
+	HPWH::MODELS model;
+	const double EBALTHRESHOLD = 0.005;
+	const int nTestTCouples = HPWH::STEP_TCOUPLES;
+	const size_t RING_STEPS = 4096;
+
+	string testDirectory, fileToOpen, var1, input1, input2, input3, inputFile, outputDirectory;
+	double testVal, newSetpoint, airTemp, inletH, newTankSize, tot_limit;
+	long minutesToRun;
+	bool HPWH_doTempDepress;
+	int doInvMix, doCondu;
+
+	cout << "Testing HPWHsim version " << HPWH::getVersion() << "\n";
+	if (argc < 5 || argc > 6 || string(argv[1]) == "?" || string(argv[1]) == "help") {
+		cout << "Standard usage: \"testToolPipeline [model spec type Preset/File] [model spec Name] [testName] [output directory] [airtemp override F (optional)]\"\n";
+		exit(1);
+	}
+	input1 = argv[1];
+	input2 = argv[2];
+	input3 = argv[3];
+	outputDirectory = argv[4];
+	if (argc == 6) {
+		airTemp = std::stoi(argv[5]);
+		HPWH_doTempDepress = true;
+	}
+	else {
+		airTemp = 0;
+		HPWH_doTempDepress = false;
+	}
+	testDirectory = input3;
+
+	// Parse the model
+	newSetpoint = 0;
+	if (input1 == "Preset") {
+		if (getHPWHObject(hpwh, input2) == HPWH::HPWH_ABORT) {
+			cout << "Error, preset model did not initialize.\n";
+			exit(1);
+		}
+		model = static_cast<HPWH::MODELS> (hpwh.getHPWHModel());
+		if (model == HPWH::MODELS_Sanden80 || model == HPWH::MODELS_Sanden40) {
+			newSetpoint = (149 - 32) / 1.8;
+		}
+	}
+	else {
+		inputFile = input2 + ".txt";
+		if (hpwh.HPWHinit_file(inputFile) != 0) exit(1);
+	}
+	hpwh.setMaxTempDepression(4);
+	hpwh.setDoTempDepression(HPWH_doTempDepress);
+
+	// Read the test control file
+	fileToOpen = testDirectory + "/" + "testInfo.txt";
+	ifstream controlFile(fileToOpen.c_str());
+	if (!controlFile.is_open()) {
+		cout << "Could not open control file " << fileToOpen << "\n";
+		exit(1);
+	}
+	minutesToRun = 0;
+	newSetpoint = 0;
+	inletH = 0;
+	newTankSize = 0;
+	tot_limit = 0;
+	doInvMix = 1;
+	doCondu = 1;
+	cout << "Running: " << input2 << ", " << input1 << ", " << input3 << "\n";
+	while (controlFile >> var1 >> testVal) {
+		if (var1 == "setpoint") newSetpoint = testVal;
+		else if (var1 == "length_of_test") minutesToRun = (int)testVal;
+		else if (var1 == "doInversionMixing") doInvMix = (testVal > 0.0) ? 1 : 0;
+		else if (var1 == "doConduction") doCondu = (testVal > 0.0) ? 1 : 0;
+		else if (var1 == "inletH") inletH = testVal;
+		else if (var1 == "tanksize") newTankSize = testVal;
+		else if (var1 == "tot_limit") tot_limit = testVal;
+		else cout << var1 << " in testInfo.txt is an unrecogized key.\n";
+	}
+	if (minutesToRun == 0) {
+		cout << "Error, must record length_of_test in testInfo.txt file\n";
+		exit(1);
+	}
+
+	// the schedules, setpoint optional
+	const char *scheduleNames[] = { "inletT", "draw", "ambientT", "evaporatorT", "DR", "setpoint" };
+	std::vector<ScheduleStream> schedules(6);
+	for (int s = 0; s < 6; s++) {
+		if (!schedules[s].open(testDirectory + "/" + scheduleNames[s] + "schedule.csv") && s != 5) {
+			cout << "readSchedule returns an error on " << scheduleNames[s] << " schedule!\n";
+			exit(1);
+		}
+	}
+	bool setpointSchedule = schedules[5].exists;
+
+	// ----------------------Open the Output Files and Print the Header---------------------------- //
+	bool yearly = minutesToRun > 500000.;
+	bool writeRows = minutesToRun < 500000.;  // as testTool, neither at exactly 500000
+	FILE *outputFile = NULL;
+	if (!yearly) {
+		fileToOpen = outputDirectory + "/" + input3 + "_" + input1 + "_" + input2 + ".csv";
+		if (fopen_s(&outputFile, fileToOpen.c_str(), "w+") != 0) {
+			cout << "Could not open output file " << fileToOpen << "\n";
+			exit(1);
+		}
+		hpwh.WriteCSVHeading(outputFile, "minutes,Ta,Tsetpoint,inletT,draw,", nTestTCouples, 0);
+	}
+
+	// ------------------------------------- Simulate --------------------------------------- //
+	cout << "Now Simulating " << minutesToRun << " Minutes of the Test\n";
+	SpscRing<StepInput> inputRing(RING_STEPS);
+	SpscRing<StepRow> rowRing(RING_STEPS);
+	std::atomic<bool> failed(false);
+	string readError, simError;
+	StageStats readerStats, simStats, writerStats;
+	readerStats.name = "reader";
+	simStats.name = "simulation";
+	writerStats.name = "writer";
+	double cumHeatIn[3] = { 0,0,0 };
+	double cumHeatOut[3] = { 0,0,0 };
+
+	std::thread reader([&]() {
+		benchClock::time_point start = benchClock::now();
+		for (int s = 0; s < 6 && !failed; s++) {
+			if (schedules[s].exists && !schedules[s].read(minutesToRun, readError)) {
+				failed = true;
+			}
+		}
+		for (long i = 0; i < minutesToRun && !failed; i++) {
+			StepInput in;
+			in.inletT = schedules[0].next();
+			in.draw = schedules[1].next();
+			in.ambientT = schedules[2].next();
+			in.evaporatorT = schedules[3].next();
+			in.DR = schedules[4].next();
+			in.setpoint = setpointSchedule ? schedules[5].next() : 0.;
+			if (!pushWait(inputRing, in, readerStats, failed)) {
+				break;
+			}
+			readerStats.items++;
+		}
+		readerStats.seconds = secondsSince(start);
+	});
+
+	std::thread simulation([&]() {
+		benchClock::time_point start = benchClock::now();
+		for (long i = 0; i < minutesToRun; i++) {
+			StepInput in;
+			if (!popWait(inputRing, in, simStats, failed)) {
+				break;
+			}
+
+			// set up as testTool does once the first setpoint is known
+			if (i == 0) {
+				int outputCode = 0;
+				if (doInvMix == 0) {
+					outputCode += hpwh.setDoInversionMixing(false);
+				}
+				if (doCondu == 0) {
+					outputCode += hpwh.setDoConduction(false);
+				}
+				if (newSetpoint > 0) {
+					hpwh.setSetpoint(setpointSchedule ? in.setpoint : newSetpoint); //expect this to fail sometimes
+					hpwh.resetTankToSetpoint();
+				}
+				if (inletH > 0) {
+					outputCode += hpwh.setInletByFraction(inletH);
+				}
+				if (newTankSize > 0) {
+					hpwh.setTankSize(newTankSize, HPWH::UNITS_GAL);
+				}
+				if (tot_limit > 0) {
+					outputCode += hpwh.setTimerLimitTOT(tot_limit);
+				}
+				if (outputCode != 0) {
+					simError = "Control file testInfo.txt has unsettable specifics in it. \n";
+					failed = true;
+					break;
+				}
+			}
+
+			double airTemp2 = HPWH_doTempDepress ? F_TO_C(airTemp) : in.ambientT;
+			double tankHCStart = hpwh.getTankHeatContent_kJ();
+			HPWH::DRMODES drStatus = static_cast<HPWH::DRMODES>(int(in.DR));
+
+			// Change setpoint if there is a setpoint schedule.
+			if (setpointSchedule && !hpwh.isSetpointFixed()) {
+				hpwh.setSetpoint(in.setpoint); //expect this to fail sometimes
+			}
+
+			// Mix down for yearly tests with large compressors
+			if (hpwh.getHPWHModel() >= 210 && yearly) {
+				if (hpwh.getSetpoint() <= 125.) {
+					in.draw *= (125. - in.inletT) / (hpwh.getTankNodeTemp(hpwh.getNumNodes() - 1, HPWH::UNITS_F) - in.inletT);
+				}
+			}
+
+			int stepResult = hpwh.runOneStep(in.inletT, GAL_TO_L(in.draw), airTemp2, in.evaporatorT, drStatus,
+				1. * GAL_TO_L(in.draw), in.inletT, NULL);
+
+			// Check energy balance accounting.
+			double hpwhElect = 0;
+			for (int iHS = 0; iHS < hpwh.getNumHeatSources(); iHS++) {
+				hpwhElect += hpwh.getNthHeatSourceEnergyInput(iHS, HPWH::UNITS_KJ);
+			}
+			double hpwhqHW = GAL_TO_L(in.draw) * (hpwh.getOutletTemp() - in.inletT) * HPWH::DENSITYWATER_kgperL * HPWH::CPWATER_kJperkgC;
+			double qBal = hpwh.getEnergyRemovedFromEnvironment(HPWH::UNITS_KJ) - hpwh.getStandbyLosses(HPWH::UNITS_KJ)
+				+ hpwhElect - hpwhqHW - (hpwh.getTankHeatContent_kJ() - tankHCStart);
+			double fBal = fabs(qBal) / std::max(tankHCStart, 1.);
+			if (fBal > EBALTHRESHOLD) {
+				cout << "WARNING: On minute " << i << " HPWH has an energy balance error " << qBal << "kJ, " << 100 * fBal << "%" << "\n";
+			}
+			for (int iHS = 0; iHS < hpwh.getNumHeatSources(); iHS++) {
+				if (hpwh.getNthHeatSourceRunTime(iHS) > 1) {
+					cout << "WARNING: On minute " << i << " heat source " << iHS << " ran for " << hpwh.getNthHeatSourceRunTime(iHS) << "minutes" << "\n";
+				}
+			}
+
+			if (!writeRows) {
+				for (int iHS = 0; iHS < hpwh.getNumHeatSources(); iHS++) {
+					cumHeatIn[iHS] += hpwh.getNthHeatSourceEnergyInput(iHS, HPWH::UNITS_KWH)*1000.;
+					cumHeatOut[iHS] += hpwh.getNthHeatSourceEnergyOutput(iHS, HPWH::UNITS_KWH)*1000.;
+				}
+				simStats.items++;
+				continue;
+			}
+
+			// Recording, the writer formats it
+			StepRow row;
+			row.minute = (int)i;
+			row.airTemp = HPWH_doTempDepress ? hpwh.getLocationTemp_C() : airTemp2;
+			row.setpoint = hpwh.getSetpoint();
+			row.inletT = in.inletT;
+			row.draw = in.draw;
+			row.DRstatus = drStatus;
+			if (stepResult != 0) {
+				// a failed step may stop before it takes the DR status
+				HPWH::SimState state;
+				hpwh.getSimState(state);
+				row.DRstatus = state.prevDRstatus;
+			}
+			if (hpwh.getStepOutputs(row.outputs) != 0) {
+				simError = "The model has too many heat sources or too few nodes for the pipeline.\n";
+				failed = true;
+				break;
+			}
+			if (!pushWait(rowRing, row, simStats, failed)) {
+				break;
+			}
+			simStats.items++;
+		}
+		simStats.seconds = secondsSince(start);
+	});
+
+	std::thread writer([&]() {
+		benchClock::time_point start = benchClock::now();
+		std::vector<char> buffer(1 << 16);
+		size_t used = 0;
+		for (long i = 0; i < minutesToRun && writeRows; i++) {
+			StepRow row;
+			if (!popWait(rowRing, row, writerStats, failed)) {
+				break;
+			}
+			// the preamble testTool builds with std::to_string, then HPWH::WriteCSVRow's columns
+			char *out = buffer.data() + used;
+			char *end = buffer.data() + buffer.size();
+			out += snprintf(out, end - out, "%d, %f, %f, %f, %f, %i", row.minute, row.airTemp, row.setpoint, row.inletT, row.draw,
+				row.DRstatus);
+			for (int iHS = 0; iHS < row.outputs.numHeatSources; iHS++) {
+				out += snprintf(out, end - out, ",%0.2f,%0.2f", row.outputs.heatSourceEnergyInput_kWh[iHS] * 1000.,
+					row.outputs.heatSourceEnergyOutput_kWh[iHS] * 1000.);
+			}
+			for (int iTC = 0; iTC < nTestTCouples; iTC++) {
+				out += snprintf(out, end - out, ",%0.2f", row.outputs.simTcouples_C[iTC]);
+			}
+			*out++ = '\n';
+			used = out - buffer.data();
+			if (buffer.size() - used < 1024) {
+				fwrite(buffer.data(), 1, used, outputFile);
+				used = 0;
+			}
+			writerStats.items++;
+		}
+		if (used > 0) {
+			fwrite(buffer.data(), 1, used, outputFile);
+		}
+		writerStats.seconds = secondsSince(start);
+	});
+
+	reader.join();
+	simulation.join();
+	writer.join();
+	cout << readError << simError;
+
+	if (yearly && !failed) {
+		fileToOpen = outputDirectory + "/DHW_YRLY.csv";
+		FILE *yearOutFile;
+		if (fopen_s(&yearOutFile, fileToOpen.c_str(), "a+") != 0) {
+			cout << "Could not open output file " << fileToOpen << "\n";
+			exit(1);
+		}
+		string firstCol = input3 + "," + input1 + "," + input2;
+		fprintf(yearOutFile, "%s", firstCol.c_str());
+		double totalIn = 0, totalOut = 0;
+		for (int iHS = 0; iHS < 3; iHS++) {
+			fprintf(yearOutFile, ",%0.0f,%0.0f", cumHeatIn[iHS], cumHeatOut[iHS]);
+			totalIn += cumHeatIn[iHS];
+			totalOut += cumHeatOut[iHS];
+		}
+		fprintf(yearOutFile, ",%0.0f,%0.0f", totalIn, totalOut);
+		for (int iHS = 0; iHS < 3; iHS++) {
+			fprintf(yearOutFile, ",%0.2f", cumHeatOut[iHS] / cumHeatIn[iHS]);
+		}
+		fprintf(yearOutFile, ",%0.2f", totalOut / totalIn);
+		fprintf(yearOutFile, "\n");
+		fclose(yearOutFile);
+	}
+	if (outputFile != NULL) {
+		fclose(outputFile);
+	}
+
+	printf("stage,steps,seconds,stepsPerSecond,stalledSeconds\n");
+	for (const StageStats *stats : { &readerStats, &simStats, &writerStats }) {
+		printf("%s,%ld,%.4f,%.0f,%.4f\n", stats->name, stats->items, stats->seconds,
+			(stats->seconds > 0.) ? stats->items / stats->seconds : 0., stats->stallSeconds);
+	}
+	return failed ? 1 : 0;
+}
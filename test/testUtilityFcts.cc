@@ -10,10 +10,17 @@
  */
 #include "HPWH.hh"
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <string> 
+#include <chrono>
 
 using std::cout;
 using std::string;
+using std::ifstream;
+
+typedef std::vector<double> schedule;
+typedef std::chrono::steady_clock benchClock;
 
 #define F_TO_C(T) ((T-32.0)*5.0/9.0)
 #define C_TO_F(T) (((9.0/5.0)*T) + 32.0)
@@ -35,166 +42,26 @@ bool relcmpd(double A, double B, double epsilon = 0.00001) {
 	return fabs(A - B) < (epsilon *(fabs(A) < fabs(B) ? fabs(B) : fabs(A)));
 }
 
+//Wall time in seconds since start, for the bench tools
+double secondsSince(benchClock::time_point start) {
+	return std::chrono::duration<double>(benchClock::now() - start).count();
+}
+
 HPWH::MODELS mapStringToPreset(string modelName) {
 
 	HPWH::MODELS hpwhModel;
+	const HPWH::PresetInfo *preset = HPWH::findPreset(modelName);
 
-	if(modelName == "Voltex60" || modelName == "AOSmithPHPT60") {
-		hpwhModel = HPWH::MODELS_AOSmithPHPT60;
-	}
-	else if (modelName == "Voltex80" || modelName == "AOSmith80") {
-		hpwhModel = HPWH::MODELS_AOSmithPHPT80;
-	}
-	else if (modelName == "GEred" || modelName == "GE") {
-		hpwhModel = HPWH::MODELS_GE2012;
-	}
-	else if (modelName == "SandenGAU" || modelName == "Sanden80" || modelName == "SandenGen3") {
-		hpwhModel = HPWH::MODELS_Sanden80;
-	}
-	else if (modelName == "Sanden120") {
-		hpwhModel = HPWH::MODELS_Sanden120;
-	}
-	else if (modelName == "SandenGES" || modelName == "Sanden40") {
-		hpwhModel = HPWH::MODELS_Sanden40;
-	}
-	else if (modelName == "AOSmithHPTU50") {
-		hpwhModel = HPWH::MODELS_AOSmithHPTU50;
-	}
-	else if (modelName == "AOSmithHPTU66") {
-		hpwhModel = HPWH::MODELS_AOSmithHPTU66;
-	}
-	else if (modelName == "AOSmithHPTU80") {
-		hpwhModel = HPWH::MODELS_AOSmithHPTU80;
-	}
-	else if (modelName == "AOSmithHPTU80DR") {
-		hpwhModel = HPWH::MODELS_AOSmithHPTU80_DR;
-	}
-	else if (modelName == "GE502014STDMode" || modelName == "GE2014STDMode") {
-		hpwhModel = HPWH::MODELS_GE2014STDMode;
-	}
-	else if (modelName == "GE502014" || modelName == "GE2014") {
-		hpwhModel = HPWH::MODELS_GE2014;
-	}
-	else if (modelName == "GE802014") {
-		hpwhModel = HPWH::MODELS_GE2014_80DR;
-	}
-	else if (modelName == "RheemHB50") {
-		hpwhModel = HPWH::MODELS_RheemHB50;
-	}
-	else if (modelName == "Stiebel220e" || modelName == "Stiebel220E") {
-		hpwhModel = HPWH::MODELS_Stiebel220E;
-	}
-	else if (modelName == "Generic1") {
-		hpwhModel = HPWH::MODELS_Generic1;
-	}
-	else if (modelName == "Generic2") {
-		hpwhModel = HPWH::MODELS_Generic2;
-	}
-	else if (modelName == "Generic3") {
-		hpwhModel = HPWH::MODELS_Generic3;
+	if (preset != NULL) {
+		hpwhModel = preset->model;
 	}
 	else if (modelName == "custom") {
 		hpwhModel = HPWH::MODELS_CustomFile;
 	}
-	else if (modelName == "restankRealistic") {
-		hpwhModel = HPWH::MODELS_restankRealistic;
-	}
-	else if (modelName == "StorageTank") {
-		hpwhModel = HPWH::MODELS_StorageTank;
-	}
-	else if (modelName == "BWC2020_65") {
-		hpwhModel = HPWH::MODELS_BWC2020_65;
-	}
-	// New Rheems
-	else if (modelName == "Rheem2020Prem40") {
-		hpwhModel = HPWH::MODELS_Rheem2020Prem40;
-	}
-	else if (modelName == "Rheem2020Prem50") {
-		hpwhModel = HPWH::MODELS_Rheem2020Prem50;
-	}
-	else if (modelName == "Rheem2020Prem65") {
-		hpwhModel = HPWH::MODELS_Rheem2020Prem65;
-	}
-	else if (modelName == "Rheem2020Prem80") {
-		hpwhModel = HPWH::MODELS_Rheem2020Prem80;
-	}
-	else if (modelName == "Rheem2020Build40") {
-		hpwhModel = HPWH::MODELS_Rheem2020Build40;
-	}
-	else if (modelName == "Rheem2020Build50") {
-		hpwhModel = HPWH::MODELS_Rheem2020Build50;
-	}
-	else if (modelName == "Rheem2020Build65") {
-		hpwhModel = HPWH::MODELS_Rheem2020Build65;
-	}
-	else if (modelName == "Rheem2020Build80") {
-		hpwhModel = HPWH::MODELS_Rheem2020Build80;
-	}
-	// Large HPWH's
-	else if (modelName == "AOSmithCAHP120") {
-		hpwhModel = HPWH::MODELS_AOSmithCAHP120;
-	}
-	else if (modelName == "ColmacCxV_5_SP") {
-		hpwhModel = HPWH::MODELS_ColmacCxV_5_SP;
-	}
-	else if (modelName == "ColmacCxA_10_SP") {
-		hpwhModel = HPWH::MODELS_ColmacCxA_10_SP;
-	}
-	else if (modelName == "ColmacCxA_15_SP") {
-		hpwhModel = HPWH::MODELS_ColmacCxA_15_SP;
-	}
-	else if (modelName == "ColmacCxA_20_SP") {
-		hpwhModel = HPWH::MODELS_ColmacCxA_20_SP;
-	}
-	else if (modelName == "ColmacCxA_25_SP") {
-		hpwhModel = HPWH::MODELS_ColmacCxA_25_SP;
-	}
-	else if (modelName == "ColmacCxA_30_SP") {
-		hpwhModel = HPWH::MODELS_ColmacCxA_30_SP;
-	}
-	else if (modelName == "NyleC25A_SP") {
-		hpwhModel = HPWH::MODELS_NyleC25A_SP;
-	}
-	else if (modelName == "NyleC90A_SP") {
-		hpwhModel = HPWH::MODELS_NyleC90A_SP;
-	}
-	else if (modelName == "NyleC185A_SP") {
-		hpwhModel = HPWH::MODELS_NyleC185A_SP;
-	}
-	else if (modelName == "NyleC250A_SP") {
-		hpwhModel = HPWH::MODELS_NyleC250A_SP;
-	}
-	else if (modelName == "NyleC90A_C_SP") {
-		hpwhModel = HPWH::MODELS_NyleC90A_C_SP;
-	}
-	else if (modelName == "NyleC185A_C_SP") {
-		hpwhModel = HPWH::MODELS_NyleC185A_C_SP;
-	}
-	else if (modelName == "NyleC250A_C_SP") {
-		hpwhModel = HPWH::MODELS_NyleC250A_C_SP;
-	}
-	// Stack in a couple scalable models
-	else if (modelName == "TamScalable_SP") {
+	// Stack in a couple scalable models, scaled in getHPWHObject
+	else if (modelName == "TamScalable_SP_2X" || modelName == "TamScalable_SP_Half") {
 		hpwhModel = HPWH::MODELS_TamScalable_SP;
 	}
-	else if (modelName == "TamScalable_SP_2X") {
-		hpwhModel = HPWH::MODELS_TamScalable_SP;
-	}
-	else if (modelName == "TamScalable_SP_Half") {
-		hpwhModel = HPWH::MODELS_TamScalable_SP;
-	}
-	else if (modelName == "AWHSTier3Generic40") {
-		hpwhModel = HPWH::MODELS_AWHSTier3Generic40;
-	}
-	else if (modelName == "AWHSTier3Generic50") {
-		hpwhModel = HPWH::MODELS_AWHSTier3Generic50;
-	}
-	else if (modelName == "AWHSTier3Generic65") {
-		hpwhModel = HPWH::MODELS_AWHSTier3Generic65;
-	}
-	else if (modelName == "AWHSTier3Generic80") {
-		hpwhModel = HPWH::MODELS_AWHSTier3Generic80;
-	}
 	else { 
 		hpwhModel = HPWH::MODELS_basicIntegrated;
 		cout << "Couldn't find model " << modelName << ".  Exiting...\n";
@@ -220,4 +87,104 @@ int getHPWHObject(HPWH &hpwh, string modelName) {
 		hpwh.setResistanceCapacity(15.); // Reset resistance elements in kW
 	}
 	return returnVal;
-}
\ No newline at end of file
+}
+
+// this function reads the named schedule into the provided array
+int readSchedule(schedule &scheduleArray, string scheduleFileName, long minutesOfTest) {
+  int minuteHrTmp;
+  bool hourInput;
+  string line, snippet, s, minORhr;
+  double valTmp;
+  ifstream inputFile(scheduleFileName.c_str());
+  //open the schedule file provided
+  cout << "Opening " << scheduleFileName << '\n';
+
+  if(!inputFile.is_open()) {
+    return 1;
+  }
+
+  inputFile >> snippet >> valTmp;
+  // cout << "snippet " << snippet << " valTmp"<< valTmp<<'\n';
+
+  if(snippet != "default") {
+    cout << "First line of " << scheduleFileName << " must specify default\n";
+    return 1;
+  }
+  // cout << valTmp << " minutes = " << minutesOfTest << "\n";
+
+  // Fill with the default value
+  scheduleArray.assign(minutesOfTest, valTmp);
+
+  // Burn the first two lines
+  std::getline(inputFile, line);
+  std::getline(inputFile, line);
+
+  std::stringstream ss(line); // Will parse with a stringstream
+  // Grab the first token, which is the minute or hour marker
+  ss >> minORhr;
+  if (minORhr.empty() ) { // If nothing left in the file
+	  return 0;
+  }
+  hourInput = tolower(minORhr.at(0)) == 'h';
+  char c; // to eat the commas nom nom
+  // Read all the exceptions to the default value
+  while (inputFile >> minuteHrTmp >> c >> valTmp) {
+
+		if (minuteHrTmp >= (int)scheduleArray.size()) {
+			cout << "In " << scheduleFileName << " the input file has more minutes than the test was defined with\n";
+			return 1;
+		}
+		// Update the value
+		if (!hourInput) {
+			scheduleArray[minuteHrTmp] = valTmp;
+		}
+		else if (hourInput) {
+			for (int j = minuteHrTmp * 60; j < (minuteHrTmp+1) * 60; j++) {
+				scheduleArray[j] = valTmp;
+				//cout << "minute " << j-(minuteHrTmp) * 60 << " of hour" << (minuteHrTmp)<<"\n";
+			}
+		}
+  }
+
+  inputFile.close();
+
+  return 0;
+
+}
+
+// this function reads testInfo.txt and the inletT, draw, ambientT, evaporatorT, DR and
+// (optional) setpoint schedules of a test directory, in that order
+int readTestSchedules(string testDirectory, std::vector<schedule> &allSchedules, long &minutesToRun, double &newSetpoint) {
+	const char *scheduleNames[6] = { "inletT", "draw", "ambientT", "evaporatorT", "DR", "setpoint" };
+	string var;
+	double testVal;
+
+	ifstream controlFile((testDirectory + "/testInfo.txt").c_str());
+	if (!controlFile.is_open()) {
+		cout << "Could not open control file " << testDirectory << "/testInfo.txt\n";
+		return 1;
+	}
+	minutesToRun = 0;
+	newSetpoint = 0.;
+	while (controlFile >> var >> testVal) {
+		if (var == "setpoint") {
+			newSetpoint = testVal;
+		}
+		else if (var == "length_of_test") {
+			minutesToRun = (long)testVal;
+		}
+	}
+	if (minutesToRun == 0) {
+		cout << "Error, must record length_of_test in testInfo.txt file\n";
+		return 1;
+	}
+
+	allSchedules.assign(6, schedule());
+	for (int i = 0; i < 6; i++) {
+		if (readSchedule(allSchedules[i], testDirectory + "/" + scheduleNames[i] + "schedule.csv", minutesToRun) != 0 && i < 5) {
+			cout << "readSchedule returns an error on " << scheduleNames[i] << " schedule!\n";
+			return 1;
+		}
+	}
+	return 0;
+}